@@ -0,0 +1,35 @@
+// libFuzzer target for PkgReader::parse, which indexes untrusted workshop
+// packages: every accepted entry must lie inside the input, and nothing
+// may read past it (AddressSanitizer catches that part).
+#include "universal-wallpaper/pkg_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string version;
+    std::vector<PkgReader::Entry> entries;
+    if (!PkgReader::parse(data, size, version, entries)) {
+        if (!entries.empty()) abort();
+        return 0;
+    }
+    
+    const unsigned char* end = data + size;
+    if (version.compare(0, 4, "PKGV") != 0) abort();
+    for (const auto& entry : entries) {
+        const auto* name = reinterpret_cast<const unsigned char*>(entry.name.data());
+        if (name < data || name + entry.name.size() > end) abort();
+        if (entry.data < data || entry.size > static_cast<size_t>(end - entry.data)) abort();
+        
+        // Touch both ends, as a reader of the entry would
+        if (entry.size > 0) {
+            volatile unsigned char first = entry.data[0];
+            volatile unsigned char last = entry.data[entry.size - 1];
+            (void)first;
+            (void)last;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "spectrum_fft.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Forward declaration for PulseAudio types
+struct pa_threaded_mainloop;
+struct pa_context;
+struct pa_stream;
+
+// Spectrum of what the default sink plays, for audio-reactive effects.
+// Records the sink's monitor source downmixed to mono at a low sample
+// rate; the analysis runs on the PulseAudio mainloop thread, and band
+// levels reach the render loop through a lock-free single-producer ring
+// plus a wakeup fd. Nothing is recorded between stop() and start().
+class AudioAnalyzer {
+public:
+    static constexpr int kBands = 16;
+    
+    struct Levels {
+        std::array<float, kBands> bands{};  // 0..1, low to high frequencies
+        float level = 0.0f;                 // Overall loudness, 0..1
+    };
+    
+    AudioAnalyzer();
+    ~AudioAnalyzer();
+    
+    AudioAnalyzer(const AudioAnalyzer&) = delete;
+    AudioAnalyzer& operator=(const AudioAnalyzer&) = delete;
+    
+    bool start();
+    void stop();
+    bool is_running() const { return mainloop_ != nullptr; }
+    
+    // Readable when new levels were published; drained by poll_levels()
+    int get_wakeup_fd() const { return wakeup_fd_; }
+    
+    // Latest published levels; false if none arrived since the last call
+    bool poll_levels(Levels& levels);
+    
+    void dump_stats() const;
+
+private:
+    static constexpr uint32_t kSampleRate = 11025;
+    static constexpr size_t kFftSize = 512;           // ~46 ms window
+    static constexpr size_t kHopSize = kSampleRate / 30;  // ~30 updates per second
+    static constexpr size_t kRingSize = 8;            // Power of two
+    
+    pa_threaded_mainloop* mainloop_ = nullptr;
+    pa_context* context_ = nullptr;
+    pa_stream* stream_ = nullptr;
+    int wakeup_fd_ = -1;
+    
+    // Analysis state; touched only on the mainloop thread
+    SpectrumFft fft_;
+    std::vector<float> history_;     // Last kFftSize samples, oldest first
+    size_t pending_samples_ = 0;     // Samples since the last analysis
+    std::vector<float> power_;
+    std::array<size_t, kBands + 1> band_edges_{};
+    Levels smoothed_;
+    
+    // A published Levels, read under a sequence lock: the consumer may copy
+    // a slot while the producer rewrites it, so the values are atomics and
+    // a torn copy is detected by the sequence and retried
+    struct RingSlot {
+        std::atomic<uint64_t> sequence{0};   // 2 * index + 1 while written, + 2 once published
+        std::array<std::atomic<float>, kBands + 1> values{};   // Bands, then the level
+    };
+    
+    // Single-producer, single-consumer ring of published levels
+    std::array<RingSlot, kRingSize> ring_;
+    std::atomic<uint64_t> ring_head_{0};   // Next slot the producer writes
+    uint64_t ring_tail_ = 0;               // Next slot the consumer reads
+    
+    std::atomic<uint64_t> frames_analyzed_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> analysis_ns_{0};
+    
+    void cleanup_pulseaudio();
+    void consume(const float* samples, size_t count);
+    void analyze();
+    void publish(const Levels& levels);
+    
+    // PulseAudio callbacks
+    static void context_state_callback(pa_context* context, void* userdata);
+    static void stream_state_callback(pa_stream* stream, void* userdata);
+    static void stream_read_callback(pa_stream* stream, size_t bytes, void* userdata);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+class MediaEngine;
+
+// Wallpaper audio while auto-muted. Instead of flipping mpv's mute, which
+// keeps the decoder, resampler and audio output running for nothing, the
+// audio track is dropped while muted and reattached with a fade-in once
+// the other audio stops. Engines are brought in line by sync(), which is
+// cheap to call every loop since engines ignore repeated settings.
+class AudioPipelineController {
+public:
+    AudioPipelineController();
+    
+    void set_muted(bool muted, std::chrono::steady_clock::time_point now);
+    bool is_muted() const { return muted_; }
+    
+    // Applies the current state to an engine that plays wallpaper audio
+    void sync(MediaEngine& engine, std::chrono::steady_clock::time_point now) const;
+    
+    // How soon sync() has a fade step to apply; duration::max() when idle
+    std::chrono::steady_clock::duration time_until_update(std::chrono::steady_clock::time_point now) const;
+    
+    // CPU use with and without the audio pipeline, for --stats
+    void dump_stats();
+
+private:
+    static constexpr std::chrono::milliseconds kFadeDuration{400};
+    static constexpr std::chrono::milliseconds kFadeStep{25};
+    
+    bool muted_ = false;
+    std::chrono::steady_clock::time_point fade_start_;
+    
+    // Process CPU time and wall time, split by whether audio was attached
+    struct Usage {
+        double cpu_seconds = 0.0;
+        double wall_seconds = 0.0;
+    };
+    Usage attached_;
+    Usage detached_;
+    double last_cpu_seconds_ = 0.0;
+    std::chrono::steady_clock::time_point last_sample_time_;
+    uint64_t detaches_ = 0;
+    
+    void account(std::chrono::steady_clock::time_point now);
+};
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+// An output given its own media with "-o NAME FILE"
+struct OutputBinding {
+    std::string output;
+    std::string media_path;
+};
+
 struct Config {
     std::string media_path;
     std::vector<std::string> outputs;
+    std::vector<OutputBinding> output_media;         // -o NAME FILE (per-output media)
     bool loop = true;
     bool hardware_decode = true;
     bool mute_audio = false;                         // Enable audio by default
@@ -25,6 +34,42 @@ struct Config {
     std::string screen_root;                         // -r, --screen-root (alias for output)
     std::string background_id;                       // -b, --bg (alias for media_path)
     
+    // Resource and diagnostics settings
+    int vram_budget_mb = 256;                        // --vram-budget (GPU resource pool limit)
+    int stats_interval = 0;                          // --stats (seconds between stats dumps, 0 = off)
+    bool dynamic_resolution = false;                 // --dynamic-resolution (shrink render target under load)
+    double min_render_scale = 0.5;                   // --min-render-scale (lower bound for dynamic resolution)
+    bool use_gles = false;                           // --gles (OpenGL ES context instead of desktop GL)
+    int cache_budget_mb = 256;                       // --cache-budget (memory-resident media, 0 = stream from disk)
+    bool seamless_loop = false;                      // --seamless-loop (pre-rolled handover, loop start cached)
+    bool prescale = true;                            // --no-prescale (downscale oversized video after decoding)
+    std::string engine = "auto";                     // --engine (auto, mpv, lavc)
+    std::string control_fifo;                        // --control-fifo (command FIFO for switching wallpapers)
+    int transition_ms = 500;                         // --transition (crossfade length when switching, 0 = cut)
+    std::string playlist;                            // --playlist (directory or list file for a slideshow)
+    int playlist_interval = 300;                     // --interval (seconds per playlist item)
+    bool shuffle = false;                            // --shuffle (random playlist order)
+    std::string playlist_order;                      // --order (name, mtime; default natural order)
+    std::string schedule;                            // --schedule (time-of-day manifest)
+    bool has_location = false;                       // --location given
+    double latitude = 0.0;                           // --location (degrees north, for sun times)
+    double longitude = 0.0;                          // --location (degrees east)
+    std::string effect;                              // --effect (fragment shader over the wallpaper)
+    int memory_budget_mb = 0;                        // --memory-budget (split across caches and pools, 0 = off)
+    bool thumbnail = false;                          // --thumbnail (write previews and exit)
+    std::vector<std::string> thumbnail_inputs;       // files given with --thumbnail
+    int thumbnail_size = 320;                        // --thumbnail-size (longest edge in pixels)
+    std::string thumbnail_dir;                       // --thumbnail-dir (default: cache dir)
+    std::string thumbnail_format = "webp";           // --thumbnail-format (webp, png)
+    int jobs = 0;                                    // --jobs (parallel thumbnail workers, 0 = cores)
+    bool span = false;                               // --span (one picture across all outputs)
+    int bezel_horizontal = 0;                        // --bezel (pixels between spanned columns)
+    int bezel_vertical = 0;                          // --bezel (pixels between spanned rows)
+    std::vector<std::pair<int, int>> headless_sizes; // --headless (offscreen outputs, no display server)
+    std::string record_path;                         // --record (write the first headless output to a file)
+    uint64_t frame_limit = 0;                        // --frames (quit after N headless frames, 0 = run on)
+    bool deterministic = false;                      // --deterministic (media steps 1/fps per headless frame)
+    
     static Config parse_args(int argc, char* argv[]);
     static void print_help(const char* program_name);
 };
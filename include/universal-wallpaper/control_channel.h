@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Line-based command FIFO for controlling a running instance, e.g.
+//   echo "switch /path/to/video.mp4" > $XDG_RUNTIME_DIR/wallpaper.fifo
+// The read end is non-blocking and polled by the main loop; a write end
+// is held open so writers closing the FIFO never signal end-of-file.
+class ControlChannel {
+public:
+    ControlChannel() = default;
+    ~ControlChannel();
+    
+    ControlChannel(const ControlChannel&) = delete;
+    ControlChannel& operator=(const ControlChannel&) = delete;
+    
+    // Creates the FIFO if missing; an existing non-FIFO path is an error
+    bool open(const std::string& path);
+    void close();
+    
+    bool is_open() const { return read_fd_ >= 0; }
+    int get_fd() const { return read_fd_; }
+    
+    // Complete lines received since the last call, without the newline
+    std::vector<std::string> read_commands();
+
+private:
+    // Longest accepted command; anything beyond is dropped with a warning
+    static constexpr size_t kMaxLineLength = 4096;
+    
+    std::string path_;
+    bool created_ = false;
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+    std::string buffer_;
+    bool discarding_ = false;   // Skipping to the end of an oversized line
+};
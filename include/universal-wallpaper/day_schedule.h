@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Time-of-day wallpapers. A manifest keys media to times of day, either
+// fixed ("07:30") or relative to the sun ("sunset-45"), and each entry
+// fades in over its transition window starting at its time. Sun times come
+// from the sunrise equation for the configured location, so nothing needs
+// the network. Between windows nothing changes and the loop sleeps.
+//
+// Manifest lines ('#' comments, media paths relative to the manifest):
+//   location 52.52 13.40       latitude, longitude (degrees north, east)
+//   transition 30              default window in minutes
+//   sunrise+15 morning.jpg 45  time, media and optionally its own window
+// Times are HH:MM or dawn, sunrise, noon, sunset, dusk with an optional
+// +/- offset in minutes; dawn and dusk are civil twilight.
+class DaySchedule {
+public:
+    using Clock = std::chrono::system_clock;
+    
+    enum class Action {
+        None,
+        Prepare,   // Open next() and hold it on its first frame
+        Switch     // current() changed; get_transition() says how to fade
+    };
+    
+    bool load(const std::string& path);
+    
+    // Overrides the manifest's location
+    void set_location(double latitude, double longitude);
+    
+    // Picks the entry for `now`; false if none applies (sun-relative
+    // entries only, during polar day or night)
+    bool start(Clock::time_point now);
+    
+    // What the caller should do now; Switch has already advanced current()
+    Action update(Clock::time_point now);
+    
+    const std::string& current() const { return entries_[current_entry_].media_path; }
+    const std::string& next() const;
+    
+    // Window of the current entry and how much of it has passed at `now`
+    void get_transition(Clock::time_point now, std::chrono::milliseconds& duration,
+                        std::chrono::milliseconds& elapsed) const;
+    
+    Clock::duration time_until_action(Clock::time_point now) const;
+    
+    // Call for every frame presented from the scheduled media; frames
+    // outside the windows are counted for --stats
+    void frame_presented(Clock::time_point now);
+    uint64_t get_frames_between_windows() const { return frames_between_windows_; }
+    
+    void dump_stats() const;
+
+private:
+    // Open the next entry this long before its window starts
+    static constexpr auto kPrepareLead = std::chrono::seconds(5);
+    
+    enum class Anchor { Clock, Dawn, Sunrise, Noon, Sunset, Dusk };
+    
+    struct Entry {
+        Anchor anchor = Anchor::Clock;
+        int minutes = 0;             // After midnight, or offset from the anchor
+        int window_minutes = -1;     // -1: the manifest default
+        std::string media_path;
+    };
+    
+    // An entry resolved to a start time on one day
+    struct Slot {
+        time_t start;
+        time_t window;
+        size_t entry;
+    };
+    
+    std::vector<Entry> entries_;
+    int default_window_minutes_ = 30;
+    bool has_location_ = false;
+    double latitude_ = 0.0;
+    double longitude_ = 0.0;
+    
+    // Slots from yesterday to tomorrow, sorted; rebuilt when the date changes
+    std::vector<Slot> slots_;
+    int resolved_day_ = -1;
+    
+    size_t current_entry_ = 0;
+    time_t current_start_ = 0;
+    time_t current_window_ = 0;
+    bool prepared_ = false;
+    
+    uint64_t switches_ = 0;
+    // The first frame after a window completes its fade and isn't counted
+    bool settled_ = false;
+    uint64_t frames_between_windows_ = 0;
+    
+    bool parse_time(const std::string& text, Entry& entry) const;
+    void resolve(time_t now);
+    // Index of the slot in effect at `now`, slots_.size() if none
+    size_t slot_at(time_t now) const;
+};
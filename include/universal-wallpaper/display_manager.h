@@ -2,7 +2,9 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <GL/gl.h>
 
 // Forward declarations
@@ -33,7 +35,18 @@ public:
     virtual void process_events() = 0;
     virtual bool should_quit() const = 0;
     
+    // Connection fd to poll for incoming events, or -1
+    virtual int get_event_fd() const = 0;
+    
+    // Fd of a capture clock to poll for process_capture(), or -1. Kept
+    // apart from the event fd: its ticks are no display events
+    virtual int get_capture_fd() const { return -1; }
+    virtual void process_capture() {}
+    
     virtual void set_renderer(Renderer* renderer) = 0;
+    
+    // Backend-specific --stats lines
+    virtual void dump_stats() const {}
 };
 
 class DisplayManager {
@@ -42,6 +55,9 @@ public:
     ~DisplayManager();
     
     bool initialize(bool force_x11 = false, bool force_wayland = false);
+    // Offscreen outputs of the given sizes instead of a display server
+    bool initialize_headless(const std::vector<std::pair<int, int>>& sizes, const std::string& record_path,
+                             int record_fps, uint64_t frame_limit, bool step_clock = false);
     void destroy();
     
     void set_renderer(Renderer* renderer);
@@ -55,10 +71,18 @@ public:
     
     void process_events();
     bool should_quit() const;
+    int get_event_fd() const;
     
+    void process_capture();
+    int get_capture_fd() const;
+    
+    void dump_stats() const;
+
 private:
     std::unique_ptr<DisplayBackend> backend_;
     
     std::unique_ptr<DisplayBackend> create_wayland_backend();
     std::unique_ptr<DisplayBackend> create_x11_backend();
+    
+    bool initialize_backend();
 };
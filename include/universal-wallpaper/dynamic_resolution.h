@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Shrinks the internal render target in steps while measured frame cost
+// exceeds the frame budget and grows it back once there is headroom again.
+// Growing requires a much longer quiet period than shrinking, so the scale
+// doesn't oscillate around the budget.
+class DynamicResolution {
+public:
+    DynamicResolution() = default;
+    
+    void configure(double frame_budget_ms, double min_scale);
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+    bool is_enabled() const { return enabled_; }
+    
+    // Feeds the cost of the last measured frame; returns true if the scale changed
+    bool update(double frame_cost_ms);
+    
+    double get_scale() const;
+    void apply(int width, int height, int& out_width, int& out_height) const;
+    
+    void dump_stats() const;
+
+private:
+    static constexpr double kScaleSteps[] = {1.0, 0.875, 0.75, 0.625, 0.5, 0.375, 0.25};
+    static constexpr int kNumSteps = sizeof(kScaleSteps) / sizeof(kScaleSteps[0]);
+    
+    // Thresholds relative to the frame budget
+    static constexpr double kShrinkThreshold = 0.90;
+    static constexpr double kGrowThreshold = 0.55;
+    static constexpr int kShrinkFrames = 6;
+    static constexpr int kGrowFrames = 90;
+    static constexpr int kCooldownFrames = 30;
+    
+    bool enabled_ = false;
+    double frame_budget_ms_ = 33.3;
+    int max_step_ = kNumSteps - 1;
+    int step_ = 0;
+    
+    double smoothed_cost_ms_ = 0.0;
+    bool has_samples_ = false;
+    int over_budget_frames_ = 0;
+    int under_budget_frames_ = 0;
+    int frames_since_change_ = 0;
+    
+    uint64_t downscales_ = 0;
+    uint64_t upscales_ = 0;
+};
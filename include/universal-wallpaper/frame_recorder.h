@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVStream;
+struct SwsContext;
+
+// Writes presented frames to disk (--record). The path picks the format:
+//   out.y4m           raw YUV 4:2:0 stream any encoder reads (also a FIFO)
+//   frames/%05d.png   numbered PNGs; without a pattern the file is
+//                     rewritten with the latest frame
+//   out.mp4, out.mkv  encoded by FFmpeg for the container
+// Frames are stamped at a constant rate, one per write_frame() call. PNG
+// and encoded files need FFmpeg at build time; Y4M has no dependencies.
+class FrameRecorder {
+public:
+    FrameRecorder(std::string path, int fps);
+    ~FrameRecorder();
+    
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+    
+    bool open(int width, int height);
+    void close();
+    
+    // pixels are tightly packed RGBA rows of the opened size, bottom row first
+    bool write_frame(const unsigned char* pixels);
+    
+    const std::string& get_path() const { return path_; }
+    uint64_t get_frames_written() const { return frames_written_; }
+
+private:
+    enum class Format { Y4m, Png, Encoded };
+    
+    std::string path_;
+    int fps_;
+    Format format_ = Format::Y4m;
+    int width_ = 0;
+    int height_ = 0;
+    uint64_t frames_written_ = 0;
+    
+    // Y4M
+    FILE* file_ = nullptr;
+    std::vector<unsigned char> planes_;
+    
+    // FFmpeg (PNG and encoded files)
+    AVFormatContext* muxer_ = nullptr;
+    AVStream* stream_ = nullptr;
+    AVCodecContext* encoder_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    SwsContext* sws_ = nullptr;
+    bool muxing_ = false;              // Header written, trailer due
+    
+    bool open_y4m();
+    bool write_y4m(const unsigned char* pixels);
+    bool open_ffmpeg();
+    bool write_ffmpeg(const unsigned char* pixels);
+    bool drain_encoder();
+    // path_ with a %d / %0Nd pattern replaced by the frame number
+    std::string sequence_path(uint64_t frame) const;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Decides what to do with the frame mpv has queued, based on the
+// NEXT_FRAME_INFO flags of the advanced render control API. Frames are
+// rendered at the video's own rate; repeats of the frame already on screen
+// are skipped, and --fps only caps how often a changed frame is presented.
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    enum class Action {
+        None,     // Nothing to present
+        Render,   // A changed frame is due now
+        Skip,     // Repeat of the displayed frame; consume it without rendering
+        Wait      // A frame is queued but not due yet (target time or fps cap)
+    };
+    
+    explicit FrameScheduler(int max_fps = 30);
+    
+    void set_max_fps(int max_fps);
+    
+    // `info_flags` are mpv_render_frame_info flags; `target_delay_us` is how
+    // far in the future mpv wants the frame shown (0 or negative: now)
+    Action decide(uint64_t info_flags, int64_t target_delay_us, Clock::time_point now);
+    
+    // Whether a forced redraw may happen now without exceeding the cap
+    bool can_render(Clock::time_point now) const;
+    
+    // Time until the deferred frame becomes due; Clock::duration::max() if none
+    Clock::duration time_until_due(Clock::time_point now) const;
+    Clock::duration time_until_can_render(Clock::time_point now) const;
+    
+    void frame_rendered(Clock::time_point now);
+    void frame_skipped();
+    
+    void dump_stats(double container_fps) const;
+
+private:
+    Clock::duration min_interval_;
+    Clock::time_point last_render_;
+    Clock::time_point due_time_;
+    bool waiting_ = false;
+    
+    uint64_t rendered_ = 0;
+    uint64_t skipped_duplicates_ = 0;
+    uint64_t deferred_ = 0;
+};
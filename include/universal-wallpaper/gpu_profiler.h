@@ -0,0 +1,119 @@
+#pragma once
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Fixed-size window of recent samples with percentile queries
+class RollingWindow {
+public:
+    explicit RollingWindow(size_t capacity = 240);
+    
+    void push(double value);
+    double percentile(double p) const;  // p in [0, 1]
+    double last() const { return last_; }
+    size_t size() const { return count_; }
+
+private:
+    std::vector<double> samples_;
+    size_t next_ = 0;
+    size_t count_ = 0;
+    double last_ = 0.0;
+};
+
+// Per-stage GPU and CPU timing. GPU time comes from GL_TIMESTAMP query pairs
+// kept in a ring and read back a few frames later, so collecting results
+// never waits on the GPU. Stages may nest; names like "composite:DP-1"
+// attribute cost to individual outputs.
+class GpuProfiler {
+public:
+    static constexpr int kQueryRingSize = 4;
+    
+    struct StageStats {
+        std::string name;
+        size_t gpu_samples = 0;
+        size_t cpu_samples = 0;
+        double gpu_p50 = 0.0, gpu_p95 = 0.0, gpu_p99 = 0.0;
+        double cpu_p50 = 0.0, cpu_p95 = 0.0, cpu_p99 = 0.0;
+        double gpu_last = 0.0, cpu_last = 0.0;
+    };
+    
+    GpuProfiler() = default;
+    ~GpuProfiler() = default;
+    
+    // Loads the query entry points; needs a current context. GLES contexts
+    // use EXT_disjoint_timer_query. Without timer query support only CPU
+    // timings are recorded.
+    bool initialize(bool gles = false);
+    void destroy();
+    
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+    bool is_enabled() const { return enabled_; }
+    bool has_gpu_timers() const { return gpu_timers_; }
+    
+    // Starts a new frame; stage costs are summed per frame from here on
+    void begin_frame() { frame_++; }
+    
+    void begin_stage(const std::string& name);
+    void end_stage(const std::string& name);
+    
+    // Reads back every query whose result is already available
+    void collect();
+    
+    std::vector<StageStats> get_stats() const;
+    bool get_stage_stats(const std::string& name, StageStats& out) const;
+    
+    // Cost of the frame before the current one, without presentation (which
+    // may wait on the compositor): per stage run in that frame the larger of
+    // its GPU and CPU time, with repeated runs added up. GPU time is that of
+    // the stage's latest fully read back frame.
+    double last_frame_cost_ms() const;
+    void dump_stats() const;
+
+private:
+    struct QuerySlot {
+        GLuint begin_query = 0;
+        GLuint end_query = 0;
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+    
+    struct Stage {
+        std::array<QuerySlot, kQueryRingSize> slots;
+        int write_index = 0;
+        bool open = false;
+        bool slot_active = false;
+        std::chrono::steady_clock::time_point cpu_start;
+        RollingWindow gpu_ms;
+        RollingWindow cpu_ms;
+        uint64_t dropped = 0;
+        
+        // Per-frame sums; a stage may run several times in one frame
+        uint64_t cpu_frame = 0;          // Frame of frame_cpu_ms
+        double frame_cpu_ms = 0.0;
+        uint64_t gpu_frame = 0;          // Frame being read back into gpu_frame_ms
+        double gpu_frame_ms = 0.0;
+        double gpu_last_frame_ms = 0.0;  // Sum of the last frame read back in full
+    };
+    
+    std::map<std::string, Stage> stages_;
+    uint64_t frame_ = 1;
+    bool enabled_ = false;
+    bool gpu_timers_ = false;
+    bool gles_ = false;
+    
+    PFNGLGENQUERIESPROC glGenQueries = nullptr;
+    PFNGLDELETEQUERIESPROC glDeleteQueries = nullptr;
+    PFNGLQUERYCOUNTERPROC glQueryCounter = nullptr;
+    PFNGLGETQUERYIVPROC glGetQueryiv = nullptr;
+    PFNGLGETQUERYOBJECTIVPROC glGetQueryObjectiv = nullptr;
+    PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v = nullptr;
+    
+    void read_slot(Stage& stage, QuerySlot& slot);
+    bool slot_available(const QuerySlot& slot);
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <GL/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+enum class GpuResourceKind {
+    Texture,
+    Framebuffer,   // Framebuffer object with a single color texture attachment
+    PixelBuffer    // Pixel buffer object; width holds the size in bytes, height is 1
+};
+
+// Two requests with equal keys are served by the same pooled resource, so
+// outputs asking for the same size and format share one texture/FBO.
+// `slot` separates users that need distinct resources of identical storage
+// (e.g. the two sides of a crossfade).
+struct GpuResourceKey {
+    GpuResourceKind kind = GpuResourceKind::Texture;
+    int width = 0;
+    int height = 0;
+    GLenum internal_format = 0;
+    uint32_t slot = 0;
+    
+    bool operator==(const GpuResourceKey& other) const {
+        return kind == other.kind && width == other.width && height == other.height &&
+               internal_format == other.internal_format && slot == other.slot;
+    }
+};
+
+struct GpuResourceKeyHash {
+    size_t operator()(const GpuResourceKey& key) const;
+};
+
+struct GpuResource {
+    GpuResourceKey key;
+    GLuint fbo = 0;
+    GLuint texture = 0;
+    GLuint buffer = 0;
+    size_t bytes = 0;
+};
+
+// LRU pool of GPU allocations bounded by a VRAM budget. The pool only does
+// bookkeeping; GL objects are created by the caller and destroyed through the
+// destroyer callback, which must run with the owning context current.
+class GpuResourcePool {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes_in_use = 0;
+        size_t peak_bytes = 0;
+        size_t budget_bytes = 0;
+    };
+    
+    using Destroyer = std::function<void(const GpuResource&)>;
+    
+    static constexpr size_t kDefaultBudgetBytes = 256u * 1024u * 1024u;
+    
+    explicit GpuResourcePool(size_t budget_bytes = kDefaultBudgetBytes);
+    
+    void set_destroyer(Destroyer destroyer);
+    void set_budget(size_t budget_bytes);
+    size_t get_budget() const { return budget_bytes_; }
+    
+    // Resources used since the last begin_frame() are never evicted
+    void begin_frame();
+    
+    // Returns the pooled resource for `key` and marks it most recently used,
+    // or nullptr on a miss
+    const GpuResource* acquire(const GpuResourceKey& key);
+    
+    // Adds a freshly created resource, evicting least recently used entries
+    // until it fits the budget
+    const GpuResource* insert(const GpuResource& resource);
+    
+    // Destroys a single entry (e.g. after its owner is torn down)
+    void release(const GpuResourceKey& key);
+    void clear();
+    
+    Stats get_stats() const;
+    void dump_stats() const;
+    
+    // Storage size of a resource as allocated by the driver
+    static size_t bytes_for(const GpuResourceKey& key);
+    static size_t bytes_per_pixel(GLenum internal_format);
+
+private:
+    struct Entry {
+        GpuResource resource;
+        uint64_t last_used_frame = 0;
+    };
+    
+    std::list<Entry> lru_;  // front = most recently used
+    std::unordered_map<GpuResourceKey, std::list<Entry>::iterator, GpuResourceKeyHash> index_;
+    Destroyer destroyer_;
+    
+    size_t budget_bytes_;
+    size_t bytes_in_use_ = 0;
+    size_t peak_bytes_ = 0;
+    uint64_t current_frame_ = 1;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    bool over_budget_warned_ = false;
+    
+    void evict_to_fit(size_t incoming_bytes);
+    void destroy_entry(std::list<Entry>::iterator it);
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "display_manager.h"
+#include "frame_recorder.h"
+#include <GL/gl.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Forward declaration
+class Renderer;
+
+// Display backend without a display server (--headless), for recording,
+// CI and render farms. Outputs are offscreen framebuffers of fixed sizes
+// on a surfaceless or pbuffer EGL context (Mesa llvmpipe works); each
+// present is read back into a small per-output ring of RGBA frames, and
+// the first output is optionally written out through a FrameRecorder.
+//
+// Recording and --frames run on an output clock at record_fps that starts
+// with the first present: each tick takes the first output's latest frame,
+// repeating it while nothing new is presented. Recordings therefore play
+// at the content's own speed, and stills and paused media still finish.
+//
+// A stepped clock (--deterministic) instead ticks on the first output's
+// next present once the previous tick was taken: each tick records that
+// frame and signals the capture fd, on which the caller steps the media
+// clock by one output frame and draws again.
+class HeadlessBackend : public DisplayBackend {
+public:
+    // frame_limit > 0 quits after that many ticks of the output clock
+    HeadlessBackend(std::vector<std::pair<int, int>> sizes, std::string record_path, int record_fps,
+                    uint64_t frame_limit, bool step_clock = false);
+    ~HeadlessBackend() override;
+    
+    bool initialize() override;
+    void destroy() override;
+    
+    std::vector<Monitor> get_monitors() override;
+    bool set_wallpaper(const std::string& monitor_name, GLuint texture, int width, int height) override;
+    bool set_wallpaper_all(GLuint texture, int width, int height) override;
+    
+    void* get_native_display() override;
+    const std::string& get_backend_name() const override;
+    
+    // No display connection, hence no events
+    void process_events() override {}
+    bool should_quit() const override;
+    int get_event_fd() const override { return -1; }
+    
+    // Writes the output clock's due ticks; a stepped clock waits for the
+    // next present instead
+    void process_capture() override;
+    // The output clock's timerfd (eventfd when stepped), -1 without
+    // --record or --frames
+    int get_capture_fd() const override { return clock_fd_; }
+    
+    void set_renderer(Renderer* renderer) override;
+    
+    void dump_stats() const override;
+    
+    // RGBA pixels (bottom row first) of an output's latest frame (age 0) or
+    // an earlier one; nullptr if the ring holds no such frame
+    const unsigned char* get_frame(const std::string& monitor_name, size_t age = 0) const;
+
+private:
+    static constexpr size_t kRingFrames = 3;
+    // Pool slots of the output framebuffers, clear of the media sessions'
+    static constexpr uint32_t kFramebufferSlotBase = 0x80000000u;
+    
+    struct Output {
+        Monitor monitor;
+        std::vector<std::vector<unsigned char>> ring;
+        uint64_t frames_presented = 0;
+    };
+    
+    std::vector<std::pair<int, int>> sizes_;
+    std::vector<Output> outputs_;
+    Renderer* renderer_ = nullptr;
+    
+    std::string record_path_;
+    int record_fps_;
+    std::unique_ptr<FrameRecorder> recorder_;
+    
+    uint64_t frame_limit_;
+    bool step_clock_;
+    bool tick_wanted_ = true;            // Stepped clock: the next present ticks
+    int clock_fd_ = -1;
+    uint64_t ticks_ = 0;
+    uint64_t frames_presented_ = 0;      // Over all outputs
+    uint64_t readback_ns_ = 0;
+    std::chrono::steady_clock::time_point first_present_time_;
+    std::chrono::steady_clock::time_point last_present_time_;
+    bool should_quit_ = false;
+    
+    static const std::string backend_name_;
+    
+    bool present(size_t index, GLuint texture);
+    void tick();
+};
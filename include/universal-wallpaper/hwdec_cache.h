@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+// Remembers which hardware decoder mpv ended up using for each codec,
+// profile and resolution class, so later starts can request that exact
+// API (or software decoding) instead of walking mpv's probe chain.
+// Stored under the user cache directory and discarded when the GPU driver
+// or kernel changes.
+class HwdecCache {
+public:
+    HwdecCache() = default;
+    
+    // `driver_id` identifies the GPU driver (GL vendor, renderer, version)
+    bool load(const std::string& driver_id);
+    // Merges the results recorded since load() into the file as it is now
+    bool save();
+    
+    // Known result for a stream: an mpv hwdec value such as "vaapi",
+    // "nvdec-copy" or "no"
+    bool lookup(const std::string& codec, const std::string& profile, int64_t width, int64_t height,
+                std::string& hwdec) const;
+    void record(const std::string& codec, const std::string& profile, int64_t width, int64_t height,
+                const std::string& hwdec);
+    
+    bool is_loaded() const { return !path_.empty(); }
+
+private:
+    static constexpr const char* kHeader = "# wallpaper-ne-linux hwdec cache v1";
+    
+    std::string path_;
+    std::string driver_id_;
+    std::map<std::string, std::string> entries_;
+    std::set<std::string> changed_;    // Keys recorded since load()
+    bool dirty_ = false;
+    
+    static std::string make_key(const std::string& codec, const std::string& profile, int64_t width, int64_t height);
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "media_engine.h"
+#include <GL/gl.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+class Renderer;
+
+// Minimal player for muted, looping, single-stream video: one decode thread
+// demuxes and decodes with libavformat/libavcodec into a small queue of
+// RGBA frames, and the render thread uploads the due frame through the
+// renderer's texture uploader. No audio, no demuxer cache, no scripting.
+class LavcEngine : public MediaEngine {
+public:
+    explicit LavcEngine(Renderer& renderer);
+    ~LavcEngine() override;
+    
+    // Whether a file is simple enough for this engine: a local file with one
+    // decodable video stream, not a still, no larger than kMaxWidth x kMaxHeight
+    static bool is_suitable(const std::string& media_path);
+    
+    const char* get_engine_name() const override { return "lavc"; }
+    
+    bool initialize(const std::string& media_path, bool hardware_decode = true,
+                    bool loop = true, bool mute_audio = true, double volume = 0.0,
+                    const std::string& additional_options = std::string()) override;
+    void destroy() override;
+    
+    bool create_render_context(void* (*get_proc_address)(void* ctx, const char* name),
+                               void* get_proc_address_ctx) override;
+    bool render_frame(int fbo, int width, int height) override;
+    void report_flip() override {}
+    
+    int get_wakeup_fd() const override { return wakeup_fd_; }
+    uint64_t update() override;
+    void process_events() override {}
+    
+    void get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const override;
+    int64_t get_time_us() const override;
+    bool skip_frame() override;
+    bool has_new_frame() const override;
+    void mark_frame_rendered() override {}
+    bool has_first_frame() const override { return decoded_frames_.load() > 0; }
+    
+    bool is_playing() const override { return playing_ && !paused_; }
+    bool has_video() const override { return video_width_ > 0; }
+    double get_duration() const override { return duration_; }
+    double get_position() const override { return position_; }
+    double get_container_fps() const override { return container_fps_; }
+    
+    void set_audio_enabled(bool) override {}  // No audio path
+    void set_volume_scale(double) override {}
+    void set_paused(bool paused) override;
+    void set_prescale_target(int width, int height, bool cover) override;
+    
+    // get_time_us() becomes the stepped time; frames are due against it
+    bool set_clock_step(int64_t step_us) override;
+    void step_clock() override;
+    bool has_stepped() const override;
+    
+    void dump_stats() const override;
+    void get_memory_usage(size_t& buffer_bytes, size_t& decoder_bytes) const override;
+
+private:
+    // Software decode of larger videos costs more than mpv's hardware path saves
+    static constexpr int kMaxWidth = 1920;
+    static constexpr int kMaxHeight = 1080;
+    static constexpr size_t kQueueSize = 3;
+    
+    struct Frame {
+        std::vector<unsigned char> pixels;   // RGBA, bottom row first
+        int width = 0;
+        int height = 0;
+        int64_t pts_us = 0;                  // on the looped timeline
+    };
+    
+    Renderer& renderer_;
+    int wakeup_fd_ = -1;
+    
+    // Decoder state, owned by the decode thread once it runs
+    AVFormatContext* format_ = nullptr;
+    AVCodecContext* codec_ = nullptr;
+    AVFrame* decoded_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    SwsContext* sws_ = nullptr;
+    int stream_index_ = -1;
+    double time_base_ = 0.0;
+    int64_t start_pts_ = 0;                  // Stream start, pts 0 of each pass
+    bool loop_ = true;
+    int64_t loop_offset_us_ = 0;
+    int64_t last_pts_us_ = 0;
+    int64_t frame_duration_us_ = 33333;
+    
+    std::thread decode_thread_;
+    std::atomic<bool> stop_{false};
+    
+    // Decoded frames waiting for presentation, plus recycled buffers
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_space_;
+    std::deque<Frame> queue_;
+    std::vector<std::vector<unsigned char>> free_buffers_;
+    
+    // Playback clock: get_time_us() of pts 0
+    int64_t clock_base_us_ = 0;
+    bool clock_started_ = false;
+    bool paused_ = false;
+    int64_t paused_at_us_ = 0;
+    int64_t clock_step_us_ = 0;
+    int64_t stepped_time_us_ = 0;
+    
+    GLuint texture_ = 0;
+    int video_width_ = 0;
+    int video_height_ = 0;
+    int output_width_ = 0;
+    int output_height_ = 0;
+    bool output_cover_ = false;
+    std::atomic<bool> playing_{false};
+    double duration_ = 0.0;
+    double position_ = 0.0;
+    double container_fps_ = 0.0;
+    
+    std::atomic<uint64_t> decoded_frames_{0};
+    uint64_t presented_frames_ = 0;
+    uint64_t dropped_frames_ = 0;
+    std::atomic<uint64_t> loops_{0};
+    
+    void decode_loop();
+    bool decode_next(Frame& frame);
+    bool rewind();
+    void recycle(Frame& frame);
+    void draw_texture(int width, int height);
+    void signal_wakeup();
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Pre-rolled loop boundaries (--seamless-loop). Even with the start of the
+// file cached, a looping engine seeks and flushes its decoder at the end,
+// and the first frame of the next pass comes late. Instead, shortly before
+// the end a second engine opens the same media and holds its first frame;
+// once the last frame of the pass has been shown for its duration, that
+// engine takes over and the first one is dropped. Decisions come from the
+// presented positions and the clock, like PlaylistScheduler's.
+class LoopHandover {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    enum class Action {
+        None,
+        Prepare,   // Open the media again and hold it on its first frame
+        Switch     // The pass is over; the prepared engine takes over
+    };
+    
+    // Call after every presented frame with the playback position and
+    // duration in seconds and the container frame rate (0 if unknown)
+    void frame_presented(double position, double duration, double fps, Clock::time_point now);
+    
+    // What the caller should do now
+    Action update(Clock::time_point now);
+    Clock::duration time_until_action(Clock::time_point now) const;
+    
+    // Whether the engine that just became current came from a handover, so
+    // the media continues rather than changes; call once per switch
+    bool take_handover();
+    
+    // Forget the pass in progress, e.g. when different media starts playing
+    void reset();
+    
+    uint64_t get_handovers() const { return handovers_; }
+    uint64_t get_missed() const { return missed_; }
+    
+    void dump_stats() const;
+
+private:
+    // Shorter loops restart from the demuxer cache instead: a second engine
+    // every few seconds costs more than the seek
+    static constexpr double kMinDuration = 5.0;
+    // Open the second engine this long before the end; a warm open is well
+    // under a second, and it holds a decoder meanwhile
+    static constexpr double kPrepareLead = 2.0;
+    // Positions this far behind the previous frame count as a restart
+    static constexpr double kRewindThreshold = 0.5;
+    
+    enum class State {
+        Playing,
+        PrepareDue,
+        Prepared,    // Second engine opening or holding its first frame
+        SwitchDue,   // Last frame shown, handover at switch_time_
+        Switched     // Handover requested, until take_handover()
+    };
+    
+    State state_ = State::Playing;
+    bool has_previous_ = false;
+    double last_position_ = 0.0;
+    Clock::time_point switch_time_;
+    
+    uint64_t handovers_ = 0;
+    uint64_t missed_ = 0;          // The engine looped by itself first
+};
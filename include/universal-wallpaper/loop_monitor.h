@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Measures the presentation gap at loop boundaries. A boundary is a
+// presented frame whose playback position jumped backwards; its gap is
+// compared with the ordinary frame-to-frame interval so hitches show up
+// in --stats.
+class LoopMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    LoopMonitor() = default;
+    
+    // Call after every presented frame with the playback position in seconds
+    void frame_presented(double position, Clock::time_point now);
+    
+    // Forget the previous frame, e.g. when different media starts playing
+    void reset() { has_previous_ = false; }
+    
+    uint64_t get_loops() const { return loops_; }
+    
+    void dump_stats() const;
+
+private:
+    // Positions this far behind the previous frame count as a restart
+    static constexpr double kRewindThreshold = 0.5;
+    
+    bool has_previous_ = false;
+    double last_position_ = 0.0;
+    Clock::time_point last_present_;
+    
+    uint64_t frames_ = 0;
+    double frame_interval_total_ms_ = 0.0;
+    uint64_t loops_ = 0;
+    double boundary_gap_total_ms_ = 0.0;
+    double boundary_gap_max_ms_ = 0.0;
+    double last_boundary_gap_ms_ = 0.0;
+};
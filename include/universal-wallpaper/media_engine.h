@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What the render loop needs from a media player. MPVWrapper is the full
+// implementation; LavcEngine is a lean decoder for simple silent loops.
+// Frame timing follows mpv's advanced render control: frames are reported
+// with mpv_render_frame_info flags and a target time in get_time_us() time.
+class MediaEngine {
+public:
+    virtual ~MediaEngine() = default;
+    
+    virtual const char* get_engine_name() const = 0;
+    
+    virtual bool initialize(const std::string& media_path, bool hardware_decode = true,
+                            bool loop = true, bool mute_audio = true, double volume = 0.0,
+                            const std::string& additional_options = std::string()) = 0;
+    virtual void destroy() = 0;
+    
+    // Rendering; get_proc_address_ctx is the Renderer
+    virtual bool create_render_context(void* (*get_proc_address)(void* ctx, const char* name),
+                                       void* get_proc_address_ctx) = 0;
+    virtual bool render_frame(int fbo, int width, int height) = 0;
+    virtual void report_flip() = 0;
+    
+    // Readable when the engine wants attention; drained by update()
+    virtual int get_wakeup_fd() const = 0;
+    virtual uint64_t update() = 0;
+    virtual void process_events() = 0;
+    
+    // Frame pacing
+    virtual void get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const = 0;
+    virtual int64_t get_time_us() const = 0;
+    virtual bool skip_frame() = 0;
+    virtual bool has_new_frame() const = 0;
+    virtual void mark_frame_rendered() = 0;
+    // Whether the media's first video frame is decoded and can be drawn;
+    // an engine being prepared for a switch is ready once this holds
+    virtual bool has_first_frame() const = 0;
+    
+    // State
+    virtual bool is_playing() const = 0;
+    virtual bool has_video() const = 0;
+    virtual double get_duration() const = 0;
+    virtual double get_position() const = 0;
+    virtual double get_container_fps() const = 0;
+    
+    // Control
+    // A disabled audio track takes the decoder and audio output down with
+    // it; the volume scale multiplies the configured volume, for fades
+    virtual void set_audio_enabled(bool enabled) = 0;
+    virtual void set_volume_scale(double scale) = 0;
+    virtual void set_paused(bool paused) = 0;
+    virtual void set_prescale_target(int width, int height, bool cover) = 0;
+    
+    // Frame-exact recording: the media clock stops following real time and
+    // moves ahead by step_us on each step_clock(); has_stepped() holds once
+    // the frame due after a step can be drawn. false if the engine can't.
+    virtual bool set_clock_step(int64_t step_us) {
+        (void)step_us;
+        return false;
+    }
+    virtual void step_clock() {}
+    virtual bool has_stepped() const { return true; }
+    
+    // Earliest internal deadline, so the caller's wait doesn't overshoot it
+    virtual std::chrono::steady_clock::duration time_until_deadline(std::chrono::steady_clock::time_point now) const {
+        (void)now;
+        return std::chrono::steady_clock::duration::max();
+    }
+    
+    // Memory held for media, for --stats: CPU-side buffers and an estimate
+    // of decoder surfaces in VRAM
+    virtual void get_memory_usage(size_t& buffer_bytes, size_t& decoder_bytes) const {
+        buffer_bytes = 0;
+        decoder_bytes = 0;
+    }
+    
+    virtual void dump_stats() const {}
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <mpv/client.h>
+#include <mpv/stream_cb.h>
+#include "pkg_reader.h"
+
+// Serves local media to mpv through a custom stream protocol instead of
+// mpv's file stream. Files that fit the cache budget are read from disk
+// once into a sealed memfd and every loop is served from memory; larger
+// files are streamed with pread() and posix_fadvise() read-ahead through a
+// bounded buffer. Entries of Wallpaper Engine packages are served straight
+// from the mapped package. Stream callbacks run on mpv's demuxer thread.
+class MediaIO {
+public:
+    static constexpr const char* kProtocol = "wnefile";
+    static constexpr const char* kPackageProtocol = "wnepkg";   // wnepkg://path#entry
+    
+    MediaIO() = default;
+    ~MediaIO();
+    
+    MediaIO(const MediaIO&) = delete;
+    MediaIO& operator=(const MediaIO&) = delete;
+    
+    // Total size of memory-resident files; 0 streams everything
+    void set_cache_budget(size_t bytes) { cache_budget_ = bytes; }
+    size_t get_resident_bytes() const;
+    
+    // Registers the protocol with mpv; call before loading media
+    bool register_protocol(mpv_handle* mpv);
+    
+    // Local paths become kProtocol URIs and packages ("file.pkg" or
+    // "file.pkg#entry") kPackageProtocol URIs, defaulting to the first video
+    // entry; URLs and missing files pass through
+    std::string wrap_path(const std::string& path);
+    
+    // Disk reads per loop of the media; logged by --stats
+    void dump_stats() const;
+
+private:
+    struct ResidentFile;
+    struct Stream;
+    
+    static constexpr size_t kReadChunk = 1024 * 1024;        // bytes per pread()
+    static constexpr size_t kReadAheadWindow = 8 * 1024 * 1024;
+    
+    size_t cache_budget_ = 0;
+    bool registered_ = false;
+    
+    // Resident files by path, shared by every open stream of that file
+    mutable std::mutex resident_mutex_;
+    std::map<std::string, std::shared_ptr<ResidentFile>> resident_;
+    size_t resident_bytes_ = 0;
+    
+    // Open packages by path; mappings stay alive while a stream uses them
+    std::mutex packages_mutex_;
+    std::map<std::string, std::shared_ptr<PkgReader>> packages_;
+    
+    std::atomic<uint64_t> disk_bytes_{0};
+    std::atomic<uint64_t> served_bytes_{0};
+    std::atomic<uint64_t> loops_{0};
+    std::atomic<uint64_t> disk_bytes_at_loop_{0};
+    std::atomic<uint64_t> last_loop_disk_bytes_{0};
+    
+    std::shared_ptr<ResidentFile> get_resident(const std::string& path, int fd, int64_t size);
+    std::shared_ptr<ResidentFile> load_resident(int fd, int64_t size);
+    std::shared_ptr<PkgReader> get_package(const std::string& path);
+    void count_loop();
+    
+    int open_stream(const char* uri, mpv_stream_cb_info* info);
+    int open_package_stream(const char* uri, mpv_stream_cb_info* info);
+    static void fill_callbacks(Stream* stream, mpv_stream_cb_info* info);
+    
+    static int on_open(void* user_data, char* uri, mpv_stream_cb_info* info);
+    static int on_open_package(void* user_data, char* uri, mpv_stream_cb_info* info);
+    static int64_t on_read(void* cookie, char* buffer, uint64_t bytes);
+    static int64_t on_seek(void* cookie, int64_t offset);
+    static int64_t on_size(void* cookie);
+    static void on_close(void* cookie);
+    static void on_cancel(void* cookie);
+};
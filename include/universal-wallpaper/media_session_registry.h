@@ -0,0 +1,93 @@
+#pragma once
+
+#include "frame_scheduler.h"
+#include "loop_handover.h"
+#include "loop_monitor.h"
+#include "wallpaper_switcher.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One playing wallpaper and everything that paces it. Outputs showing the
+// same media share a session: one decoder, one rendered frame per vsync.
+struct MediaSession {
+    // As WallpaperSwitcher's, plus whether the engine gets audio; only one
+    // session at a time does
+    using EngineFactory = std::function<std::unique_ptr<MediaEngine>(const std::string& media_path, bool audio)>;
+    using EngineAttach = std::function<bool(MediaEngine& engine, bool audio)>;
+    
+    // Engines are opened with the audio the session has at the time
+    MediaSession(Renderer& renderer, EngineFactory factory, EngineAttach attach, int max_fps)
+        : switcher(renderer, [this, factory](const std::string& path) { return factory(path, has_audio); },
+                   [this, attach](MediaEngine& engine) { return attach(engine, has_audio); }),
+          scheduler(max_fps) {}
+    
+    std::string key;
+    WallpaperSwitcher switcher;
+    FrameScheduler scheduler;
+    LoopMonitor loop_monitor;
+    LoopHandover loop_handover;
+    
+    // Bound output names ("ALL" for every output); the session's refcount
+    std::vector<std::string> outputs;
+    uint32_t framebuffer_slot = 0;
+    // Read by the switcher's open worker
+    std::atomic<bool> has_audio{false};
+    bool needs_redraw = true;
+};
+
+// Per-output media assignment. Sessions are keyed by canonical media path
+// plus playback options, created when the first output binds to them and
+// destroyed when the last one unbinds.
+class MediaSessionRegistry {
+public:
+    using EngineFactory = MediaSession::EngineFactory;
+    using EngineAttach = MediaSession::EngineAttach;
+    
+    MediaSessionRegistry(Renderer& renderer, EngineFactory factory, EngineAttach attach, std::string options,
+                         int max_fps, std::chrono::milliseconds transition_duration);
+    ~MediaSessionRegistry();
+    
+    MediaSessionRegistry(const MediaSessionRegistry&) = delete;
+    MediaSessionRegistry& operator=(const MediaSessionRegistry&) = delete;
+    
+    // Points an output at media_path, joining a session that already plays
+    // it; nullptr if the media can't be started
+    MediaSession* bind(const std::string& output, const std::string& media_path);
+    void unbind(const std::string& output);
+    
+    MediaSession* find_output(const std::string& output) const;
+    const std::vector<std::unique_ptr<MediaSession>>& get_sessions() const { return sessions_; }
+    
+    // Call after a session switched media, so sharing follows what it plays.
+    // A session that switched to media another one already plays keeps its
+    // own decoder until its outputs rebind: merging would retarget the
+    // session the playlist and schedule drive.
+    void refresh_key(MediaSession& session);
+    
+    void dump_stats() const;
+    
+    // Pool slot, relative to a session's framebuffer_slot, of the --effect pass
+    static constexpr uint32_t kEffectSlot = 3;
+
+private:
+    // Each session owns its render target slot, the switcher's two after it
+    // and the effect pass target
+    static constexpr uint32_t kSlotsPerSession = 4;
+    
+    Renderer& renderer_;
+    EngineFactory factory_;
+    EngineAttach attach_;
+    std::string options_;
+    int max_fps_;
+    std::chrono::milliseconds transition_duration_;
+    
+    std::vector<std::unique_ptr<MediaSession>> sessions_;
+    
+    std::string make_key(const std::string& media_path) const;
+    uint32_t free_framebuffer_slot() const;
+    void release(MediaSession* session);
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// One --memory-budget split across everything that holds media memory:
+// memory-resident media files, mpv's demuxer cache, hardware decoder
+// surfaces and the GPU resource pool. The rest is left to mpv's core, the
+// GL driver and the heap, which is trimmed after wallpapers are torn down.
+//
+// The media cache and demuxer shares are pools that every live engine
+// draws from. A switch keeps two engines alive until its crossfade ends
+// (the current one and the incoming or outgoing one), so an engine takes at
+// most half of each pool; further sessions get what is left. The shares go
+// back to the pools when the engine is destroyed.
+class MemoryBudget {
+public:
+    struct Split {
+        size_t media_cache_bytes = 0;     // MediaIO resident files
+        size_t demuxer_bytes = 0;         // demuxer-max-bytes (read ahead)
+        size_t demuxer_back_bytes = 0;    // demuxer-max-back-bytes (kept behind)
+        int hwdec_extra_frames = 4;       // hwdec-extra-frames
+        size_t vram_bytes = 0;            // GpuResourcePool
+    };
+    
+    // Process memory from /proc/self/smaps_rollup
+    struct Usage {
+        size_t rss_bytes = 0;
+        size_t anonymous_bytes = 0;
+        size_t shmem_bytes = 0;           // memfd-resident media lands here
+        size_t swap_bytes = 0;
+    };
+    
+    // One engine's part of the media cache and demuxer pools; returned
+    // when destroyed, so it must not outlive the budget
+    class EngineShare {
+    public:
+        ~EngineShare();
+        EngineShare(const EngineShare&) = delete;
+        EngineShare& operator=(const EngineShare&) = delete;
+        
+        size_t media_cache_bytes = 0;
+        size_t demuxer_bytes = 0;
+        size_t demuxer_back_bytes = 0;
+    
+    private:
+        friend class MemoryBudget;
+        explicit EngineShare(MemoryBudget& budget) : budget_(budget) {}
+        MemoryBudget& budget_;
+    };
+    
+    MemoryBudget() = default;
+    
+    void configure(size_t total_bytes);
+    bool is_enabled() const { return total_bytes_ > 0; }
+    const Split& get_split() const { return split_; }
+    
+    // Reserves an engine's share; thread-safe, engines are opened on workers
+    std::unique_ptr<EngineShare> reserve_engine_share();
+    
+    // Returns freed heap pages to the kernel
+    void trim();
+    
+    static bool read_usage(Usage& usage);
+    
+    // Logs process memory next to the per-component estimates
+    void dump_stats(size_t media_bytes, size_t decoder_bytes, size_t pool_bytes) const;
+
+private:
+    // Engines a switch keeps alive at once
+    static constexpr size_t kEnginesPerSwitch = 2;
+    
+    size_t total_bytes_ = 0;
+    Split split_;
+    
+    // Held by live engines, against the split's pools
+    std::mutex shares_mutex_;
+    size_t reserved_media_cache_bytes_ = 0;
+    size_t reserved_demuxer_bytes_ = 0;
+    size_t reserved_demuxer_back_bytes_ = 0;
+    size_t engine_shares_ = 0;
+    
+    void release_engine_share(const EngineShare& share);
+    
+    uint64_t trims_ = 0;
+    size_t trimmed_bytes_ = 0;
+};
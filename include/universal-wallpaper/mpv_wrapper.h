@@ -3,53 +3,263 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
+#include "media_io.h"
+#include "hwdec_cache.h"
+#include "media_engine.h"
+#include "memory_budget.h"
 
-class MPVWrapper {
+// Typed argument for asynchronous commands, passed to mpv as an mpv_node
+// so numbers and flags don't round-trip through strings
+struct MPVArg {
+    MPVArg(const char* value) : format(MPV_FORMAT_STRING), string(value) {}
+    MPVArg(std::string value) : format(MPV_FORMAT_STRING), string(std::move(value)) {}
+    MPVArg(int value) : format(MPV_FORMAT_INT64), integer(value) {}
+    MPVArg(int64_t value) : format(MPV_FORMAT_INT64), integer(value) {}
+    MPVArg(double value) : format(MPV_FORMAT_DOUBLE), number(value) {}
+    MPVArg(bool value) : format(MPV_FORMAT_FLAG), flag(value) {}
+    
+    mpv_format format;
+    std::string string;
+    int64_t integer = 0;
+    double number = 0.0;
+    bool flag = false;
+};
+
+class MPVWrapper : public MediaEngine {
 public:
+    // Completion of an asynchronous request: an mpv_error code (MPV_ERROR_SUCCESS,
+    // or kAsyncTimeout if no reply arrived in time) and, for commands, the
+    // result node. The node is only valid during the call.
+    using AsyncCallback = std::function<void(int error, const mpv_node* result)>;
+    static constexpr int kAsyncTimeout = MPV_ERROR_GENERIC;
+    static constexpr std::chrono::milliseconds kDefaultAsyncTimeout{5000};
+    
     MPVWrapper();
-    ~MPVWrapper();
+    ~MPVWrapper() override;
+    
+    const char* get_engine_name() const override { return "mpv"; }
     
     bool initialize(const std::string& media_path, bool hardware_decode = true, 
                    bool loop = true, bool mute_audio = true, double volume = 0.0,
-                   const std::string& additional_options = std::string());
+                   const std::string& additional_options = std::string()) override;
+    
+    void destroy() override;
+    
+    // Local files are read through MediaIO; files up to `bytes` in total
+    // stay memory resident. Set before initialize(); 0 streams everything.
+    void set_media_cache_budget(size_t bytes) { media_io_.set_cache_budget(bytes); }
+    const MediaIO& get_media_io() const { return media_io_; }
+    
+    // Keeps the start of a looping file in the demuxer cache so the seek
+    // back at EOF doesn't hit the file again. Set before initialize().
+    void set_seamless_loop(bool enabled) { seamless_loop_ = enabled; }
     
-    void destroy();
+    // Memory limits from --memory-budget; set before initialize(). A zero
+    // demuxer limit keeps mpv's defaults.
+    void set_demuxer_limits(size_t max_bytes, size_t max_back_bytes) {
+        demuxer_max_bytes_ = max_bytes;
+        demuxer_max_back_bytes_ = max_back_bytes;
+    }
+    void set_hwdec_extra_frames(int frames) { hwdec_extra_frames_ = frames; }
+    // Takes the media cache and demuxer limits from a --memory-budget share,
+    // held until the engine is destroyed. Set before initialize().
+    void set_memory_share(std::unique_ptr<MemoryBudget::EngineShare> share) {
+        set_media_cache_budget(share->media_cache_bytes);
+        set_demuxer_limits(share->demuxer_bytes, share->demuxer_back_bytes);
+        memory_share_ = std::move(share);
+    }
+    
+    // Videos larger than the target are downscaled by a filter right after
+    // the decoder (on the GPU for VA-API/NVDEC frames), so later stages move
+    // output-sized frames. `cover` keeps the short side at the target, for
+    // fill scaling. Re-evaluated when the video or decoder changes.
+    void set_prescale_enabled(bool enabled) { prescale_enabled_ = enabled; }
+    
+    void set_prescale_target(int width, int height, bool cover) override;
+    
+    // Hardware decoder results are cached per GPU driver; with a driver set
+    // before initialize(), known streams get their decoder without probing
+    void set_hwdec_driver(const std::string& driver_id) { hwdec_driver_ = driver_id; }
+    const std::string& get_hwdec_current() const { return hwdec_current_; }
     
     // Rendering
     bool create_render_context(void* (*get_proc_address)(void* ctx, const char* name), 
-                              void* get_proc_address_ctx);
+                              void* get_proc_address_ctx) override;
     void set_render_params(int width, int height, int fbo = 0);
-    bool render_frame(int fbo, int width, int height);
-    void report_flip();
+    bool render_frame(int fbo, int width, int height) override;
+    void report_flip() override;
+    
+    // Becomes readable whenever mpv wants attention: a render update or a
+    // queued client event. Poll it instead of sleeping on a timer.
+    int get_wakeup_fd() const override { return wakeup_fd_; }
+    
+    // Drains the wakeup fd and asks mpv what changed; returns the
+    // mpv_render_context_update() flags. MPV_RENDER_UPDATE_FRAME marks a
+    // new frame for has_new_frame().
+    uint64_t update() override;
+    
+    // Advanced render control: what the queued frame is (PRESENT, REPEAT,
+    // REDRAW) and when mpv wants it shown, in mpv_get_time_us() time.
+    // Without support every queued frame is reported as PRESENT, due now.
+    void get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const override;
+    int64_t get_time_us() const override;
+    
+    // Consumes the queued frame without rendering it
+    bool skip_frame() override;
     
     // Control
     void set_property(const std::string& name, const std::string& value);
-    void set_property_async(const std::string& name, const std::string& value);
     std::string get_property(const std::string& name) const;
     void command(const std::string& cmd);
     
+    // Non-blocking control. Requests return a request id (0 if mpv rejected
+    // them outright) and complete through the callback, which runs from
+    // process_events(). Timed-out commands are aborted.
+    uint64_t set_property_async(const std::string& name, const std::string& value,
+                                AsyncCallback callback = nullptr,
+                                std::chrono::milliseconds timeout = kDefaultAsyncTimeout);
+    uint64_t command_async(const std::vector<MPVArg>& args, AsyncCallback callback = nullptr,
+                           std::chrono::milliseconds timeout = kDefaultAsyncTimeout);
+    size_t get_pending_requests() const { return pending_requests_.size(); }
+    
+    // Time until the earliest pending request times out, so the caller's
+    // wait doesn't overshoot it; duration::max() if none are pending
+    std::chrono::steady_clock::duration time_until_request_timeout(std::chrono::steady_clock::time_point now) const;
+    std::chrono::steady_clock::duration time_until_deadline(std::chrono::steady_clock::time_point now) const override {
+        return time_until_request_timeout(now);
+    }
+    
+    // Asynchronous, so a busy mpv core can't stall the caller
+    void set_audio_enabled(bool enabled) override;
+    void set_volume_scale(double scale) override;
+    void set_paused(bool paused) override { set_property_async("pause", paused ? "yes" : "no"); }
+    
+    // Stepping keeps mpv paused and seeks exactly by the step; the frame
+    // is shown when playback restarts
+    bool set_clock_step(int64_t step_us) override;
+    void step_clock() override;
+    bool has_stepped() const override { return !step_pending_; }
+    
+    // Media I/O statistics
+    void dump_stats() const override { media_io_.dump_stats(); }
+    void get_memory_usage(size_t& buffer_bytes, size_t& decoder_bytes) const override;
+    
     // Event handling
     void set_wakeup_callback(std::function<void()> callback);
-    void process_events();
-    
-    // State
-    bool is_playing() const;
-    bool has_video() const;
-    double get_duration() const;
-    double get_position() const;
-    bool has_new_frame() const;  // Check if there's a new frame to render
-    void mark_frame_rendered();  // Mark that we've rendered the current frame
+    void process_events() override;
+    
+    // State, served from observed properties without calling into mpv;
+    // refreshed by process_events()
+    bool is_playing() const override;
+    bool has_video() const override;
+    double get_duration() const override;
+    double get_position() const override;
+    int64_t get_video_width() const;
+    int64_t get_video_height() const;
+    double get_container_fps() const override;
+    bool has_new_frame() const override;  // Check if there's a new frame to render
+    void mark_frame_rendered() override;  // Mark that we've rendered the current frame
+    // The first MPV_RENDER_UPDATE_FRAME after MPV_EVENT_VIDEO_RECONFIG; call
+    // process_events() before update() so the event is seen first
+    bool has_first_frame() const override { return first_frame_; }
 
     mpv_handle* get_handle() { return mpv_; }
     mpv_render_context* get_render_context() { return render_ctx_; }
 
 private:
+    // Typical reference frames held by a hardware decoder, for estimates
+    static constexpr int kEstimatedDecoderSurfaces = 8;
+    
     mpv_handle* mpv_ = nullptr;
     mpv_render_context* render_ctx_ = nullptr;
     std::function<void()> wakeup_callback_;
-    mutable bool has_new_frame_ = true;  // Track if we need to render a new frame
+    // Declared before media_io_, so it is returned after the cache is freed
+    std::unique_ptr<MemoryBudget::EngineShare> memory_share_;
+    MediaIO media_io_;
+    
+    // Written from mpv's threads, read by the render loop
+    std::atomic<bool> has_new_frame_{false};  // Track if we need to render a new frame
+    std::atomic<uint64_t> update_requests_{0};
+    int wakeup_fd_ = -1;
+    bool video_configured_ = false;
+    bool first_frame_ = false;
+    bool advanced_control_ = false;
+    bool seamless_loop_ = false;
+    int64_t clock_step_us_ = 0;
+    bool step_pending_ = false;
+    size_t demuxer_max_bytes_ = 0;
+    size_t demuxer_max_back_bytes_ = 0;
+    int hwdec_extra_frames_ = 4;
+    
+    // Audio as last requested; repeated settings are dropped
+    bool audio_enabled_ = false;
+    double volume_ = 0.0;
+    double volume_scale_ = 1.0;
+    
+    // Pre-scale state; touched only from the thread running process_events()
+    bool prescale_enabled_ = true;
+    int prescale_width_ = 0;
+    int prescale_height_ = 0;
+    bool prescale_cover_ = false;
+    bool prescale_dirty_ = false;
+    std::string prescale_filter_;
+    std::string hwdec_current_;
+    std::unordered_set<std::string> prescale_failed_;
+    
+    // Hardware decoder cache; the stream seen by the last on_preloaded hook
+    // is recorded once hwdec-current reports the decoder mpv settled on
+    HwdecCache hwdec_cache_;
+    std::string hwdec_driver_;
+    bool hwdec_pending_ = false;
+    bool hwdec_from_cache_ = false;
+    std::string stream_codec_;
+    std::string stream_profile_;
+    int64_t stream_width_ = 0;
+    int64_t stream_height_ = 0;
+    
+    // Last values reported through mpv_observe_property
+    struct PropertySnapshot {
+        std::atomic<bool> paused{false};
+        std::atomic<int64_t> width{0};
+        std::atomic<int64_t> height{0};
+        std::atomic<double> duration{0.0};
+        std::atomic<double> position{0.0};
+        std::atomic<double> container_fps{0.0};
+    };
+    PropertySnapshot properties_;
+    
+    struct PendingRequest {
+        AsyncCallback callback;
+        std::chrono::steady_clock::time_point deadline;
+        std::string description;
+        bool is_command;
+    };
+    std::unordered_map<uint64_t, PendingRequest> pending_requests_;
+    uint64_t next_request_id_ = 1;
+    
+    uint64_t track_request(AsyncCallback callback, std::chrono::milliseconds timeout,
+                           std::string description, bool is_command);
+    void complete_request(uint64_t id, int error, const mpv_node* result);
+    void expire_requests();
+    
+    void configure_seamless_loop(const std::string& media_path);
+    std::string choose_prescale_filter() const;
+    void update_prescale();
+    void select_hwdec();
+    void record_hwdec();
+    void observe_properties();
+    void handle_property_change(uint64_t id, const mpv_event_property* property);
+    
+    void signal_wakeup();
     
     static void on_mpv_events(void* ctx);
+    static void on_render_update(void* ctx);
 };
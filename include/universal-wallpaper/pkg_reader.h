@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a Wallpaper Engine package (scene.pkg). The file is
+// memory-mapped and entries point straight into the mapping, so nothing
+// is extracted or copied.
+//
+// Layout (little endian):
+//   u32 length, "PKGVxxxx" version
+//   u32 entry count
+//   per entry: u32 name length, name, u32 offset, u32 size
+//   entry data; offsets are relative to the end of the table
+class PkgReader {
+public:
+    struct Entry {
+        std::string_view name;
+        const unsigned char* data;
+        size_t size;
+    };
+    
+    PkgReader() = default;
+    ~PkgReader();
+    
+    PkgReader(const PkgReader&) = delete;
+    PkgReader& operator=(const PkgReader&) = delete;
+    
+    bool open(const std::string& path);
+    void close();
+    
+    const std::string& get_version() const { return version_; }
+    const std::vector<Entry>& get_entries() const { return entries_; }
+    const Entry* find(std::string_view name) const;
+    
+    // First entry with a video container extension, for packages opened
+    // without naming an entry
+    const Entry* find_first_video() const;
+    
+    // Validates and indexes a package image in one pass; every entry is
+    // bounds-checked against `size`. Safe on arbitrary input.
+    static bool parse(const unsigned char* data, size_t size, std::string& version, std::vector<Entry>& entries);
+    
+    static bool is_package_path(const std::string& path);
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string version_;
+    std::vector<Entry> entries_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+// Slideshow over a directory of media files or a playlist file (one path
+// per line, '#' comments, relative to the list). Each item plays for the
+// interval; ahead of every change the next file is read into the page
+// cache and, a little later, handed out for preparation so the switch
+// itself only swaps engines.
+class PlaylistScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    enum class Action {
+        None,
+        Prepare,   // Open the next item and hold it on its first frame
+        Switch     // The interval is over; the next item is now current
+    };
+    
+    // `order` is "name", "mtime" or empty for the natural order (file name
+    // for directories, listed order for playlist files)
+    bool load(const std::string& path, const std::string& order, bool shuffle);
+    
+    void set_interval(std::chrono::seconds interval) { interval_ = interval; }
+    
+    size_t size() const { return items_.size(); }
+    const std::string& current() const { return items_[order_[position_]]; }
+    const std::string& next() const;
+    
+    // Starts timing the current item
+    void start(Clock::time_point now);
+    
+    // What the caller should do now; Switch has already advanced current()
+    Action update(Clock::time_point now);
+    
+    // Moves to the next item immediately and restarts the interval
+    void skip(Clock::time_point now);
+    
+    Clock::duration time_until_action(Clock::time_point now) const;
+    
+    void dump_stats() const;
+
+private:
+    // Open the next item this long before its switch; long enough for a
+    // cold hwdec probe, short enough not to hold a second decoder for long
+    static constexpr auto kPrepareLead = std::chrono::seconds(5);
+    // Prefetch reads at most this much of the next file ahead of time
+    static constexpr size_t kPrefetchBytes = 64 * 1024 * 1024;
+    
+    std::vector<std::string> items_;
+    std::vector<size_t> order_;
+    std::vector<size_t> next_order_;   // Following pass, drawn ahead so next() is exact
+    size_t position_ = 0;
+    bool shuffle_ = false;
+    std::mt19937 random_{std::random_device{}()};
+    
+    std::chrono::seconds interval_{300};
+    Clock::time_point due_;
+    bool prepared_ = false;
+    
+    uint64_t switches_ = 0;
+    uint64_t prefetched_bytes_ = 0;
+    
+    bool load_directory(const std::string& path);
+    bool load_list(const std::string& path);
+    void advance(Clock::time_point now);
+    std::vector<size_t> shuffled(size_t last);
+    void prefetch(const std::string& media_path);
+    Clock::time_point prepare_time() const;
+};
@@ -5,8 +5,12 @@
 #include <GL/gl.h>
 #include <GL/glext.h>
 #include <wayland-egl.h>
-#include <map>
-#include <utility>
+#include "gpu_resource_pool.h"
+#include "gpu_profiler.h"
+#include "texture_uploader.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // OpenGL extension function declarations
 #ifndef GL_VERSION_3_0
@@ -28,6 +32,7 @@ typedef void (APIENTRY *PFNGLGETPROGRAMIVPROC)(GLuint program, GLenum pname, GLi
 typedef void (APIENTRY *PFNGLGETPROGRAMINFOLOGPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
 typedef void (APIENTRY *PFNGLUSEPROGRAMPROC)(GLuint program);
 typedef void (APIENTRY *PFNGLDELETEPROGRAMPROC)(GLuint program);
+typedef void (APIENTRY *PFNGLBINDATTRIBLOCATIONPROC)(GLuint program, GLuint index, const GLchar *name);
 
 // Additional OpenGL function typedefs for VAO and VBO
 typedef void (APIENTRY *PFNGLGENVERTEXARRAYSPROC)(GLsizei n, GLuint *arrays);
@@ -35,6 +40,7 @@ typedef void (APIENTRY *PFNGLBINDVERTEXARRAYPROC)(GLuint array);
 typedef void (APIENTRY *PFNGLGENBUFFERSPROC)(GLsizei n, GLuint *buffers);
 typedef void (APIENTRY *PFNGLBINDBUFFERPROC)(GLenum target, GLuint buffer);
 typedef void (APIENTRY *PFNGLBUFFERDATAPROC)(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void (APIENTRY *PFNGLDELETEBUFFERSPROC)(GLsizei n, const GLuint *buffers);
 typedef void (APIENTRY *PFNGLVERTEXATTRIBPOINTERPROC)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
 typedef void (APIENTRY *PFNGLENABLEVERTEXATTRIBARRAYPROC)(GLuint index);
 typedef GLint (APIENTRY *PFNGLGETUNIFORMLOCATIONPROC)(GLuint program, const GLchar *name);
@@ -42,6 +48,14 @@ typedef void (APIENTRY *PFNGLUNIFORM1IPROC)(GLint location, GLint value);
 typedef void (APIENTRY *PFNGLBLITFRAMEBUFFERPROC)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
 #endif
 
+// Sub-rectangle of a texture in texture coordinates (origin bottom left)
+struct TextureRegion {
+    float u = 0.0f;
+    float v = 0.0f;
+    float width = 1.0f;
+    float height = 1.0f;
+};
+
 class Renderer {
 public:
     struct FramebufferInfo {
@@ -57,22 +71,44 @@ public:
     bool initialize();
     void destroy();
     
-    // OpenGL context management
+    // OpenGL context management. With prefer_gles an OpenGL ES 3 (then ES 2)
+    // context is tried first, falling back to desktop OpenGL.
+    void set_prefer_gles(bool prefer_gles) { prefer_gles_ = prefer_gles; }
+    bool is_gles() const { return gles_version_ > 0; }
+    int get_gles_version() const { return gles_version_; }
+    size_t get_surface_bytes_per_pixel() const { return surface_bytes_per_pixel_; }
+    // GL vendor, renderer and version of the current context
+    const std::string& get_driver_description() const { return driver_description_; }
     bool create_context(void* native_display = nullptr);
     void destroy_context();
     bool make_current();
     void swap_buffers();
     
+    // Per-frame bookkeeping (resource pool pinning, timer query readback)
+    void begin_frame();
+    
     // Framebuffer management
-    FramebufferInfo create_framebuffer(int width, int height);
+    FramebufferInfo create_framebuffer(int width, int height, GLenum internal_format = GL_RGBA8);
     void destroy_framebuffer(const FramebufferInfo& info);
     void bind_framebuffer(const FramebufferInfo& info);
     void bind_default_framebuffer();
     
-    // Cached framebuffer management for better performance
-    FramebufferInfo get_or_create_framebuffer(int width, int height);
+    // Pooled framebuffers/textures, shared by every caller asking for the same
+    // size, format and slot; valid until evicted, so re-acquire every frame
+    FramebufferInfo get_or_create_framebuffer(int width, int height, GLenum internal_format = GL_RGBA8,
+                                              uint32_t slot = 0);
+    GLuint get_or_create_texture(int width, int height, GLenum internal_format = GL_RGBA8, uint32_t slot = 0);
     void cleanup_framebuffer_cache();
     
+    // VRAM budget for pooled GPU resources
+    void set_vram_budget(size_t bytes);
+    GpuResourcePool& get_resource_pool() { return resource_pool_; }
+    
+    // Per-stage GPU/CPU timings
+    GpuProfiler& get_profiler() { return profiler_; }
+    
+    const TextureUploader& get_uploader() const { return uploader_; }
+    
     // Multi-monitor optimization - render once, copy to multiple outputs
     bool copy_framebuffer_to_texture(const FramebufferInfo& source, GLuint target_texture, int target_width, int target_height);
     
@@ -80,11 +116,16 @@ public:
     void clear(float r = 0.0f, float g = 0.0f, float b = 0.0f, float a = 1.0f);
     void set_viewport(int x, int y, int width, int height);
     
-    // Texture utilities
+    // Texture utilities; textures are GL_RGBA8 and updates stream through
+    // the pixel buffer ring of the uploader
     GLuint create_texture(int width, int height, const void* data = nullptr);
     void update_texture(GLuint texture, int width, int height, const void* data);
+    void update_texture(GLuint texture, int width, int height, const void* data, int stride, PixelFormat format);
     void destroy_texture(GLuint texture);
     
+    // Reads a GL_RGBA8 texture into tightly packed RGBA rows, bottom row first
+    bool read_texture_rgba(GLuint texture, int width, int height, void* pixels);
+    
     // Shader utilities
     GLuint compile_shader(GLenum type, const char* source);
     GLuint create_program(const char* vertex_source, const char* fragment_source);
@@ -96,8 +137,32 @@ public:
     
     // Methods for rendering to Wayland surfaces
     EGLSurface create_egl_surface_for_wayland(wl_egl_window* egl_window);
-    bool render_texture_to_surface(EGLSurface target_surface, GLuint texture, int surface_width, int surface_height);
-    void draw_fullscreen_quad(GLuint texture);
+    bool render_texture_to_surface(EGLSurface target_surface, GLuint texture, int surface_width, int surface_height,
+                                   const std::string& output_name = "default");
+    void draw_fullscreen_quad(GLuint texture, const TextureRegion& region = TextureRegion());
+    // Offscreen counterpart of render_texture_to_surface, for outputs
+    // without a window surface
+    bool render_texture_to_framebuffer(const FramebufferInfo& target, GLuint texture,
+                                       const std::string& output_name = "default");
+    
+    // Part of the wallpaper texture an output shows when one picture spans
+    // several outputs; outputs without a region show the whole texture
+    void set_output_region(const std::string& output_name, const TextureRegion& region);
+    void clear_output_regions() { output_regions_.clear(); }
+    // Blends two textures over the viewport: from at mix 0, to at mix 1
+    void draw_crossfade_quad(GLuint from_texture, GLuint to_texture, float mix);
+    
+    // Post-processing pass over each finished wallpaper frame. source is
+    // the body of a fragment shader (see effect_prelude_* in renderer.cpp);
+    // false if it does not compile, keeping the previous effect.
+    bool set_effect(const std::string& source);
+    void clear_effect();
+    bool has_effect() const { return effect_program_ != 0; }
+    // Whether the effect reads the audioBands or audioLevel uniforms
+    bool effect_uses_audio() const { return effect_uses_audio_; }
+    void set_audio_levels(const float* bands, int count, float level);
+    // Draws texture through the effect over the viewport
+    void draw_effect_quad(GLuint texture);
     
     EGLDisplay get_egl_display() const { return egl_display_; }
     EGLContext get_egl_context() const { return egl_context_; }
@@ -107,6 +172,11 @@ private:
     EGLContext egl_context_ = EGL_NO_CONTEXT;
     EGLSurface egl_surface_ = EGL_NO_SURFACE;
     EGLConfig egl_config_;
+    EGLint egl_config_candidates_ = 0;
+    bool prefer_gles_ = false;
+    int gles_version_ = 0;                 // 0 for desktop OpenGL
+    size_t surface_bytes_per_pixel_ = 4;
+    std::string driver_description_;
     
     // OpenGL extension function pointers
     PFNGLGENFRAMEBUFFERSPROC glGenFramebuffers = nullptr;
@@ -127,6 +197,7 @@ private:
     PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog = nullptr;
     PFNGLUSEPROGRAMPROC glUseProgram = nullptr;
     PFNGLDELETEPROGRAMPROC glDeleteProgram = nullptr;
+    PFNGLBINDATTRIBLOCATIONPROC glBindAttribLocation = nullptr;
     
     // Additional OpenGL function pointers for rendering
     PFNGLGENVERTEXARRAYSPROC glGenVertexArrays = nullptr;
@@ -134,16 +205,44 @@ private:
     PFNGLGENBUFFERSPROC glGenBuffers = nullptr;
     PFNGLBINDBUFFERPROC glBindBuffer = nullptr;
     PFNGLBUFFERDATAPROC glBufferData = nullptr;
+    PFNGLDELETEBUFFERSPROC glDeleteBuffers = nullptr;
     PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer = nullptr;
     PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArray = nullptr;
     PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation = nullptr;
     PFNGLUNIFORM1IPROC glUniform1i = nullptr;
+    PFNGLUNIFORM1FPROC glUniform1f = nullptr;
+    PFNGLUNIFORM4FPROC glUniform4f = nullptr;
+    PFNGLUNIFORM1FVPROC glUniform1fv = nullptr;
     PFNGLBLITFRAMEBUFFERPROC glBlitFramebuffer = nullptr;
     
-    // Framebuffer cache to avoid recreating framebuffers every frame
-    std::map<std::pair<int, int>, FramebufferInfo> framebuffer_cache_;
+    // LRU pool of render targets and textures, bounded by the VRAM budget
+    GpuResourcePool resource_pool_;
+    GpuProfiler profiler_;
+    TextureUploader uploader_;
+    std::vector<unsigned char> upload_scratch_;
+    
+    // Fullscreen quad shared by the composite shaders
+    GLuint quad_vao_ = 0;
+    GLuint quad_vbo_ = 0;
+    GLuint quad_ebo_ = 0;
     
+    std::unordered_map<std::string, TextureRegion> output_regions_;
+    
+    static constexpr int kAudioBands = 16;
+    GLuint effect_program_ = 0;
+    bool effect_uses_audio_ = false;
+    float audio_bands_[kAudioBands] = {};
+    float audio_level_ = 0.0f;
+
     bool setup_egl(void* native_display);
+    bool choose_egl_config(EGLint renderable_type);
+    void log_egl_config() const;
+    bool create_gl_context();
+    bool create_gles_context();
+    GLenum storage_format(GLenum internal_format) const;
+    void destroy_pooled_resource(const GpuResource& resource);
     bool load_gl_extensions();
+    GLuint create_quad_program(const char* const sources[3][2]);
+    void draw_quad();
     void check_gl_error(const char* operation);
 };
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "display_manager.h"
+#include "renderer.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// One picture across several monitors. The canvas is the bounding box of
+// the monitors, widened by the bezel gap between neighbouring columns and
+// rows so lines continue straight across the frames. Each monitor shows
+// its own sub-rectangle of the canvas.
+class SpanLayout {
+public:
+    SpanLayout() = default;
+    
+    // Bezel width in canvas pixels between horizontal / vertical neighbours
+    void set_bezel(int horizontal, int vertical);
+    
+    // Lays out the monitors; the canvas is scaled down to fit max_side and
+    // kMaxCanvasPixels, keeping its aspect ratio. max_side 0 keeps it at
+    // full size, for targets that are copied 1:1. Returns whether the
+    // canvas or any region changed.
+    bool compute(const std::vector<Monitor>& monitors, int max_side);
+    
+    bool empty() const { return regions_.empty(); }
+    int get_width() const { return width_; }
+    int get_height() const { return height_; }
+    const std::vector<std::pair<std::string, TextureRegion>>& get_regions() const { return regions_; }
+
+private:
+    // 8K; a larger canvas costs more than it shows
+    static constexpr long long kMaxCanvasPixels = 7680LL * 4320;
+    
+    int bezel_horizontal_ = 0;
+    int bezel_vertical_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<std::pair<std::string, TextureRegion>> regions_;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Power spectrum of a block of real samples: Hann window, radix-2 FFT and
+// |X[k]|^2 for the lower half of the bins. Real and imaginary parts are
+// kept in separate arrays so the butterflies of each stage run over
+// contiguous memory; they use AVX2 or SSE on x86 (picked at run time),
+// NEON on ARM, and plain C++ elsewhere or for stages too short to vectorize.
+class SpectrumFft {
+public:
+    enum class Backend {
+        Auto,     // The widest one the CPU supports
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+    
+    // size must be a power of two. A backend this CPU or build lacks falls
+    // back to scalar, which get_backend_name() reports.
+    explicit SpectrumFft(size_t size, Backend backend = Backend::Auto);
+    
+    size_t get_size() const { return size_; }
+    const char* get_backend_name() const { return backend_; }
+    
+    // samples holds get_size() values, power receives get_size() / 2
+    void compute(const float* samples, float* power);
+
+private:
+    // a += w * b and b = a - w * b over `count` butterflies
+    using ButterflyKernel = void (*)(float* a_re, float* a_im, float* b_re, float* b_im,
+                                     const float* w_re, const float* w_im, size_t count);
+    
+    size_t size_;
+    std::vector<float> window_;
+    std::vector<uint32_t> bit_reverse_;
+    
+    // Twiddles of the stage with half size h start at offset h - 1
+    std::vector<float> twiddle_re_;
+    std::vector<float> twiddle_im_;
+    
+    std::vector<float> re_;
+    std::vector<float> im_;
+    
+    ButterflyKernel kernel_;
+    size_t kernel_width_;
+    const char* backend_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+class GpuResourcePool;
+
+// Byte order of CPU-side pixels; both are 4 bytes per pixel so rows stay
+// 4-byte aligned and the driver can DMA them without conversion
+enum class PixelFormat {
+    RGBA8,
+    BGRA8
+};
+
+// Streams CPU-produced pixels into textures through a ring of pixel buffer
+// objects. With ARB_buffer_storage the buffers are persistently mapped and
+// written in place; otherwise each upload orphans its buffer. A fence per
+// ring slot keeps the CPU from overwriting data the GPU hasn't consumed.
+class TextureUploader {
+public:
+    static constexpr int kRingSize = 3;
+    
+    struct Stats {
+        uint64_t uploads = 0;
+        uint64_t bytes = 0;
+        uint64_t fence_waits = 0;     // Uploads that had to wait for the GPU
+        uint64_t reallocations = 0;
+        double cpu_ms = 0.0;          // Time spent inside upload()
+    };
+    
+    TextureUploader() = default;
+    ~TextureUploader() = default;
+    
+    // Needs a current context. Buffers are registered with `pool` so they are
+    // accounted against the VRAM budget. GLES2 has no mappable buffers, so
+    // initialization fails there and callers upload synchronously.
+    bool initialize(GpuResourcePool* pool, int gles_version = 0);
+    void destroy();
+    
+    // Copies `height` rows of `stride` bytes into the next ring slot and
+    // updates `texture` (allocated with GL_RGBA8 storage) from it
+    bool upload(GLuint texture, int width, int height, const void* pixels, int stride, PixelFormat format);
+    
+    bool is_persistent() const { return persistent_; }
+    const Stats& get_stats() const { return stats_; }
+    void dump_stats() const;
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        void* mapped = nullptr;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+    };
+    
+    std::array<Slot, kRingSize> slots_;
+    int next_slot_ = 0;
+    bool persistent_ = false;
+    bool gles_ = false;
+    bool initialized_ = false;
+    GpuResourcePool* pool_ = nullptr;
+    Stats stats_;
+    
+    PFNGLGENBUFFERSPROC glGenBuffers = nullptr;
+    PFNGLBINDBUFFERPROC glBindBuffer = nullptr;
+    PFNGLBUFFERDATAPROC glBufferData = nullptr;
+    PFNGLDELETEBUFFERSPROC glDeleteBuffers = nullptr;
+    PFNGLBUFFERSTORAGEPROC glBufferStorage = nullptr;
+    PFNGLMAPBUFFERRANGEPROC glMapBufferRange = nullptr;
+    PFNGLUNMAPBUFFERPROC glUnmapBuffer = nullptr;
+    PFNGLFENCESYNCPROC glFenceSync = nullptr;
+    PFNGLCLIENTWAITSYNCPROC glClientWaitSync = nullptr;
+    PFNGLDELETESYNCPROC glDeleteSync = nullptr;
+    PFNGLGETSTRINGIPROC glGetStringi = nullptr;
+    
+    bool has_extension(const char* name);
+    bool prepare_slot(Slot& slot, int index, size_t size);
+    void wait_for_slot(Slot& slot);
+};
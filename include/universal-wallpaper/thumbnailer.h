@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct AVCodec;
+
+// Batch preview extraction for GUIs (--thumbnail). Each file is opened
+// demuxer-only, seeked to a keyframe, and a single keyframe is decoded
+// with the cheapest decoder settings, scaled on the CPU and encoded as
+// WebP or PNG. Results are stored in a content-addressed cache, so
+// renamed or copied wallpapers reuse their preview. Files are processed in
+// parallel; each finished file prints "input<TAB>thumbnail" on stdout.
+class Thumbnailer {
+public:
+    // format is "webp" or "png"; webp falls back to png when FFmpeg was
+    // built without libwebp
+    Thumbnailer(std::string cache_dir, int size, const std::string& format);
+    
+    Thumbnailer(const Thumbnailer&) = delete;
+    Thumbnailer& operator=(const Thumbnailer&) = delete;
+    
+    // Processes all inputs on `jobs` worker threads (0 = one per core);
+    // returns the number of files that failed
+    size_t run(const std::vector<std::string>& inputs, int jobs);
+    
+    static std::string default_cache_dir();
+    
+    // Where the thumbnail of `input` is cached, whether or not it exists;
+    // false if the input can't be read
+    bool cache_path(const std::string& input, std::string& path) const;
+
+private:
+    // Bytes hashed from each end of the media; enough to tell files apart
+    // without reading whole videos
+    static constexpr size_t kFingerprintBytes = 64 * 1024;
+    // Give up on files without a decodable keyframe this early on
+    static constexpr int kMaxPackets = 600;
+    
+    std::string cache_dir_;
+    int size_;
+    const AVCodec* encoder_ = nullptr;
+    std::string extension_;
+    
+    std::mutex output_mutex_;
+    std::atomic<size_t> cached_{0};
+    std::atomic<size_t> generated_{0};
+    std::atomic<size_t> failed_{0};
+    
+    bool process(const std::string& input, size_t worker);
+    bool extract(const std::string& input, const std::string& output, size_t worker) const;
+};
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
 
 enum class LogLevel {
     LOG_DEBUG,
@@ -11,6 +12,8 @@ enum class LogLevel {
 };
 
 void set_log_level(LogLevel level);
+// Sends every level to stderr, leaving stdout to a command's own output
+void set_log_to_stderr(bool enabled);
 void log_debug(const std::string& message);
 void log_info(const std::string& message);
 void log_warn(const std::string& message);
@@ -21,9 +24,14 @@ bool file_exists(const std::string& path);
 bool is_video_file(const std::string& path);
 bool is_image_file(const std::string& path);
 
+// Per-user cache directory ($XDG_CACHE_HOME/wallpaper-ne-linux), created on
+// demand; empty if it can't be determined or created
+std::string get_cache_dir();
+
 // String utilities
 std::vector<std::string> split_string(const std::string& str, char delimiter);
 std::string trim_string(const std::string& str);
+std::string format_bytes(size_t bytes);
 
 // Process utilities
 void daemonize();
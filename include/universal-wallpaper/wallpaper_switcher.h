@@ -0,0 +1,133 @@
+#pragma once
+
+#include "media_engine.h"
+#include "renderer.h"
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Switches wallpapers inside the running process. The new media is opened
+// in a second engine while the current one keeps playing; once the new
+// engine has decoded its first frame it becomes current, and the old one
+// is crossfaded out in the composite pass and destroyed afterwards.
+// Opening and probing the new media runs on a worker thread, so a slow
+// file or network source doesn't stall the frames of the current one.
+// Media can also be prepared ahead of time and held paused on its first
+// frame, so a scheduled switch costs no open or decode latency.
+class WallpaperSwitcher {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Creates and initializes an engine; nullptr on failure. Runs on a
+    // worker thread, so it must not touch GL or the render thread's state.
+    using EngineFactory = std::function<std::unique_ptr<MediaEngine>(const std::string& media_path)>;
+    // Attaches an opened engine to the renderer, on the render thread
+    using EngineAttach = std::function<bool(MediaEngine& engine)>;
+    
+    WallpaperSwitcher(Renderer& renderer, EngineFactory factory, EngineAttach attach);
+    ~WallpaperSwitcher();
+    
+    void set_transition_duration(std::chrono::milliseconds duration) { transition_duration_ = duration; }
+    
+    // Pool slot of the caller's render target; the crossfade uses the two
+    // slots after it, so switchers sharing a renderer need distinct bases
+    void set_framebuffer_slot(uint32_t slot) { framebuffer_slot_ = slot; }
+    
+    // Starts the first wallpaper without a transition; opens synchronously
+    bool start(const std::string& media_path);
+    
+    // Begins preparing media_path; the switch happens once it has a frame
+    bool request_switch(const std::string& media_path);
+    
+    // Prepares media_path but holds it on its first frame until switch_to()
+    bool prepare(const std::string& media_path);
+    // Switches to media_path, reusing the prepared engine when it matches
+    bool switch_to(const std::string& media_path);
+    // As above with a transition of its own; `elapsed` starts partway into
+    // it, for switches that were due while the process wasn't running
+    bool switch_to(const std::string& media_path, std::chrono::milliseconds duration,
+                   std::chrono::milliseconds elapsed);
+    
+    MediaEngine& current() { return *current_; }
+    const std::string& get_current_path() const { return current_path_; }
+    
+    // Wakeup fd of the engine being opened or prepared, -1 if none
+    int get_pending_wakeup_fd() const;
+    
+    // Drives the engines that aren't current; returns true when a prepared
+    // engine has just become current
+    bool update(Clock::time_point now);
+    
+    bool is_preparing() const { return pending_ != nullptr || opening_.valid(); }
+    const std::string& get_pending_path() const { return pending_path_; }
+    bool is_transitioning() const { return outgoing_ != nullptr; }
+    
+    // Whether the blend has moved enough to be worth a frame: long
+    // transitions advance in 8-bit steps instead of at the frame rate
+    bool transition_step_due(Clock::time_point now) const;
+    Clock::duration time_until_transition_step(Clock::time_point now) const;
+    
+    // Blends the outgoing engine into `target`, which holds the current
+    // engine's frame, and returns the framebuffer to present. Finishes the
+    // transition once it has run its duration.
+    Renderer::FramebufferInfo composite(const Renderer::FramebufferInfo& target, Clock::time_point now);
+    
+    void dump_stats() const;
+
+private:
+    // Blend levels a transition is drawn in; finer steps wouldn't show
+    static constexpr int kTransitionSteps = 256;
+    // Give up on media that produces no frame within this time
+    static constexpr auto kPrepareTimeout = std::chrono::seconds(10);
+    // Pool slots, relative to framebuffer_slot_, for the outgoing picture
+    // and the blended result
+    static constexpr uint32_t kOutgoingSlot = 1;
+    static constexpr uint32_t kCompositeSlot = 2;
+    
+    Renderer& renderer_;
+    EngineFactory factory_;
+    EngineAttach attach_;
+    std::chrono::milliseconds transition_duration_{500};
+    uint32_t framebuffer_slot_ = 0;
+    
+    std::unique_ptr<MediaEngine> current_;
+    std::string current_path_;
+    
+    // Open in flight on a worker; its result becomes pending_
+    std::future<std::unique_ptr<MediaEngine>> opening_;
+    // Opens superseded while in flight, reaped once they finish
+    std::vector<std::future<std::unique_ptr<MediaEngine>>> abandoned_;
+    // Signalled by the worker when an open finishes
+    int open_fd_ = -1;
+    
+    std::unique_ptr<MediaEngine> pending_;
+    std::string pending_path_;
+    bool hold_pending_ = false;
+    Clock::time_point request_time_;
+    
+    std::unique_ptr<MediaEngine> outgoing_;
+    Clock::time_point transition_start_;
+    Clock::time_point last_step_;
+    bool awaiting_first_frame_ = false;
+    bool outgoing_drawn_ = false;
+    Renderer::FramebufferInfo outgoing_target_{};
+    
+    // Timing of the transition in progress
+    std::chrono::milliseconds active_duration_{0};
+    std::chrono::milliseconds active_elapsed_{0};
+    
+    uint64_t switches_ = 0;
+    uint64_t failed_switches_ = 0;
+    double last_latency_ms_ = 0.0;
+    double max_latency_ms_ = 0.0;
+    double total_latency_ms_ = 0.0;
+    
+    bool prepare_engine(const std::string& media_path, bool hold);
+    bool take_opened_engine();
+    void abandon_open();
+    void reap_abandoned(bool wait);
+    std::chrono::milliseconds step_interval() const { return active_duration_ / kTransitionSteps; }
+    void finish_transition();
+};
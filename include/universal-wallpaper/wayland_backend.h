@@ -25,6 +25,7 @@ struct WaylandOutput {
 };
 
 struct WaylandSurface {
+    WaylandOutput* output = nullptr;
     wl_surface* surface = nullptr;
     zwlr_layer_surface_v1* layer_surface = nullptr;
     wl_egl_window* egl_window = nullptr;
@@ -53,6 +54,7 @@ public:
     
     void process_events() override;
     bool should_quit() const override;
+    int get_event_fd() const override;
     
     // Set the renderer instance for wallpaper rendering
     void set_renderer(Renderer* renderer) { renderer_ = renderer; }
@@ -105,7 +107,8 @@ private:
     
     WaylandSurface* create_surface_for_output(WaylandOutput* output);
     bool render_to_output(WaylandOutput* output, GLuint texture, int tex_width, int tex_height);
-    void render_to_surface(WaylandSurface* surface, GLuint texture, int tex_width, int tex_height);
+    void render_to_surface(WaylandSurface* surface, GLuint texture, int tex_width, int tex_height,
+                           const std::string& output_name);
     WaylandSurface* find_surface_for_output(WaylandOutput* output);
     
     WaylandOutput* find_output_by_name(const std::string& name);
@@ -25,6 +25,7 @@ public:
     
     void process_events() override;
     bool should_quit() const override;
+    int get_event_fd() const override;
     
     void set_renderer(Renderer* renderer) override;
 
@@ -0,0 +1,297 @@
+#include "universal-wallpaper/audio_analyzer.h"
+#include "universal-wallpaper/utils.h"
+#include <pulse/pulseaudio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Levels are shown on a logarithmic scale down to this far below full scale
+static constexpr float kFloorDb = -60.0f;
+// Per-update decay of the smoothed levels, so peaks fall off gently
+static constexpr float kDecay = 0.85f;
+
+static float to_unit(float ratio) {
+    float db = 10.0f * std::log10(ratio + 1e-12f);
+    return std::min(1.0f, std::max(0.0f, (db - kFloorDb) / -kFloorDb));
+}
+
+AudioAnalyzer::AudioAnalyzer()
+    : fft_(kFftSize), history_(kFftSize, 0.0f), power_(kFftSize / 2, 0.0f) {
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        throw std::runtime_error("Failed to create audio analyzer eventfd");
+    }
+    
+    // Logarithmic bands from 40 Hz up to the Nyquist frequency, at least
+    // one FFT bin each
+    const double bin_hz = static_cast<double>(kSampleRate) / kFftSize;
+    const double low_hz = 40.0;
+    const double high_hz = kSampleRate / 2.0;
+    for (int band = 0; band <= kBands; band++) {
+        double hz = low_hz * std::pow(high_hz / low_hz, static_cast<double>(band) / kBands);
+        band_edges_[band] = std::min(kFftSize / 2, static_cast<size_t>(std::lround(hz / bin_hz)));
+        if (band > 0) {
+            band_edges_[band] = std::max(band_edges_[band], band_edges_[band - 1] + 1);
+        }
+    }
+    band_edges_[kBands] = std::min(band_edges_[kBands], kFftSize / 2);
+}
+
+AudioAnalyzer::~AudioAnalyzer() {
+    stop();
+    
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+}
+
+bool AudioAnalyzer::start() {
+    if (mainloop_) return true;
+    
+    mainloop_ = pa_threaded_mainloop_new();
+    if (!mainloop_) {
+        log_error("Failed to create PulseAudio mainloop for audio analysis");
+        return false;
+    }
+    
+    context_ = pa_context_new(pa_threaded_mainloop_get_api(mainloop_), "wallpaper-ne-linux-audio-analyzer");
+    if (context_) {
+        pa_context_set_state_callback(context_, context_state_callback, this);
+    }
+    if (!context_ || pa_threaded_mainloop_start(mainloop_) < 0) {
+        log_error("Failed to set up PulseAudio for audio analysis");
+        cleanup_pulseaudio();
+        return false;
+    }
+    
+    pa_threaded_mainloop_lock(mainloop_);
+    bool ready = pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) >= 0;
+    while (ready) {
+        pa_context_state_t state = pa_context_get_state(context_);
+        if (state == PA_CONTEXT_READY) break;
+        if (!PA_CONTEXT_IS_GOOD(state)) {
+            ready = false;
+            break;
+        }
+        pa_threaded_mainloop_wait(mainloop_);
+    }
+    
+    if (ready) {
+        // The server downmixes and resamples; mono at 11 kHz is plenty for
+        // band levels and keeps the analysis cheap
+        pa_sample_spec spec;
+        spec.format = PA_SAMPLE_FLOAT32NE;
+        spec.rate = kSampleRate;
+        spec.channels = 1;
+        stream_ = pa_stream_new(context_, "Wallpaper audio analysis", &spec, nullptr);
+        ready = stream_ != nullptr;
+    }
+    if (ready) {
+        pa_stream_set_state_callback(stream_, stream_state_callback, this);
+        pa_stream_set_read_callback(stream_, stream_read_callback, this);
+        
+        // One hop per fragment; an idle sink may still suspend
+        pa_buffer_attr attributes;
+        attributes.maxlength = static_cast<uint32_t>(-1);
+        attributes.tlength = static_cast<uint32_t>(-1);
+        attributes.prebuf = static_cast<uint32_t>(-1);
+        attributes.minreq = static_cast<uint32_t>(-1);
+        attributes.fragsize = static_cast<uint32_t>(kHopSize * sizeof(float));
+        ready = pa_stream_connect_record(stream_, "@DEFAULT_MONITOR@", &attributes,
+                                         static_cast<pa_stream_flags_t>(PA_STREAM_ADJUST_LATENCY |
+                                                                        PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND)) >= 0;
+    }
+    while (ready) {
+        pa_stream_state_t state = pa_stream_get_state(stream_);
+        if (state == PA_STREAM_READY) break;
+        if (!PA_STREAM_IS_GOOD(state)) {
+            ready = false;
+            break;
+        }
+        pa_threaded_mainloop_wait(mainloop_);
+    }
+    pa_threaded_mainloop_unlock(mainloop_);
+    
+    if (!ready) {
+        log_error("Failed to record the default sink's monitor for audio analysis");
+        cleanup_pulseaudio();
+        return false;
+    }
+    
+    log_info(std::string("Audio analysis started (") + fft_.get_backend_name() + " FFT)");
+    return true;
+}
+
+void AudioAnalyzer::stop() {
+    if (!mainloop_) return;
+    cleanup_pulseaudio();
+    
+    // A restart begins from silence
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    pending_samples_ = 0;
+    smoothed_ = Levels();
+    log_info("Audio analysis stopped");
+}
+
+void AudioAnalyzer::cleanup_pulseaudio() {
+    if (mainloop_) {
+        pa_threaded_mainloop_lock(mainloop_);
+        if (stream_) {
+            pa_stream_disconnect(stream_);
+            pa_stream_unref(stream_);
+            stream_ = nullptr;
+        }
+        if (context_) {
+            pa_context_disconnect(context_);
+        }
+        pa_threaded_mainloop_unlock(mainloop_);
+        pa_threaded_mainloop_stop(mainloop_);
+    }
+    
+    if (context_) {
+        pa_context_unref(context_);
+        context_ = nullptr;
+    }
+    if (mainloop_) {
+        pa_threaded_mainloop_free(mainloop_);
+        mainloop_ = nullptr;
+    }
+}
+
+void AudioAnalyzer::consume(const float* samples, size_t count) {
+    // Slide the newest samples into the analysis window
+    if (count >= kFftSize) {
+        std::copy(samples + count - kFftSize, samples + count, history_.begin());
+    } else {
+        std::move(history_.begin() + count, history_.end(), history_.begin());
+        std::copy(samples, samples + count, history_.end() - count);
+    }
+    
+    pending_samples_ += count;
+    if (pending_samples_ >= kHopSize) {
+        pending_samples_ = 0;
+        analyze();
+    }
+}
+
+void AudioAnalyzer::analyze() {
+    auto begin = std::chrono::steady_clock::now();
+    fft_.compute(history_.data(), power_.data());
+    
+    // A full-scale sine through the Hann window peaks at (N/4)^2
+    const float reference = static_cast<float>(kFftSize * kFftSize) / 16.0f;
+    Levels levels;
+    float total = 0.0f;
+    for (int band = 0; band < kBands; band++) {
+        float sum = 0.0f;
+        for (size_t bin = band_edges_[band]; bin < band_edges_[band + 1]; bin++) {
+            sum += power_[bin];
+        }
+        total += sum;
+        size_t bins = band_edges_[band + 1] - band_edges_[band];
+        levels.bands[band] = to_unit(sum / std::max<size_t>(1, bins) / reference);
+    }
+    levels.level = to_unit(total / reference);
+    
+    // Rise at once, fall gradually
+    for (int band = 0; band < kBands; band++) {
+        smoothed_.bands[band] = std::max(levels.bands[band], smoothed_.bands[band] * kDecay);
+    }
+    smoothed_.level = std::max(levels.level, smoothed_.level * kDecay);
+    publish(smoothed_);
+    
+    frames_analyzed_.fetch_add(1, std::memory_order_relaxed);
+    analysis_ns_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin).count()), std::memory_order_relaxed);
+}
+
+void AudioAnalyzer::publish(const Levels& levels) {
+    uint64_t head = ring_head_.load(std::memory_order_relaxed);
+    RingSlot& slot = ring_[head % kRingSize];
+    slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int band = 0; band < kBands; band++) {
+        slot.values[band].store(levels.bands[band], std::memory_order_relaxed);
+    }
+    slot.values[kBands].store(levels.level, std::memory_order_relaxed);
+    slot.sequence.store(2 * head + 2, std::memory_order_release);
+    ring_head_.store(head + 1, std::memory_order_release);
+    
+    uint64_t one = 1;
+    ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+bool AudioAnalyzer::poll_levels(Levels& levels) {
+    uint64_t count = 0;
+    ssize_t drained = read(wakeup_fd_, &count, sizeof(count));
+    (void)drained;
+    
+    uint64_t head = ring_head_.load(std::memory_order_acquire);
+    if (head == ring_tail_) return false;
+    
+    // Only the newest levels matter. The producer reuses a slot kRingSize
+    // publishes later; if it rewrote the slot during the copy, the sequence
+    // no longer matches and a newer one is taken.
+    for (;;) {
+        const uint64_t index = head - 1;
+        const RingSlot& slot = ring_[index % kRingSize];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        for (int band = 0; band < kBands; band++) {
+            levels.bands[band] = slot.values[band].load(std::memory_order_relaxed);
+        }
+        levels.level = slot.values[kBands].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before == 2 * index + 2 && after == before) break;
+        head = ring_head_.load(std::memory_order_acquire);
+    }
+    frames_dropped_.fetch_add(head - ring_tail_ - 1, std::memory_order_relaxed);
+    ring_tail_ = head;
+    return true;
+}
+
+void AudioAnalyzer::dump_stats() const {
+    uint64_t frames = frames_analyzed_.load(std::memory_order_relaxed);
+    if (frames == 0) return;
+    
+    char message[160];
+    snprintf(message, sizeof(message), "Audio analysis: %llu spectra (%s), avg %.1f us each, %llu not drawn",
+             static_cast<unsigned long long>(frames), fft_.get_backend_name(),
+             static_cast<double>(analysis_ns_.load(std::memory_order_relaxed)) / frames / 1000.0,
+             static_cast<unsigned long long>(frames_dropped_.load(std::memory_order_relaxed)));
+    log_info(message);
+}
+
+void AudioAnalyzer::context_state_callback(pa_context* context, void* userdata) {
+    (void)context;
+    AudioAnalyzer* analyzer = static_cast<AudioAnalyzer*>(userdata);
+    pa_threaded_mainloop_signal(analyzer->mainloop_, 0);
+}
+
+void AudioAnalyzer::stream_state_callback(pa_stream* stream, void* userdata) {
+    (void)stream;
+    AudioAnalyzer* analyzer = static_cast<AudioAnalyzer*>(userdata);
+    pa_threaded_mainloop_signal(analyzer->mainloop_, 0);
+}
+
+void AudioAnalyzer::stream_read_callback(pa_stream* stream, size_t bytes, void* userdata) {
+    (void)bytes;
+    AudioAnalyzer* analyzer = static_cast<AudioAnalyzer*>(userdata);
+    
+    const void* data = nullptr;
+    size_t length = 0;
+    if (pa_stream_peek(stream, &data, &length) < 0 || length == 0) return;
+    
+    // A null buffer with a length is a hole in the recording
+    if (data) {
+        analyzer->consume(static_cast<const float*>(data), length / sizeof(float));
+    }
+    pa_stream_drop(stream);
+}
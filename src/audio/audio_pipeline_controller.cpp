@@ -0,0 +1,84 @@
+#include "universal-wallpaper/audio_pipeline_controller.h"
+#include "universal-wallpaper/media_engine.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+// CPU time of every thread in the process, mpv's audio threads included
+static double process_cpu_seconds() {
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0.0;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+AudioPipelineController::AudioPipelineController()
+    : fade_start_(std::chrono::steady_clock::now() - kFadeDuration),
+      last_cpu_seconds_(process_cpu_seconds()),
+      last_sample_time_(std::chrono::steady_clock::now()) {}
+
+void AudioPipelineController::set_muted(bool muted, std::chrono::steady_clock::time_point now) {
+    if (muted == muted_) return;
+    account(now);
+    muted_ = muted;
+    if (muted) {
+        detaches_++;
+        log_debug("Detaching wallpaper audio");
+    } else {
+        fade_start_ = now;
+        log_debug("Reattaching wallpaper audio");
+    }
+}
+
+void AudioPipelineController::sync(MediaEngine& engine, std::chrono::steady_clock::time_point now) const {
+    if (muted_) {
+        engine.set_audio_enabled(false);
+        return;
+    }
+    
+    // The volume goes first, so a reattached track starts silent
+    double progress = std::chrono::duration<double>(now - fade_start_) / std::chrono::duration<double>(kFadeDuration);
+    engine.set_volume_scale(std::min(1.0, std::max(0.0, progress)));
+    engine.set_audio_enabled(true);
+}
+
+std::chrono::steady_clock::duration AudioPipelineController::time_until_update(
+    std::chrono::steady_clock::time_point now) const {
+    if (muted_ || now - fade_start_ >= kFadeDuration) {
+        return std::chrono::steady_clock::duration::max();
+    }
+    return kFadeStep;
+}
+
+void AudioPipelineController::account(std::chrono::steady_clock::time_point now) {
+    double cpu_seconds = process_cpu_seconds();
+    Usage& usage = muted_ ? detached_ : attached_;
+    usage.cpu_seconds += cpu_seconds - last_cpu_seconds_;
+    usage.wall_seconds += std::chrono::duration<double>(now - last_sample_time_).count();
+    last_cpu_seconds_ = cpu_seconds;
+    last_sample_time_ = now;
+}
+
+void AudioPipelineController::dump_stats() {
+    account(std::chrono::steady_clock::now());
+    if (detached_.wall_seconds <= 0.0) return;
+    
+    double attached_load = attached_.wall_seconds > 0.0 ? attached_.cpu_seconds / attached_.wall_seconds : 0.0;
+    double detached_load = detached_.cpu_seconds / detached_.wall_seconds;
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Audio: %llu detaches, %.0f s attached at %.1f%% CPU, %.0f s detached at %.1f%% CPU",
+             static_cast<unsigned long long>(detaches_), attached_.wall_seconds, attached_load * 100.0,
+             detached_.wall_seconds, detached_load * 100.0);
+    std::string line = message;
+    
+    // Only meaningful once both states have been observed for a while
+    if (attached_.wall_seconds >= 10.0) {
+        snprintf(message, sizeof(message), " (~%.0f CPU seconds saved per detached hour)",
+                 (attached_load - detached_load) * 3600.0);
+        line += message;
+    }
+    log_info(line);
+}
@@ -0,0 +1,154 @@
+#include "universal-wallpaper/spectrum_fft.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WALLPAPER_NE_FFT_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WALLPAPER_NE_FFT_NEON 1
+#endif
+
+static void butterflies_scalar(float* a_re, float* a_im, float* b_re, float* b_im,
+                               const float* w_re, const float* w_im, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        float t_re = w_re[k] * b_re[k] - w_im[k] * b_im[k];
+        float t_im = w_re[k] * b_im[k] + w_im[k] * b_re[k];
+        b_re[k] = a_re[k] - t_re;
+        b_im[k] = a_im[k] - t_im;
+        a_re[k] += t_re;
+        a_im[k] += t_im;
+    }
+}
+
+#ifdef WALLPAPER_NE_FFT_X86
+__attribute__((target("sse2")))
+static void butterflies_sse(float* a_re, float* a_im, float* b_re, float* b_im,
+                            const float* w_re, const float* w_im, size_t count) {
+    for (size_t k = 0; k < count; k += 4) {
+        __m128 wr = _mm_loadu_ps(w_re + k);
+        __m128 wi = _mm_loadu_ps(w_im + k);
+        __m128 br = _mm_loadu_ps(b_re + k);
+        __m128 bi = _mm_loadu_ps(b_im + k);
+        __m128 ar = _mm_loadu_ps(a_re + k);
+        __m128 ai = _mm_loadu_ps(a_im + k);
+        __m128 t_re = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+        __m128 t_im = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+        _mm_storeu_ps(b_re + k, _mm_sub_ps(ar, t_re));
+        _mm_storeu_ps(b_im + k, _mm_sub_ps(ai, t_im));
+        _mm_storeu_ps(a_re + k, _mm_add_ps(ar, t_re));
+        _mm_storeu_ps(a_im + k, _mm_add_ps(ai, t_im));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void butterflies_avx2(float* a_re, float* a_im, float* b_re, float* b_im,
+                             const float* w_re, const float* w_im, size_t count) {
+    for (size_t k = 0; k < count; k += 8) {
+        __m256 wr = _mm256_loadu_ps(w_re + k);
+        __m256 wi = _mm256_loadu_ps(w_im + k);
+        __m256 br = _mm256_loadu_ps(b_re + k);
+        __m256 bi = _mm256_loadu_ps(b_im + k);
+        __m256 ar = _mm256_loadu_ps(a_re + k);
+        __m256 ai = _mm256_loadu_ps(a_im + k);
+        __m256 t_re = _mm256_fmsub_ps(wr, br, _mm256_mul_ps(wi, bi));
+        __m256 t_im = _mm256_fmadd_ps(wr, bi, _mm256_mul_ps(wi, br));
+        _mm256_storeu_ps(b_re + k, _mm256_sub_ps(ar, t_re));
+        _mm256_storeu_ps(b_im + k, _mm256_sub_ps(ai, t_im));
+        _mm256_storeu_ps(a_re + k, _mm256_add_ps(ar, t_re));
+        _mm256_storeu_ps(a_im + k, _mm256_add_ps(ai, t_im));
+    }
+}
+#endif
+
+#ifdef WALLPAPER_NE_FFT_NEON
+static void butterflies_neon(float* a_re, float* a_im, float* b_re, float* b_im,
+                             const float* w_re, const float* w_im, size_t count) {
+    for (size_t k = 0; k < count; k += 4) {
+        float32x4_t wr = vld1q_f32(w_re + k);
+        float32x4_t wi = vld1q_f32(w_im + k);
+        float32x4_t br = vld1q_f32(b_re + k);
+        float32x4_t bi = vld1q_f32(b_im + k);
+        float32x4_t ar = vld1q_f32(a_re + k);
+        float32x4_t ai = vld1q_f32(a_im + k);
+        float32x4_t t_re = vmlsq_f32(vmulq_f32(wr, br), wi, bi);
+        float32x4_t t_im = vmlaq_f32(vmulq_f32(wr, bi), wi, br);
+        vst1q_f32(b_re + k, vsubq_f32(ar, t_re));
+        vst1q_f32(b_im + k, vsubq_f32(ai, t_im));
+        vst1q_f32(a_re + k, vaddq_f32(ar, t_re));
+        vst1q_f32(a_im + k, vaddq_f32(ai, t_im));
+    }
+}
+#endif
+
+SpectrumFft::SpectrumFft(size_t size, Backend backend)
+    : size_(size), window_(size), bit_reverse_(size), twiddle_re_(size - 1), twiddle_im_(size - 1),
+      re_(size), im_(size), kernel_(butterflies_scalar), kernel_width_(1), backend_("scalar") {
+    const double pi = 3.14159265358979323846;
+    for (size_t i = 0; i < size; i++) {
+        window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / (size - 1)));
+    }
+    
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < size) bits++;
+    for (size_t i = 0; i < size; i++) {
+        uint32_t reversed = 0;
+        for (unsigned bit = 0; bit < bits; bit++) {
+            reversed |= ((i >> bit) & 1u) << (bits - 1 - bit);
+        }
+        bit_reverse_[i] = reversed;
+    }
+    
+    for (size_t half = 1; half < size; half *= 2) {
+        for (size_t k = 0; k < half; k++) {
+            double angle = -pi * static_cast<double>(k) / static_cast<double>(half);
+            twiddle_re_[half - 1 + k] = static_cast<float>(std::cos(angle));
+            twiddle_im_[half - 1 + k] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+#ifdef WALLPAPER_NE_FFT_X86
+    bool auto_backend = backend == Backend::Auto;
+    if ((auto_backend || backend == Backend::AVX2) && __builtin_cpu_supports("avx2") &&
+        __builtin_cpu_supports("fma")) {
+        kernel_ = butterflies_avx2;
+        kernel_width_ = 8;
+        backend_ = "AVX2";
+    } else if ((auto_backend || backend == Backend::SSE2) && __builtin_cpu_supports("sse2")) {
+        kernel_ = butterflies_sse;
+        kernel_width_ = 4;
+        backend_ = "SSE2";
+    }
+#elif defined(WALLPAPER_NE_FFT_NEON)
+    if (backend == Backend::Auto || backend == Backend::NEON) {
+        kernel_ = butterflies_neon;
+        kernel_width_ = 4;
+        backend_ = "NEON";
+    }
+#else
+    (void)backend;
+#endif
+}
+
+void SpectrumFft::compute(const float* samples, float* power) {
+    for (size_t i = 0; i < size_; i++) {
+        re_[bit_reverse_[i]] = samples[i] * window_[i];
+        im_[bit_reverse_[i]] = 0.0f;
+    }
+    
+    // Short early stages stay scalar; from half >= kernel width on, every
+    // group of butterflies is a whole number of vectors
+    for (size_t half = 1; half < size_; half *= 2) {
+        ButterflyKernel kernel = half >= kernel_width_ ? kernel_ : butterflies_scalar;
+        const float* w_re = twiddle_re_.data() + half - 1;
+        const float* w_im = twiddle_im_.data() + half - 1;
+        for (size_t start = 0; start < size_; start += 2 * half) {
+            kernel(re_.data() + start, im_.data() + start, re_.data() + start + half, im_.data() + start + half,
+                   w_re, w_im, half);
+        }
+    }
+    
+    for (size_t k = 0; k < size_ / 2; k++) {
+        power[k] = re_[k] * re_[k] + im_[k] * im_[k];
+    }
+}
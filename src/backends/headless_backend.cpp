@@ -0,0 +1,251 @@
+#include "universal-wallpaper/headless_backend.h"
+#include "universal-wallpaper/renderer.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+const std::string HeadlessBackend::backend_name_ = "Headless";
+
+HeadlessBackend::HeadlessBackend(std::vector<std::pair<int, int>> sizes, std::string record_path, int record_fps,
+                                 uint64_t frame_limit, bool step_clock)
+    : sizes_(std::move(sizes)), record_path_(std::move(record_path)), record_fps_(record_fps),
+      frame_limit_(frame_limit), step_clock_(step_clock) {
+}
+
+HeadlessBackend::~HeadlessBackend() {
+    destroy();
+}
+
+bool HeadlessBackend::initialize() {
+    log_info("Initializing headless backend");
+    
+    if (sizes_.empty()) {
+        log_error("Headless backend needs at least one output size");
+        return false;
+    }
+    
+    // Outputs sit side by side, like a row of monitors
+    outputs_.clear();
+    int x = 0;
+    for (size_t i = 0; i < sizes_.size(); i++) {
+        Output output;
+        output.monitor.name = "HEADLESS-" + std::to_string(i + 1);
+        output.monitor.x = x;
+        output.monitor.y = 0;
+        output.monitor.width = sizes_[i].first;
+        output.monitor.height = sizes_[i].second;
+        output.monitor.refresh_rate = 60;
+        output.monitor.primary = i == 0;
+        output.ring.resize(kRingFrames);
+        x += sizes_[i].first;
+        outputs_.push_back(std::move(output));
+    }
+    
+    if (!record_path_.empty()) {
+        const Monitor& recorded = outputs_.front().monitor;
+        recorder_ = std::make_unique<FrameRecorder>(record_path_, record_fps_);
+        if (!recorder_->open(recorded.width, recorded.height)) {
+            recorder_.reset();
+            return false;
+        }
+        log_info("Recording " + recorded.name + " to " + record_path_);
+    }
+    
+    if ((recorder_ || frame_limit_ > 0) && record_fps_ > 0) {
+        clock_fd_ = step_clock_ ? eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)
+                                : timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (clock_fd_ < 0) {
+            log_error("Failed to create headless output clock: " + std::string(strerror(errno)));
+            return false;
+        }
+    }
+    
+    log_info("Headless backend initialized successfully");
+    return true;
+}
+
+void HeadlessBackend::destroy() {
+    if (recorder_) {
+        recorder_->close();
+        log_info("Recorded " + std::to_string(recorder_->get_frames_written()) + " frames to " + record_path_);
+        recorder_.reset();
+    }
+    if (clock_fd_ >= 0) {
+        close(clock_fd_);
+        clock_fd_ = -1;
+    }
+    outputs_.clear();
+}
+
+std::vector<Monitor> HeadlessBackend::get_monitors() {
+    std::vector<Monitor> monitors;
+    for (const auto& output : outputs_) {
+        monitors.push_back(output.monitor);
+    }
+    return monitors;
+}
+
+bool HeadlessBackend::set_wallpaper(const std::string& monitor_name, GLuint texture, int width, int height) {
+    if (monitor_name == "ALL") {
+        return set_wallpaper_all(texture, width, height);
+    }
+    
+    auto it = std::find_if(outputs_.begin(), outputs_.end(),
+                           [&monitor_name](const Output& output) { return output.monitor.name == monitor_name; });
+    if (it == outputs_.end()) {
+        log_error("Output not found: " + monitor_name);
+        return false;
+    }
+    
+    return present(static_cast<size_t>(it - outputs_.begin()), texture);
+}
+
+bool HeadlessBackend::set_wallpaper_all(GLuint texture, int width, int height) {
+    (void)width;
+    (void)height;
+    
+    bool success = true;
+    for (size_t i = 0; i < outputs_.size(); i++) {
+        if (!present(i, texture)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool HeadlessBackend::present(size_t index, GLuint texture) {
+    if (!renderer_) return false;
+    
+    Output& output = outputs_[index];
+    const Monitor& monitor = output.monitor;
+    Renderer::FramebufferInfo target = renderer_->get_or_create_framebuffer(
+        monitor.width, monitor.height, GL_RGBA8, kFramebufferSlotBase + static_cast<uint32_t>(index));
+    if (target.fbo == 0) {
+        log_error("Failed to create framebuffer for " + monitor.name);
+        return false;
+    }
+    
+    if (!renderer_->render_texture_to_framebuffer(target, texture, monitor.name)) {
+        return false;
+    }
+    
+    // The readback stands in for the swap: it waits for the frame to finish
+    GpuProfiler& profiler = renderer_->get_profiler();
+    const std::string present_stage = profiler.is_enabled() ? "present:" + monitor.name : std::string();
+    profiler.begin_stage(present_stage);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char>& frame = output.ring[output.frames_presented % kRingFrames];
+    frame.resize(static_cast<size_t>(monitor.width) * monitor.height * 4);
+    bool read = renderer_->read_texture_rgba(target.texture, monitor.width, monitor.height, frame.data());
+    auto end = std::chrono::steady_clock::now();
+    profiler.end_stage(present_stage);
+    if (!read) {
+        return false;
+    }
+    
+    readback_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (frames_presented_ == 0) {
+        first_present_time_ = start;
+    }
+    last_present_time_ = end;
+    frames_presented_++;
+    output.frames_presented++;
+    
+    if (index != 0 || clock_fd_ < 0) return true;
+    
+    if (step_clock_) {
+        // A stepped clock ticks on the first present after each step
+        if (tick_wanted_) {
+            tick_wanted_ = false;
+            tick();
+            uint64_t one = 1;
+            while (write(clock_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+            }
+        }
+    } else if (output.frames_presented == 1) {
+        // The output clock starts with the first frame of the recorded output
+        tick();
+        int64_t interval_ns = 1000000000LL / record_fps_;
+        struct itimerspec period = {};
+        period.it_interval.tv_sec = static_cast<time_t>(interval_ns / 1000000000LL);
+        period.it_interval.tv_nsec = static_cast<long>(interval_ns % 1000000000LL);
+        period.it_value = period.it_interval;
+        timerfd_settime(clock_fd_, 0, &period, nullptr);
+    }
+    return true;
+}
+
+void HeadlessBackend::tick() {
+    ticks_++;
+    if (recorder_ && !recorder_->write_frame(get_frame(outputs_.front().monitor.name))) {
+        log_error("Recording to " + record_path_ + " stopped");
+        recorder_.reset();
+    }
+    if (frame_limit_ > 0 && ticks_ >= frame_limit_) {
+        should_quit_ = true;
+    }
+}
+
+const unsigned char* HeadlessBackend::get_frame(const std::string& monitor_name, size_t age) const {
+    for (const auto& output : outputs_) {
+        if (output.monitor.name != monitor_name) continue;
+        if (age >= kRingFrames || age >= output.frames_presented) return nullptr;
+        return output.ring[(output.frames_presented - 1 - age) % kRingFrames].data();
+    }
+    return nullptr;
+}
+
+void* HeadlessBackend::get_native_display() {
+    // The renderer falls back to a surfaceless or pbuffer EGL display
+    return nullptr;
+}
+
+const std::string& HeadlessBackend::get_backend_name() const {
+    return backend_name_;
+}
+
+void HeadlessBackend::process_capture() {
+    if (clock_fd_ < 0) return;
+    
+    uint64_t expirations = 0;
+    if (read(clock_fd_, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+    if (step_clock_) {
+        tick_wanted_ = true;  // The caller steps the media clock and draws
+        return;
+    }
+    
+    // A late wakeup owes several ticks; each repeats the latest frame, so
+    // the recording keeps real time
+    for (uint64_t i = 0; i < expirations && !should_quit_; i++) {
+        tick();
+    }
+}
+
+bool HeadlessBackend::should_quit() const {
+    return should_quit_;
+}
+
+void HeadlessBackend::set_renderer(Renderer* renderer) {
+    renderer_ = renderer;
+}
+
+void HeadlessBackend::dump_stats() const {
+    if (frames_presented_ == 0) return;
+    
+    double seconds = std::chrono::duration<double>(last_present_time_ - first_present_time_).count();
+    char message[192];
+    snprintf(message, sizeof(message), "Headless: %llu frames presented (%.1f per second), avg readback %.2f ms",
+             static_cast<unsigned long long>(frames_presented_),
+             seconds > 0.0 ? (frames_presented_ - 1) / seconds : 0.0,
+             static_cast<double>(readback_ns_) / frames_presented_ / 1e6);
+    log_info(message);
+    if (recorder_) {
+        log_info("Headless: " + std::to_string(recorder_->get_frames_written()) + " frames recorded to " +
+                 record_path_);
+    }
+}
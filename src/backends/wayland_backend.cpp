@@ -226,6 +226,7 @@ WaylandSurface* WaylandBackend::create_surface_for_output(WaylandOutput* output)
     log_debug("Creating surface for output: " + output->name);
     
     auto surface = std::make_unique<WaylandSurface>();
+    surface->output = output;
     
     // Create Wayland surface
     surface->surface = wl_compositor_create_surface(compositor_);
@@ -282,7 +283,8 @@ WaylandSurface* WaylandBackend::create_surface_for_output(WaylandOutput* output)
     return surface_ptr;
 }
 
-void WaylandBackend::render_to_surface(WaylandSurface* surface, GLuint texture, int tex_width, int tex_height) {
+void WaylandBackend::render_to_surface(WaylandSurface* surface, GLuint texture, int tex_width, int tex_height,
+                                       const std::string& output_name) {
     if (!surface || !surface->configured || !surface->egl_window) {
         log_debug("Surface not ready for rendering - configured: " + std::to_string(surface ? surface->configured : false) + 
                  ", egl_window: " + std::to_string(surface && surface->egl_window != nullptr));
@@ -318,7 +320,8 @@ void WaylandBackend::render_to_surface(WaylandSurface* surface, GLuint texture,
     
     // Render the texture to the surface
     log_debug("Calling renderer->render_texture_to_surface");
-    bool result = renderer_->render_texture_to_surface(surface->egl_surface, texture, surface->width, surface->height);
+    bool result = renderer_->render_texture_to_surface(surface->egl_surface, texture, surface->width, surface->height,
+                                                       output_name);
     log_debug("Render result: " + std::to_string(result));
     
     if (result) {
@@ -365,15 +368,14 @@ bool WaylandBackend::render_to_output(WaylandOutput* output, GLuint texture, int
     }
     
     // Render the texture to the surface
-    render_to_surface(surface, texture, tex_width, tex_height);
+    render_to_surface(surface, texture, tex_width, tex_height, generate_output_name(output));
     return true;
 }
 
 WaylandSurface* WaylandBackend::find_surface_for_output(WaylandOutput* output) {
-    // For now, we'll use a simple approach - one surface per output
-    // This could be enhanced to track which surface belongs to which output
+    // One surface per output; outputs can show different media
     for (auto& surface : surfaces_) {
-        if (surface->configured) {
+        if (surface->output == output) {
             return surface.get();
         }
     }
@@ -414,6 +416,10 @@ bool WaylandBackend::should_quit() const {
     return should_quit_;
 }
 
+int WaylandBackend::get_event_fd() const {
+    return display_ ? wl_display_get_fd(display_) : -1;
+}
+
 // Helper function to generate meaningful output names
 std::string WaylandBackend::generate_output_name(const WaylandOutput* output) {
     if (!output->name.empty() && output->name != "Unknown") {
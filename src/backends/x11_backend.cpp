@@ -163,10 +163,15 @@ bool X11Backend::set_wallpaper(const std::string& monitor_name, GLuint texture,
 bool X11Backend::set_wallpaper_all(GLuint texture, int width, int height) {
     if (!display_) return false;
     
+    // The root window is shared by all monitors, so present cost is attributed to it
+    static const std::string present_stage = "present:root";
+    if (renderer_) renderer_->get_profiler().begin_stage(present_stage);
+    
     // Convert OpenGL texture to X11 pixmap
     Pixmap pixmap = texture_to_pixmap(texture, width, height);
     if (pixmap == None) {
         log_error("Failed to convert texture to pixmap");
+        if (renderer_) renderer_->get_profiler().end_stage(present_stage);
         return false;
     }
     
@@ -175,6 +180,7 @@ bool X11Backend::set_wallpaper_all(GLuint texture, int width, int height) {
     // Clean up
     XFreePixmap(display_, pixmap);
     
+    if (renderer_) renderer_->get_profiler().end_stage(present_stage);
     return success;
 }
 
@@ -221,14 +227,9 @@ Pixmap X11Backend::texture_to_pixmap(GLuint texture, int width, int height) {
     // Read texture data from OpenGL
     std::vector<unsigned char> pixels(width * height * 4);
     
-    // Bind the texture and read its data
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
-    
-    // Check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        log_error("OpenGL error reading texture: " + std::to_string(error));
+    // Read back through a framebuffer (glGetTexImage doesn't exist on GLES)
+    bool read_ok = renderer_ && renderer_->read_texture_rgba(texture, width, height, pixels.data());
+    if (!read_ok) {
         log_warn("Falling back to test pattern");
         // Fall back to test pattern for debugging
         for (int y = 0; y < height; y++) {
@@ -327,6 +328,10 @@ bool X11Backend::should_quit() const {
     return should_quit_;
 }
 
+int X11Backend::get_event_fd() const {
+    return display_ ? ConnectionNumber(display_) : -1;
+}
+
 void X11Backend::set_renderer(Renderer* renderer) {
     renderer_ = renderer;
 }
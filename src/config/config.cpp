@@ -2,6 +2,8 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 
 Config Config::parse_args(int argc, char* argv[]) {
     Config config;
@@ -16,6 +18,12 @@ Config Config::parse_args(int argc, char* argv[]) {
         else if (arg == "-o" || arg == "--output") {
             if (i + 1 < argc) {
                 config.outputs.push_back(argv[++i]);
+                
+                // "-o NAME FILE" gives the output its own media
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    config.output_media.push_back({config.outputs.back(), argv[++i]});
+                    config.outputs.pop_back();
+                }
             }
         }
         else if (arg == "--no-loop") {
@@ -89,6 +97,195 @@ Config Config::parse_args(int argc, char* argv[]) {
                 }
             }
         }
+        else if (arg == "--vram-budget") {
+            if (i + 1 < argc) {
+                config.vram_budget_mb = std::max(16, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--stats") {
+            if (i + 1 < argc) {
+                config.stats_interval = std::max(0, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--dynamic-resolution") {
+            config.dynamic_resolution = true;
+        }
+        else if (arg == "--min-render-scale") {
+            if (i + 1 < argc) {
+                config.min_render_scale = std::max(0.25, std::min(1.0, std::stod(argv[++i])));
+            }
+        }
+        else if (arg == "--gles") {
+            config.use_gles = true;
+        }
+        else if (arg == "--seamless-loop") {
+            config.seamless_loop = true;
+        }
+        else if (arg == "--no-prescale") {
+            config.prescale = false;
+        }
+        else if (arg == "--engine") {
+            if (i + 1 < argc) {
+                std::string engine_value = argv[++i];
+                if (engine_value == "auto" || engine_value == "mpv" || engine_value == "lavc") {
+                    config.engine = engine_value;
+                } else {
+                    std::cerr << "Error: Invalid engine. Use: auto, mpv, or lavc\n";
+                    exit(1);
+                }
+            }
+        }
+        else if (arg == "--control-fifo") {
+            if (i + 1 < argc) {
+                config.control_fifo = argv[++i];
+            }
+        }
+        else if (arg == "--transition") {
+            if (i + 1 < argc) {
+                config.transition_ms = std::max(0, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--playlist") {
+            if (i + 1 < argc) {
+                config.playlist = argv[++i];
+            }
+        }
+        else if (arg == "--interval") {
+            if (i + 1 < argc) {
+                config.playlist_interval = std::max(1, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--shuffle") {
+            config.shuffle = true;
+        }
+        else if (arg == "--order") {
+            if (i + 1 < argc) {
+                std::string order_value = argv[++i];
+                if (order_value == "name" || order_value == "mtime") {
+                    config.playlist_order = order_value;
+                } else {
+                    std::cerr << "Error: Invalid playlist order. Use: name or mtime\n";
+                    exit(1);
+                }
+            }
+        }
+        else if (arg == "--schedule") {
+            if (i + 1 < argc) {
+                config.schedule = argv[++i];
+            }
+        }
+        else if (arg == "--location") {
+            if (i + 1 < argc) {
+                std::string location = argv[++i];
+                char trailing = 0;
+                if (sscanf(location.c_str(), "%lf,%lf%c", &config.latitude, &config.longitude, &trailing) != 2 ||
+                    std::abs(config.latitude) > 90.0 || std::abs(config.longitude) > 180.0) {
+                    std::cerr << "Error: Invalid location. Use: LAT,LON in degrees (e.g. 52.52,13.40)\n";
+                    exit(1);
+                }
+                config.has_location = true;
+            }
+        }
+        else if (arg == "--effect") {
+            if (i + 1 < argc) {
+                config.effect = argv[++i];
+            }
+        }
+        else if (arg == "--memory-budget") {
+            if (i + 1 < argc) {
+                int budget = std::stoi(argv[++i]);
+                config.memory_budget_mb = budget > 0 ? std::max(128, budget) : 0;
+            }
+        }
+        else if (arg == "--thumbnail") {
+            config.thumbnail = true;
+        }
+        else if (arg == "--thumbnail-size") {
+            if (i + 1 < argc) {
+                config.thumbnail_size = std::max(16, std::min(4096, std::stoi(argv[++i])));
+            }
+        }
+        else if (arg == "--thumbnail-dir") {
+            if (i + 1 < argc) {
+                config.thumbnail_dir = argv[++i];
+            }
+        }
+        else if (arg == "--thumbnail-format") {
+            if (i + 1 < argc) {
+                std::string format_value = argv[++i];
+                if (format_value == "webp" || format_value == "png") {
+                    config.thumbnail_format = format_value;
+                } else {
+                    std::cerr << "Error: Invalid thumbnail format. Use: webp or png\n";
+                    exit(1);
+                }
+            }
+        }
+        else if (arg == "--jobs") {
+            if (i + 1 < argc) {
+                config.jobs = std::max(0, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--span") {
+            config.span = true;
+        }
+        else if (arg == "--bezel") {
+            if (i + 1 < argc) {
+                // "PX" for both directions or "HxV"
+                std::string bezel_value = argv[++i];
+                size_t separator = bezel_value.find('x');
+                try {
+                    config.bezel_horizontal = std::stoi(bezel_value.substr(0, separator));
+                    config.bezel_vertical = separator == std::string::npos ? config.bezel_horizontal
+                                                                           : std::stoi(bezel_value.substr(separator + 1));
+                } catch (const std::exception&) {
+                    config.bezel_horizontal = -1;
+                }
+                if (config.bezel_horizontal < 0 || config.bezel_vertical < 0) {
+                    std::cerr << "Error: Invalid bezel. Use: PX or HxV (pixels)\n";
+                    exit(1);
+                }
+            }
+        }
+        else if (arg == "--cache-budget") {
+            if (i + 1 < argc) {
+                config.cache_budget_mb = std::max(0, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--headless") {
+            if (i + 1 < argc) {
+                // "WxH", or several separated by commas for more outputs
+                std::string sizes_value = argv[++i];
+                size_t start = 0;
+                while (start <= sizes_value.size()) {
+                    size_t end = sizes_value.find(',', start);
+                    if (end == std::string::npos) end = sizes_value.size();
+                    int width = 0, height = 0;
+                    char trailing = 0;
+                    std::string size_value = sizes_value.substr(start, end - start);
+                    if (sscanf(size_value.c_str(), "%dx%d%c", &width, &height, &trailing) != 2 ||
+                        width < 1 || height < 1 || width > 16384 || height > 16384) {
+                        std::cerr << "Error: Invalid headless size. Use: WxH[,WxH...]\n";
+                        exit(1);
+                    }
+                    config.headless_sizes.push_back({width, height});
+                    start = end + 1;
+                }
+            }
+        }
+        else if (arg == "--record") {
+            if (i + 1 < argc) {
+                config.record_path = argv[++i];
+            }
+        }
+        else if (arg == "--frames") {
+            if (i + 1 < argc) {
+                config.frame_limit = static_cast<uint64_t>(std::max(0LL, std::stoll(argv[++i])));
+            }
+        }
+        else if (arg == "--deterministic") {
+            config.deterministic = true;
+        }
         else if (arg == "--force-x11") {
             config.force_x11 = true;
         }
@@ -108,10 +305,50 @@ Config Config::parse_args(int argc, char* argv[]) {
         }
         else if (arg[0] != '-') {
             config.media_path = arg;
+            config.thumbnail_inputs.push_back(arg);
+        }
+    }
+    
+    // Thumbnail mode takes any number of files and needs no main wallpaper
+    if (config.thumbnail) {
+        for (const auto& binding : config.output_media) {
+            config.thumbnail_inputs.push_back(binding.media_path);
+        }
+        if (config.thumbnail_inputs.empty()) {
+            std::cerr << "Error: --thumbnail needs at least one media file\n";
+            exit(1);
         }
+        return config;
+    }
+    config.thumbnail_inputs.clear();
+    
+    if (!config.headless_sizes.empty() && (config.force_x11 || config.force_wayland)) {
+        std::cerr << "Error: --headless can't be combined with --force-x11 or --force-wayland\n";
+        exit(1);
+    }
+    if (config.headless_sizes.empty() && (!config.record_path.empty() || config.frame_limit > 0)) {
+        std::cerr << "Error: --record and --frames need --headless\n";
+        exit(1);
+    }
+    if (config.deterministic && config.record_path.empty() && config.frame_limit == 0) {
+        std::cerr << "Error: --deterministic needs --record or --frames\n";
+        exit(1);
+    }
+    if (!config.schedule.empty() && !config.playlist.empty()) {
+        std::cerr << "Error: --schedule and --playlist can't be combined\n";
+        exit(1);
+    }
+    
+    // Without a separate media path the first "-o NAME FILE" names the main
+    // wallpaper, so "-o DP-1 video.mp4" keeps its old meaning
+    if (config.media_path.empty() && config.playlist.empty() && config.schedule.empty() &&
+        !config.output_media.empty()) {
+        config.media_path = config.output_media[0].media_path;
+        config.outputs.push_back(config.output_media[0].output);
+        config.output_media.erase(config.output_media.begin());
     }
     
-    if (config.media_path.empty()) {
+    if (config.media_path.empty() && config.playlist.empty() && config.schedule.empty()) {
         std::cerr << "Error: Media path is required\n";
         print_help(argv[0]);
         exit(1);
@@ -130,11 +367,11 @@ void Config::print_help(const char* program_name) {
     std::cout << "Usage: " << program_name << " [OPTIONS] <media_path>\n\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help                 Show this help message\n";
-    std::cout << "  -o, --output OUTPUT        Set wallpaper on specific output (can be used multiple times)\n";
-    std::cout << "                             Use 'ALL' for all outputs (default)\n";
+    std::cout << "  -o, --output OUTPUT [FILE] Set wallpaper on specific output (can be used multiple times)\n";
+    std::cout << "                             Use 'ALL' for all outputs (default); FILE plays on that output only\n";
     std::cout << "  -r, --screen-root OUTPUT   Alias for --output (for GUI compatibility)\n";
     std::cout << "  -b, --bg PATH              Alias for media path (for GUI compatibility)\n";
-    std::cout << "  -f, --fps FPS              Set target FPS (default: 30)\n";
+    std::cout << "  -f, --fps FPS              Maximum FPS; video plays at its own rate (default: 30)\n";
     std::cout << "  -s, --silent               Mute audio\n";
     std::cout << "  --noautomute               Don't automatically mute audio when other apps play sound\n";
     std::cout << "  --scaling MODE             Scaling mode: stretch, fit, fill, default (default: fit)\n";
@@ -142,6 +379,42 @@ void Config::print_help(const char* program_name) {
     std::cout << "  --no-hardware-decode       Disable hardware decoding\n";
     std::cout << "  --volume VOLUME            Set audio volume (0.0-1.0 or 0-100, default: 0.5)\n";
     std::cout << "  --mpv-options OPTIONS      Additional MPV options\n";
+    std::cout << "  --vram-budget MB           VRAM budget for cached render targets (default: 256)\n";
+    std::cout << "  --stats SECONDS            Log performance statistics every SECONDS (default: off)\n";
+    std::cout << "  --dynamic-resolution       Lower the internal render resolution when frames run over budget\n";
+    std::cout << "  --min-render-scale SCALE   Lowest render scale for --dynamic-resolution (0.25-1.0, default: 0.5)\n";
+    std::cout << "  --gles                     Render with OpenGL ES 3 (or ES 2) instead of desktop OpenGL\n";
+    std::cout << "  --engine ENGINE            Media engine: auto, mpv, lavc (default: auto - lavc for muted simple loops)\n";
+    std::cout << "  --no-prescale              Don't downscale videos larger than the output before rendering\n";
+    std::cout << "  --seamless-loop            Restart loops without a hitch: a second engine pre-rolls the video\n";
+    std::cout << "                             and takes over at the end (short loops: the start stays cached)\n";
+    std::cout << "  --cache-budget MB          Keep media files up to MB in memory instead of re-reading them every loop (default: 256, 0 = off)\n";
+    std::cout << "  --control-fifo PATH        Accept commands (\"switch FILE\", \"next\", \"bind OUTPUT FILE\", \"effect FILE|none\") on a FIFO at PATH\n";
+    std::cout << "  --transition MS            Crossfade length when switching wallpapers (default: 500, 0 = cut)\n";
+    std::cout << "  --memory-budget MB         Split MB across media cache, demuxer cache, decoder surfaces and VRAM pool\n";
+    std::cout << "                             (min 128; overrides --cache-budget and --vram-budget)\n";
+    std::cout << "  --thumbnail                Write previews of the given files to the thumbnail cache and exit\n";
+    std::cout << "                             Prints \"FILE<TAB>THUMBNAIL\" per file; takes any number of files\n";
+    std::cout << "  --thumbnail-size PX        Longest edge of thumbnails (default: 320)\n";
+    std::cout << "  --thumbnail-dir DIR        Thumbnail cache (default: ~/.cache/wallpaper-ne-linux/thumbnails)\n";
+    std::cout << "  --thumbnail-format FORMAT  Thumbnail format: webp, png (default: webp)\n";
+    std::cout << "  --jobs N                   Files processed in parallel by --thumbnail (default: 0 = one per core)\n";
+    std::cout << "  --span                     Stretch one picture across all outputs instead of repeating it\n";
+    std::cout << "  --bezel PX|HxV             Pixels hidden behind monitor frames between spanned outputs (default: 0)\n";
+    std::cout << "  --playlist PATH            Cycle through a directory or list file of wallpapers (replaces media_path)\n";
+    std::cout << "  --interval SECONDS         Time per playlist item (default: 300)\n";
+    std::cout << "  --shuffle                  Play the playlist in random order\n";
+    std::cout << "  --order ORDER              Playlist order: name, mtime (default: name for directories, file order for lists)\n";
+    std::cout << "  --schedule FILE            Time-of-day wallpapers from a manifest (replaces media_path)\n";
+    std::cout << "  --location LAT,LON         Location for sunrise/sunset times in --schedule (overrides the manifest)\n";
+    std::cout << "  --effect FILE              Draw the wallpaper through a fragment shader; shaders using the\n";
+    std::cout << "                             audioBands/audioLevel uniforms react to what is playing\n";
+    std::cout << "  --headless WxH[,WxH...]    Render to offscreen outputs of these sizes instead of a display\n";
+    std::cout << "  --record PATH              Write the first headless output to PATH: .y4m, .png (%05d numbers\n";
+    std::cout << "                             the frames), or a video such as .mp4/.mkv\n";
+    std::cout << "  --frames N                 Quit after N headless frames at --fps (default: 0 = run until stopped)\n";
+    std::cout << "  --deterministic            Advance the media by exactly 1/--fps per headless frame instead of\n";
+    std::cout << "                             playing in real time, so runs record the same frames\n";
     std::cout << "  --force-x11                Force X11 backend\n";
     std::cout << "  --force-wayland            Force Wayland backend\n";
     std::cout << "  -v, --verbose              Enable verbose output\n";
@@ -0,0 +1,103 @@
+#include "universal-wallpaper/control_channel.h"
+#include "universal-wallpaper/utils.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ControlChannel::~ControlChannel() {
+    close();
+}
+
+bool ControlChannel::open(const std::string& path) {
+    close();
+    
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        if (!S_ISFIFO(st.st_mode)) {
+            log_error("Control path exists and is not a FIFO: " + path);
+            return false;
+        }
+    } else if (mkfifo(path.c_str(), 0600) == 0) {
+        created_ = true;
+    } else {
+        log_error("Failed to create control FIFO " + path + ": " + strerror(errno));
+        return false;
+    }
+    
+    read_fd_ = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd_ >= 0) {
+        write_fd_ = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (read_fd_ < 0 || write_fd_ < 0) {
+        log_error("Failed to open control FIFO " + path + ": " + strerror(errno));
+        path_ = path;
+        close();
+        return false;
+    }
+    
+    path_ = path;
+    log_info("Listening for commands on " + path);
+    return true;
+}
+
+void ControlChannel::close() {
+    if (read_fd_ >= 0) {
+        ::close(read_fd_);
+        read_fd_ = -1;
+    }
+    if (write_fd_ >= 0) {
+        ::close(write_fd_);
+        write_fd_ = -1;
+    }
+    if (created_) {
+        unlink(path_.c_str());
+        created_ = false;
+    }
+    path_.clear();
+    buffer_.clear();
+    discarding_ = false;
+}
+
+std::vector<std::string> ControlChannel::read_commands() {
+    std::vector<std::string> commands;
+    if (read_fd_ < 0) return commands;
+    
+    char chunk[1024];
+    for (;;) {
+        ssize_t count = read(read_fd_, chunk, sizeof(chunk));
+        if (count > 0) {
+            buffer_.append(chunk, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        break;
+    }
+    
+    size_t start = 0;
+    for (size_t newline = buffer_.find('\n'); newline != std::string::npos; newline = buffer_.find('\n', start)) {
+        std::string line = buffer_.substr(start, newline - start);
+        start = newline + 1;
+        if (discarding_) {
+            // The rest of a command already dropped as oversized
+            discarding_ = false;
+            continue;
+        }
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.size() > kMaxLineLength) {
+            log_warn("Dropping oversized control command");
+            continue;
+        }
+        if (!line.empty()) commands.push_back(std::move(line));
+    }
+    buffer_.erase(0, start);
+    
+    // A partial line already too long; drop what arrived and the rest of it
+    if (buffer_.size() > kMaxLineLength) {
+        if (!discarding_) log_warn("Dropping oversized control command");
+        buffer_.clear();
+        discarding_ = true;
+    }
+    return commands;
+}
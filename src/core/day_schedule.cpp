@@ -0,0 +1,338 @@
+#include "universal-wallpaper/day_schedule.h"
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kDegrees = kPi / 180.0;
+
+// Sun altitudes at the events, in degrees: the upper limb touching the
+// horizon after refraction, and civil twilight
+static constexpr double kSunriseAltitude = -0.833;
+static constexpr double kTwilightAltitude = -6.0;
+
+// Solar noon of a UTC date and the hour angle at which the sun crosses
+// `altitude`, from the sunrise equation (good to about a minute). False if
+// the sun stays above or below that altitude all day.
+static bool solar_day(int year, int month, int day, double latitude, double longitude, double altitude,
+                      double& noon_julian, double& hour_angle) {
+    tm date = {};
+    date.tm_year = year - 1900;
+    date.tm_mon = month - 1;
+    date.tm_mday = day;
+    date.tm_hour = 12;
+    double julian_day = static_cast<double>(timegm(&date)) / 86400.0 + 2440587.5;
+    
+    double days = std::round(julian_day - 2451545.0) - longitude / 360.0;
+    double anomaly = std::fmod(357.5291 + 0.98560028 * days, 360.0) * kDegrees;
+    double center = 1.9148 * std::sin(anomaly) + 0.02 * std::sin(2 * anomaly) + 0.0003 * std::sin(3 * anomaly);
+    double ecliptic = std::fmod(anomaly / kDegrees + center + 180.0 + 102.9372, 360.0) * kDegrees;
+    noon_julian = 2451545.0 + days + 0.0053 * std::sin(anomaly) - 0.0069 * std::sin(2 * ecliptic);
+    
+    double declination = std::asin(std::sin(ecliptic) * std::sin(23.4397 * kDegrees));
+    double cos_angle = (std::sin(altitude * kDegrees) - std::sin(latitude * kDegrees) * std::sin(declination)) /
+                       (std::cos(latitude * kDegrees) * std::cos(declination));
+    if (cos_angle < -1.0 || cos_angle > 1.0) return false;
+    hour_angle = std::acos(cos_angle) / kDegrees;
+    return true;
+}
+
+static time_t julian_to_time(double julian) {
+    return static_cast<time_t>(std::llround((julian - 2440587.5) * 86400.0));
+}
+
+bool DaySchedule::load(const std::string& path) {
+    entries_.clear();
+    
+    std::ifstream manifest(path);
+    if (!manifest) {
+        log_error("Failed to open schedule " + path);
+        return false;
+    }
+    
+    std::string base = path.substr(0, path.find_last_of('/') + 1);
+    std::string line;
+    int line_number = 0;
+    while (std::getline(manifest, line)) {
+        line_number++;
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') continue;
+        
+        std::istringstream fields(line);
+        std::string first;
+        fields >> first;
+        if (first == "location") {
+            double latitude = 0.0;
+            double longitude = 0.0;
+            if (!(fields >> latitude >> longitude) || std::abs(latitude) > 90.0 || std::abs(longitude) > 180.0) {
+                log_error("Invalid location in " + path + ":" + std::to_string(line_number));
+                return false;
+            }
+            if (!has_location_) {
+                latitude_ = latitude;
+                longitude_ = longitude;
+                has_location_ = true;
+            }
+            continue;
+        }
+        if (first == "transition") {
+            if (!(fields >> default_window_minutes_) || default_window_minutes_ < 0) {
+                log_error("Invalid transition in " + path + ":" + std::to_string(line_number));
+                return false;
+            }
+            continue;
+        }
+        
+        Entry entry;
+        if (!parse_time(first, entry)) {
+            log_error("Invalid time '" + first + "' in " + path + ":" + std::to_string(line_number));
+            return false;
+        }
+        
+        // The media path may contain spaces; a trailing number is the window
+        std::string rest;
+        std::getline(fields, rest);
+        rest.erase(0, rest.find_first_not_of(" \t"));
+        size_t last_space = rest.find_last_of(" \t");
+        if (last_space != std::string::npos &&
+            rest.find_first_not_of("0123456789", last_space + 1) == std::string::npos) {
+            entry.window_minutes = std::atoi(rest.c_str() + last_space + 1);
+            rest.erase(rest.find_last_not_of(" \t", last_space) + 1);
+        }
+        if (rest.empty()) {
+            log_error("Missing media in " + path + ":" + std::to_string(line_number));
+            return false;
+        }
+        
+        entry.media_path = rest[0] == '/' ? rest : base + rest;
+        std::string file = PkgReader::is_package_path(entry.media_path) ?
+            entry.media_path.substr(0, entry.media_path.find('#')) : entry.media_path;
+        if (!file_exists(file)) {
+            log_error("Schedule media not found: " + entry.media_path);
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+    }
+    
+    if (entries_.empty()) {
+        log_error("Schedule has no entries: " + path);
+        return false;
+    }
+    for (const auto& entry : entries_) {
+        if (entry.anchor != Anchor::Clock && !has_location_) {
+            log_error("Schedule uses sun times but has no location; add a location line or use --location");
+            return false;
+        }
+    }
+    return true;
+}
+
+void DaySchedule::set_location(double latitude, double longitude) {
+    latitude_ = latitude;
+    longitude_ = longitude;
+    has_location_ = true;
+    resolved_day_ = -1;
+}
+
+bool DaySchedule::parse_time(const std::string& text, Entry& entry) const {
+    static const struct { const char* name; Anchor anchor; } kAnchors[] = {
+        {"dawn", Anchor::Dawn}, {"sunrise", Anchor::Sunrise}, {"noon", Anchor::Noon},
+        {"sunset", Anchor::Sunset}, {"dusk", Anchor::Dusk}
+    };
+    
+    for (const auto& anchor : kAnchors) {
+        size_t length = strlen(anchor.name);
+        if (text.compare(0, length, anchor.name) != 0) continue;
+        
+        entry.anchor = anchor.anchor;
+        entry.minutes = 0;
+        if (text.size() == length) return true;
+        if (text[length] != '+' && text[length] != '-') return false;
+        
+        char* end = nullptr;
+        long offset = std::strtol(text.c_str() + length + 1, &end, 10);
+        if (end == text.c_str() + length + 1 || *end != '\0' || offset > 24 * 60) return false;
+        entry.minutes = static_cast<int>(text[length] == '-' ? -offset : offset);
+        return true;
+    }
+    
+    int hours = 0;
+    int minutes = 0;
+    char trailing = 0;
+    if (sscanf(text.c_str(), "%d:%d%c", &hours, &minutes, &trailing) != 2 ||
+        hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
+        return false;
+    }
+    entry.anchor = Anchor::Clock;
+    entry.minutes = hours * 60 + minutes;
+    return true;
+}
+
+void DaySchedule::resolve(time_t now) {
+    tm local = {};
+    localtime_r(&now, &local);
+    int day = (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+    if (day == resolved_day_) return;
+    resolved_day_ = day;
+    
+    slots_.clear();
+    for (int offset = -1; offset <= 1; offset++) {
+        // mktime normalizes the day and minute overflow, DST included
+        tm midnight = {};
+        midnight.tm_year = local.tm_year;
+        midnight.tm_mon = local.tm_mon;
+        midnight.tm_mday = local.tm_mday + offset;
+        midnight.tm_isdst = -1;
+        mktime(&midnight);
+        
+        double noon_julian = 0.0;
+        double sun_angle = 0.0;
+        double twilight_angle = 0.0;
+        bool has_sun = false;
+        bool has_twilight = false;
+        if (has_location_) {
+            int year = midnight.tm_year + 1900;
+            int month = midnight.tm_mon + 1;
+            has_sun = solar_day(year, month, midnight.tm_mday, latitude_, longitude_, kSunriseAltitude,
+                                noon_julian, sun_angle);
+            has_twilight = solar_day(year, month, midnight.tm_mday, latitude_, longitude_, kTwilightAltitude,
+                                     noon_julian, twilight_angle);
+        }
+        
+        for (size_t i = 0; i < entries_.size(); i++) {
+            const Entry& entry = entries_[i];
+            time_t start = 0;
+            switch (entry.anchor) {
+                case Anchor::Clock: {
+                    tm when = midnight;
+                    when.tm_min = entry.minutes;
+                    when.tm_isdst = -1;
+                    start = mktime(&when);
+                    break;
+                }
+                case Anchor::Noon:
+                    if (!has_location_) continue;
+                    start = julian_to_time(noon_julian);
+                    break;
+                case Anchor::Sunrise:
+                case Anchor::Sunset:
+                    if (!has_sun) continue;  // Polar day or night
+                    start = julian_to_time(noon_julian + (entry.anchor == Anchor::Sunrise ? -sun_angle : sun_angle) / 360.0);
+                    break;
+                case Anchor::Dawn:
+                case Anchor::Dusk:
+                    if (!has_twilight) continue;
+                    start = julian_to_time(noon_julian + (entry.anchor == Anchor::Dawn ? -twilight_angle : twilight_angle) / 360.0);
+                    break;
+            }
+            if (entry.anchor != Anchor::Clock) {
+                start += static_cast<time_t>(entry.minutes) * 60;
+            }
+            
+            int window = entry.window_minutes >= 0 ? entry.window_minutes : default_window_minutes_;
+            slots_.push_back(Slot{start, static_cast<time_t>(window) * 60, i});
+        }
+    }
+    std::stable_sort(slots_.begin(), slots_.end(),
+                     [](const Slot& a, const Slot& b) { return a.start < b.start; });
+}
+
+size_t DaySchedule::slot_at(time_t now) const {
+    auto it = std::upper_bound(slots_.begin(), slots_.end(), now,
+                               [](time_t time, const Slot& slot) { return time < slot.start; });
+    if (it == slots_.begin()) return slots_.size();
+    return static_cast<size_t>(it - slots_.begin()) - 1;
+}
+
+bool DaySchedule::start(Clock::time_point now) {
+    time_t time = Clock::to_time_t(now);
+    resolve(time);
+    size_t index = slot_at(time);
+    if (index == slots_.size()) {
+        log_error("No schedule entry applies today at this location");
+        return false;
+    }
+    
+    current_entry_ = slots_[index].entry;
+    current_start_ = slots_[index].start;
+    current_window_ = slots_[index].window;
+    prepared_ = false;
+    return true;
+}
+
+const std::string& DaySchedule::next() const {
+    size_t index = slot_at(current_start_);
+    if (index + 1 < slots_.size()) {
+        return entries_[slots_[index + 1].entry].media_path;
+    }
+    return current();
+}
+
+DaySchedule::Action DaySchedule::update(Clock::time_point now) {
+    time_t time = Clock::to_time_t(now);
+    resolve(time);
+    size_t index = slot_at(time);
+    if (index == slots_.size()) return Action::None;
+    
+    const Slot& slot = slots_[index];
+    if (slot.start != current_start_ || slot.entry != current_entry_) {
+        // Consecutive entries may share media; only the timing moves on
+        bool changed = entries_[slot.entry].media_path != current();
+        current_entry_ = slot.entry;
+        current_start_ = slot.start;
+        current_window_ = slot.window;
+        prepared_ = false;
+        if (!changed) return Action::None;
+        switches_++;
+        return Action::Switch;
+    }
+    
+    if (!prepared_ && index + 1 < slots_.size() &&
+        Clock::from_time_t(slots_[index + 1].start) - now <= kPrepareLead) {
+        prepared_ = true;
+        if (next() != current()) return Action::Prepare;
+    }
+    return Action::None;
+}
+
+void DaySchedule::get_transition(Clock::time_point now, std::chrono::milliseconds& duration,
+                                 std::chrono::milliseconds& elapsed) const {
+    duration = std::chrono::seconds(current_window_);
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - Clock::from_time_t(current_start_));
+    elapsed = std::max(std::chrono::milliseconds(0), std::min(elapsed, duration));
+}
+
+DaySchedule::Clock::duration DaySchedule::time_until_action(Clock::time_point now) const {
+    size_t index = slot_at(Clock::to_time_t(now));
+    if (index + 1 >= slots_.size()) return Clock::duration::max();
+    
+    Clock::time_point next_start = Clock::from_time_t(slots_[index + 1].start);
+    Clock::time_point next_action = prepared_ ? next_start : next_start - kPrepareLead;
+    return std::max<Clock::duration>(Clock::duration::zero(), next_action - now);
+}
+
+void DaySchedule::frame_presented(Clock::time_point now) {
+    if (now < Clock::from_time_t(current_start_ + current_window_)) {
+        settled_ = false;
+        return;
+    }
+    if (!settled_) {
+        settled_ = true;
+        return;
+    }
+    frames_between_windows_++;
+}
+
+void DaySchedule::dump_stats() const {
+    if (entries_.empty()) return;
+    log_info("Schedule: " + std::to_string(switches_) + " switches, " + std::to_string(entries_.size()) +
+             " entries, " + std::to_string(frames_between_windows_) + " frames between windows, now showing " +
+             current());
+}
@@ -1,6 +1,7 @@
 #include "universal-wallpaper/display_manager.h"
 #include "universal-wallpaper/x11_backend.h"
 #include "universal-wallpaper/wayland_backend.h"
+#include "universal-wallpaper/headless_backend.h"
 #include "universal-wallpaper/utils.h"
 
 DisplayManager::DisplayManager() = default;
@@ -57,6 +58,16 @@ bool DisplayManager::initialize(bool force_x11, bool force_wayland) {
         return false;
     }
     
+    return initialize_backend();
+}
+
+bool DisplayManager::initialize_headless(const std::vector<std::pair<int, int>>& sizes, const std::string& record_path,
+                                         int record_fps, uint64_t frame_limit, bool step_clock) {
+    backend_ = std::make_unique<HeadlessBackend>(sizes, record_path, record_fps, frame_limit, step_clock);
+    return initialize_backend();
+}
+
+bool DisplayManager::initialize_backend() {
     if (!backend_->initialize()) {
         log_error("Failed to initialize display backend");
         backend_.reset();
@@ -117,6 +128,28 @@ bool DisplayManager::should_quit() const {
     return backend_->should_quit();
 }
 
+int DisplayManager::get_event_fd() const {
+    if (!backend_) return -1;
+    return backend_->get_event_fd();
+}
+
+void DisplayManager::process_capture() {
+    if (backend_) {
+        backend_->process_capture();
+    }
+}
+
+int DisplayManager::get_capture_fd() const {
+    if (!backend_) return -1;
+    return backend_->get_capture_fd();
+}
+
+void DisplayManager::dump_stats() const {
+    if (backend_) {
+        backend_->dump_stats();
+    }
+}
+
 std::unique_ptr<DisplayBackend> DisplayManager::create_wayland_backend() {
     try {
         return std::make_unique<WaylandBackend>();
@@ -0,0 +1,81 @@
+#include "universal-wallpaper/frame_scheduler.h"
+#include "universal-wallpaper/utils.h"
+#include <mpv/render.h>
+#include <algorithm>
+#include <cstdio>
+
+FrameScheduler::FrameScheduler(int max_fps) {
+    set_max_fps(max_fps);
+}
+
+void FrameScheduler::set_max_fps(int max_fps) {
+    max_fps = std::max(1, max_fps);
+    min_interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / max_fps;
+}
+
+FrameScheduler::Action FrameScheduler::decide(uint64_t info_flags, int64_t target_delay_us, Clock::time_point now) {
+    if (!(info_flags & MPV_RENDER_FRAME_INFO_PRESENT)) {
+        waiting_ = false;
+        return Action::None;
+    }
+    
+    // Redraws (resize, reconfig) always need real rendering; plain repeats
+    // of the displayed frame never change a pixel
+    if ((info_flags & MPV_RENDER_FRAME_INFO_REPEAT) && !(info_flags & MPV_RENDER_FRAME_INFO_REDRAW)) {
+        waiting_ = false;
+        return Action::Skip;
+    }
+    
+    Clock::time_point due = now;
+    if (target_delay_us > 1000) {
+        due = now + std::chrono::microseconds(target_delay_us);
+    }
+    due = std::max(due, last_render_ + min_interval_);
+    
+    if (due > now) {
+        if (!waiting_) {
+            deferred_++;
+        }
+        waiting_ = true;
+        due_time_ = due;
+        return Action::Wait;
+    }
+    
+    waiting_ = false;
+    return Action::Render;
+}
+
+bool FrameScheduler::can_render(Clock::time_point now) const {
+    return now - last_render_ >= min_interval_;
+}
+
+FrameScheduler::Clock::duration FrameScheduler::time_until_due(Clock::time_point now) const {
+    if (!waiting_) return Clock::duration::max();
+    return std::max(Clock::duration::zero(), due_time_ - now);
+}
+
+FrameScheduler::Clock::duration FrameScheduler::time_until_can_render(Clock::time_point now) const {
+    return std::max(Clock::duration::zero(), last_render_ + min_interval_ - now);
+}
+
+void FrameScheduler::frame_rendered(Clock::time_point now) {
+    last_render_ = now;
+    waiting_ = false;
+    rendered_++;
+}
+
+void FrameScheduler::frame_skipped() {
+    skipped_duplicates_++;
+}
+
+void FrameScheduler::dump_stats(double container_fps) const {
+    uint64_t total = rendered_ + skipped_duplicates_;
+    double skipped_percent = total > 0 ? 100.0 * static_cast<double>(skipped_duplicates_) / static_cast<double>(total) : 0.0;
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Frames: %llu rendered, %llu duplicates skipped (%.1f%%), %llu deferred, content %.2f fps",
+             static_cast<unsigned long long>(rendered_), static_cast<unsigned long long>(skipped_duplicates_),
+             skipped_percent, static_cast<unsigned long long>(deferred_), container_fps);
+    log_info(message);
+}
@@ -4,11 +4,34 @@
 #include "universal-wallpaper/mpv_wrapper.h"
 #include "universal-wallpaper/utils.h"
 #include "universal-wallpaper/audio_detector.h"
+#include "universal-wallpaper/audio_pipeline_controller.h"
+#include "universal-wallpaper/audio_analyzer.h"
+#include "universal-wallpaper/dynamic_resolution.h"
+#include "universal-wallpaper/frame_scheduler.h"
+#include "universal-wallpaper/loop_monitor.h"
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/wallpaper_switcher.h"
+#include "universal-wallpaper/media_session_registry.h"
+#include "universal-wallpaper/span_layout.h"
+#include "universal-wallpaper/memory_budget.h"
+#include "universal-wallpaper/control_channel.h"
+#include "universal-wallpaper/playlist_scheduler.h"
+#include "universal-wallpaper/day_schedule.h"
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+#include "universal-wallpaper/lavc_engine.h"
+#include "universal-wallpaper/thumbnailer.h"
+#endif
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <csignal>
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <poll.h>
+#include <cerrno>
+#include <cstring>
 
 std::atomic<bool> g_running{true};
 
@@ -19,6 +42,65 @@ void signal_handler(int signal) {
     }
 }
 
+// Largest of the outputs the wallpaper is shown on, by area
+static void largest_output_size(const std::vector<Monitor>& monitors, const std::vector<std::string>& outputs,
+                                int& width, int& height) {
+    width = 0;
+    height = 0;
+    for (const auto& monitor : monitors) {
+        bool shown = std::find(outputs.begin(), outputs.end(), "ALL") != outputs.end() ||
+                     std::find(outputs.begin(), outputs.end(), monitor.name) != outputs.end();
+        if (shown && monitor.width * monitor.height > width * height) {
+            width = monitor.width;
+            height = monitor.height;
+        }
+    }
+}
+
+// Simple silent loops don't need mpv's player core; everything else does.
+// Stills always go to mpv, which shows them once and then holds them.
+static std::unique_ptr<MediaEngine> create_media_engine(const Config& config, const std::string& media_path,
+                                                        bool muted, Renderer& renderer,
+                                                        MemoryBudget& memory_budget) {
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+    bool lean = config.engine == "lavc" ||
+                (config.engine == "auto" && muted && config.loop && config.mpv_options.empty());
+    if (lean && LavcEngine::is_suitable(media_path)) {
+        return std::make_unique<LavcEngine>(renderer);
+    }
+    if (config.engine == "lavc") {
+        log_warn("lavc engine can't play " + media_path + " - using the mpv engine");
+    }
+#else
+    (void)media_path;
+    (void)muted;
+    if (config.engine == "lavc") {
+        log_warn("Built without libavcodec - using the mpv engine");
+    }
+#endif
+    
+    auto mpv = std::make_unique<MPVWrapper>();
+    if (memory_budget.is_enabled()) {
+        mpv->set_memory_share(memory_budget.reserve_engine_share());
+        mpv->set_hwdec_extra_frames(memory_budget.get_split().hwdec_extra_frames);
+    } else {
+        mpv->set_media_cache_budget(static_cast<size_t>(config.cache_budget_mb) * 1024 * 1024);
+    }
+    mpv->set_seamless_loop(config.seamless_loop);
+    mpv->set_prescale_enabled(config.prescale);
+    mpv->set_hwdec_driver(renderer.get_driver_description());
+    return mpv;
+}
+
+// Package paths name an entry after '#'; the package file itself must exist
+static bool media_exists(const std::string& media_path) {
+    std::string media_file = media_path;
+    if (PkgReader::is_package_path(media_file)) {
+        media_file = media_file.substr(0, media_file.find('#'));
+    }
+    return file_exists(media_file);
+}
+
 int main(int argc, char* argv[]) {
     // Parse configuration
     Config config;
@@ -40,13 +122,60 @@ int main(int argc, char* argv[]) {
         set_log_level(LogLevel::LOG_ERROR);
     }
     
+    // Batch previews for GUIs; no display or playback involved. Stdout
+    // carries only the "FILE\tTHUMBNAIL" results, logs go to stderr.
+    if (config.thumbnail) {
+        set_log_to_stderr(true);
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+        std::string thumbnail_dir = !config.thumbnail_dir.empty() ? config.thumbnail_dir
+                                                                  : Thumbnailer::default_cache_dir();
+        if (thumbnail_dir.empty()) {
+            log_error("No thumbnail cache directory, use --thumbnail-dir");
+            return 1;
+        }
+        Thumbnailer thumbnailer(thumbnail_dir, config.thumbnail_size, config.thumbnail_format);
+        return thumbnailer.run(config.thumbnail_inputs, config.jobs) == 0 ? 0 : 1;
+#else
+        log_error("Built without libavcodec - --thumbnail is unavailable");
+        return 1;
+#endif
+    }
+    
     log_info("Wallpaper Not-Engine Linux starting...");
     
-    // Check if media file exists
-    if (!file_exists(config.media_path)) {
+    // A playlist supplies the media; its first item plays first
+    PlaylistScheduler playlist;
+    if (!config.playlist.empty()) {
+        playlist.set_interval(std::chrono::seconds(config.playlist_interval));
+        if (!playlist.load(config.playlist, config.playlist_order, config.shuffle)) {
+            return 1;
+        }
+        config.media_path = playlist.current();
+    }
+    
+    // A schedule picks the media for the time of day
+    DaySchedule schedule;
+    if (!config.schedule.empty()) {
+        if (config.has_location) {
+            schedule.set_location(config.latitude, config.longitude);
+        }
+        if (!schedule.load(config.schedule) || !schedule.start(std::chrono::system_clock::now())) {
+            return 1;
+        }
+        config.media_path = schedule.current();
+    }
+    
+    // Check if media file exists; "scene.pkg#entry" names an entry inside a package
+    if (!media_exists(config.media_path)) {
         log_error("Media file not found: " + config.media_path);
         return 1;
     }
+    for (const auto& binding : config.output_media) {
+        if (!media_exists(binding.media_path)) {
+            log_error("Media file not found: " + binding.media_path);
+            return 1;
+        }
+    }
     
     // Daemonize if requested
     if (config.daemon) {
@@ -59,9 +188,13 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signal_handler);
     
     try {
-        // Initialize display manager
+        // Initialize display manager; headless recordings run on a --fps clock
         DisplayManager display_manager;
-        if (!display_manager.initialize(config.force_x11, config.force_wayland)) {
+        bool display_ready = config.headless_sizes.empty()
+            ? display_manager.initialize(config.force_x11, config.force_wayland)
+            : display_manager.initialize_headless(config.headless_sizes, config.record_path, config.fps,
+                                                  config.frame_limit, config.deterministic);
+        if (!display_ready) {
             log_error("Failed to initialize display manager");
             return 1;
         }
@@ -91,17 +224,39 @@ int main(int argc, char* argv[]) {
         }
         
         // Create OpenGL context
+        renderer.set_prefer_gles(config.use_gles);
         if (!renderer.create_context(display_manager.get_native_display())) {
             log_error("Failed to create OpenGL context");
             return 1;
         }
         
+        // --memory-budget replaces the separate cache and VRAM budgets
+        MemoryBudget memory_budget;
+        if (config.memory_budget_mb > 0) {
+            memory_budget.configure(static_cast<size_t>(config.memory_budget_mb) * 1024 * 1024);
+            renderer.set_vram_budget(memory_budget.get_split().vram_bytes);
+        } else {
+            renderer.set_vram_budget(static_cast<size_t>(config.vram_budget_mb) * 1024 * 1024);
+        }
+        
+        // X11 copies the render target 1:1 into the root pixmap, so a shrunken
+        // target would never be upscaled there
+        DynamicResolution dynamic_resolution;
+        if (config.dynamic_resolution) {
+            if (display_manager.get_backend_name() == "X11") {
+                log_warn("Dynamic resolution is not supported on X11, ignoring --dynamic-resolution");
+            } else {
+                dynamic_resolution.configure(1000.0 / config.fps, config.min_render_scale);
+                dynamic_resolution.set_enabled(true);
+            }
+        }
+        
+        // Stage timings feed both --stats and the dynamic resolution controller
+        renderer.get_profiler().set_enabled(config.stats_interval > 0 || dynamic_resolution.is_enabled());
+        
         // Set renderer on display manager for wallpaper rendering
         display_manager.set_renderer(&renderer);
         
-        // Initialize MPV
-        MPVWrapper mpv;
-        
         // Handle audio settings
         bool final_mute_audio = config.mute_audio;
         if (config.silent) {
@@ -124,184 +279,654 @@ int main(int argc, char* argv[]) {
             }
         }
         
-        if (!mpv.initialize(config.media_path, config.hardware_decode, config.loop,
-                           final_mute_audio, config.volume, config.mpv_options)) {
-            log_error("Failed to initialize MPV");
+        // Auto-mute detaches the audio track rather than muting it; --silent
+        // and --mute start engines without one
+        AudioPipelineController audio_pipeline;
+        
+        // --span renders one canvas covering the shown outputs once per
+        // frame; each output samples its own part of it when presenting
+        SpanLayout span;
+        int max_span_side = 0;
+        if (config.span) {
+            if (display_manager.get_backend_name() == "X11") {
+                // The root pixmap already spans all monitors, at their real positions
+                if (config.bezel_horizontal > 0 || config.bezel_vertical > 0) {
+                    log_warn("Bezel compensation is not supported on X11, ignoring --bezel");
+                }
+            } else {
+                span.set_bezel(config.bezel_horizontal, config.bezel_vertical);
+                GLint max_texture_size = 0;
+                glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+                max_span_side = max_texture_size > 0 ? max_texture_size : 4096;
+            }
+        }
+        auto update_span = [&](const std::vector<Monitor>& current_monitors) {
+            if (!config.span) return;
+            
+            std::vector<Monitor> shown;
+            bool all = std::find(config.outputs.begin(), config.outputs.end(), "ALL") != config.outputs.end();
+            for (const auto& monitor : current_monitors) {
+                if (all || std::find(config.outputs.begin(), config.outputs.end(), monitor.name) != config.outputs.end()) {
+                    shown.push_back(monitor);
+                }
+            }
+            if (!span.compute(shown, max_span_side)) return;
+            renderer.clear_output_regions();
+            for (const auto& [name, region] : span.get_regions()) {
+                renderer.set_output_region(name, region);
+            }
+        };
+        update_span(monitors);
+        
+        // Render size for a session: the span canvas, or else the largest
+        // output the session is shown on
+        auto session_size = [&](const std::vector<Monitor>& current_monitors, const std::vector<std::string>& outputs,
+                                int& width, int& height) {
+            if (!span.empty()) {
+                width = span.get_width();
+                height = span.get_height();
+                return;
+            }
+            largest_output_size(current_monitors, outputs, width, height);
+        };
+        
+        // Decode-side downscale target for newly started engines: the
+        // largest output overall; sessions narrow it to their own outputs
+        int prescale_width = 0;
+        int prescale_height = 0;
+        session_size(monitors, config.outputs, prescale_width, prescale_height);
+        
+        // Creates and opens a media engine; used at startup, for every
+        // wallpaper switch and for every per-output session. Switches call
+        // it on a worker thread, so it only reads the configuration.
+        auto open_engine = [&](const std::string& media_path, bool audio) -> std::unique_ptr<MediaEngine> {
+            bool muted = final_mute_audio || !audio;
+            std::unique_ptr<MediaEngine> engine = create_media_engine(config, media_path, muted, renderer, memory_budget);
+            log_info("Using " + std::string(engine->get_engine_name()) + " media engine");
+            
+            if (!engine->initialize(media_path, config.hardware_decode, config.loop,
+                                    muted, config.volume, config.mpv_options)) {
+                log_error("Failed to initialize media engine");
+                return nullptr;
+            }
+            return engine;
+        };
+        
+        // Hooks an opened engine up to audio and the renderer, on the
+        // render thread
+        auto attach_engine = [&](MediaEngine& engine, bool audio) -> bool {
+            if (!final_mute_audio && audio) {
+                audio_pipeline.sync(engine, std::chrono::steady_clock::now());
+            }
+            engine.set_prescale_target(prescale_width, prescale_height, config.scaling == "fill");
+            if (config.deterministic && !engine.set_clock_step(1000000 / config.fps)) {
+                log_warn(std::string(engine.get_engine_name()) + " engine can't step its clock, playing in real time");
+            }
+            
+            // Create the engine's render context
+            if (!engine.create_render_context(Renderer::get_proc_address, &renderer)) {
+                log_error("Failed to create media render context");
+                return false;
+            }
+            return true;
+        };
+        
+        // Outputs named with their own media get their own session; the
+        // rest show the main media. Outputs playing the same file share one.
+        MediaSessionRegistry sessions(renderer, open_engine, attach_engine, config.engine + ' ' + config.mpv_options,
+                                      config.fps, std::chrono::milliseconds(config.transition_ms));
+        std::vector<std::string> default_outputs = config.outputs;
+        if (!config.output_media.empty() && display_manager.get_backend_name() == "X11") {
+            // One root pixmap covers every monitor on X11
+            log_warn("Per-output media is not supported on X11, showing " + config.media_path + " everywhere");
+        } else if (!config.output_media.empty() && config.span) {
+            log_warn("Per-output media can't be combined with --span, showing " + config.media_path + " everywhere");
+        } else {
+            for (const auto& binding : config.output_media) {
+                if (!sessions.bind(binding.output, binding.media_path)) {
+                    return 1;
+                }
+            }
+            
+            // "ALL" now means every output without media of its own
+            default_outputs.clear();
+            for (const auto& output : config.outputs) {
+                if (output == "ALL" && !config.output_media.empty()) {
+                    for (const auto& monitor : monitors) {
+                        if (!sessions.find_output(monitor.name)) default_outputs.push_back(monitor.name);
+                    }
+                } else if (!sessions.find_output(output)) {
+                    default_outputs.push_back(output);
+                }
+            }
+        }
+        for (const auto& output : default_outputs) {
+            if (!sessions.bind(output, config.media_path)) {
+                return 1;
+            }
+        }
+        
+        // The main media's session follows the playlist and switch commands
+        MediaSession* main_session = !default_outputs.empty() ? sessions.find_output(default_outputs[0])
+                                                              : sessions.find_output(config.output_media[0].output);
+        
+        // Narrow each session's prescale target to the outputs it is shown on
+        auto update_prescale_targets = [&](const std::vector<Monitor>& current_monitors) {
+            for (const auto& session : sessions.get_sessions()) {
+                int width = 0;
+                int height = 0;
+                session_size(current_monitors, session->outputs, width, height);
+                session->switcher.current().set_prescale_target(width, height, config.scaling == "fill");
+            }
+        };
+        update_prescale_targets(monitors);
+        
+        // --effect shaders that read the audio uniforms get the spectrum of
+        // what is playing; without one, nothing is recorded or analyzed
+        AudioAnalyzer audio_analyzer;
+        auto apply_effect = [&](const std::string& path) -> bool {
+            renderer.make_current();
+            if (path == "none") {
+                renderer.clear_effect();
+            } else {
+                std::ifstream file(path);
+                if (!file) {
+                    log_error("Cannot open effect shader: " + path);
+                    return false;
+                }
+                std::stringstream source;
+                source << file.rdbuf();
+                if (!renderer.set_effect(source.str())) {
+                    return false;
+                }
+                log_info("Effect loaded: " + path);
+            }
+            
+            if (renderer.effect_uses_audio()) {
+                if (!audio_analyzer.start()) {
+                    log_warn("Audio analysis unavailable, the effect sees silence");
+                }
+            } else {
+                audio_analyzer.stop();
+            }
+            if (!audio_analyzer.is_running()) {
+                AudioAnalyzer::Levels silence;
+                renderer.set_audio_levels(silence.bands.data(), AudioAnalyzer::kBands, silence.level);
+            }
+            for (const auto& session : sessions.get_sessions()) {
+                session->needs_redraw = true;
+            }
+            return true;
+        };
+        if (!config.effect.empty() && !apply_effect(config.effect)) {
             return 1;
         }
         
-        // Create MPV render context
-        if (!mpv.create_render_context(Renderer::get_proc_address, &renderer)) {
-            log_error("Failed to create MPV render context");
+        // Commands from other processes, e.g. a GUI switching wallpapers
+        ControlChannel control;
+        if (!config.control_fifo.empty() && !control.open(config.control_fifo)) {
             return 1;
         }
         
         log_info("All components initialized successfully");
         
         // Main loop
-        auto last_frame_time = std::chrono::steady_clock::now();
-        auto last_event_time = std::chrono::steady_clock::now();
         auto last_audio_check_time = std::chrono::steady_clock::now();
+        auto last_stats_time = std::chrono::steady_clock::now();
+        bool clock_stepping = false;  // --deterministic: waiting for stepped frames
         
-        // Use FPS setting from config
-        const auto frame_duration = std::chrono::milliseconds(1000 / config.fps);
-        // Process events at a lower frequency to reduce CPU usage
-        const auto event_duration = std::chrono::milliseconds(16); // ~60 FPS for events
         // Check audio status less frequently
         const auto audio_check_duration = std::chrono::milliseconds(100); // 10 FPS for audio checks
+        // Periodic statistics dump (disabled unless --stats is given)
+        const auto stats_duration = std::chrono::seconds(config.stats_interval);
         
-        log_info("Running at " + std::to_string(config.fps) + " FPS");
+        // Frames are presented at each video's own rate, never faster than --fps
+        log_info("Rendering at content frame rate, capped at " + std::to_string(config.fps) + " FPS");
         log_debug("Starting main render loop");
         
-        bool was_muted_by_detector = false;
-        bool needs_redraw = true; // Force initial render
+        // The loop sleeps in poll() until a media engine signals a frame or
+        // event, the display connection has input, or a timed job is due.
+        // The first three entries are fixed; engine fds are appended each pass.
+        std::vector<pollfd> wait_fds = {
+            {display_manager.get_event_fd(), POLLIN, 0},
+            {control.get_fd(), POLLIN, 0},
+            {display_manager.get_capture_fd(), POLLIN, 0}
+        };
         
-        while (g_running && !display_manager.should_quit()) {
-            auto current_time = std::chrono::steady_clock::now();
-            auto elapsed = current_time - last_frame_time;
-            auto event_elapsed = current_time - last_event_time;
-            auto audio_elapsed = current_time - last_audio_check_time;
+        // Renders one session's due frame into its target and presents it on
+        // the session's outputs
+        auto render_session = [&](MediaSession& session, std::chrono::steady_clock::time_point current_time) {
+            MediaEngine& media = session.switcher.current();
             
-            // Process events less frequently to reduce CPU usage
-            if (event_elapsed >= event_duration) {
-                display_manager.process_events();
-                mpv.process_events();
-                last_event_time = current_time;
+            // Render at the size of the largest output showing this session,
+            // or of the whole canvas when spanning
+            int render_width = 0;
+            int render_height = 0;
+            session_size(display_manager.get_monitors(), session.outputs, render_width, render_height);
+            if (render_width == 0 || render_height == 0) {
+                render_width = monitors[0].width;
+                render_height = monitors[0].height;
             }
+            log_debug("Using " + config.scaling + " scaling: " + std::to_string(render_width) + "x" +
+                      std::to_string(render_height));
             
-            // Process events less frequently to reduce CPU usage
-            if (event_elapsed >= event_duration) {
-                display_manager.process_events();
-                mpv.process_events();
-                last_event_time = current_time;
-            }
+            // Shrink the internal target while frames run over budget; the
+            // composite pass upscales it back to the output size
+            dynamic_resolution.apply(render_width, render_height, render_width, render_height);
             
-            // Handle auto-mute based on other audio playing (less frequently)
-            if (audio_elapsed >= audio_check_duration && audio_detector.is_enabled() && !final_mute_audio) {
-                bool other_audio_playing = audio_detector.is_other_audio_playing();
+            auto fbo_info = renderer.get_or_create_framebuffer(render_width, render_height, GL_RGBA8,
+                                                               session.framebuffer_slot);
+            
+            log_debug("Created framebuffer: " + std::to_string(fbo_info.fbo) + ", texture: " + std::to_string(fbo_info.texture));
+            
+            if (fbo_info.fbo != 0) {
+                renderer.bind_framebuffer(fbo_info);
+                renderer.clear(0.0f, 0.0f, 0.0f, 1.0f);
+                
+                // Render MPV frame
+                log_debug("Calling MPV render_frame");
+                renderer.get_profiler().begin_stage("mpv_render");
+                bool rendered = media.render_frame(fbo_info.fbo, fbo_info.width, fbo_info.height);
+                renderer.get_profiler().end_stage("mpv_render");
                 
-                if (other_audio_playing && !was_muted_by_detector) {
-                    // Mute wallpaper audio when other apps are playing
-                    mpv.set_property("mute", "yes");
-                    was_muted_by_detector = true;
-                    log_debug("Auto-muted wallpaper audio (other app playing)");
-                } else if (!other_audio_playing && was_muted_by_detector) {
-                    // Unmute wallpaper audio when no other apps are playing
-                    mpv.set_property("mute", "no");
-                    was_muted_by_detector = false;
-                    log_debug("Auto-unmuted wallpaper audio (no other apps playing)");
+                if (rendered) {
+                    log_debug("MPV rendered frame successfully");
+                    media.report_flip();
+                    
+                    // Blend out the previous wallpaper during a switch
+                    if (session.switcher.is_transitioning()) {
+                        renderer.get_profiler().begin_stage("crossfade");
+                        fbo_info = session.switcher.composite(fbo_info, current_time);
+                        renderer.get_profiler().end_stage("crossfade");
+                        
+                        // The outgoing engine is destroyed when the crossfade ends
+                        if (!session.switcher.is_transitioning() && memory_budget.is_enabled()) {
+                            memory_budget.trim();
+                        }
+                    }
+                    
+                    if (renderer.has_effect()) {
+                        auto effect_info = renderer.get_or_create_framebuffer(
+                            fbo_info.width, fbo_info.height, GL_RGBA8,
+                            session.framebuffer_slot + MediaSessionRegistry::kEffectSlot);
+                        if (effect_info.fbo != 0) {
+                            renderer.get_profiler().begin_stage("effect");
+                            renderer.bind_framebuffer(effect_info);
+                            renderer.draw_effect_quad(fbo_info.texture);
+                            renderer.get_profiler().end_stage("effect");
+                            fbo_info = effect_info;
+                        }
+                    }
+                    
+                    // Only set wallpaper if MPV has video content
+                    if (media.has_video() && media.is_playing()) {
+                        // Set wallpaper for the session's outputs
+                        for (const auto& output_name : session.outputs) {
+                            log_debug("Setting wallpaper for output: " + output_name);
+                            if (output_name == "ALL") {
+                                display_manager.set_wallpaper_all(fbo_info.texture, 
+                                                                 fbo_info.width, fbo_info.height);
+                            } else {
+                                display_manager.set_wallpaper(output_name, fbo_info.texture,
+                                                             fbo_info.width, fbo_info.height);
+                            }
+                        }
+                        session.needs_redraw = false; // Reset redraw flag after successful render
+                        session.loop_monitor.frame_presented(media.get_position(), current_time);
+                        if (config.seamless_loop && config.loop) {
+                            session.loop_handover.frame_presented(media.get_position(), media.get_duration(),
+                                                                  media.get_container_fps(), current_time);
+                        }
+                    } else {
+                        static int wait_counter = 0;
+                        wait_counter++;
+                        if (wait_counter == 1 || wait_counter % 60 == 0) { // Log initially, then every 2 seconds at 30fps
+                            log_info("Waiting for MPV to start playing video (has_video: " + 
+                                     std::string(media.has_video() ? "true" : "false") + 
+                                     ", is_playing: " + std::string(media.is_playing() ? "true" : "false") + 
+                                     ", duration: " + std::to_string(media.get_duration()) + "s)");
+                        }
+                    }
+                } else {
+                    log_debug("MPV render_frame returned false");
                 }
-                last_audio_check_time = current_time;
+                
+                renderer.bind_default_framebuffer();
+                // Don't destroy the cached framebuffer - it will be reused
+            } else {
+                log_debug("Failed to create framebuffer");
             }
             
-            // Render frame if enough time has passed and we have new content
-            bool should_render = needs_redraw || mpv.has_new_frame();
+            session.scheduler.frame_rendered(current_time);
+            if (!config.schedule.empty() && &session == main_session) {
+                schedule.frame_presented(std::chrono::system_clock::now());
+            }
+        };
+        
+        auto dump_stats = [&]() {
+            renderer.get_resource_pool().dump_stats();
+            renderer.get_profiler().dump_stats();
+            renderer.get_uploader().dump_stats();
+            display_manager.dump_stats();
+            dynamic_resolution.dump_stats();
+            for (const auto& session : sessions.get_sessions()) {
+                MediaEngine& media = session->switcher.current();
+                session->scheduler.dump_stats(media.get_container_fps());
+                media.dump_stats();
+                session->loop_monitor.dump_stats();
+                session->loop_handover.dump_stats();
+                session->switcher.dump_stats();
+            }
+            sessions.dump_stats();
+            playlist.dump_stats();
+            schedule.dump_stats();
+            audio_pipeline.dump_stats();
+            audio_analyzer.dump_stats();
             
-            // Advanced frame throttling to reduce memory bandwidth
-            static auto last_render_time = std::chrono::steady_clock::now();
-            auto render_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_render_time);
+            size_t media_bytes = 0;
+            size_t decoder_bytes = 0;
+            for (const auto& session : sessions.get_sessions()) {
+                size_t buffer_bytes = 0;
+                size_t surface_bytes = 0;
+                session->switcher.current().get_memory_usage(buffer_bytes, surface_bytes);
+                media_bytes += buffer_bytes;
+                decoder_bytes += surface_bytes;
+            }
+            memory_budget.dump_stats(media_bytes, decoder_bytes, renderer.get_resource_pool().get_stats().bytes_in_use);
+        };
+        
+        playlist.start(std::chrono::steady_clock::now());
+        
+        while (g_running && !display_manager.should_quit()) {
+            // Slideshow: the next item is opened ahead of its slot and held
+            // on its first frame, so the switch lands on a frame boundary
+            switch (playlist.update(std::chrono::steady_clock::now())) {
+                case PlaylistScheduler::Action::Prepare:
+                    main_session->switcher.prepare(playlist.next());
+                    break;
+                case PlaylistScheduler::Action::Switch:
+                    main_session->switcher.switch_to(playlist.current());
+                    break;
+                case PlaylistScheduler::Action::None:
+                    break;
+            }
             
-            // Skip render if we just rendered and MPV doesn't have new content
-            if (render_elapsed < std::chrono::milliseconds(16) && !mpv.has_new_frame()) {
-                should_render = false;
+            // Scheduled switches fade over their whole window; the switcher
+            // steps the blend only as fast as it visibly changes
+            if (!config.schedule.empty()) {
+                auto wall_time = std::chrono::system_clock::now();
+                switch (schedule.update(wall_time)) {
+                    case DaySchedule::Action::Prepare:
+                        main_session->switcher.prepare(schedule.next());
+                        break;
+                    case DaySchedule::Action::Switch: {
+                        std::chrono::milliseconds duration(0);
+                        std::chrono::milliseconds elapsed(0);
+                        schedule.get_transition(wall_time, duration, elapsed);
+                        main_session->switcher.switch_to(schedule.current(), duration, elapsed);
+                        break;
+                    }
+                    case DaySchedule::Action::None:
+                        break;
+                }
             }
             
-            if (elapsed >= frame_duration && should_render) {
-                log_debug("Rendering frame (new_content: " + std::string(mpv.has_new_frame() ? "true" : "false") + ")");
-                renderer.make_current();
-                last_render_time = current_time;
-                
-                // Render MPV frame to a framebuffer
-                // For now, we'll use the screen dimensions of the primary monitor
-                const auto& primary_monitor = monitors[0];
-                
-                // Calculate dimensions based on scaling mode
-                int render_width = primary_monitor.width;
-                int render_height = primary_monitor.height;
-                
-                // Apply scaling logic based on config.scaling
-                if (config.scaling == "stretch") {
-                    // Use full screen dimensions (already set above)
-                    log_debug("Using stretch scaling: " + std::to_string(render_width) + "x" + std::to_string(render_height));
-                } else if (config.scaling == "fit") {
-                    // Maintain aspect ratio, fit within screen
-                    // We'll let MPV handle this by using the existing scale_to_fit logic
-                    log_debug("Using fit scaling: " + std::to_string(render_width) + "x" + std::to_string(render_height));
-                } else if (config.scaling == "fill") {
-                    // Fill the screen, may crop
-                    log_debug("Using fill scaling: " + std::to_string(render_width) + "x" + std::to_string(render_height));
-                } else { // "default"
-                    // Use original scaling settings
-                    log_debug("Using default scaling: " + std::to_string(render_width) + "x" + std::to_string(render_height));
+            for (const auto& session : sessions.get_sessions()) {
+                // --seamless-loop: a second engine pre-rolls the media and
+                // takes over when the pass ends, instead of a seek back
+                WallpaperSwitcher& switcher = session->switcher;
+                switch (session->loop_handover.update(std::chrono::steady_clock::now())) {
+                    case LoopHandover::Action::Prepare:
+                        if (!switcher.is_preparing()) {
+                            switcher.prepare(switcher.get_current_path());
+                        }
+                        break;
+                    case LoopHandover::Action::Switch:
+                        if (switcher.is_preparing() && switcher.get_pending_path() == switcher.get_current_path()) {
+                            switcher.switch_to(switcher.get_current_path(), std::chrono::milliseconds(0),
+                                               std::chrono::milliseconds(0));
+                        } else {
+                            session->loop_handover.reset();  // A playlist switch took the second engine
+                        }
+                        break;
+                    case LoopHandover::Action::None:
+                        break;
                 }
                 
-                auto fbo_info = renderer.get_or_create_framebuffer(render_width, render_height);
+                // A prepared wallpaper takes over once its first frame is decoded
+                if (switcher.update(std::chrono::steady_clock::now())) {
+                    sessions.refresh_key(*session);
+                    // A handover continues the media, so its boundary is measured
+                    if (!session->loop_handover.take_handover()) {
+                        session->loop_monitor.reset();
+                        session->loop_handover.reset();
+                    }
+                    session->needs_redraw = true;
+                }
                 
-                log_debug("Created framebuffer: " + std::to_string(fbo_info.fbo) + ", texture: " + std::to_string(fbo_info.texture));
+                // Picks up new frames (MPV_RENDER_UPDATE_FRAME for mpv)
+                session->switcher.current().update();
+            }
+            display_manager.process_events();
+            if (wait_fds[0].revents & POLLIN) {
+                // Output modes arrive as display events
+                update_span(display_manager.get_monitors());
+                update_prescale_targets(display_manager.get_monitors());
+            }
+            if (wait_fds[2].revents & POLLIN) {
+                display_manager.process_capture();
                 
-                if (fbo_info.fbo != 0) {
-                    renderer.bind_framebuffer(fbo_info);
-                    renderer.clear(0.0f, 0.0f, 0.0f, 1.0f);
-                    
-                    // Render MPV frame
-                    log_debug("Calling MPV render_frame");
-                    if (mpv.render_frame(fbo_info.fbo, fbo_info.width, fbo_info.height)) {
-                        log_debug("MPV rendered frame successfully");
-                        mpv.report_flip();
-                        
-                        // Only set wallpaper if MPV has video content
-                        if (mpv.has_video() && mpv.is_playing()) {
-                            // Set wallpaper for specified outputs
-                            for (const auto& output_name : config.outputs) {
-                                log_debug("Setting wallpaper for output: " + output_name);
-                                if (output_name == "ALL") {
-                                    display_manager.set_wallpaper_all(fbo_info.texture, 
-                                                                     fbo_info.width, fbo_info.height);
-                                } else {
-                                    display_manager.set_wallpaper(output_name, fbo_info.texture,
-                                                                 fbo_info.width, fbo_info.height);
+                // --deterministic: a recorded frame moves the media on by one
+                if (config.deterministic) {
+                    for (const auto& session : sessions.get_sessions()) {
+                        session->switcher.current().step_clock();
+                    }
+                    clock_stepping = true;
+                }
+            }
+            for (const auto& session : sessions.get_sessions()) {
+                session->switcher.current().process_events();
+            }
+            
+            if (wait_fds[1].revents & POLLIN) {
+                for (const auto& command : control.read_commands()) {
+                    if (command.rfind("switch ", 0) == 0) {
+                        std::string media_path = command.substr(7);
+                        if (!media_exists(media_path)) {
+                            log_error("Media file not found: " + media_path);
+                        } else {
+                            main_session->switcher.request_switch(media_path);
+                        }
+                    } else if (command.rfind("effect ", 0) == 0) {
+                        apply_effect(command.substr(7));
+                    } else if (command == "next") {
+                        if (playlist.size() > 1) {
+                            playlist.skip(std::chrono::steady_clock::now());
+                            main_session->switcher.switch_to(playlist.current());
+                        }
+                    } else if (command.rfind("bind ", 0) == 0 && command.find(' ', 5) != std::string::npos) {
+                        // "bind OUTPUT FILE" gives one output its own media
+                        std::string output = command.substr(5, command.find(' ', 5) - 5);
+                        std::string media_path = command.substr(command.find(' ', 5) + 1);
+                        if (display_manager.get_backend_name() == "X11" || config.span) {
+                            log_warn("Per-output media is not supported on X11 or with --span");
+                        } else if (output == "ALL") {
+                            log_warn("Use \"switch FILE\" to change the main wallpaper");
+                        } else if (!media_exists(media_path)) {
+                            log_error("Media file not found: " + media_path);
+                        } else {
+                            // "ALL" would draw over the newly bound output
+                            auto& main_outputs = main_session->outputs;
+                            if (std::find(main_outputs.begin(), main_outputs.end(), "ALL") != main_outputs.end()) {
+                                main_outputs.erase(std::remove(main_outputs.begin(), main_outputs.end(), "ALL"),
+                                                   main_outputs.end());
+                                for (const auto& monitor : display_manager.get_monitors()) {
+                                    if (!sessions.find_output(monitor.name)) main_outputs.push_back(monitor.name);
                                 }
                             }
-                            needs_redraw = false; // Reset redraw flag after successful render
-                        } else {
-                            static int wait_counter = 0;
-                            wait_counter++;
-                            if (wait_counter == 1 || wait_counter % 60 == 0) { // Log initially, then every 2 seconds at 30fps
-                                log_info("Waiting for MPV to start playing video (has_video: " + 
-                                         std::string(mpv.has_video() ? "true" : "false") + 
-                                         ", is_playing: " + std::string(mpv.is_playing() ? "true" : "false") + 
-                                         ", duration: " + std::to_string(mpv.get_duration()) + "s)");
+                            // The main session keeps at least one output
+                            if (main_outputs.size() == 1 && main_outputs[0] == output) {
+                                log_warn("Use \"switch FILE\" to change the main wallpaper");
+                                continue;
+                            }
+                            MediaSession* session = sessions.bind(output, media_path);
+                            if (memory_budget.is_enabled()) {
+                                memory_budget.trim();  // The output's previous session may be gone
                             }
+                            if (!session) continue;
+                            
+                            int width = 0;
+                            int height = 0;
+                            session_size(display_manager.get_monitors(), session->outputs, width, height);
+                            session->switcher.current().set_prescale_target(width, height, config.scaling == "fill");
                         }
                     } else {
-                        log_debug("MPV render_frame returned false");
+                        log_warn("Unknown control command: " + command);
                     }
-                    
-                    renderer.bind_default_framebuffer();
-                    // Don't destroy the cached framebuffer - it will be reused
-                } else {
-                    log_debug("Failed to create framebuffer");
                 }
+            }
+            
+            auto current_time = std::chrono::steady_clock::now();
+            auto audio_elapsed = current_time - last_audio_check_time;
+            
+            // Handle auto-mute based on other audio playing (less frequently)
+            if (audio_elapsed >= audio_check_duration && audio_detector.is_enabled() && !final_mute_audio) {
+                audio_pipeline.set_muted(audio_detector.is_other_audio_playing(), current_time);
+                last_audio_check_time = current_time;
+            }
+            
+            // Detach or fade in the wallpaper audio; asynchronous, so a busy
+            // mpv core can't stall the render loop
+            if (!final_mute_audio) {
+                for (const auto& session : sessions.get_sessions()) {
+                    if (session->has_audio) {
+                        audio_pipeline.sync(session->switcher.current(), current_time);
+                    }
+                }
+            }
+            
+            // Effects redraw with each new spectrum, within the fps cap
+            AudioAnalyzer::Levels audio_levels;
+            if (audio_analyzer.poll_levels(audio_levels)) {
+                renderer.set_audio_levels(audio_levels.bands.data(), AudioAnalyzer::kBands, audio_levels.level);
+                for (const auto& session : sessions.get_sessions()) {
+                    session->needs_redraw = true;
+                }
+            }
+            
+            // After a step nothing is drawn until every engine decoded the
+            // frame now due; then each session draws once, to be recorded
+            if (clock_stepping && std::all_of(sessions.get_sessions().begin(), sessions.get_sessions().end(),
+                                              [](const auto& session) {
+                                                  return session->switcher.current().has_stepped();
+                                              })) {
+                for (const auto& session : sessions.get_sessions()) {
+                    session->needs_redraw = true;
+                }
+                clock_stepping = false;
+            }
+            
+            // Render only frames that change the picture, when mpv wants them
+            // shown; repeats of the current frame are consumed without drawing
+            bool frame_started = false;
+            for (const auto& session : sessions.get_sessions()) {
+                if (clock_stepping) break;
+                MediaEngine& media = session->switcher.current();
+                FrameScheduler& scheduler = session->scheduler;
                 
-                last_frame_time = current_time;
+                bool should_render = false;
+                if (media.has_new_frame()) {
+                    uint64_t frame_flags = 0;
+                    int64_t target_time_us = 0;
+                    media.get_next_frame_info(frame_flags, target_time_us);
+                    int64_t target_delay_us = target_time_us > 0 ? target_time_us - media.get_time_us() : 0;
+                    
+                    switch (scheduler.decide(frame_flags, target_delay_us, current_time)) {
+                        case FrameScheduler::Action::Render:
+                            should_render = true;
+                            break;
+                        case FrameScheduler::Action::Skip:
+                            renderer.make_current();
+                            media.skip_frame();
+                            scheduler.frame_skipped();
+                            break;
+                        case FrameScheduler::Action::None:
+                            media.mark_frame_rendered();
+                            break;
+                        case FrameScheduler::Action::Wait:
+                            break;
+                    }
+                }
+                // Crossfades advance without new frames, one blend step at a time
+                if (session->switcher.transition_step_due(current_time)) {
+                    session->needs_redraw = true;
+                }
+                if (session->needs_redraw && scheduler.can_render(current_time)) {
+                    should_render = true;
+                }
+                if (should_render) {
+                    if (!frame_started) {
+                        renderer.make_current();
+                        renderer.begin_frame();
+                        dynamic_resolution.update(renderer.get_profiler().last_frame_cost_ms());
+                        frame_started = true;
+                    }
+                    render_session(*session, current_time);
+                }
             }
             
-            // Calculate optimal sleep time based on remaining time until next frame
-            auto time_until_next_frame = frame_duration - elapsed;
-            auto time_until_next_event = event_duration - event_elapsed;
-            auto time_until_next_audio = audio_check_duration - audio_elapsed;
+            if (config.stats_interval > 0 && current_time - last_stats_time >= stats_duration) {
+                dump_stats();
+                last_stats_time = current_time;
+            }
             
-            // Sleep until the next required operation
-            auto min_sleep = std::min({time_until_next_frame, time_until_next_event, time_until_next_audio});
-            if (min_sleep > std::chrono::milliseconds(1)) {
-                std::this_thread::sleep_for(min_sleep / 2); // Sleep for half the time to avoid oversleeping
-            } else {
+            // Nothing to do until a wakeup unless a frame is waiting for its
+            // target time or the fps cap, or a periodic check comes due
+            auto wait_time = std::chrono::steady_clock::duration(std::chrono::seconds(1));
+            wait_fds.resize(3);
+            for (const auto& session : sessions.get_sessions()) {
+                MediaEngine& media = session->switcher.current();
+                wait_time = std::min(wait_time, session->scheduler.time_until_due(current_time));
+                wait_time = std::min(wait_time, media.time_until_deadline(current_time));
+                wait_time = std::min(wait_time, session->switcher.time_until_transition_step(current_time));
+                wait_time = std::min(wait_time, session->loop_handover.time_until_action(current_time));
+                if (session->needs_redraw) {
+                    wait_time = std::min(wait_time, session->scheduler.time_until_can_render(current_time));
+                }
+                
+                // Engines being prepared for a switch need polling too
+                wait_fds.push_back({media.get_wakeup_fd(), POLLIN, 0});
+                wait_fds.push_back({session->switcher.get_pending_wakeup_fd(), POLLIN, 0});
+            }
+            if (audio_analyzer.is_running()) {
+                wait_fds.push_back({audio_analyzer.get_wakeup_fd(), POLLIN, 0});
+            }
+            wait_time = std::min(wait_time, playlist.time_until_action(current_time));
+            if (!config.schedule.empty()) {
+                wait_time = std::min(wait_time, std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    schedule.time_until_action(std::chrono::system_clock::now())));
+            }
+            wait_time = std::min(wait_time, audio_pipeline.time_until_update(current_time));
+            if (audio_detector.is_enabled() && !final_mute_audio) {
+                wait_time = std::min(wait_time, audio_check_duration - audio_elapsed);
+            }
+            if (config.stats_interval > 0) {
+                wait_time = std::min(wait_time, stats_duration - (current_time - last_stats_time));
+            }
+            
+            int timeout_ms = static_cast<int>(std::max<int64_t>(
+                0, std::chrono::duration_cast<std::chrono::milliseconds>(wait_time).count()));
+            if (poll(wait_fds.data(), wait_fds.size(), timeout_ms) < 0 && errno != EINTR) {
+                log_warn("poll failed: " + std::string(strerror(errno)));
                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
         }
         
         log_info("Shutting down...");
         
+        if (config.stats_interval > 0) {
+            dump_stats();
+        }
     } catch (const std::exception& e) {
         log_error("Fatal error: " + std::string(e.what()));
         return 1;
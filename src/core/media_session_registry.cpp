@@ -0,0 +1,137 @@
+#include "universal-wallpaper/media_session_registry.h"
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+MediaSessionRegistry::MediaSessionRegistry(Renderer& renderer, EngineFactory factory, EngineAttach attach,
+                                           std::string options, int max_fps,
+                                           std::chrono::milliseconds transition_duration)
+    : renderer_(renderer), factory_(std::move(factory)), attach_(std::move(attach)), options_(std::move(options)),
+      max_fps_(max_fps), transition_duration_(transition_duration) {
+}
+
+MediaSessionRegistry::~MediaSessionRegistry() {
+    renderer_.make_current();
+    sessions_.clear();
+}
+
+std::string MediaSessionRegistry::make_key(const std::string& media_path) const {
+    // Different spellings of one file ("./a.mp4", symlinks) share a decoder;
+    // a package entry suffix stays part of the key
+    std::string file = media_path;
+    std::string entry;
+    if (PkgReader::is_package_path(media_path) && media_path.find('#') != std::string::npos) {
+        file = media_path.substr(0, media_path.find('#'));
+        entry = media_path.substr(media_path.find('#'));
+    }
+    
+    char resolved[PATH_MAX];
+    if (realpath(file.c_str(), resolved)) {
+        file = resolved;
+    }
+    return file + entry + '\n' + options_;
+}
+
+uint32_t MediaSessionRegistry::free_framebuffer_slot() const {
+    for (uint32_t slot = 0;; slot += kSlotsPerSession) {
+        bool used = std::any_of(sessions_.begin(), sessions_.end(),
+                                [slot](const auto& session) { return session->framebuffer_slot == slot; });
+        if (!used) return slot;
+    }
+}
+
+MediaSession* MediaSessionRegistry::bind(const std::string& output, const std::string& media_path) {
+    std::string key = make_key(media_path);
+    MediaSession* current = find_output(output);
+    if (current && current->key == key) return current;
+    
+    auto it = std::find_if(sessions_.begin(), sessions_.end(),
+                           [&key](const auto& session) { return session->key == key; });
+    MediaSession* session = it != sessions_.end() ? it->get() : nullptr;
+    
+    if (!session) {
+        // Audio goes to the first session; more would play over each other
+        bool audio = std::none_of(sessions_.begin(), sessions_.end(),
+                                  [](const auto& other) { return other->has_audio.load(); });
+        auto created = std::make_unique<MediaSession>(renderer_, factory_, attach_, max_fps_);
+        created->key = key;
+        created->has_audio = audio;
+        created->framebuffer_slot = free_framebuffer_slot();
+        created->switcher.set_framebuffer_slot(created->framebuffer_slot);
+        created->switcher.set_transition_duration(transition_duration_);
+        if (!created->switcher.start(media_path)) {
+            return nullptr;
+        }
+        session = created.get();
+        sessions_.push_back(std::move(created));
+        log_info("Started media session for " + media_path);
+    } else {
+        log_info("Output " + output + " shares the session playing " + session->switcher.get_current_path());
+    }
+    
+    if (current) {
+        current->outputs.erase(std::remove(current->outputs.begin(), current->outputs.end(), output),
+                               current->outputs.end());
+        release(current);
+    }
+    session->outputs.push_back(output);
+    session->needs_redraw = true;
+    return session;
+}
+
+void MediaSessionRegistry::unbind(const std::string& output) {
+    MediaSession* session = find_output(output);
+    if (!session) return;
+    
+    session->outputs.erase(std::remove(session->outputs.begin(), session->outputs.end(), output),
+                           session->outputs.end());
+    release(session);
+}
+
+void MediaSessionRegistry::release(MediaSession* session) {
+    if (!session->outputs.empty()) return;
+    
+    log_info("Stopping media session for " + session->switcher.get_current_path());
+    bool had_audio = session->has_audio;
+    renderer_.make_current();
+    sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                   [session](const auto& other) { return other.get() == session; }),
+                    sessions_.end());
+    
+    // The audio goes on with the oldest remaining session: the main loop
+    // attaches its track, and its later switches open with audio. An
+    // engine without audio support (lavc) stays silent until it switches.
+    if (had_audio && !sessions_.empty()) {
+        sessions_.front()->has_audio = true;
+        log_info("Audio moves to the session playing " + sessions_.front()->switcher.get_current_path());
+    }
+}
+
+MediaSession* MediaSessionRegistry::find_output(const std::string& output) const {
+    for (const auto& session : sessions_) {
+        if (std::find(session->outputs.begin(), session->outputs.end(), output) != session->outputs.end()) {
+            return session.get();
+        }
+    }
+    return nullptr;
+}
+
+void MediaSessionRegistry::refresh_key(MediaSession& session) {
+    session.key = make_key(session.switcher.get_current_path());
+}
+
+void MediaSessionRegistry::dump_stats() const {
+    if (sessions_.size() < 2) return;
+    
+    std::string message = "Media sessions: " + std::to_string(sessions_.size());
+    for (const auto& session : sessions_) {
+        std::string outputs;
+        for (const auto& output : session->outputs) {
+            outputs += (outputs.empty() ? "" : ",") + output;
+        }
+        message += "; " + session->switcher.get_current_path() + " -> " + outputs;
+    }
+    log_info(message);
+}
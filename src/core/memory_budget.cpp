@@ -0,0 +1,148 @@
+#include "universal-wallpaper/memory_budget.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+static constexpr size_t kMB = 1024 * 1024;
+
+void MemoryBudget::configure(size_t total_bytes) {
+    total_bytes_ = total_bytes;
+    
+    // Shares of the budget; about 40% stays unassigned for mpv's core and
+    // decoder, the GL driver and our own heap
+    split_.vram_bytes = std::max(16 * kMB, total_bytes / 4);
+    split_.media_cache_bytes = total_bytes / 5;
+    split_.demuxer_bytes = std::max(4 * kMB, total_bytes / 10);
+    split_.demuxer_back_bytes = std::max(kMB, total_bytes / 20);
+    
+    // Each extra surface is a full decoded frame in VRAM
+    split_.hwdec_extra_frames = total_bytes < 1024 * kMB ? 1 : 2;
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Memory budget %zu MB: %zu MB VRAM pool, %zu MB media cache, %zu+%zu MB demuxer cache, "
+             "%d extra decoder surfaces",
+             total_bytes / kMB, split_.vram_bytes / kMB, split_.media_cache_bytes / kMB,
+             split_.demuxer_bytes / kMB, split_.demuxer_back_bytes / kMB, split_.hwdec_extra_frames);
+    log_info(message);
+}
+
+// What a pool has left, up to an engine's maximum
+static size_t draw_share(size_t pool, size_t reserved, size_t maximum) {
+    size_t left = pool > reserved ? pool - reserved : 0;
+    return std::min(maximum, left);
+}
+
+std::unique_ptr<MemoryBudget::EngineShare> MemoryBudget::reserve_engine_share() {
+    std::unique_ptr<EngineShare> share(new EngineShare(*this));
+    std::lock_guard<std::mutex> lock(shares_mutex_);
+    
+    // Without the media cache files are streamed; the demuxer needs some
+    // room, as zero would mean mpv's unbounded defaults
+    share->media_cache_bytes = draw_share(split_.media_cache_bytes, reserved_media_cache_bytes_,
+                                          split_.media_cache_bytes / kEnginesPerSwitch);
+    share->demuxer_bytes = std::max(kMB, draw_share(split_.demuxer_bytes, reserved_demuxer_bytes_,
+                                                    split_.demuxer_bytes / kEnginesPerSwitch));
+    share->demuxer_back_bytes = std::max(kMB, draw_share(split_.demuxer_back_bytes, reserved_demuxer_back_bytes_,
+                                                         split_.demuxer_back_bytes / kEnginesPerSwitch));
+    reserved_media_cache_bytes_ += share->media_cache_bytes;
+    reserved_demuxer_bytes_ += share->demuxer_bytes;
+    reserved_demuxer_back_bytes_ += share->demuxer_back_bytes;
+    engine_shares_++;
+    
+    char message[160];
+    snprintf(message, sizeof(message), "Engine memory share: %zu MB media cache, %zu+%zu MB demuxer cache (%zu engines)",
+             share->media_cache_bytes / kMB, share->demuxer_bytes / kMB, share->demuxer_back_bytes / kMB,
+             engine_shares_);
+    log_debug(message);
+    return share;
+}
+
+void MemoryBudget::release_engine_share(const EngineShare& share) {
+    std::lock_guard<std::mutex> lock(shares_mutex_);
+    reserved_media_cache_bytes_ -= share.media_cache_bytes;
+    reserved_demuxer_bytes_ -= share.demuxer_bytes;
+    reserved_demuxer_back_bytes_ -= share.demuxer_back_bytes;
+    engine_shares_--;
+}
+
+MemoryBudget::EngineShare::~EngineShare() {
+    budget_.release_engine_share(*this);
+}
+
+void MemoryBudget::trim() {
+#ifdef __GLIBC__
+    // A torn-down engine leaves its frames and packets in free heap chunks
+    // that glibc keeps mapped; give them back
+    Usage before;
+    Usage after;
+    bool measured = read_usage(before);
+    malloc_trim(0);
+    trims_++;
+    if (measured && read_usage(after) && after.rss_bytes < before.rss_bytes) {
+        trimmed_bytes_ += before.rss_bytes - after.rss_bytes;
+        log_debug("Heap trim released " + std::to_string((before.rss_bytes - after.rss_bytes) / kMB) + " MB");
+    }
+#endif
+}
+
+bool MemoryBudget::read_usage(Usage& usage) {
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    if (!smaps) return false;
+    
+    // Lines look like "Rss:              123456 kB"
+    std::string line;
+    while (std::getline(smaps, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        
+        std::string field = line.substr(0, colon);
+        size_t bytes = std::strtoull(line.c_str() + colon + 1, nullptr, 10) * 1024;
+        if (field == "Rss") {
+            usage.rss_bytes = bytes;
+        } else if (field == "Anonymous") {
+            usage.anonymous_bytes = bytes;
+        } else if (field == "Pss_Shmem") {
+            usage.shmem_bytes = bytes;
+        } else if (field == "Swap") {
+            usage.swap_bytes = bytes;
+        }
+    }
+    return usage.rss_bytes > 0;
+}
+
+static int read_thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::atoi(line.c_str() + 8);
+        }
+    }
+    return 0;
+}
+
+void MemoryBudget::dump_stats(size_t media_bytes, size_t decoder_bytes, size_t pool_bytes) const {
+    Usage usage;
+    if (!read_usage(usage)) return;
+    
+    // Threads sit next to RSS so --engine mpv and lavc compare on one line
+    int threads = read_thread_count();
+    std::string budget = is_enabled() ? " of " + std::to_string(total_bytes_ / kMB) + " MB budget" : "";
+    char message[384];
+    snprintf(message, sizeof(message),
+             "Memory: RSS %.1f MB%s (anon %.1f, shmem %.1f, swap %.1f), %d threads; media buffers %.1f MB; "
+             "VRAM: pool %.1f MB, decoder surfaces ~%.1f MB; %llu heap trims released %.1f MB",
+             static_cast<double>(usage.rss_bytes) / kMB, budget.c_str(),
+             static_cast<double>(usage.anonymous_bytes) / kMB, static_cast<double>(usage.shmem_bytes) / kMB,
+             static_cast<double>(usage.swap_bytes) / kMB, threads, static_cast<double>(media_bytes) / kMB,
+             static_cast<double>(pool_bytes) / kMB, static_cast<double>(decoder_bytes) / kMB,
+             static_cast<unsigned long long>(trims_), static_cast<double>(trimmed_bytes_) / kMB);
+    log_info(message);
+}
@@ -0,0 +1,221 @@
+#include "universal-wallpaper/playlist_scheduler.h"
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <numeric>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const kMediaExtensions[] = {
+    ".mp4", ".webm", ".mkv", ".mov", ".avi", ".m4v", ".gif", ".png", ".jpg", ".jpeg", ".webp", ".pkg"
+};
+
+static bool has_media_extension(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const char* extension : kMediaExtensions) {
+        size_t length = strlen(extension);
+        if (lower.size() > length && lower.compare(lower.size() - length, length, extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static time_t modification_time(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+bool PlaylistScheduler::load(const std::string& path, const std::string& order, bool shuffle) {
+    items_.clear();
+    
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        log_error("Playlist not found: " + path);
+        return false;
+    }
+    bool loaded = S_ISDIR(st.st_mode) ? load_directory(path) : load_list(path);
+    if (!loaded) return false;
+    
+    if (items_.empty()) {
+        log_error("Playlist has no media files: " + path);
+        return false;
+    }
+    
+    if (order == "name" || (order.empty() && S_ISDIR(st.st_mode))) {
+        std::sort(items_.begin(), items_.end());
+    } else if (order == "mtime") {
+        std::vector<std::pair<time_t, std::string>> dated;
+        dated.reserve(items_.size());
+        for (auto& item : items_) {
+            dated.emplace_back(modification_time(item), std::move(item));
+        }
+        std::stable_sort(dated.begin(), dated.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < dated.size(); i++) {
+            items_[i] = std::move(dated[i].second);
+        }
+    }
+    
+    order_.resize(items_.size());
+    std::iota(order_.begin(), order_.end(), 0);
+    position_ = 0;
+    shuffle_ = shuffle;
+    next_order_ = order_;
+    if (shuffle_) {
+        order_ = shuffled(items_.size());
+        next_order_ = shuffled(order_.back());
+    }
+    
+    log_info("Playlist " + path + ": " + std::to_string(items_.size()) + " items, " +
+             std::to_string(interval_.count()) + "s each" + (shuffle_ ? ", shuffled" : ""));
+    return true;
+}
+
+bool PlaylistScheduler::load_directory(const std::string& path) {
+    DIR* directory = opendir(path.c_str());
+    if (!directory) {
+        log_error("Failed to open playlist directory " + path + ": " + strerror(errno));
+        return false;
+    }
+    
+    while (dirent* entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name[0] == '.' || !has_media_extension(name)) continue;
+        
+        std::string item = path + "/" + name;
+        struct stat st;
+        if (stat(item.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            items_.push_back(std::move(item));
+        }
+    }
+    closedir(directory);
+    return true;
+}
+
+bool PlaylistScheduler::load_list(const std::string& path) {
+    std::ifstream list(path);
+    if (!list) {
+        log_error("Failed to open playlist " + path);
+        return false;
+    }
+    
+    std::string base = path.substr(0, path.find_last_of('/') + 1);
+    std::string line;
+    while (std::getline(list, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') continue;
+        
+        std::string item = line[0] == '/' ? line : base + line;
+        std::string file = PkgReader::is_package_path(item) ? item.substr(0, item.find('#')) : item;
+        if (!file_exists(file)) {
+            log_warn("Skipping missing playlist entry: " + item);
+            continue;
+        }
+        items_.push_back(std::move(item));
+    }
+    return true;
+}
+
+std::vector<size_t> PlaylistScheduler::shuffled(size_t last) {
+    std::vector<size_t> order(items_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), random_);
+    
+    // Never repeat the last item of a pass as the first of the next
+    if (order.size() > 1 && order[0] == last) {
+        std::swap(order[0], order[1 + random_() % (order.size() - 1)]);
+    }
+    return order;
+}
+
+const std::string& PlaylistScheduler::next() const {
+    if (position_ + 1 < order_.size()) {
+        return items_[order_[position_ + 1]];
+    }
+    return items_[next_order_[0]];
+}
+
+void PlaylistScheduler::start(Clock::time_point now) {
+    due_ = now + interval_;
+    prepared_ = false;
+    if (items_.size() > 1) {
+        prefetch(next());
+    }
+}
+
+PlaylistScheduler::Clock::time_point PlaylistScheduler::prepare_time() const {
+    // Short intervals prepare halfway through instead
+    Clock::duration lead = std::min<Clock::duration>(kPrepareLead, interval_ / 2);
+    return due_ - lead;
+}
+
+PlaylistScheduler::Action PlaylistScheduler::update(Clock::time_point now) {
+    if (items_.size() < 2) return Action::None;
+    
+    if (now >= due_) {
+        advance(now);
+        return Action::Switch;
+    }
+    if (!prepared_ && now >= prepare_time()) {
+        prepared_ = true;
+        return Action::Prepare;
+    }
+    return Action::None;
+}
+
+void PlaylistScheduler::skip(Clock::time_point now) {
+    if (items_.size() < 2) return;
+    advance(now);
+}
+
+void PlaylistScheduler::advance(Clock::time_point now) {
+    position_++;
+    if (position_ == order_.size()) {
+        position_ = 0;
+        if (shuffle_) {
+            order_ = std::move(next_order_);
+            next_order_ = shuffled(order_.back());
+        }
+    }
+    switches_++;
+    start(now);
+}
+
+PlaylistScheduler::Clock::duration PlaylistScheduler::time_until_action(Clock::time_point now) const {
+    if (items_.size() < 2) return Clock::duration::max();
+    
+    Clock::time_point next_action = prepared_ ? due_ : prepare_time();
+    return std::max<Clock::duration>(Clock::duration::zero(), next_action - now);
+}
+
+void PlaylistScheduler::prefetch(const std::string& media_path) {
+    std::string file = PkgReader::is_package_path(media_path) ? media_path.substr(0, media_path.find('#')) : media_path;
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    
+    // Asynchronous readahead: the kernel queues the reads and returns, so
+    // the file's head is in the page cache by the time it is opened
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        size_t length = std::min(static_cast<size_t>(st.st_size), kPrefetchBytes);
+        if (posix_fadvise(fd, 0, static_cast<off_t>(length), POSIX_FADV_WILLNEED) == 0) {
+            prefetched_bytes_ += length;
+        }
+    }
+    close(fd);
+}
+
+void PlaylistScheduler::dump_stats() const {
+    if (items_.size() < 2) return;
+    log_info("Playlist: " + std::to_string(switches_) + " switches, " +
+             std::to_string(prefetched_bytes_ / (1024 * 1024)) + " MB prefetched, now at " + current());
+}
@@ -0,0 +1,93 @@
+#include "universal-wallpaper/span_layout.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+void SpanLayout::set_bezel(int horizontal, int vertical) {
+    bezel_horizontal_ = std::max(0, horizontal);
+    bezel_vertical_ = std::max(0, vertical);
+}
+
+// Number of distinct edges left of (or above) `edge`: the bezels crossed
+// between the canvas origin and a monitor starting there
+static int edges_before(const std::set<int>& edges, int edge) {
+    return static_cast<int>(std::distance(edges.begin(), edges.lower_bound(edge)));
+}
+
+static bool same_regions(const std::vector<std::pair<std::string, TextureRegion>>& a,
+                         const std::vector<std::pair<std::string, TextureRegion>>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto& x, const auto& y) {
+        return x.first == y.first && x.second.u == y.second.u && x.second.v == y.second.v &&
+               x.second.width == y.second.width && x.second.height == y.second.height;
+    });
+}
+
+bool SpanLayout::compute(const std::vector<Monitor>& monitors, int max_side) {
+    // Called for every display event; only a new layout is worth a log line
+    std::vector<std::pair<std::string, TextureRegion>> previous = std::move(regions_);
+    int previous_width = width_;
+    int previous_height = height_;
+    regions_.clear();
+    width_ = 0;
+    height_ = 0;
+    if (monitors.empty()) return !previous.empty();
+    
+    int min_x = monitors[0].x;
+    int min_y = monitors[0].y;
+    std::set<int> columns;
+    std::set<int> rows;
+    for (const auto& monitor : monitors) {
+        min_x = std::min(min_x, monitor.x);
+        min_y = std::min(min_y, monitor.y);
+        columns.insert(monitor.x);
+        rows.insert(monitor.y);
+    }
+    
+    // Monitor positions on the canvas, bezels included
+    struct Placement { int x, y; };
+    std::vector<Placement> placements;
+    placements.reserve(monitors.size());
+    int canvas_width = 0;
+    int canvas_height = 0;
+    for (const auto& monitor : monitors) {
+        Placement placement;
+        placement.x = monitor.x - min_x + edges_before(columns, monitor.x) * bezel_horizontal_;
+        placement.y = monitor.y - min_y + edges_before(rows, monitor.y) * bezel_vertical_;
+        canvas_width = std::max(canvas_width, placement.x + monitor.width);
+        canvas_height = std::max(canvas_height, placement.y + monitor.height);
+        placements.push_back(placement);
+    }
+    if (canvas_width <= 0 || canvas_height <= 0) return !previous.empty();
+    
+    double scale = 1.0;
+    if (max_side > 0) {
+        scale = std::min({scale, static_cast<double>(max_side) / canvas_width,
+                          static_cast<double>(max_side) / canvas_height});
+        double pixels = static_cast<double>(canvas_width) * canvas_height;
+        if (pixels > kMaxCanvasPixels) {
+            scale = std::min(scale, std::sqrt(kMaxCanvasPixels / pixels));
+        }
+    }
+    width_ = std::max(1, static_cast<int>(canvas_width * scale));
+    height_ = std::max(1, static_cast<int>(canvas_height * scale));
+    
+    // Regions are relative, so they hold at any canvas scale. Canvas rows
+    // run top down, texture coordinates bottom up.
+    for (size_t i = 0; i < monitors.size(); i++) {
+        TextureRegion region;
+        region.u = static_cast<float>(placements[i].x) / canvas_width;
+        region.width = static_cast<float>(monitors[i].width) / canvas_width;
+        region.height = static_cast<float>(monitors[i].height) / canvas_height;
+        region.v = 1.0f - static_cast<float>(placements[i].y + monitors[i].height) / canvas_height;
+        regions_.emplace_back(monitors[i].name, region);
+    }
+    
+    if (width_ == previous_width && height_ == previous_height && same_regions(regions_, previous)) {
+        return false;
+    }
+    log_info("Spanning " + std::to_string(monitors.size()) + " monitors: " + std::to_string(canvas_width) + "x" +
+             std::to_string(canvas_height) + " canvas, rendered at " + std::to_string(width_) + "x" +
+             std::to_string(height_));
+    return true;
+}
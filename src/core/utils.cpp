@@ -7,34 +7,49 @@
 #include <sys/stat.h>
 #include <cstdlib>
 #include <csignal>
+#include <cstdio>
+#include <mutex>
 
 static LogLevel current_log_level = LogLevel::LOG_INFO;
+static bool log_to_stderr = false;
+// Decoder, open and thumbnail workers log too; lines must not interleave
+static std::mutex log_mutex;
 
 void set_log_level(LogLevel level) {
     current_log_level = level;
 }
 
+void set_log_to_stderr(bool enabled) {
+    log_to_stderr = enabled;
+}
+
+static void write_log(const char* prefix, const std::string& message, bool error) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::ostream& stream = error || log_to_stderr ? std::cerr : std::cout;
+    stream << prefix << message << std::endl;
+}
+
 void log_debug(const std::string& message) {
     if (current_log_level <= LogLevel::LOG_DEBUG) {
-        std::cout << "[DEBUG] " << message << std::endl;
+        write_log("[DEBUG] ", message, false);
     }
 }
 
 void log_info(const std::string& message) {
     if (current_log_level <= LogLevel::LOG_INFO) {
-        std::cout << "[INFO] " << message << std::endl;
+        write_log("[INFO] ", message, false);
     }
 }
 
 void log_warn(const std::string& message) {
     if (current_log_level <= LogLevel::LOG_WARN) {
-        std::cout << "[WARN] " << message << std::endl;
+        write_log("[WARN] ", message, false);
     }
 }
 
 void log_error(const std::string& message) {
     if (current_log_level <= LogLevel::LOG_ERROR) {
-        std::cerr << "[ERROR] " << message << std::endl;
+        write_log("[ERROR] ", message, true);
     }
 }
 
@@ -43,6 +58,25 @@ bool file_exists(const std::string& path) {
     return (stat(path.c_str(), &buffer) == 0);
 }
 
+std::string get_cache_dir() {
+    std::string base;
+    const char* xdg_cache = getenv("XDG_CACHE_HOME");
+    if (xdg_cache && xdg_cache[0] == '/') {
+        base = xdg_cache;
+    } else {
+        const char* home = getenv("HOME");
+        if (!home || home[0] != '/') return "";
+        base = std::string(home) + "/.cache";
+    }
+    
+    std::string dir = base + "/wallpaper-ne-linux";
+    mkdir(base.c_str(), 0700);
+    if (mkdir(dir.c_str(), 0700) != 0 && !file_exists(dir)) {
+        return "";
+    }
+    return dir;
+}
+
 bool is_video_file(const std::string& path) {
     std::string ext = path.substr(path.find_last_of('.') + 1);
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
@@ -80,6 +114,20 @@ std::string trim_string(const std::string& str) {
     return str.substr(start, end - start + 1);
 }
 
+std::string format_bytes(size_t bytes) {
+    static const char* units[] = {"B", "KB", "MB", "GB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 3) {
+        value /= 1024.0;
+        unit++;
+    }
+    
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return buffer;
+}
+
 void daemonize() {
     pid_t pid = fork();
     
@@ -0,0 +1,273 @@
+#include "universal-wallpaper/wallpaper_switcher.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+WallpaperSwitcher::WallpaperSwitcher(Renderer& renderer, EngineFactory factory, EngineAttach attach)
+    : renderer_(renderer), factory_(std::move(factory)), attach_(std::move(attach)) {
+    open_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (open_fd_ < 0) {
+        throw std::runtime_error(std::string("Failed to create switcher eventfd: ") + strerror(errno));
+    }
+}
+
+WallpaperSwitcher::~WallpaperSwitcher() {
+    // Opens still in flight use the factory and open_fd_; wait them out
+    abandon_open();
+    reap_abandoned(true);
+    
+    // Engines release GL objects on destruction
+    renderer_.make_current();
+    outgoing_.reset();
+    pending_.reset();
+    current_.reset();
+    close(open_fd_);
+}
+
+bool WallpaperSwitcher::start(const std::string& media_path) {
+    current_ = factory_(media_path);
+    if (!current_) return false;
+    if (!attach_(*current_)) {
+        renderer_.make_current();
+        current_.reset();
+        return false;
+    }
+    current_path_ = media_path;
+    return true;
+}
+
+bool WallpaperSwitcher::request_switch(const std::string& media_path) {
+    return prepare_engine(media_path, false);
+}
+
+bool WallpaperSwitcher::prepare(const std::string& media_path) {
+    return prepare_engine(media_path, true);
+}
+
+bool WallpaperSwitcher::switch_to(const std::string& media_path) {
+    if (!is_preparing() || pending_path_ != media_path) {
+        return request_switch(media_path);
+    }
+    
+    // Prepared ahead: latency now only covers the handover itself
+    hold_pending_ = false;
+    request_time_ = Clock::now();
+    return true;
+}
+
+bool WallpaperSwitcher::switch_to(const std::string& media_path, std::chrono::milliseconds duration,
+                                  std::chrono::milliseconds elapsed) {
+    if (!switch_to(media_path)) return false;
+    active_duration_ = duration;
+    active_elapsed_ = elapsed;
+    return true;
+}
+
+bool WallpaperSwitcher::prepare_engine(const std::string& media_path, bool hold) {
+    renderer_.make_current();
+    
+    // A newer request replaces one still being prepared, and a running
+    // transition is cut short so at most two engines are alive
+    if (is_preparing()) {
+        log_info("Abandoning switch to " + pending_path_);
+        pending_.reset();
+        abandon_open();
+    }
+    if (outgoing_) {
+        finish_transition();
+    }
+    
+    request_time_ = Clock::now();
+    pending_path_ = media_path;
+    hold_pending_ = hold;
+    active_duration_ = transition_duration_;
+    active_elapsed_ = std::chrono::milliseconds(0);
+    
+    // Probing and opening can take a while on large or remote media; the
+    // current engine keeps rendering meanwhile. The destructor waits for
+    // the worker, so it may use this switcher's factory and eventfd.
+    opening_ = std::async(std::launch::async, [this, media_path]() {
+        std::unique_ptr<MediaEngine> engine = factory_(media_path);
+        uint64_t one = 1;
+        while (write(open_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+        }
+        return engine;
+    });
+    log_info("Preparing " + media_path);
+    return true;
+}
+
+bool WallpaperSwitcher::take_opened_engine() {
+    std::unique_ptr<MediaEngine> engine = opening_.get();
+    renderer_.make_current();
+    if (!engine || !attach_(*engine)) {
+        log_error("Failed to prepare " + pending_path_ + ", keeping " + current_path_);
+        pending_path_.clear();
+        failed_switches_++;
+        return false;
+    }
+    
+    pending_ = std::move(engine);
+    if (hold_pending_) {
+        pending_->set_paused(true);
+    }
+    return true;
+}
+
+void WallpaperSwitcher::abandon_open() {
+    if (opening_.valid()) {
+        abandoned_.push_back(std::move(opening_));
+    }
+}
+
+void WallpaperSwitcher::reap_abandoned(bool wait) {
+    // Dropping a finished future destroys its engine, which was never
+    // attached and so holds no GL objects; an unfinished one would block
+    abandoned_.erase(std::remove_if(abandoned_.begin(), abandoned_.end(),
+                                    [wait](const auto& open) {
+                                        return wait || open.wait_for(std::chrono::seconds(0)) ==
+                                                           std::future_status::ready;
+                                    }),
+                     abandoned_.end());
+}
+
+int WallpaperSwitcher::get_pending_wakeup_fd() const {
+    if (pending_) return pending_->get_wakeup_fd();
+    return opening_.valid() || !abandoned_.empty() ? open_fd_ : -1;
+}
+
+bool WallpaperSwitcher::update(Clock::time_point now) {
+    uint64_t count;
+    while (read(open_fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    reap_abandoned(false);
+    
+    if (outgoing_) {
+        outgoing_->update();
+        outgoing_->process_events();
+    }
+    
+    if (opening_.valid() && opening_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        take_opened_engine();
+    }
+    if (!is_preparing()) return false;
+    
+    // Events first: mpv announces the video before its first frame
+    if (pending_) {
+        pending_->process_events();
+        pending_->update();
+    }
+    
+    bool ready = pending_ && pending_->has_first_frame();
+    if (ready && hold_pending_) return false;
+    if (!ready) {
+        if (now - request_time_ > kPrepareTimeout) {
+            log_error("No frame from " + pending_path_ + " after " +
+                      std::to_string(std::chrono::duration_cast<std::chrono::seconds>(kPrepareTimeout).count()) +
+                      "s, keeping " + current_path_);
+            renderer_.make_current();
+            pending_.reset();
+            abandon_open();
+            pending_path_.clear();
+            failed_switches_++;
+        }
+        return false;
+    }
+    
+    // First frame is decoded: the new engine takes over and the old one
+    // keeps playing underneath until the crossfade is done
+    outgoing_ = std::move(current_);
+    current_ = std::move(pending_);
+    current_->set_paused(false);
+    current_path_ = pending_path_;
+    pending_path_.clear();
+    transition_start_ = now;
+    awaiting_first_frame_ = true;
+    outgoing_drawn_ = false;
+    return true;
+}
+
+bool WallpaperSwitcher::transition_step_due(Clock::time_point now) const {
+    return outgoing_ && (awaiting_first_frame_ || now - last_step_ >= step_interval());
+}
+
+WallpaperSwitcher::Clock::duration WallpaperSwitcher::time_until_transition_step(Clock::time_point now) const {
+    if (!outgoing_) return Clock::duration::max();
+    return std::max(Clock::duration::zero(), Clock::duration(last_step_ + step_interval() - now));
+}
+
+Renderer::FramebufferInfo WallpaperSwitcher::composite(const Renderer::FramebufferInfo& target, Clock::time_point now) {
+    if (awaiting_first_frame_) {
+        // Latency runs from the request to the first composited new frame
+        awaiting_first_frame_ = false;
+        transition_start_ = now - active_elapsed_;
+        last_latency_ms_ = std::chrono::duration<double, std::milli>(now - request_time_).count();
+        max_latency_ms_ = std::max(max_latency_ms_, last_latency_ms_);
+        total_latency_ms_ += last_latency_ms_;
+        switches_++;
+        char latency[32];
+        snprintf(latency, sizeof(latency), "%.1f", last_latency_ms_);
+        log_info("Switched to " + current_path_ + " in " + latency + " ms");
+    }
+    
+    if (!outgoing_) return target;
+    
+    last_step_ = now;
+    float mix = 1.0f;
+    if (active_duration_.count() > 0) {
+        mix = static_cast<float>(std::chrono::duration<double>(now - transition_start_) /
+                                 std::chrono::duration<double>(active_duration_));
+    }
+    if (mix >= 1.0f) {
+        finish_transition();
+        return target;
+    }
+    
+    // The outgoing picture stays in its render target; it is redrawn only
+    // when the outgoing engine has a new frame, so a still costs one draw
+    auto outgoing_fbo = renderer_.get_or_create_framebuffer(target.width, target.height, GL_RGBA8,
+                                                            framebuffer_slot_ + kOutgoingSlot);
+    auto composite_fbo = renderer_.get_or_create_framebuffer(target.width, target.height, GL_RGBA8,
+                                                             framebuffer_slot_ + kCompositeSlot);
+    if (outgoing_fbo.fbo == 0 || composite_fbo.fbo == 0) {
+        finish_transition();
+        return target;
+    }
+    
+    bool target_changed = outgoing_fbo.fbo != outgoing_target_.fbo || outgoing_fbo.width != outgoing_target_.width ||
+                          outgoing_fbo.height != outgoing_target_.height;
+    if (!outgoing_drawn_ || target_changed || outgoing_->has_new_frame()) {
+        renderer_.bind_framebuffer(outgoing_fbo);
+        renderer_.clear(0.0f, 0.0f, 0.0f, 1.0f);
+        if (outgoing_->render_frame(outgoing_fbo.fbo, outgoing_fbo.width, outgoing_fbo.height)) {
+            outgoing_->report_flip();
+        }
+        outgoing_drawn_ = true;
+        outgoing_target_ = outgoing_fbo;
+    }
+    
+    renderer_.bind_framebuffer(composite_fbo);
+    renderer_.draw_crossfade_quad(outgoing_fbo.texture, target.texture, std::max(mix, 0.0f));
+    return composite_fbo;
+}
+
+void WallpaperSwitcher::finish_transition() {
+    renderer_.make_current();
+    outgoing_.reset();
+    awaiting_first_frame_ = false;
+}
+
+void WallpaperSwitcher::dump_stats() const {
+    if (switches_ == 0 && failed_switches_ == 0) return;
+    
+    char message[160];
+    snprintf(message, sizeof(message), "Wallpaper switches: %llu (%llu failed), latency last %.1f ms, avg %.1f ms, max %.1f ms",
+             static_cast<unsigned long long>(switches_), static_cast<unsigned long long>(failed_switches_),
+             last_latency_ms_, switches_ > 0 ? total_latency_ms_ / switches_ : 0.0, max_latency_ms_);
+    log_info(message);
+}
@@ -0,0 +1,333 @@
+#include "universal-wallpaper/frame_recorder.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <utility>
+
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+static std::string av_error_string(int error) {
+    char buffer[128];
+    if (av_strerror(error, buffer, sizeof(buffer)) < 0) {
+        return "error " + std::to_string(error);
+    }
+    return buffer;
+}
+#endif
+
+static bool has_extension(const std::string& path, const char* extension) {
+    size_t length = strlen(extension);
+    if (path.size() < length) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (tolower(static_cast<unsigned char>(path[path.size() - length + i])) != extension[i]) return false;
+    }
+    return true;
+}
+
+FrameRecorder::FrameRecorder(std::string path, int fps) : path_(std::move(path)), fps_(fps > 0 ? fps : 30) {
+    if (has_extension(path_, ".y4m")) {
+        format_ = Format::Y4m;
+    } else if (has_extension(path_, ".png")) {
+        format_ = Format::Png;
+    } else {
+        format_ = Format::Encoded;
+    }
+}
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+bool FrameRecorder::open(int width, int height) {
+    close();
+    width_ = width;
+    height_ = height;
+    frames_written_ = 0;
+    
+    if (format_ == Format::Y4m) {
+        return open_y4m();
+    }
+    return open_ffmpeg();
+}
+
+bool FrameRecorder::write_frame(const unsigned char* pixels) {
+    bool written = format_ == Format::Y4m ? write_y4m(pixels) : write_ffmpeg(pixels);
+    if (written) frames_written_++;
+    return written;
+}
+
+void FrameRecorder::close() {
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+    if (muxer_) {
+        // Flush frames the encoder still holds, then finish the container
+        if (muxing_) {
+            if (avcodec_send_frame(encoder_, nullptr) >= 0) {
+                drain_encoder();
+            }
+            av_write_trailer(muxer_);
+            muxing_ = false;
+        }
+        if (muxer_->pb) {
+            avio_closep(&muxer_->pb);
+        }
+        avformat_free_context(muxer_);
+        muxer_ = nullptr;
+        stream_ = nullptr;
+    }
+    avcodec_free_context(&encoder_);
+    av_frame_free(&frame_);
+    av_packet_free(&packet_);
+    sws_freeContext(sws_);
+    sws_ = nullptr;
+#endif
+}
+
+bool FrameRecorder::open_y4m() {
+    file_ = fopen(path_.c_str(), "wb");
+    if (!file_) {
+        log_error("Failed to open " + path_ + ": " + strerror(errno));
+        return false;
+    }
+    
+    // 4:2:0 with chroma sited between the luma samples, as a 2x2 average gives
+    size_t chroma = static_cast<size_t>((width_ + 1) / 2) * ((height_ + 1) / 2);
+    planes_.resize(static_cast<size_t>(width_) * height_ + 2 * chroma);
+    if (fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width_, height_, fps_) < 0) {
+        log_error("Failed to write " + path_);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool FrameRecorder::write_y4m(const unsigned char* pixels) {
+    if (!file_) return false;
+    
+    // BT.601 limited range in 8-bit fixed point; rows flipped to top first
+    const int chroma_width = (width_ + 1) / 2;
+    const int chroma_height = (height_ + 1) / 2;
+    unsigned char* luma = planes_.data();
+    unsigned char* cb = luma + static_cast<size_t>(width_) * height_;
+    unsigned char* cr = cb + static_cast<size_t>(chroma_width) * chroma_height;
+    auto pixel = [&](int x, int y) {
+        return pixels + (static_cast<size_t>(height_ - 1 - y) * width_ + x) * 4;
+    };
+    
+    for (int y = 0; y < height_; y++) {
+        unsigned char* row = luma + static_cast<size_t>(y) * width_;
+        for (int x = 0; x < width_; x++) {
+            const unsigned char* p = pixel(x, y);
+            row[x] = static_cast<unsigned char>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+        }
+    }
+    for (int cy = 0; cy < chroma_height; cy++) {
+        for (int cx = 0; cx < chroma_width; cx++) {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int y = cy * 2; y < std::min(cy * 2 + 2, height_); y++) {
+                for (int x = cx * 2; x < std::min(cx * 2 + 2, width_); x++) {
+                    const unsigned char* p = pixel(x, y);
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            size_t index = static_cast<size_t>(cy) * chroma_width + cx;
+            cb[index] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr[index] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    
+    if (fputs("FRAME\n", file_) < 0 || fwrite(planes_.data(), 1, planes_.size(), file_) != planes_.size()) {
+        log_error("Failed to write frame to " + path_ + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::string FrameRecorder::sequence_path(uint64_t frame) const {
+    size_t percent = path_.find('%');
+    if (percent == std::string::npos) return path_;
+    
+    // Only %d and %0Nd; the path is user input, not a format string
+    size_t end = percent + 1;
+    bool zero_pad = end < path_.size() && path_[end] == '0';
+    if (zero_pad) end++;
+    int width = 0;
+    while (end < path_.size() && isdigit(static_cast<unsigned char>(path_[end]))) {
+        width = width * 10 + (path_[end++] - '0');
+    }
+    if (end >= path_.size() || path_[end] != 'd' || width > 20) return path_;
+    
+    std::string number = std::to_string(frame);
+    if (static_cast<int>(number.size()) < width) {
+        number.insert(0, width - number.size(), zero_pad ? '0' : ' ');
+    }
+    return path_.substr(0, percent) + number + path_.substr(end + 1);
+}
+
+#ifdef WALLPAPER_NE_HAVE_LIBAV
+bool FrameRecorder::open_ffmpeg() {
+    const AVCodec* codec = nullptr;
+    AVPixelFormat pixel_format = AV_PIX_FMT_YUV420P;
+    if (format_ == Format::Png) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+        pixel_format = AV_PIX_FMT_RGBA;
+    } else {
+        int result = avformat_alloc_output_context2(&muxer_, nullptr, nullptr, path_.c_str());
+        if (result < 0 || !muxer_) {
+            log_error("No FFmpeg container for " + path_ + " (use .y4m, .png, .mp4, .mkv, ...)");
+            return false;
+        }
+        codec = avcodec_find_encoder(muxer_->oformat->video_codec);
+    }
+    if (!codec) {
+        log_error("FFmpeg has no video encoder for " + path_);
+        close();
+        return false;
+    }
+    
+    encoder_ = avcodec_alloc_context3(codec);
+    frame_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!encoder_ || !frame_ || !packet_) {
+        close();
+        return false;
+    }
+    
+    // Encoded video wants even 4:2:0 dimensions; the edge is dropped
+    int width = format_ == Format::Png ? width_ : width_ & ~1;
+    int height = format_ == Format::Png ? height_ : height_ & ~1;
+    encoder_->width = width;
+    encoder_->height = height;
+    encoder_->pix_fmt = pixel_format;
+    encoder_->time_base = AVRational{1, fps_};
+    encoder_->framerate = AVRational{fps_, 1};
+    if (muxer_ && (muxer_->oformat->flags & AVFMT_GLOBALHEADER)) {
+        encoder_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    int result = avcodec_open2(encoder_, codec, nullptr);
+    if (result < 0) {
+        log_error("Failed to open " + std::string(codec->name) + " encoder: " + av_error_string(result));
+        close();
+        return false;
+    }
+    
+    frame_->format = pixel_format;
+    frame_->width = width;
+    frame_->height = height;
+    sws_ = sws_getContext(width, height, AV_PIX_FMT_RGBA, width, height, pixel_format, SWS_BILINEAR,
+                          nullptr, nullptr, nullptr);
+    if (!sws_ || av_frame_get_buffer(frame_, 0) < 0) {
+        close();
+        return false;
+    }
+    
+    if (muxer_) {
+        stream_ = avformat_new_stream(muxer_, nullptr);
+        if (!stream_ || avcodec_parameters_from_context(stream_->codecpar, encoder_) < 0) {
+            close();
+            return false;
+        }
+        stream_->time_base = encoder_->time_base;
+        
+        result = avio_open(&muxer_->pb, path_.c_str(), AVIO_FLAG_WRITE);
+        if (result >= 0) {
+            result = avformat_write_header(muxer_, nullptr);
+        }
+        if (result < 0) {
+            log_error("Failed to start " + path_ + ": " + av_error_string(result));
+            close();
+            return false;
+        }
+        muxing_ = true;
+    }
+    
+    log_info("Recording frames to " + path_ + " with " + codec->name);
+    return true;
+}
+
+bool FrameRecorder::write_ffmpeg(const unsigned char* pixels) {
+    if (!encoder_) return false;
+    if (av_frame_make_writable(frame_) < 0) return false;
+    
+    // A negative stride walks the bottom-up rows top first
+    const uint8_t* source[1] = {pixels + static_cast<size_t>(height_ - 1) * width_ * 4};
+    const int source_stride[1] = {-width_ * 4};
+    sws_scale(sws_, source, source_stride, 0, frame_->height, frame_->data, frame_->linesize);
+    frame_->pts = static_cast<int64_t>(frames_written_);
+    
+    if (format_ == Format::Png) {
+        if (avcodec_send_frame(encoder_, frame_) < 0 || avcodec_receive_packet(encoder_, packet_) < 0) {
+            log_error("Failed to encode frame for " + path_);
+            return false;
+        }
+        
+        // Written aside and renamed, so readers never see a partial file
+        std::string output = sequence_path(frames_written_);
+        std::string temporary = output + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        bool written = file && fwrite(packet_->data, 1, packet_->size, file) == static_cast<size_t>(packet_->size);
+        written = file && fclose(file) == 0 && written;
+        av_packet_unref(packet_);
+        if (!written || rename(temporary.c_str(), output.c_str()) != 0) {
+            log_error("Failed to write " + output + ": " + strerror(errno));
+            unlink(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+    
+    if (avcodec_send_frame(encoder_, frame_) < 0) {
+        log_error("Failed to encode frame for " + path_);
+        return false;
+    }
+    return drain_encoder();
+}
+
+bool FrameRecorder::drain_encoder() {
+    for (;;) {
+        int result = avcodec_receive_packet(encoder_, packet_);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) return true;
+        if (result < 0) return false;
+        
+        av_packet_rescale_ts(packet_, encoder_->time_base, stream_->time_base);
+        packet_->stream_index = stream_->index;
+        result = av_interleaved_write_frame(muxer_, packet_);
+        if (result < 0) {
+            log_error("Failed to write " + path_ + ": " + av_error_string(result));
+            return false;
+        }
+    }
+}
+#else
+bool FrameRecorder::open_ffmpeg() {
+    log_error("Recording to " + path_ + " needs FFmpeg at build time; use a .y4m file");
+    return false;
+}
+
+bool FrameRecorder::write_ffmpeg(const unsigned char*) {
+    return false;
+}
+
+bool FrameRecorder::drain_encoder() {
+    return false;
+}
+#endif
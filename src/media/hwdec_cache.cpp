@@ -0,0 +1,150 @@
+#include "universal-wallpaper/hwdec_cache.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// Decoder limits come in steps; streams within a class behave alike
+static const char* size_class(int64_t width, int64_t height) {
+    int64_t longer = std::max(width, height);
+    int64_t shorter = std::min(width, height);
+    if (longer <= 2048 && shorter <= 1152) return "fhd";
+    if (longer <= 4096 && shorter <= 2304) return "uhd";
+    return "8k";
+}
+
+// Tabs and newlines would break the line format
+static std::string sanitize(std::string value) {
+    for (char& c : value) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return value;
+}
+
+enum class CacheFile {
+    Missing,       // Absent, unreadable or another format
+    OtherDriver,   // Written for another driver or kernel
+    Read
+};
+
+static CacheFile read_cache_file(const std::string& path, const std::string& header, const std::string& driver_id,
+                                 std::map<std::string, std::string>& entries) {
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != header) {
+        return CacheFile::Missing;
+    }
+    if (!std::getline(file, line) || line != "driver\t" + driver_id) {
+        return CacheFile::OtherDriver;
+    }
+    
+    while (std::getline(file, line)) {
+        size_t separator = line.rfind('\t');
+        if (separator == std::string::npos || separator == 0) continue;
+        entries[line.substr(0, separator)] = line.substr(separator + 1);
+    }
+    return CacheFile::Read;
+}
+
+std::string HwdecCache::make_key(const std::string& codec, const std::string& profile, int64_t width, int64_t height) {
+    return sanitize(codec) + "\t" + sanitize(profile) + "\t" + size_class(width, height);
+}
+
+bool HwdecCache::load(const std::string& driver_id) {
+    entries_.clear();
+    changed_.clear();
+    dirty_ = false;
+    
+    std::string dir = get_cache_dir();
+    if (dir.empty()) {
+        path_.clear();
+        return false;
+    }
+    path_ = dir + "/hwdec.cache";
+    
+    // Kernel updates bring new DRM drivers; treat them like a driver change
+    struct utsname system{};
+    uname(&system);
+    driver_id_ = sanitize(driver_id + " / " + system.release);
+    
+    if (read_cache_file(path_, kHeader, driver_id_, entries_) == CacheFile::OtherDriver) {
+        log_info("GPU driver changed - hardware decoder support will be probed again");
+        dirty_ = true;
+        return true;
+    }
+    
+    log_debug("Loaded " + std::to_string(entries_.size()) + " cached hardware decoder results");
+    return true;
+}
+
+bool HwdecCache::save() {
+    if (path_.empty() || !dirty_) return false;
+    
+    // Instances sharing the cache serialize on a lock file; the cache itself
+    // is replaced by rename, so it can't hold the lock
+    std::string lock_path = path_ + ".lock";
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd < 0) return false;
+    if (flock(lock_fd, LOCK_EX) != 0) {
+        close(lock_fd);
+        return false;
+    }
+    
+    // Keep what other instances saved since load(); results recorded here win
+    std::map<std::string, std::string> merged;
+    read_cache_file(path_, kHeader, driver_id_, merged);
+    for (const std::string& key : changed_) {
+        merged[key] = entries_[key];
+    }
+    
+    std::string contents = std::string(kHeader) + "\n" + "driver\t" + driver_id_ + "\n";
+    for (const auto& [key, hwdec] : merged) {
+        contents += key + "\t" + hwdec + "\n";
+    }
+    
+    // Write a uniquely named sibling and rename it, so a crash can't leave
+    // half a cache and concurrent savers don't share a temp file
+    std::string temp_path = path_ + ".XXXXXX";
+    int fd = mkstemp(temp_path.data());
+    bool written = fd >= 0;
+    for (size_t offset = 0; written && offset < contents.size();) {
+        ssize_t count = write(fd, contents.data() + offset, contents.size() - offset);
+        written = count > 0;
+        if (written) offset += static_cast<size_t>(count);
+    }
+    if (fd >= 0) {
+        written = close(fd) == 0 && written;
+        if (written) written = rename(temp_path.c_str(), path_.c_str()) == 0;
+        if (!written) unlink(temp_path.c_str());
+    }
+    close(lock_fd);
+    
+    if (!written) return false;
+    entries_ = std::move(merged);
+    changed_.clear();
+    dirty_ = false;
+    return true;
+}
+
+bool HwdecCache::lookup(const std::string& codec, const std::string& profile, int64_t width, int64_t height,
+                        std::string& hwdec) const {
+    auto it = entries_.find(make_key(codec, profile, width, height));
+    if (it == entries_.end()) return false;
+    hwdec = it->second;
+    return true;
+}
+
+void HwdecCache::record(const std::string& codec, const std::string& profile, int64_t width, int64_t height,
+                        const std::string& hwdec) {
+    std::string key = make_key(codec, profile, width, height);
+    std::string& entry = entries_[key];
+    if (entry != hwdec) {
+        entry = hwdec;
+        changed_.insert(key);
+        dirty_ = true;
+    }
+}
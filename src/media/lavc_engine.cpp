@@ -0,0 +1,508 @@
+#include "universal-wallpaper/lavc_engine.h"
+#include "universal-wallpaper/renderer.h"
+#include "universal-wallpaper/utils.h"
+#include <mpv/render.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+static std::string av_error_string(int error) {
+    char buffer[128];
+    if (av_strerror(error, buffer, sizeof(buffer)) < 0) {
+        return "error " + std::to_string(error);
+    }
+    return buffer;
+}
+
+LavcEngine::LavcEngine(Renderer& renderer) : renderer_(renderer) {
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        throw std::runtime_error(std::string("Failed to create media wakeup eventfd: ") + strerror(errno));
+    }
+}
+
+LavcEngine::~LavcEngine() {
+    destroy();
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+}
+
+// A still would be decoded again on every pass of the loop; mpv shows it
+// once. Not every container counts its frames, so look for a second one.
+static bool is_still_image(AVFormatContext* format, const AVStream* stream) {
+    if (stream->nb_frames == 1 || (stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+        return true;
+    }
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) return true;
+    int frames = 0;
+    while (frames < 2 && av_read_frame(format, packet) >= 0) {
+        if (packet->stream_index == stream->index) frames++;
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    return frames < 2;
+}
+
+bool LavcEngine::is_suitable(const std::string& media_path) {
+    // Packages, URLs and anything else mpv resolves itself stay with mpv
+    struct stat st;
+    if (stat(media_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    
+    AVFormatContext* format = nullptr;
+    if (avformat_open_input(&format, media_path.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    bool suitable = false;
+    if (avformat_find_stream_info(format, nullptr) >= 0) {
+        int video_streams = 0;
+        AVStream* stream = nullptr;
+        for (unsigned int i = 0; i < format->nb_streams; i++) {
+            if (format->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                video_streams++;
+                stream = format->streams[i];
+            }
+        }
+        const AVCodecParameters* video = stream ? stream->codecpar : nullptr;
+        suitable = video_streams == 1 && video->width > 0 && video->height > 0 &&
+                   video->width <= kMaxWidth && video->height <= kMaxHeight && !is_still_image(format, stream) &&
+                   av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) >= 0;
+    }
+    
+    avformat_close_input(&format);
+    return suitable;
+}
+
+bool LavcEngine::initialize(const std::string& media_path, bool hardware_decode, bool loop,
+                            bool mute_audio, double volume, const std::string& additional_options) {
+    (void)hardware_decode;
+    (void)mute_audio;
+    (void)volume;
+    if (!additional_options.empty()) {
+        log_warn("lavc engine ignores mpv options: " + additional_options);
+    }
+    
+    int result = avformat_open_input(&format_, media_path.c_str(), nullptr, nullptr);
+    if (result < 0) {
+        log_error("Failed to open media " + media_path + ": " + av_error_string(result));
+        return false;
+    }
+    
+    result = avformat_find_stream_info(format_, nullptr);
+    if (result < 0) {
+        log_error("Failed to read stream info: " + av_error_string(result));
+        destroy();
+        return false;
+    }
+    
+    const AVCodec* decoder = nullptr;
+    stream_index_ = av_find_best_stream(format_, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (stream_index_ < 0 || !decoder) {
+        log_error("No decodable video stream in " + media_path);
+        destroy();
+        return false;
+    }
+    AVStream* stream = format_->streams[stream_index_];
+    
+    codec_ = avcodec_alloc_context3(decoder);
+    if (!codec_ || avcodec_parameters_to_context(codec_, stream->codecpar) < 0) {
+        log_error("Failed to set up decoder " + std::string(decoder->name));
+        destroy();
+        return false;
+    }
+    
+    // Decode on our own thread only: loops this engine takes are small
+    // enough for one core, and libavcodec's thread pools are exactly the
+    // threads and per-thread buffers this engine is meant to avoid
+    codec_->thread_count = 1;
+    
+    result = avcodec_open2(codec_, decoder, nullptr);
+    if (result < 0) {
+        log_error("Failed to open decoder " + std::string(decoder->name) + ": " + av_error_string(result));
+        destroy();
+        return false;
+    }
+    
+    decoded_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!decoded_ || !packet_) {
+        log_error("Failed to allocate decoder buffers");
+        destroy();
+        return false;
+    }
+    
+    time_base_ = av_q2d(stream->time_base);
+    start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    AVRational rate = av_guess_frame_rate(format_, stream, nullptr);
+    if (rate.num > 0 && rate.den > 0) {
+        container_fps_ = av_q2d(rate);
+        frame_duration_us_ = static_cast<int64_t>(1000000.0 / container_fps_);
+    }
+    if (format_->duration != AV_NOPTS_VALUE && format_->duration > 0) {
+        duration_ = static_cast<double>(format_->duration) / AV_TIME_BASE;
+    }
+    
+    video_width_ = codec_->width;
+    video_height_ = codec_->height;
+    loop_ = loop;
+    loop_offset_us_ = 0;
+    last_pts_us_ = 0;
+    clock_started_ = false;
+    stop_ = false;
+    playing_ = true;
+    
+    decode_thread_ = std::thread(&LavcEngine::decode_loop, this);
+    
+    log_info("lavc engine playing " + media_path + " (" + decoder->name + ", " +
+             std::to_string(video_width_) + "x" + std::to_string(video_height_) + ")");
+    return true;
+}
+
+void LavcEngine::destroy() {
+    if (decode_thread_.joinable()) {
+        stop_ = true;
+        queue_space_.notify_all();
+        decode_thread_.join();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.clear();
+        free_buffers_.clear();
+    }
+    
+    if (texture_) {
+        renderer_.destroy_texture(texture_);
+        texture_ = 0;
+    }
+    
+    if (sws_) {
+        sws_freeContext(sws_);
+        sws_ = nullptr;
+    }
+    av_packet_free(&packet_);
+    av_frame_free(&decoded_);
+    avcodec_free_context(&codec_);
+    avformat_close_input(&format_);
+    
+    stream_index_ = -1;
+    video_width_ = 0;
+    video_height_ = 0;
+    playing_ = false;
+}
+
+bool LavcEngine::create_render_context(void* (*get_proc_address)(void* ctx, const char* name),
+                                       void* get_proc_address_ctx) {
+    // Frames go through the renderer's own texture path; nothing to set up
+    (void)get_proc_address;
+    (void)get_proc_address_ctx;
+    return true;
+}
+
+void LavcEngine::decode_loop() {
+    while (!stop_) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_space_.wait(lock, [this] { return stop_ || queue_.size() < kQueueSize; });
+            if (stop_) break;
+            if (!free_buffers_.empty()) {
+                frame.pixels = std::move(free_buffers_.back());
+                free_buffers_.pop_back();
+            }
+        }
+        
+        if (!decode_next(frame)) {
+            playing_ = false;
+            signal_wakeup();
+            break;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back(std::move(frame));
+        }
+        decoded_frames_++;
+        signal_wakeup();
+    }
+}
+
+bool LavcEngine::decode_next(Frame& frame) {
+    while (!stop_) {
+        int result = avcodec_receive_frame(codec_, decoded_);
+        if (result == 0) {
+            int64_t pts = decoded_->best_effort_timestamp;
+            int64_t pts_us = last_pts_us_ + frame_duration_us_;
+            if (pts != AV_NOPTS_VALUE) {
+                // Relative to the stream start, which needn't be 0 (MPEG-TS)
+                pts_us = loop_offset_us_ + std::llround((pts - start_pts_) * time_base_ * 1000000.0);
+            }
+            last_pts_us_ = pts_us;
+            
+            // Rows are written bottom-up through a negative stride so the
+            // buffer is already in GL's texture orientation
+            int width = decoded_->width;
+            int height = decoded_->height;
+            sws_ = sws_getCachedContext(sws_, width, height, static_cast<AVPixelFormat>(decoded_->format),
+                                        width, height, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!sws_) {
+                log_error("Failed to create pixel format converter");
+                return false;
+            }
+            frame.pixels.resize(static_cast<size_t>(width) * height * 4);
+            uint8_t* destination[4] = {frame.pixels.data() + static_cast<size_t>(height - 1) * width * 4,
+                                       nullptr, nullptr, nullptr};
+            int destination_stride[4] = {-width * 4, 0, 0, 0};
+            sws_scale(sws_, decoded_->data, decoded_->linesize, 0, height, destination, destination_stride);
+            
+            frame.width = width;
+            frame.height = height;
+            frame.pts_us = pts_us;
+            av_frame_unref(decoded_);
+            return true;
+        }
+        if (result == AVERROR_EOF) {
+            if (!loop_ || !rewind()) return false;
+            continue;
+        }
+        if (result != AVERROR(EAGAIN)) {
+            log_error("Video decode failed: " + av_error_string(result));
+            return false;
+        }
+        
+        // Decoder wants input
+        result = av_read_frame(format_, packet_);
+        if (result == AVERROR_EOF) {
+            avcodec_send_packet(codec_, nullptr);  // Drain the remaining frames
+            continue;
+        }
+        if (result < 0) {
+            log_error("Demux failed: " + av_error_string(result));
+            return false;
+        }
+        if (packet_->stream_index == stream_index_) {
+            result = avcodec_send_packet(codec_, packet_);
+            if (result < 0 && result != AVERROR(EAGAIN)) {
+                log_warn("Dropping undecodable packet: " + av_error_string(result));
+            }
+        }
+        av_packet_unref(packet_);
+    }
+    return false;
+}
+
+bool LavcEngine::rewind() {
+    int result = av_seek_frame(format_, stream_index_, start_pts_, AVSEEK_FLAG_BACKWARD);
+    if (result < 0) {
+        log_error("Failed to rewind for loop: " + av_error_string(result));
+        return false;
+    }
+    avcodec_flush_buffers(codec_);
+    
+    // The next pass continues the timeline where this one ended, so the
+    // render side never sees timestamps jump backwards
+    loop_offset_us_ = last_pts_us_ + frame_duration_us_;
+    loops_++;
+    return true;
+}
+
+void LavcEngine::recycle(Frame& frame) {
+    // Caller holds queue_mutex_
+    free_buffers_.push_back(std::move(frame.pixels));
+    queue_space_.notify_one();
+}
+
+void LavcEngine::signal_wakeup() {
+    uint64_t one = 1;
+    while (write(wakeup_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+uint64_t LavcEngine::update() {
+    uint64_t count = 0;
+    while (read(wakeup_fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    
+    // Drop frames whose successor is already due; late frames would only
+    // make the video run behind its clock
+    if (clock_started_ && !paused_) {
+        int64_t now = get_time_us();
+        while (queue_.size() > 1 && clock_base_us_ + queue_[1].pts_us <= now) {
+            recycle(queue_.front());
+            queue_.pop_front();
+            dropped_frames_++;
+        }
+    }
+    return queue_.empty() ? 0 : MPV_RENDER_UPDATE_FRAME;
+}
+
+void LavcEngine::get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const {
+    flags = MPV_RENDER_FRAME_INFO_PRESENT;
+    target_time_us = 0;
+    
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queue_.empty()) {
+        flags = 0;
+        return;
+    }
+    if (clock_started_) {
+        target_time_us = clock_base_us_ + queue_.front().pts_us;
+    }
+}
+
+int64_t LavcEngine::get_time_us() const {
+    if (clock_step_us_ > 0) return stepped_time_us_;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool LavcEngine::skip_frame() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queue_.empty()) return false;
+    recycle(queue_.front());
+    queue_.pop_front();
+    dropped_frames_++;
+    return true;
+}
+
+bool LavcEngine::has_new_frame() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return !queue_.empty();
+}
+
+void LavcEngine::set_paused(bool paused) {
+    if (paused == paused_) return;
+    paused_ = paused;
+    
+    // The clock stands still while paused; the decode thread simply stops
+    // once the queue is full
+    if (paused) {
+        paused_at_us_ = get_time_us();
+    } else if (clock_started_) {
+        clock_base_us_ += get_time_us() - paused_at_us_;
+    }
+}
+
+bool LavcEngine::set_clock_step(int64_t step_us) {
+    if (step_us <= 0) return false;
+    clock_step_us_ = step_us;
+    stepped_time_us_ = 0;
+    return true;
+}
+
+void LavcEngine::step_clock() {
+    if (clock_step_us_ <= 0) return;
+    stepped_time_us_ += clock_step_us_;
+    signal_wakeup();  // update() drops the frames the step passed
+}
+
+bool LavcEngine::has_stepped() const {
+    if (clock_step_us_ <= 0 || !clock_started_) return true;
+    
+    // The frame due now is known once a later one is decoded, or none come
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return !playing_ || (!queue_.empty() && clock_base_us_ + queue_.back().pts_us > stepped_time_us_);
+}
+
+void LavcEngine::set_prescale_target(int width, int height, bool cover) {
+    output_width_ = width;
+    output_height_ = height;
+    output_cover_ = cover;
+}
+
+bool LavcEngine::render_frame(int fbo, int width, int height) {
+    (void)fbo;  // Already bound by the caller
+    
+    Frame frame;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!queue_.empty()) {
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+    }
+    
+    // Redraws without a new frame reuse the last upload
+    if (frame.pixels.empty()) {
+        if (!texture_) return false;
+        draw_texture(width, height);
+        return true;
+    }
+    
+    if (!clock_started_) {
+        clock_base_us_ = get_time_us() - frame.pts_us;
+        clock_started_ = true;
+    }
+    
+    if (!texture_ || frame.width != video_width_ || frame.height != video_height_) {
+        if (texture_) renderer_.destroy_texture(texture_);
+        texture_ = renderer_.create_texture(frame.width, frame.height);
+        video_width_ = frame.width;
+        video_height_ = frame.height;
+    }
+    renderer_.update_texture(texture_, frame.width, frame.height, frame.pixels.data(),
+                             frame.width * 4, PixelFormat::RGBA8);
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        recycle(frame);
+    }
+    
+    draw_texture(width, height);
+    
+    presented_frames_++;
+    double pts = static_cast<double>(frame.pts_us) / 1000000.0;
+    position_ = duration_ > 0.0 ? std::fmod(pts, duration_) : pts;
+    return true;
+}
+
+void LavcEngine::draw_texture(int width, int height) {
+    // Letterbox by default, crop for fill
+    double scale_x = static_cast<double>(width) / video_width_;
+    double scale_y = static_cast<double>(height) / video_height_;
+    double scale = output_cover_ ? std::max(scale_x, scale_y) : std::min(scale_x, scale_y);
+    int draw_width = static_cast<int>(std::lround(video_width_ * scale));
+    int draw_height = static_cast<int>(std::lround(video_height_ * scale));
+    renderer_.set_viewport((width - draw_width) / 2, (height - draw_height) / 2, draw_width, draw_height);
+    renderer_.draw_fullscreen_quad(texture_);
+    renderer_.set_viewport(0, 0, width, height);
+}
+
+void LavcEngine::get_memory_usage(size_t& buffer_bytes, size_t& decoder_bytes) const {
+    // Software decoding: the RGBA queue and its recycled buffers are all
+    // there is besides libavcodec's own frame pool
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    buffer_bytes = 0;
+    for (const auto& frame : queue_) {
+        buffer_bytes += frame.pixels.capacity();
+    }
+    for (const auto& buffer : free_buffers_) {
+        buffer_bytes += buffer.capacity();
+    }
+    decoder_bytes = 0;
+}
+
+void LavcEngine::dump_stats() const {
+    log_info("lavc engine: " + std::to_string(decoded_frames_.load()) + " decoded, " +
+             std::to_string(presented_frames_) + " presented, " + std::to_string(dropped_frames_) +
+             " dropped, " + std::to_string(loops_.load()) + " loops");
+}
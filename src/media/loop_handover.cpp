@@ -0,0 +1,67 @@
+#include "universal-wallpaper/loop_handover.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cstdio>
+
+void LoopHandover::frame_presented(double position, double duration, double fps, Clock::time_point now) {
+    // The engine restarted before the handover; the prepared engine is
+    // still held and takes the next boundary
+    if (has_previous_ && position + kRewindThreshold < last_position_ && state_ == State::SwitchDue) {
+        missed_++;
+        state_ = State::Prepared;
+    }
+    has_previous_ = true;
+    last_position_ = position;
+    if (duration < kMinDuration) return;
+    
+    double frame = 1.0 / (fps > 0.0 ? fps : 30.0);
+    double remaining = duration - position;
+    if (state_ == State::Playing && remaining <= kPrepareLead) {
+        state_ = State::PrepareDue;
+    } else if (state_ == State::Prepared && remaining < frame * 1.5) {
+        // The last frame of the pass; it keeps its full duration on screen
+        state_ = State::SwitchDue;
+        switch_time_ = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(remaining));
+    }
+}
+
+LoopHandover::Action LoopHandover::update(Clock::time_point now) {
+    if (state_ == State::PrepareDue) {
+        state_ = State::Prepared;
+        return Action::Prepare;
+    }
+    if (state_ == State::SwitchDue && now >= switch_time_) {
+        state_ = State::Switched;
+        handovers_++;
+        return Action::Switch;
+    }
+    return Action::None;
+}
+
+LoopHandover::Clock::duration LoopHandover::time_until_action(Clock::time_point now) const {
+    if (state_ == State::PrepareDue) return Clock::duration::zero();
+    if (state_ == State::SwitchDue) return std::max(Clock::duration::zero(), Clock::duration(switch_time_ - now));
+    return Clock::duration::max();
+}
+
+bool LoopHandover::take_handover() {
+    if (state_ != State::Switched) return false;
+    state_ = State::Playing;
+    has_previous_ = false;
+    return true;
+}
+
+void LoopHandover::reset() {
+    state_ = State::Playing;
+    has_previous_ = false;
+    last_position_ = 0.0;
+}
+
+void LoopHandover::dump_stats() const {
+    if (handovers_ == 0 && missed_ == 0) return;
+    
+    char message[128];
+    snprintf(message, sizeof(message), "Loop handovers: %llu, %llu missed (engine looped first)",
+             static_cast<unsigned long long>(handovers_), static_cast<unsigned long long>(missed_));
+    log_info(message);
+}
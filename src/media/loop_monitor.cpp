@@ -0,0 +1,37 @@
+#include "universal-wallpaper/loop_monitor.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cstdio>
+
+void LoopMonitor::frame_presented(double position, Clock::time_point now) {
+    if (has_previous_) {
+        double interval_ms = std::chrono::duration<double, std::milli>(now - last_present_).count();
+        
+        if (position + kRewindThreshold < last_position_) {
+            loops_++;
+            boundary_gap_total_ms_ += interval_ms;
+            boundary_gap_max_ms_ = std::max(boundary_gap_max_ms_, interval_ms);
+            last_boundary_gap_ms_ = interval_ms;
+        } else {
+            frames_++;
+            frame_interval_total_ms_ += interval_ms;
+        }
+    }
+    
+    has_previous_ = true;
+    last_position_ = position;
+    last_present_ = now;
+}
+
+void LoopMonitor::dump_stats() const {
+    if (loops_ == 0) return;
+    
+    double frame_interval_ms = frames_ > 0 ? frame_interval_total_ms_ / static_cast<double>(frames_) : 0.0;
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Loop boundaries: %llu, gap %.1f ms avg / %.1f ms max / %.1f ms last, frame interval %.1f ms avg",
+             static_cast<unsigned long long>(loops_), boundary_gap_total_ms_ / static_cast<double>(loops_),
+             boundary_gap_max_ms_, last_boundary_gap_ms_, frame_interval_ms);
+    log_info(message);
+}
@@ -0,0 +1,375 @@
+#include "universal-wallpaper/media_io.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// A file copied into a sealed memfd, mapped read-only
+struct MediaIO::ResidentFile {
+    int fd = -1;
+    const char* data = nullptr;
+    int64_t size = 0;
+    int64_t mtime_ns = 0;
+    
+    ~ResidentFile() {
+        if (data) munmap(const_cast<char*>(data), static_cast<size_t>(size));
+        if (fd >= 0) close(fd);
+    }
+};
+
+// One mpv stream; backed by memory (a resident file or a package entry)
+// or by the file itself
+struct MediaIO::Stream {
+    MediaIO* io = nullptr;
+    std::shared_ptr<ResidentFile> resident;
+    std::shared_ptr<PkgReader> package;
+    const char* memory = nullptr;
+    int fd = -1;
+    int64_t size = 0;
+    int64_t position = 0;
+    int64_t furthest = 0;
+    
+    // Read-ahead buffer for streamed files
+    std::vector<char> buffer;
+    int64_t buffer_offset = 0;
+    size_t buffer_length = 0;
+    int64_t advised_until = 0;
+    
+    std::atomic<bool> cancelled{false};
+};
+
+static int64_t mtime_ns(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+MediaIO::~MediaIO() {
+    // Streams hold their own references; mpv closes them before it is destroyed
+    std::lock_guard<std::mutex> lock(resident_mutex_);
+    resident_.clear();
+}
+
+bool MediaIO::register_protocol(mpv_handle* mpv) {
+    if (!mpv) return false;
+    
+    int result = mpv_stream_cb_add_ro(mpv, kProtocol, this, on_open);
+    if (result >= 0) {
+        result = mpv_stream_cb_add_ro(mpv, kPackageProtocol, this, on_open_package);
+    }
+    if (result < 0) {
+        log_warn("Failed to register media I/O stream: " + std::string(mpv_error_string(result)));
+        return false;
+    }
+    registered_ = true;
+    return true;
+}
+
+std::string MediaIO::wrap_path(const std::string& path) {
+    if (!registered_ || path.find("://") != std::string::npos) return path;
+    
+    if (PkgReader::is_package_path(path)) {
+        size_t separator = path.find('#');
+        std::string file = path.substr(0, separator);
+        if (separator != std::string::npos) {
+            return std::string(kPackageProtocol) + "://" + path;
+        }
+        
+        auto package = get_package(file);
+        const PkgReader::Entry* video = package ? package->find_first_video() : nullptr;
+        if (!video) {
+            log_error("No video entry in package " + file);
+            return path;
+        }
+        return std::string(kPackageProtocol) + "://" + file + "#" + std::string(video->name);
+    }
+    
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return path;
+    
+    return std::string(kProtocol) + "://" + path;
+}
+
+std::shared_ptr<MediaIO::ResidentFile> MediaIO::get_resident(const std::string& path, int fd, int64_t size) {
+    if (cache_budget_ == 0 || static_cast<size_t>(size) > cache_budget_) return nullptr;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) return nullptr;
+    
+    std::lock_guard<std::mutex> lock(resident_mutex_);
+    
+    auto it = resident_.find(path);
+    if (it != resident_.end()) {
+        if (it->second->size == size && it->second->mtime_ns == mtime_ns(st)) {
+            return it->second;
+        }
+        // The file changed on disk
+        resident_bytes_ -= static_cast<size_t>(it->second->size);
+        resident_.erase(it);
+    }
+    
+    // Make room by dropping files no stream is using
+    for (auto entry = resident_.begin();
+         entry != resident_.end() && resident_bytes_ + static_cast<size_t>(size) > cache_budget_;) {
+        if (entry->second.use_count() == 1) {
+            resident_bytes_ -= static_cast<size_t>(entry->second->size);
+            entry = resident_.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+    if (resident_bytes_ + static_cast<size_t>(size) > cache_budget_) return nullptr;
+    
+    auto file = load_resident(fd, size);
+    if (!file) return nullptr;
+    
+    file->mtime_ns = mtime_ns(st);
+    resident_bytes_ += static_cast<size_t>(size);
+    resident_[path] = file;
+    log_debug("Media " + path + " is memory resident (" + std::to_string(size / (1024 * 1024)) + " MB)");
+    return file;
+}
+
+std::shared_ptr<MediaIO::ResidentFile> MediaIO::load_resident(int fd, int64_t size) {
+    auto file = std::make_shared<ResidentFile>();
+    file->size = size;
+    file->fd = memfd_create("wallpaper-media", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (file->fd < 0 || ftruncate(file->fd, size) != 0) {
+        log_warn("Failed to create media memfd: " + std::string(strerror(errno)));
+        return nullptr;
+    }
+    if (size == 0) return nullptr;
+    
+    void* writable = mmap(nullptr, static_cast<size_t>(size), PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (writable == MAP_FAILED) return nullptr;
+    
+    // Sequential hint doubles the kernel read-ahead for the one-time copy
+    posix_fadvise(fd, 0, size, POSIX_FADV_SEQUENTIAL);
+    
+    int64_t offset = 0;
+    while (offset < size) {
+        ssize_t count = pread(fd, static_cast<char*>(writable) + offset, static_cast<size_t>(size - offset), offset);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        offset += count;
+    }
+    munmap(writable, static_cast<size_t>(size));
+    disk_bytes_.fetch_add(static_cast<uint64_t>(offset), std::memory_order_relaxed);
+    
+    if (offset != size) {
+        log_warn("Short read while caching media; streaming it instead");
+        return nullptr;
+    }
+    
+    // Sealed contents can't change under mpv, and the page cache copy of the
+    // source is no longer needed
+    fcntl(file->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED);
+    
+    void* readable = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, file->fd, 0);
+    if (readable == MAP_FAILED) return nullptr;
+    file->data = static_cast<const char*>(readable);
+    return file;
+}
+
+std::shared_ptr<PkgReader> MediaIO::get_package(const std::string& path) {
+    std::lock_guard<std::mutex> lock(packages_mutex_);
+    
+    auto it = packages_.find(path);
+    if (it != packages_.end()) return it->second;
+    
+    auto package = std::make_shared<PkgReader>();
+    if (!package->open(path)) return nullptr;
+    packages_[path] = package;
+    return package;
+}
+
+void MediaIO::count_loop() {
+    uint64_t disk = disk_bytes_.load(std::memory_order_relaxed);
+    last_loop_disk_bytes_.store(disk - disk_bytes_at_loop_.exchange(disk, std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+    loops_.fetch_add(1, std::memory_order_relaxed);
+}
+
+int MediaIO::open_stream(const char* uri, mpv_stream_cb_info* info) {
+    std::string path = uri;
+    const std::string prefix = std::string(kProtocol) + "://";
+    if (path.compare(0, prefix.size(), prefix) == 0) {
+        path = path.substr(prefix.size());
+    }
+    
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Failed to open media " + path + ": " + strerror(errno));
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    
+    auto stream = new Stream();
+    stream->io = this;
+    stream->size = static_cast<int64_t>(st.st_size);
+    stream->resident = get_resident(path, fd, stream->size);
+    if (stream->resident) {
+        stream->memory = stream->resident->data;
+        close(fd);
+    } else {
+        stream->fd = fd;
+        stream->buffer.resize(kReadChunk);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    
+    fill_callbacks(stream, info);
+    return 0;
+}
+
+int MediaIO::open_package_stream(const char* uri, mpv_stream_cb_info* info) {
+    std::string path = uri;
+    const std::string prefix = std::string(kPackageProtocol) + "://";
+    if (path.compare(0, prefix.size(), prefix) == 0) {
+        path = path.substr(prefix.size());
+    }
+    
+    size_t separator = path.find('#');
+    if (separator == std::string::npos) {
+        log_error("Package URI without an entry: " + path);
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    std::string entry_name = path.substr(separator + 1);
+    path.resize(separator);
+    
+    auto package = get_package(path);
+    const PkgReader::Entry* entry = package ? package->find(entry_name) : nullptr;
+    if (!entry) {
+        log_error("Entry " + entry_name + " not found in package " + path);
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    
+    // Reads copy straight out of the package mapping
+    auto stream = new Stream();
+    stream->io = this;
+    stream->package = package;
+    stream->memory = reinterpret_cast<const char*>(entry->data);
+    stream->size = static_cast<int64_t>(entry->size);
+    
+    fill_callbacks(stream, info);
+    return 0;
+}
+
+void MediaIO::fill_callbacks(Stream* stream, mpv_stream_cb_info* info) {
+    info->cookie = stream;
+    info->read_fn = on_read;
+    info->seek_fn = on_seek;
+    info->size_fn = on_size;
+    info->close_fn = on_close;
+    info->cancel_fn = on_cancel;
+}
+
+int MediaIO::on_open(void* user_data, char* uri, mpv_stream_cb_info* info) {
+    return static_cast<MediaIO*>(user_data)->open_stream(uri, info);
+}
+
+int MediaIO::on_open_package(void* user_data, char* uri, mpv_stream_cb_info* info) {
+    return static_cast<MediaIO*>(user_data)->open_package_stream(uri, info);
+}
+
+int64_t MediaIO::on_read(void* cookie, char* buffer, uint64_t bytes) {
+    auto* stream = static_cast<Stream*>(cookie);
+    if (stream->cancelled.load(std::memory_order_relaxed)) return -1;
+    if (stream->position >= stream->size) return 0;
+    
+    size_t count = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(bytes), stream->size - stream->position));
+    
+    if (stream->memory) {
+        memcpy(buffer, stream->memory + stream->position, count);
+    } else {
+        // Refill the buffer when the position leaves it
+        int64_t buffer_end = stream->buffer_offset + static_cast<int64_t>(stream->buffer_length);
+        if (stream->position < stream->buffer_offset || stream->position >= buffer_end) {
+            ssize_t filled;
+            do {
+                filled = pread(stream->fd, stream->buffer.data(), stream->buffer.size(), stream->position);
+            } while (filled < 0 && errno == EINTR);
+            if (filled <= 0) return filled < 0 ? -1 : 0;
+            
+            stream->buffer_offset = stream->position;
+            stream->buffer_length = static_cast<size_t>(filled);
+            buffer_end = stream->buffer_offset + filled;
+            stream->io->disk_bytes_.fetch_add(static_cast<uint64_t>(filled), std::memory_order_relaxed);
+            
+            // Keep the kernel one window ahead so the next refill hits the page cache
+            if (stream->advised_until < buffer_end || stream->advised_until > buffer_end + static_cast<int64_t>(kReadAheadWindow)) {
+                posix_fadvise(stream->fd, buffer_end, kReadAheadWindow, POSIX_FADV_WILLNEED);
+                stream->advised_until = buffer_end + static_cast<int64_t>(kReadAheadWindow);
+            }
+        }
+        count = std::min(count, static_cast<size_t>(buffer_end - stream->position));
+        memcpy(buffer, stream->buffer.data() + (stream->position - stream->buffer_offset), count);
+    }
+    
+    stream->position += static_cast<int64_t>(count);
+    stream->furthest = std::max(stream->furthest, stream->position);
+    stream->io->served_bytes_.fetch_add(count, std::memory_order_relaxed);
+    return static_cast<int64_t>(count);
+}
+
+int64_t MediaIO::on_seek(void* cookie, int64_t offset) {
+    auto* stream = static_cast<Stream*>(cookie);
+    if (offset < 0 || offset > stream->size) return MPV_ERROR_GENERIC;
+    
+    // A rewind to the start after most of the file was read is a loop
+    if (offset < static_cast<int64_t>(kReadChunk) && stream->furthest > stream->size / 2) {
+        stream->io->count_loop();
+        stream->furthest = offset;
+    }
+    stream->position = offset;
+    return offset;
+}
+
+int64_t MediaIO::on_size(void* cookie) {
+    return static_cast<Stream*>(cookie)->size;
+}
+
+void MediaIO::on_close(void* cookie) {
+    auto* stream = static_cast<Stream*>(cookie);
+    if (stream->fd >= 0) close(stream->fd);
+    delete stream;
+}
+
+void MediaIO::on_cancel(void* cookie) {
+    static_cast<Stream*>(cookie)->cancelled.store(true, std::memory_order_relaxed);
+}
+
+size_t MediaIO::get_resident_bytes() const {
+    std::lock_guard<std::mutex> lock(resident_mutex_);
+    return resident_bytes_;
+}
+
+void MediaIO::dump_stats() const {
+    if (!registered_) return;
+    
+    uint64_t loops = loops_.load(std::memory_order_relaxed);
+    double disk_mb = static_cast<double>(disk_bytes_.load(std::memory_order_relaxed)) / (1024.0 * 1024.0);
+    double served_mb = static_cast<double>(served_bytes_.load(std::memory_order_relaxed)) / (1024.0 * 1024.0);
+    double last_loop_mb = static_cast<double>(last_loop_disk_bytes_.load(std::memory_order_relaxed)) / (1024.0 * 1024.0);
+    size_t resident_bytes;
+    {
+        std::lock_guard<std::mutex> lock(resident_mutex_);
+        resident_bytes = resident_bytes_;
+    }
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Media I/O: %.1f MB resident, %.1f MB read from disk, %.1f MB served, %llu loops, %.1f MB disk reads last loop",
+             static_cast<double>(resident_bytes) / (1024.0 * 1024.0), disk_mb, served_mb,
+             static_cast<unsigned long long>(loops), last_loop_mb);
+    log_info(message);
+}
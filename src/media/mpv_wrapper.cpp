@@ -2,16 +2,54 @@
 #include "universal-wallpaper/utils.h"
 #include <iostream>
 #include <sstream>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// reply_userdata values identifying observed properties
+enum ObservedProperty : uint64_t {
+    kPropPause = 1,
+    kPropWidth,
+    kPropHeight,
+    kPropDuration,
+    kPropTimePos,
+    kPropContainerFps,
+    kPropHwdecCurrent
+};
+
+// mpv's probe order for streams without a cached result
+static const char* const kHwdecProbeChain = "vaapi,vdpau,nvdec,auto-safe";
+
+// reply_userdata of the hook run after the demuxer opened, before decoding
+static constexpr uint64_t kHookPreloaded = 1;
+
+// Label of the pre-scale filter in mpv's vf chain
+static const char* const kPrescaleLabel = "@wne-prescale";
 
 MPVWrapper::MPVWrapper() {
     mpv_ = mpv_create();
     if (!mpv_) {
         throw std::runtime_error("Failed to create MPV instance");
     }
+    
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        mpv_terminate_destroy(mpv_);
+        mpv_ = nullptr;
+        throw std::runtime_error("Failed to create MPV wakeup eventfd");
+    }
 }
 
 MPVWrapper::~MPVWrapper() {
     destroy();
+    
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
 }
 
 bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode, 
@@ -25,12 +63,13 @@ bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode,
     
     if (hardware_decode) {
         // Use more aggressive hardware decoding for better performance
-        mpv_set_option_string(mpv_, "hwdec", "vaapi,vdpau,nvdec,auto-safe");
+        mpv_set_option_string(mpv_, "hwdec", kHwdecProbeChain);
         mpv_set_option_string(mpv_, "hwdec-codecs", "all");
         
         // CRITICAL: Enable zero-copy rendering to eliminate GPU→CPU→GPU bottleneck
         mpv_set_option_string(mpv_, "gpu-hwdec-interop", "auto");
-        mpv_set_option_string(mpv_, "hwdec-extra-frames", "4");  // Reduce frame copying
+        // Reduce frame copying; each extra surface is a decoded frame in VRAM
+        mpv_set_option_string(mpv_, "hwdec-extra-frames", std::to_string(hwdec_extra_frames_).c_str());
         
         // Direct rendering optimizations
         mpv_set_option_string(mpv_, "vd-lavc-dr", "yes");  // Direct rendering
@@ -38,20 +77,34 @@ bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode,
         
         // Zero-copy texture mapping (eliminates vaapi_transfer_data_from bottleneck)
         mpv_set_option_string(mpv_, "opengl-hwdec-interop", "auto");
-        mpv_set_option_string(mpv_, "video-sync", "display-resample");  // Reduce frame drops
     } else {
         mpv_set_option_string(mpv_, "hwdec", "no");
     }
     
+    // Bounded demuxer cache under --memory-budget; mpv's defaults otherwise
+    if (demuxer_max_bytes_ > 0) {
+        mpv_set_option_string(mpv_, "demuxer-max-bytes", std::to_string(demuxer_max_bytes_).c_str());
+        mpv_set_option_string(mpv_, "demuxer-max-back-bytes", std::to_string(demuxer_max_back_bytes_).c_str());
+    }
+    
+    // A still stays up until it is replaced; with mpv's default of one
+    // second, loop-file would decode and present it again every second
+    mpv_set_option_string(mpv_, "image-display-duration", "inf");
+    
     if (loop) {
         mpv_set_option_string(mpv_, "loop-file", "inf");
         mpv_set_option_string(mpv_, "loop-playlist", "inf");
+        if (seamless_loop_) {
+            configure_seamless_loop(media_path);
+        }
     }
     
+    audio_enabled_ = !mute_audio;
+    volume_ = volume;
+    volume_scale_ = 1.0;
+    mpv_set_option_string(mpv_, "volume", std::to_string(volume * 100).c_str());
     if (mute_audio) {
         mpv_set_option_string(mpv_, "audio", "no");
-    } else {
-        mpv_set_option_string(mpv_, "volume", std::to_string(volume * 100).c_str());
     }
     
     // Performance options for zero-copy rendering
@@ -74,9 +127,8 @@ bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode,
     // Thread optimizations
     mpv_set_option_string(mpv_, "vd-lavc-threads", "0");  // Use all CPU cores
     
-    // Frame rate limiting to reduce memory bandwidth
-    mpv_set_option_string(mpv_, "display-fps", "30");  // Limit to 30fps for wallpaper
-    mpv_set_option_string(mpv_, "video-sync", "display-resample");  // Smooth playback
+    // Frames are presented at the video's own rate (see FrameScheduler);
+    // resampling to a fixed display-fps would only manufacture repeats
     mpv_set_option_string(mpv_, "interpolation", "no");  // Disable interpolation to save CPU
     
     // Parse additional options
@@ -109,8 +161,21 @@ bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode,
         return false;
     }
     
+    observe_properties();
+    mpv_set_wakeup_callback(mpv_, on_mpv_events, this);
+    
+    if (hardware_decode && !hwdec_driver_.empty() && hwdec_cache_.load(hwdec_driver_)) {
+        mpv_hook_add(mpv_, kHookPreloaded, "on_preloaded", 0);
+    }
+    
+    // Serve local files through our own stream so loops don't go back to disk
+    std::string media_uri = media_path;
+    if (media_io_.register_protocol(mpv_)) {
+        media_uri = media_io_.wrap_path(media_path);
+    }
+    
     // Load media
-    const char* cmd[] = {"loadfile", media_path.c_str(), nullptr};
+    const char* cmd[] = {"loadfile", media_uri.c_str(), nullptr};
     if (mpv_command(mpv_, cmd) < 0) {
         log_error("Failed to load media: " + media_path);
         return false;
@@ -121,6 +186,9 @@ bool MPVWrapper::initialize(const std::string& media_path, bool hardware_decode,
 }
 
 void MPVWrapper::destroy() {
+    // Outstanding callbacks would outlive the objects they capture
+    pending_requests_.clear();
+    
     if (render_ctx_) {
         mpv_render_context_free(render_ctx_);
         render_ctx_ = nullptr;
@@ -132,6 +200,92 @@ void MPVWrapper::destroy() {
     }
 }
 
+void MPVWrapper::configure_seamless_loop(const std::string& media_path) {
+    // Upper bound for the packets kept behind the playback position
+    static constexpr int64_t kMaxPinnedBytes = 512LL * 1024 * 1024;
+    
+    // loop-file seeks back to 0 at EOF. When the demuxer still holds the
+    // packets from the start of the file, that seek is served from its cache
+    // instead of re-reading and re-demuxing, and without hr-seek it lands on
+    // the first keyframe directly instead of decoding up to an exact time.
+    // Only the decoder flush remains at the boundary.
+    int64_t max_pinned_bytes = kMaxPinnedBytes;
+    if (demuxer_max_back_bytes_ > 0) {
+        max_pinned_bytes = std::min<int64_t>(max_pinned_bytes, static_cast<int64_t>(demuxer_max_back_bytes_));
+    }
+    int64_t pinned_bytes = max_pinned_bytes;
+    struct stat st;
+    if (stat(media_path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        // Container overhead aside, demuxed packets are about the file size
+        pinned_bytes = std::min<int64_t>(max_pinned_bytes, st.st_size + st.st_size / 8 + 1024 * 1024);
+        if (st.st_size > max_pinned_bytes) {
+            log_warn("Media is larger than the seamless loop cache - only the tail of each loop stays cached");
+        }
+    }
+    
+    mpv_set_option_string(mpv_, "cache", "yes");
+    mpv_set_option_string(mpv_, "demuxer-seekable-cache", "yes");
+    mpv_set_option_string(mpv_, "demuxer-max-back-bytes", std::to_string(pinned_bytes).c_str());
+    mpv_set_option_string(mpv_, "hr-seek", "no");
+    
+    log_debug("Seamless loop: keeping up to " + std::to_string(pinned_bytes / (1024 * 1024)) + " MB of demuxed packets");
+}
+
+void MPVWrapper::observe_properties() {
+    // Native formats avoid string conversions; values arrive as
+    // MPV_EVENT_PROPERTY_CHANGE and are cached by process_events()
+    mpv_observe_property(mpv_, kPropPause, "pause", MPV_FORMAT_FLAG);
+    mpv_observe_property(mpv_, kPropWidth, "width", MPV_FORMAT_INT64);
+    mpv_observe_property(mpv_, kPropHeight, "height", MPV_FORMAT_INT64);
+    mpv_observe_property(mpv_, kPropDuration, "duration", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(mpv_, kPropTimePos, "time-pos", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(mpv_, kPropContainerFps, "container-fps", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(mpv_, kPropHwdecCurrent, "hwdec-current", MPV_FORMAT_STRING);
+}
+
+void MPVWrapper::handle_property_change(uint64_t id, const mpv_event_property* property) {
+    // MPV_FORMAT_NONE means the property became unavailable (e.g. no file loaded)
+    bool available = property->format != MPV_FORMAT_NONE && property->data;
+    
+    switch (id) {
+        case kPropPause:
+            properties_.paused.store(available && *static_cast<int*>(property->data) != 0,
+                                     std::memory_order_relaxed);
+            break;
+        case kPropWidth:
+            properties_.width.store(available ? *static_cast<int64_t*>(property->data) : 0,
+                                    std::memory_order_relaxed);
+            prescale_dirty_ = true;
+            break;
+        case kPropHeight:
+            properties_.height.store(available ? *static_cast<int64_t*>(property->data) : 0,
+                                     std::memory_order_relaxed);
+            prescale_dirty_ = true;
+            break;
+        case kPropHwdecCurrent:
+            hwdec_current_ = available ? *static_cast<char**>(property->data) : "";
+            prescale_dirty_ = true;
+            if (available && hwdec_pending_) {
+                record_hwdec();
+            }
+            break;
+        case kPropDuration:
+            properties_.duration.store(available ? *static_cast<double*>(property->data) : 0.0,
+                                       std::memory_order_relaxed);
+            break;
+        case kPropTimePos:
+            properties_.position.store(available ? *static_cast<double*>(property->data) : 0.0,
+                                       std::memory_order_relaxed);
+            break;
+        case kPropContainerFps:
+            properties_.container_fps.store(available ? *static_cast<double*>(property->data) : 0.0,
+                                            std::memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+}
+
 bool MPVWrapper::create_render_context(void* (*get_proc_address)(void* ctx, const char* name), 
                                       void* get_proc_address_ctx) {
     if (!mpv_ || render_ctx_) return false;
@@ -140,28 +294,63 @@ bool MPVWrapper::create_render_context(void* (*get_proc_address)(void* ctx, cons
     gl_init_params.get_proc_address = get_proc_address;
     gl_init_params.get_proc_address_ctx = get_proc_address_ctx;
     
+    // Advanced control exposes per-frame timing (NEXT_FRAME_INFO); it
+    // requires calling mpv_render_context_update() after each update
+    // callback, which update() already does
+    int advanced_control = 1;
     mpv_render_param params[] = {
         {MPV_RENDER_PARAM_API_TYPE, (void*)MPV_RENDER_API_TYPE_OPENGL},
         {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
+        {MPV_RENDER_PARAM_ADVANCED_CONTROL, &advanced_control},
         {MPV_RENDER_PARAM_INVALID, nullptr}
     };
     
+    advanced_control_ = true;
     if (mpv_render_context_create(&render_ctx_, mpv_, params) < 0) {
-        log_error("Failed to create MPV render context");
-        return false;
+        // Older libmpv without advanced control
+        params[2] = {MPV_RENDER_PARAM_INVALID, nullptr};
+        advanced_control_ = false;
+        if (mpv_render_context_create(&render_ctx_, mpv_, params) < 0) {
+            log_error("Failed to create MPV render context");
+            return false;
+        }
+        log_warn("MPV advanced render control unavailable - duplicate frames cannot be skipped");
     }
     
-    // Set up render context update callback to detect when new frames are available
-    mpv_render_context_set_update_callback(render_ctx_, 
-        [](void* ctx) {
-            MPVWrapper* wrapper = static_cast<MPVWrapper*>(ctx);
-            wrapper->has_new_frame_ = true;
-        }, this);
+    // The callback runs on mpv's render thread and may not call into mpv;
+    // it only wakes the render loop, which then calls update()
+    mpv_render_context_set_update_callback(render_ctx_, on_render_update, this);
     
     log_info("MPV render context created successfully");
     return true;
 }
 
+void MPVWrapper::signal_wakeup() {
+    uint64_t one = 1;
+    // A full counter (EAGAIN) still leaves the fd readable, which is all we need
+    ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+uint64_t MPVWrapper::update() {
+    uint64_t count = 0;
+    while (read(wakeup_fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    
+    if (!render_ctx_ || update_requests_.exchange(0, std::memory_order_acq_rel) == 0) {
+        return 0;
+    }
+    
+    uint64_t flags = mpv_render_context_update(render_ctx_);
+    if (flags & MPV_RENDER_UPDATE_FRAME) {
+        has_new_frame_.store(true, std::memory_order_release);
+        if (video_configured_) {
+            first_frame_ = true;
+        }
+    }
+    return flags;
+}
+
 void MPVWrapper::set_render_params(int width, int height, int fbo) {
     // This will be set during render_frame call
 }
@@ -179,9 +368,13 @@ bool MPVWrapper::render_frame(int fbo, int width, int height) {
         .internal_format = 0, // 0 = auto-detect
     };
     
+    // The frame scheduler already waited for the target time
+    int block_for_target = 0;
+    
     mpv_render_param params[] = {
         {MPV_RENDER_PARAM_OPENGL_FBO, &opengl_fbo},
         {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+        {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target},
         {MPV_RENDER_PARAM_INVALID, nullptr}
     };
     
@@ -192,11 +385,52 @@ bool MPVWrapper::render_frame(int fbo, int width, int height) {
     }
     
     // Mark that we've rendered this frame
-    has_new_frame_ = false;
+    has_new_frame_.store(false, std::memory_order_release);
     
     return true;
 }
 
+void MPVWrapper::get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const {
+    flags = MPV_RENDER_FRAME_INFO_PRESENT;
+    target_time_us = 0;
+    if (!render_ctx_ || !advanced_control_) return;
+    
+    mpv_render_frame_info info{};
+    if (mpv_render_context_get_info(render_ctx_, {MPV_RENDER_PARAM_NEXT_FRAME_INFO, &info}) >= 0) {
+        flags = info.flags;
+        target_time_us = info.target_time;
+    }
+}
+
+int64_t MPVWrapper::get_time_us() const {
+    return mpv_ ? mpv_get_time_us(mpv_) : 0;
+}
+
+bool MPVWrapper::skip_frame() {
+    if (!render_ctx_) return false;
+    
+    // The FBO is required even though nothing is drawn into it
+    mpv_opengl_fbo opengl_fbo = {
+        .fbo = 0,
+        .w = 1,
+        .h = 1,
+        .internal_format = 0,
+    };
+    int skip = 1;
+    int block_for_target = 0;
+    
+    mpv_render_param params[] = {
+        {MPV_RENDER_PARAM_OPENGL_FBO, &opengl_fbo},
+        {MPV_RENDER_PARAM_SKIP_RENDERING, &skip},
+        {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target},
+        {MPV_RENDER_PARAM_INVALID, nullptr}
+    };
+    
+    int result = mpv_render_context_render(render_ctx_, params);
+    has_new_frame_.store(false, std::memory_order_release);
+    return result >= 0;
+}
+
 void MPVWrapper::report_flip() {
     if (render_ctx_) {
         mpv_render_context_report_swap(render_ctx_);
@@ -209,12 +443,6 @@ void MPVWrapper::set_property(const std::string& name, const std::string& value)
     }
 }
 
-void MPVWrapper::set_property_async(const std::string& name, const std::string& value) {
-    if (mpv_) {
-        mpv_set_property_string(mpv_, name.c_str(), value.c_str());
-    }
-}
-
 std::string MPVWrapper::get_property(const std::string& name) const {
     if (!mpv_) return "";
     
@@ -234,6 +462,128 @@ void MPVWrapper::command(const std::string& cmd) {
     }
 }
 
+uint64_t MPVWrapper::track_request(AsyncCallback callback, std::chrono::milliseconds timeout,
+                                   std::string description, bool is_command) {
+    uint64_t id = next_request_id_++;
+    pending_requests_[id] = PendingRequest{std::move(callback), std::chrono::steady_clock::now() + timeout,
+                                           std::move(description), is_command};
+    return id;
+}
+
+uint64_t MPVWrapper::set_property_async(const std::string& name, const std::string& value,
+                                        AsyncCallback callback, std::chrono::milliseconds timeout) {
+    if (!mpv_) return 0;
+    
+    uint64_t id = track_request(std::move(callback), timeout, name, false);
+    
+    // mpv copies the value before returning
+    const char* data = value.c_str();
+    int result = mpv_set_property_async(mpv_, id, name.c_str(), MPV_FORMAT_STRING, &data);
+    if (result < 0) {
+        pending_requests_.erase(id);
+        log_warn("Failed to queue property " + name + ": " + mpv_error_string(result));
+        return 0;
+    }
+    return id;
+}
+
+uint64_t MPVWrapper::command_async(const std::vector<MPVArg>& args, AsyncCallback callback,
+                                   std::chrono::milliseconds timeout) {
+    if (!mpv_ || args.empty()) return 0;
+    
+    // The nodes only borrow the argument strings; mpv copies the whole
+    // array before returning
+    std::vector<mpv_node> values(args.size());
+    for (size_t i = 0; i < args.size(); i++) {
+        const MPVArg& arg = args[i];
+        mpv_node& node = values[i];
+        node.format = arg.format;
+        switch (arg.format) {
+            case MPV_FORMAT_STRING:
+                node.u.string = const_cast<char*>(arg.string.c_str());
+                break;
+            case MPV_FORMAT_INT64:
+                node.u.int64 = arg.integer;
+                break;
+            case MPV_FORMAT_DOUBLE:
+                node.u.double_ = arg.number;
+                break;
+            case MPV_FORMAT_FLAG:
+                node.u.flag = arg.flag ? 1 : 0;
+                break;
+            default:
+                node.format = MPV_FORMAT_NONE;
+                break;
+        }
+    }
+    
+    mpv_node_list list{};
+    list.num = static_cast<int>(values.size());
+    list.values = values.data();
+    
+    mpv_node command{};
+    command.format = MPV_FORMAT_NODE_ARRAY;
+    command.u.list = &list;
+    
+    uint64_t id = track_request(std::move(callback), timeout, args[0].string, true);
+    int result = mpv_command_node_async(mpv_, id, &command);
+    if (result < 0) {
+        pending_requests_.erase(id);
+        log_warn("Failed to queue command " + args[0].string + ": " + mpv_error_string(result));
+        return 0;
+    }
+    return id;
+}
+
+void MPVWrapper::complete_request(uint64_t id, int error, const mpv_node* result) {
+    auto it = pending_requests_.find(id);
+    if (it == pending_requests_.end()) return;  // Already timed out
+    
+    // Take the request out first; the callback may queue new ones
+    PendingRequest request = std::move(it->second);
+    pending_requests_.erase(it);
+    
+    if (error < 0) {
+        log_debug("MPV request '" + request.description + "' failed: " + mpv_error_string(error));
+    }
+    if (request.callback) {
+        request.callback(error, result);
+    }
+}
+
+void MPVWrapper::expire_requests() {
+    if (pending_requests_.empty()) return;
+    
+    auto now = std::chrono::steady_clock::now();
+    std::vector<uint64_t> expired;
+    for (const auto& [id, request] : pending_requests_) {
+        if (now >= request.deadline) {
+            expired.push_back(id);
+        }
+    }
+    
+    for (uint64_t id : expired) {
+        auto it = pending_requests_.find(id);
+        if (it == pending_requests_.end()) continue;
+        
+        log_warn("MPV request '" + it->second.description + "' timed out");
+        // Property writes can't be cancelled; their late reply is ignored
+        if (it->second.is_command) {
+            mpv_abort_async_command(mpv_, id);
+        }
+        complete_request(id, kAsyncTimeout, nullptr);
+    }
+}
+
+std::chrono::steady_clock::duration MPVWrapper::time_until_request_timeout(
+    std::chrono::steady_clock::time_point now) const {
+    auto wait = std::chrono::steady_clock::duration::max();
+    for (const auto& [id, request] : pending_requests_) {
+        wait = std::min(wait, std::max(std::chrono::steady_clock::duration::zero(), request.deadline - now));
+    }
+    return wait;
+}
+
 void MPVWrapper::set_wakeup_callback(std::function<void()> callback) {
     wakeup_callback_ = callback;
     if (mpv_) {
@@ -251,15 +601,36 @@ void MPVWrapper::process_events() {
         switch (event->event_id) {
             case MPV_EVENT_VIDEO_RECONFIG:
                 log_debug("Video reconfigured");
-                has_new_frame_ = true;
+                video_configured_ = true;
+                has_new_frame_.store(true, std::memory_order_release);
                 break;
             case MPV_EVENT_PLAYBACK_RESTART:
                 log_debug("Playback restarted");
-                has_new_frame_ = true;
+                has_new_frame_.store(true, std::memory_order_release);
+                step_pending_ = false;
                 break;
             case MPV_EVENT_END_FILE:
                 log_debug("End of file reached");
                 break;
+            case MPV_EVENT_PROPERTY_CHANGE:
+                handle_property_change(event->reply_userdata, static_cast<mpv_event_property*>(event->data));
+                break;
+            case MPV_EVENT_SET_PROPERTY_REPLY:
+                complete_request(event->reply_userdata, event->error, nullptr);
+                break;
+            case MPV_EVENT_COMMAND_REPLY: {
+                auto* reply = static_cast<mpv_event_command*>(event->data);
+                complete_request(event->reply_userdata, event->error, reply ? &reply->result : nullptr);
+                break;
+            }
+            case MPV_EVENT_HOOK: {
+                auto* hook = static_cast<mpv_event_hook*>(event->data);
+                if (event->reply_userdata == kHookPreloaded) {
+                    select_hwdec();
+                }
+                mpv_hook_continue(mpv_, hook->id);
+                break;
+            }
             case MPV_EVENT_LOG_MESSAGE: {
                 auto* msg = static_cast<mpv_event_log_message*>(event->data);
                 log_debug("MPV: " + std::string(msg->text));
@@ -269,39 +640,240 @@ void MPVWrapper::process_events() {
                 break;
         }
     }
+    
+    // Width, height and decoder arrive as separate events; decide once
+    if (prescale_dirty_) {
+        prescale_dirty_ = false;
+        update_prescale();
+    }
+    
+    expire_requests();
+}
+
+void MPVWrapper::select_hwdec() {
+    // mpv waits for the hook, so reading properties here doesn't race playback
+    stream_codec_ = get_property("current-tracks/video/codec");
+    stream_profile_ = get_property("current-tracks/video/codec-profile");
+    stream_width_ = 0;
+    stream_height_ = 0;
+    mpv_get_property(mpv_, "current-tracks/video/demux-w", MPV_FORMAT_INT64, &stream_width_);
+    mpv_get_property(mpv_, "current-tracks/video/demux-h", MPV_FORMAT_INT64, &stream_height_);
+    hwdec_pending_ = !stream_codec_.empty();
+    hwdec_from_cache_ = false;
+    if (!hwdec_pending_) return;
+    
+    std::string hwdec;
+    if (hwdec_cache_.lookup(stream_codec_, stream_profile_, stream_width_, stream_height_, hwdec)) {
+        mpv_set_property_string(mpv_, "hwdec", hwdec.c_str());
+        hwdec_from_cache_ = true;
+        log_debug("Using cached decoder choice for " + stream_codec_ + ": " + hwdec);
+    } else {
+        // A cached choice for a previous file must not stick
+        mpv_set_property_string(mpv_, "hwdec", kHwdecProbeChain);
+    }
+}
+
+void MPVWrapper::record_hwdec() {
+    hwdec_pending_ = false;
+    
+    std::string stream = stream_codec_ + (stream_profile_.empty() ? "" : " (" + stream_profile_ + ")") + " " +
+                         std::to_string(stream_width_) + "x" + std::to_string(stream_height_);
+    if (hwdec_current_ == "no") {
+        log_warn("No hardware decoder for " + stream + " - decoding in software");
+    } else {
+        log_info("Decoding " + stream + " with " + hwdec_current_ + (hwdec_from_cache_ ? " (cached)" : ""));
+    }
+    
+    hwdec_cache_.record(stream_codec_, stream_profile_, stream_width_, stream_height_, hwdec_current_);
+    hwdec_cache_.save();
+}
+
+void MPVWrapper::set_prescale_target(int width, int height, bool cover) {
+    if (width == prescale_width_ && height == prescale_height_ && cover == prescale_cover_) return;
+    
+    prescale_width_ = width;
+    prescale_height_ = height;
+    prescale_cover_ = cover;
+    update_prescale();
+}
+
+std::string MPVWrapper::choose_prescale_filter() const {
+    int64_t video_width = properties_.width.load(std::memory_order_relaxed);
+    int64_t video_height = properties_.height.load(std::memory_order_relaxed);
+    if (prescale_width_ <= 0 || prescale_height_ <= 0 || video_width <= 0 || video_height <= 0) return "";
+    
+    // Only ever shrink; for cover both sides must still exceed the target
+    bool larger = prescale_cover_ ? video_width > prescale_width_ && video_height > prescale_height_
+                                  : video_width > prescale_width_ || video_height > prescale_height_;
+    if (!larger) return "";
+    
+    // Scale where the frames already are. Hardware frames without a matching
+    // scaler are left to the render pass; downloading them to scale in
+    // software would cost more than it saves.
+    std::string scaler;
+    std::string extra;
+    if (hwdec_current_ == "vaapi") {
+        scaler = "scale_vaapi";
+    } else if (hwdec_current_ == "nvdec" || hwdec_current_ == "cuda") {
+        scaler = "scale_cuda";
+    } else if (hwdec_current_.empty() || hwdec_current_ == "no" ||
+               hwdec_current_.find("-copy") != std::string::npos) {
+        scaler = "scale";
+        extra = ":flags=fast_bilinear";
+    } else {
+        return "";
+    }
+    if (prescale_failed_.count(scaler)) return "";
+    
+    return scaler + "=w=" + std::to_string(prescale_width_) + ":h=" + std::to_string(prescale_height_) +
+           ":force_original_aspect_ratio=" + (prescale_cover_ ? "increase" : "decrease") + extra;
+}
+
+void MPVWrapper::update_prescale() {
+    if (!mpv_ || !prescale_enabled_) return;
+    
+    std::string filter = choose_prescale_filter();
+    if (filter == prescale_filter_) return;
+    
+    if (!prescale_filter_.empty()) {
+        command_async({"vf", "remove", kPrescaleLabel});
+    }
+    prescale_filter_ = filter;
+    if (filter.empty()) return;
+    
+    std::string scaler = filter.substr(0, filter.find('='));
+    command_async({"vf", "add", std::string(kPrescaleLabel) + ":lavfi=[" + filter + "]"},
+                  [this, scaler](int error, const mpv_node*) {
+                      if (error >= 0) return;
+                      // Not available in this libavfilter/driver; don't retry it
+                      log_warn("Pre-scale filter " + scaler + " unavailable - scaling in the render pass");
+                      prescale_failed_.insert(scaler);
+                      prescale_filter_.clear();
+                      prescale_dirty_ = true;
+                  });
+    
+    log_info("Pre-scaling " + std::to_string(properties_.width.load(std::memory_order_relaxed)) + "x" +
+             std::to_string(properties_.height.load(std::memory_order_relaxed)) + " video to " +
+             std::to_string(prescale_width_) + "x" + std::to_string(prescale_height_) + " with " + scaler);
 }
 
 bool MPVWrapper::is_playing() const {
-    return mpv_ && get_property("pause") != "yes";
+    // A stepped clock plays, one step at a time, though mpv stays paused
+    return mpv_ && (clock_step_us_ > 0 || !properties_.paused.load(std::memory_order_relaxed));
+}
+
+bool MPVWrapper::set_clock_step(int64_t step_us) {
+    if (!mpv_ || step_us <= 0) return false;
+    clock_step_us_ = step_us;
+    set_property_async("pause", "yes");
+    return true;
+}
+
+void MPVWrapper::step_clock() {
+    if (clock_step_us_ <= 0 || step_pending_) return;
+    
+    // An exact seek decodes up to the frame due at the new time instead of
+    // landing on a keyframe
+    step_pending_ = true;
+    uint64_t id = command_async({"seek", static_cast<double>(clock_step_us_) / 1000000.0, "relative+exact"},
+                                [this](int error, const mpv_node*) {
+                                    if (error < 0) step_pending_ = false;
+                                });
+    if (id == 0) {
+        step_pending_ = false;
+    }
 }
 
 bool MPVWrapper::has_video() const {
-    return mpv_ && !get_property("video-codec").empty();
+    // Video dimensions are only known once a video track is decoding
+    return mpv_ && properties_.width.load(std::memory_order_relaxed) > 0;
 }
 
 double MPVWrapper::get_duration() const {
-    if (!mpv_) return 0.0;
-    std::string duration_str = get_property("duration");
-    return duration_str.empty() ? 0.0 : std::stod(duration_str);
+    return mpv_ ? properties_.duration.load(std::memory_order_relaxed) : 0.0;
 }
 
 double MPVWrapper::get_position() const {
-    if (!mpv_) return 0.0;
-    std::string position_str = get_property("time-pos");
-    return position_str.empty() ? 0.0 : std::stod(position_str);
+    return mpv_ ? properties_.position.load(std::memory_order_relaxed) : 0.0;
+}
+
+void MPVWrapper::set_audio_enabled(bool enabled) {
+    if (enabled == audio_enabled_) return;
+    audio_enabled_ = enabled;
+    
+    // Without an audio track mpv uninitializes the audio decoder, filters
+    // and output, and the demuxer stops reading audio packets. Selecting
+    // the track again refreshes only that stream at the current position;
+    // initial-audio-sync trims it to the video, which keeps playing.
+    set_property_async("aid", enabled ? "auto" : "no");
+}
+
+void MPVWrapper::set_volume_scale(double scale) {
+    if (scale == volume_scale_) return;
+    volume_scale_ = scale;
+    set_property_async("volume", std::to_string(volume_ * 100 * scale));
+}
+
+void MPVWrapper::get_memory_usage(size_t& buffer_bytes, size_t& decoder_bytes) const {
+    buffer_bytes = media_io_.get_resident_bytes();
+    decoder_bytes = 0;
+    
+    // Packets held by the demuxer, ahead of and behind the playback position
+    mpv_node state;
+    if (mpv_ && mpv_get_property(mpv_, "demuxer-cache-state", MPV_FORMAT_NODE, &state) >= 0) {
+        if (state.format == MPV_FORMAT_NODE_MAP) {
+            for (int i = 0; i < state.u.list->num; i++) {
+                if (strcmp(state.u.list->keys[i], "total-bytes") == 0 &&
+                    state.u.list->values[i].format == MPV_FORMAT_INT64) {
+                    buffer_bytes += static_cast<size_t>(state.u.list->values[i].u.int64);
+                }
+            }
+        }
+        mpv_free_node_contents(&state);
+    }
+    
+    // Hardware decoders keep a pool of NV12 surfaces: the codec's reference
+    // frames plus the extra frames requested for the renderer
+    if (!hwdec_current_.empty() && hwdec_current_ != "no") {
+        size_t frame_bytes = static_cast<size_t>(get_video_width() * get_video_height()) * 3 / 2;
+        decoder_bytes = frame_bytes * static_cast<size_t>(kEstimatedDecoderSurfaces + hwdec_extra_frames_);
+    }
+}
+
+int64_t MPVWrapper::get_video_width() const {
+    return properties_.width.load(std::memory_order_relaxed);
+}
+
+int64_t MPVWrapper::get_video_height() const {
+    return properties_.height.load(std::memory_order_relaxed);
+}
+
+double MPVWrapper::get_container_fps() const {
+    return properties_.container_fps.load(std::memory_order_relaxed);
 }
 
 bool MPVWrapper::has_new_frame() const {
-    return has_new_frame_;
+    return has_new_frame_.load(std::memory_order_acquire);
 }
 
 void MPVWrapper::mark_frame_rendered() {
-    has_new_frame_ = false;
+    has_new_frame_.store(false, std::memory_order_release);
 }
 
 void MPVWrapper::on_mpv_events(void* ctx) {
     auto* wrapper = static_cast<MPVWrapper*>(ctx);
-    if (wrapper && wrapper->wakeup_callback_) {
+    if (!wrapper) return;
+    
+    wrapper->signal_wakeup();
+    if (wrapper->wakeup_callback_) {
         wrapper->wakeup_callback_();
     }
 }
+
+void MPVWrapper::on_render_update(void* ctx) {
+    auto* wrapper = static_cast<MPVWrapper*>(ctx);
+    if (!wrapper) return;
+    
+    wrapper->update_requests_.fetch_add(1, std::memory_order_acq_rel);
+    wrapper->signal_wakeup();
+}
@@ -0,0 +1,175 @@
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Sanity limits; real packages stay far below them
+static constexpr uint32_t kMaxVersionLength = 32;
+static constexpr uint32_t kMaxNameLength = 4096;
+
+// Bounds-checked little-endian cursor over the package image
+class PkgCursor {
+public:
+    PkgCursor(const unsigned char* data, size_t size) : data_(data), size_(size) {}
+    
+    bool read_u32(uint32_t& value) {
+        if (size_ - offset_ < 4) return false;
+        const unsigned char* p = data_ + offset_;
+        value = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+        offset_ += 4;
+        return true;
+    }
+    
+    bool read_string(uint32_t length, std::string_view& value) {
+        if (size_ - offset_ < length) return false;
+        value = std::string_view(reinterpret_cast<const char*>(data_ + offset_), length);
+        offset_ += length;
+        return true;
+    }
+    
+    size_t offset() const { return offset_; }
+    size_t remaining() const { return size_ - offset_; }
+
+private:
+    const unsigned char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+PkgReader::~PkgReader() {
+    close();
+}
+
+bool PkgReader::parse(const unsigned char* data, size_t size, std::string& version, std::vector<Entry>& entries) {
+    entries.clear();
+    if (!data) return false;
+    
+    PkgCursor cursor(data, size);
+    
+    uint32_t version_length = 0;
+    std::string_view version_string;
+    if (!cursor.read_u32(version_length) || version_length > kMaxVersionLength ||
+        !cursor.read_string(version_length, version_string) || version_string.substr(0, 4) != "PKGV") {
+        return false;
+    }
+    
+    uint32_t count = 0;
+    if (!cursor.read_u32(count)) return false;
+    
+    // Each table record takes at least 12 bytes, so a corrupt count can't
+    // make us reserve more than the file could describe
+    entries.reserve(std::min<size_t>(count, cursor.remaining() / 12));
+    
+    struct Range {
+        uint32_t offset;
+        uint32_t size;
+    };
+    std::vector<Range> ranges;
+    ranges.reserve(entries.capacity());
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t name_length = 0;
+        std::string_view name;
+        Range range{};
+        if (!cursor.read_u32(name_length) || name_length > kMaxNameLength ||
+            !cursor.read_string(name_length, name) || !cursor.read_u32(range.offset) ||
+            !cursor.read_u32(range.size)) {
+            entries.clear();
+            return false;
+        }
+        entries.push_back(Entry{name, nullptr, range.size});
+        ranges.push_back(range);
+    }
+    
+    // Data follows the table; resolve entries once its end is known
+    const size_t data_start = cursor.offset();
+    const size_t data_size = size - data_start;
+    for (size_t i = 0; i < entries.size(); i++) {
+        uint64_t end = static_cast<uint64_t>(ranges[i].offset) + ranges[i].size;
+        if (end > data_size) {
+            entries.clear();
+            return false;
+        }
+        entries[i].data = data + data_start + ranges[i].offset;
+    }
+    
+    version.assign(version_string);
+    return true;
+}
+
+bool PkgReader::open(const std::string& path) {
+    close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Failed to open package " + path + ": " + strerror(errno));
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        log_error("Failed to open package " + path + ": empty or unreadable");
+        return false;
+    }
+    
+    mapping_size_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        log_error("Failed to map package " + path + ": " + strerror(errno));
+        return false;
+    }
+    
+    if (!parse(static_cast<const unsigned char*>(mapping_), mapping_size_, version_, entries_)) {
+        log_error("Invalid or corrupt package: " + path);
+        close();
+        return false;
+    }
+    
+    log_debug("Opened package " + path + " (" + version_ + ", " + std::to_string(entries_.size()) + " entries)");
+    return true;
+}
+
+void PkgReader::close() {
+    entries_.clear();
+    version_.clear();
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+}
+
+const PkgReader::Entry* PkgReader::find(std::string_view name) const {
+    for (const auto& entry : entries_) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+const PkgReader::Entry* PkgReader::find_first_video() const {
+    static const char* const kVideoExtensions[] = {".mp4", ".webm", ".mkv", ".mov", ".avi", ".m4v", ".gif"};
+    
+    for (const auto& entry : entries_) {
+        for (const char* extension : kVideoExtensions) {
+            size_t length = strlen(extension);
+            if (entry.name.size() > length && entry.name.substr(entry.name.size() - length) == extension) {
+                return &entry;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool PkgReader::is_package_path(const std::string& path) {
+    std::string file = path.substr(0, path.find('#'));
+    return file.size() > 4 && file.compare(file.size() - 4, 4, ".pkg") == 0;
+}
@@ -0,0 +1,378 @@
+#include "universal-wallpaper/thumbnailer.h"
+#include "universal-wallpaper/pkg_reader.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+static std::string av_error_string(int error) {
+    char buffer[128];
+    if (av_strerror(error, buffer, sizeof(buffer)) < 0) {
+        return "error " + std::to_string(error);
+    }
+    return buffer;
+}
+
+// FNV-1a; a cache key, not a security boundary
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Package entries are read from the mapped package through a memory AVIO
+struct MemoryInput {
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+};
+
+static int memory_read(void* opaque, uint8_t* buffer, int size) {
+    MemoryInput* input = static_cast<MemoryInput*>(opaque);
+    size_t count = std::min(static_cast<size_t>(size), input->size - input->position);
+    if (count == 0) return AVERROR_EOF;
+    memcpy(buffer, input->data + input->position, count);
+    input->position += count;
+    return static_cast<int>(count);
+}
+
+static int64_t memory_seek(void* opaque, int64_t offset, int whence) {
+    MemoryInput* input = static_cast<MemoryInput*>(opaque);
+    if (whence & AVSEEK_SIZE) return static_cast<int64_t>(input->size);
+    
+    int64_t base = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = static_cast<int64_t>(input->position); break;
+        case SEEK_END: base = static_cast<int64_t>(input->size); break;
+        default: return AVERROR(EINVAL);
+    }
+    if (base + offset < 0 || base + offset > static_cast<int64_t>(input->size)) {
+        return AVERROR(EINVAL);
+    }
+    input->position = static_cast<size_t>(base + offset);
+    return static_cast<int64_t>(input->position);
+}
+
+// Opens a package entry ("file.pkg#entry", or the first video in the
+// package) as bytes in memory
+static const PkgReader::Entry* open_package_entry(PkgReader& package, const std::string& input) {
+    size_t separator = input.find('#');
+    if (!package.open(input.substr(0, separator))) return nullptr;
+    return separator == std::string::npos ? package.find_first_video() : package.find(input.substr(separator + 1));
+}
+
+Thumbnailer::Thumbnailer(std::string cache_dir, int size, const std::string& format)
+    : cache_dir_(std::move(cache_dir)), size_(size) {
+    if (format == "webp") {
+        encoder_ = avcodec_find_encoder_by_name("libwebp");
+        if (encoder_) {
+            extension_ = "webp";
+        } else {
+            log_warn("FFmpeg has no WebP encoder, writing PNG thumbnails");
+        }
+    }
+    if (!encoder_) {
+        encoder_ = avcodec_find_encoder(AV_CODEC_ID_PNG);
+        extension_ = "png";
+    }
+}
+
+std::string Thumbnailer::default_cache_dir() {
+    std::string cache_dir = get_cache_dir();
+    if (cache_dir.empty()) return "";
+    
+    std::string dir = cache_dir + "/thumbnails";
+    if (mkdir(dir.c_str(), 0700) != 0 && !file_exists(dir)) {
+        return "";
+    }
+    return dir;
+}
+
+bool Thumbnailer::cache_path(const std::string& input, std::string& path) const {
+    // Size plus both ends of the content, read the same way for files and
+    // package entries; the settings are part of the key
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t content_size = 0;
+    if (PkgReader::is_package_path(input)) {
+        PkgReader package;
+        const PkgReader::Entry* entry = open_package_entry(package, input);
+        if (!entry) return false;
+        
+        content_size = entry->size;
+        size_t head = std::min(entry->size, kFingerprintBytes);
+        size_t tail = std::min(entry->size - head, kFingerprintBytes);
+        hash = fnv1a(hash, entry->data, head);
+        hash = fnv1a(hash, entry->data + entry->size - tail, tail);
+    } else {
+        int fd = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return false;
+        }
+        content_size = static_cast<uint64_t>(st.st_size);
+        size_t head = static_cast<size_t>(std::min<uint64_t>(content_size, kFingerprintBytes));
+        size_t tail = static_cast<size_t>(std::min<uint64_t>(content_size - head, kFingerprintBytes));
+        std::vector<unsigned char> buffer(kFingerprintBytes);
+        bool complete = pread(fd, buffer.data(), head, 0) == static_cast<ssize_t>(head);
+        if (complete) hash = fnv1a(hash, buffer.data(), head);
+        if (complete && tail > 0) {
+            complete = pread(fd, buffer.data(), tail, static_cast<off_t>(content_size - tail)) == static_cast<ssize_t>(tail);
+            if (complete) hash = fnv1a(hash, buffer.data(), tail);
+        }
+        close(fd);
+        if (!complete) return false;
+    }
+    hash = fnv1a(hash, &content_size, sizeof(content_size));
+    hash = fnv1a(hash, &size_, sizeof(size_));
+    
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    path = cache_dir_ + "/" + name + "." + extension_;
+    return true;
+}
+
+bool Thumbnailer::extract(const std::string& input, const std::string& output, size_t worker) const {
+    AVFormatContext* format = avformat_alloc_context();
+    if (!format) return false;
+    
+    PkgReader package;
+    MemoryInput memory{nullptr, 0, 0};
+    AVIOContext* avio = nullptr;
+    if (PkgReader::is_package_path(input)) {
+        const PkgReader::Entry* entry = open_package_entry(package, input);
+        unsigned char* buffer = entry ? static_cast<unsigned char*>(av_malloc(64 * 1024)) : nullptr;
+        if (!buffer) {
+            log_warn("No video entry in package " + input);
+            avformat_free_context(format);
+            return false;
+        }
+        memory = {entry->data, entry->size, 0};
+        avio = avio_alloc_context(buffer, 64 * 1024, 0, &memory, memory_read, nullptr, memory_seek);
+        if (!avio) {
+            av_free(buffer);
+            avformat_free_context(format);
+            return false;
+        }
+        format->pb = avio;
+        format->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    
+    AVCodecContext* codec = nullptr;
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* packet = av_packet_alloc();
+    SwsContext* sws = nullptr;
+    AVCodecContext* encoder = nullptr;
+    AVFrame* scaled = av_frame_alloc();
+    bool ok = false;
+    
+    // Single pass with early exits; everything is released at the end
+    do {
+        // avformat_open_input frees the context on failure
+        int result = avformat_open_input(&format, avio ? nullptr : input.c_str(), nullptr, nullptr);
+        if (result < 0) {
+            log_warn("Failed to open " + input + ": " + av_error_string(result));
+            break;
+        }
+        
+        // Container headers usually describe the video stream already; only
+        // probe packets when they don't
+        const AVCodec* decoder = nullptr;
+        int stream_index = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+        if (stream_index < 0 || format->streams[stream_index]->codecpar->width <= 0) {
+            if (avformat_find_stream_info(format, nullptr) < 0) break;
+            stream_index = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+        }
+        if (stream_index < 0 || !decoder || !frame || !packet || !scaled) {
+            log_warn("No decodable video stream in " + input);
+            break;
+        }
+        for (unsigned int i = 0; i < format->nb_streams; i++) {
+            format->streams[i]->discard = static_cast<int>(i) == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        }
+        
+        // Smallest decoder: one thread, keyframes only, no loop filter, and
+        // reduced resolution where the decoder can do that for free
+        codec = avcodec_alloc_context3(decoder);
+        if (!codec || avcodec_parameters_to_context(codec, format->streams[stream_index]->codecpar) < 0) break;
+        codec->thread_count = 1;
+        codec->skip_frame = AVDISCARD_NONKEY;
+        codec->skip_loop_filter = AVDISCARD_ALL;
+        codec->flags2 |= AV_CODEC_FLAG2_FAST;
+        int lowres = 0;
+        while (lowres < decoder->max_lowres && (codec->width >> (lowres + 1)) >= size_ &&
+               (codec->height >> (lowres + 1)) >= size_) {
+            lowres++;
+        }
+        codec->lowres = lowres;
+        result = avcodec_open2(codec, decoder, nullptr);
+        if (result < 0) {
+            log_warn("Failed to open decoder for " + input + ": " + av_error_string(result));
+            break;
+        }
+        
+        // Skip fade-ins: the keyframe at or before 10% of the way in
+        if (format->duration > 0) {
+            int64_t start = format->start_time != AV_NOPTS_VALUE ? format->start_time : 0;
+            int64_t target = start + std::min<int64_t>(format->duration / 10, 30LL * AV_TIME_BASE);
+            if (av_seek_frame(format, -1, target, AVSEEK_FLAG_BACKWARD) < 0) {
+                av_seek_frame(format, -1, start, AVSEEK_FLAG_BACKWARD);
+            }
+        }
+        
+        bool decoded = false;
+        for (int packets = 0; !decoded && packets < kMaxPackets; packets++) {
+            result = av_read_frame(format, packet);
+            if (result < 0) {
+                avcodec_send_packet(codec, nullptr);  // Drain whatever is buffered
+            } else if (packet->stream_index == stream_index) {
+                avcodec_send_packet(codec, packet);
+            }
+            av_packet_unref(packet);
+            decoded = avcodec_receive_frame(codec, frame) == 0;
+            if (result < 0) break;
+        }
+        if (!decoded) {
+            log_warn("No keyframe decoded from " + input);
+            break;
+        }
+        
+        // Fit within size_ x size_, honouring non-square pixels; 4:2:0
+        // output needs even dimensions
+        double display_width = frame->width;
+        if (frame->sample_aspect_ratio.num > 0 && frame->sample_aspect_ratio.den > 0) {
+            display_width *= av_q2d(frame->sample_aspect_ratio);
+        }
+        double scale = std::min(1.0, std::min(size_ / display_width, static_cast<double>(size_) / frame->height));
+        int width = std::max(2, static_cast<int>(display_width * scale) & ~1);
+        int height = std::max(2, static_cast<int>(frame->height * scale) & ~1);
+        AVPixelFormat pixel_format = extension_ == "webp" ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_RGB24;
+        
+        // Area averaging: swscale's vectorized path, and alias-free for
+        // large reductions
+        sws = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                             width, height, pixel_format, SWS_AREA, nullptr, nullptr, nullptr);
+        scaled->format = pixel_format;
+        scaled->width = width;
+        scaled->height = height;
+        if (!sws || av_frame_get_buffer(scaled, 0) < 0) break;
+        sws_scale(sws, frame->data, frame->linesize, 0, frame->height, scaled->data, scaled->linesize);
+        
+        encoder = avcodec_alloc_context3(encoder_);
+        if (!encoder) break;
+        encoder->width = width;
+        encoder->height = height;
+        encoder->pix_fmt = pixel_format;
+        encoder->time_base = AVRational{1, 25};
+        if (avcodec_open2(encoder, encoder_, nullptr) < 0) break;
+        
+        av_packet_unref(packet);
+        if (avcodec_send_frame(encoder, scaled) < 0 || avcodec_send_frame(encoder, nullptr) < 0 ||
+            avcodec_receive_packet(encoder, packet) < 0) {
+            log_warn("Failed to encode thumbnail for " + input);
+            break;
+        }
+        
+        // Written aside and renamed, so readers never see a partial file;
+        // the pid keeps concurrent thumbnailer processes apart
+        std::string temporary = output + ".tmp" + std::to_string(getpid()) + '.' + std::to_string(worker);
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file) {
+            log_warn("Failed to write " + temporary + ": " + strerror(errno));
+            break;
+        }
+        bool written = fwrite(packet->data, 1, packet->size, file) == static_cast<size_t>(packet->size);
+        written = fclose(file) == 0 && written;
+        ok = written && rename(temporary.c_str(), output.c_str()) == 0;
+        if (!ok) unlink(temporary.c_str());
+    } while (false);
+    
+    avcodec_free_context(&encoder);
+    sws_freeContext(sws);
+    av_frame_free(&scaled);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&codec);
+    avformat_close_input(&format);
+    if (avio) {
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+    }
+    return ok;
+}
+
+bool Thumbnailer::process(const std::string& input, size_t worker) {
+    std::string output;
+    if (!cache_path(input, output)) {
+        log_warn("Can't read " + input);
+        return false;
+    }
+    
+    if (file_exists(output)) {
+        cached_++;
+    } else if (extract(input, output, worker)) {
+        generated_++;
+    } else {
+        return false;
+    }
+    
+    // One stdio call per line, so lines from different workers don't mix
+    std::string line = input + '\t' + output + '\n';
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    fputs(line.c_str(), stdout);
+    fflush(stdout);
+    return true;
+}
+
+size_t Thumbnailer::run(const std::vector<std::string>& inputs, int jobs) {
+    if (!encoder_) {
+        log_error("FFmpeg has no PNG encoder");
+        return inputs.size();
+    }
+    
+    size_t workers = jobs > 0 ? static_cast<size_t>(jobs) : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, inputs.size());
+    
+    // Workers pull the next file from a shared index, so slow files don't
+    // hold up a statically assigned share
+    auto start_time = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t worker = 0; worker < workers; worker++) {
+        threads.emplace_back([this, &inputs, &next, worker]() {
+            for (size_t i = next++; i < inputs.size(); i = next++) {
+                if (!process(inputs[i], worker)) failed_++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    
+    char message[192];
+    snprintf(message, sizeof(message),
+             "Thumbnails: %zu files in %.2f s (%.1f files/s) on %zu workers, %zu generated, %zu cached, %zu failed",
+             inputs.size(), seconds, seconds > 0.0 ? inputs.size() / seconds : 0.0, workers,
+             generated_.load(), cached_.load(), failed_.load());
+    log_info(message);
+    return failed_;
+}
@@ -0,0 +1,83 @@
+#include "universal-wallpaper/dynamic_resolution.h"
+#include "universal-wallpaper/utils.h"
+#include <algorithm>
+#include <cstdio>
+
+void DynamicResolution::configure(double frame_budget_ms, double min_scale) {
+    frame_budget_ms_ = frame_budget_ms;
+    
+    max_step_ = 0;
+    while (max_step_ + 1 < kNumSteps && kScaleSteps[max_step_ + 1] >= min_scale - 1e-6) {
+        max_step_++;
+    }
+    step_ = std::min(step_, max_step_);
+}
+
+bool DynamicResolution::update(double frame_cost_ms) {
+    if (!enabled_ || frame_cost_ms <= 0.0) return false;
+    
+    // Exponential moving average keeps single slow frames from triggering a change
+    if (!has_samples_) {
+        smoothed_cost_ms_ = frame_cost_ms;
+        has_samples_ = true;
+    } else {
+        smoothed_cost_ms_ += 0.2 * (frame_cost_ms - smoothed_cost_ms_);
+    }
+    
+    frames_since_change_++;
+    
+    if (smoothed_cost_ms_ > frame_budget_ms_ * kShrinkThreshold) {
+        over_budget_frames_++;
+        under_budget_frames_ = 0;
+    } else if (smoothed_cost_ms_ < frame_budget_ms_ * kGrowThreshold) {
+        under_budget_frames_++;
+        over_budget_frames_ = 0;
+    } else {
+        over_budget_frames_ = 0;
+        under_budget_frames_ = 0;
+    }
+    
+    if (frames_since_change_ < kCooldownFrames) return false;
+    
+    if (over_budget_frames_ >= kShrinkFrames && step_ < max_step_) {
+        step_++;
+        downscales_++;
+    } else if (under_budget_frames_ >= kGrowFrames && step_ > 0) {
+        step_--;
+        upscales_++;
+    } else {
+        return false;
+    }
+    
+    over_budget_frames_ = 0;
+    under_budget_frames_ = 0;
+    frames_since_change_ = 0;
+    
+    char message[128];
+    snprintf(message, sizeof(message), "Render scale changed to %.3f (frame cost %.2f ms, budget %.2f ms)",
+             kScaleSteps[step_], smoothed_cost_ms_, frame_budget_ms_);
+    log_debug(message);
+    return true;
+}
+
+double DynamicResolution::get_scale() const {
+    return enabled_ ? kScaleSteps[step_] : 1.0;
+}
+
+void DynamicResolution::apply(int width, int height, int& out_width, int& out_height) const {
+    double scale = get_scale();
+    // Keep dimensions even; some hwdec interop paths dislike odd sizes
+    out_width = std::max(2, static_cast<int>(width * scale) & ~1);
+    out_height = std::max(2, static_cast<int>(height * scale) & ~1);
+}
+
+void DynamicResolution::dump_stats() const {
+    if (!enabled_) return;
+    
+    char message[192];
+    snprintf(message, sizeof(message),
+             "Render scale: %.3f (min %.3f), %llu downscales, %llu upscales, frame cost %.2f ms / budget %.2f ms",
+             get_scale(), kScaleSteps[max_step_], static_cast<unsigned long long>(downscales_),
+             static_cast<unsigned long long>(upscales_), smoothed_cost_ms_, frame_budget_ms_);
+    log_info(message);
+}
@@ -0,0 +1,264 @@
+#include "universal-wallpaper/gpu_profiler.h"
+#include "universal-wallpaper/utils.h"
+#include <EGL/egl.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+RollingWindow::RollingWindow(size_t capacity)
+    : samples_(capacity, 0.0) {
+}
+
+void RollingWindow::push(double value) {
+    samples_[next_] = value;
+    next_ = (next_ + 1) % samples_.size();
+    count_ = std::min(count_ + 1, samples_.size());
+    last_ = value;
+}
+
+double RollingWindow::percentile(double p) const {
+    if (count_ == 0) return 0.0;
+    
+    std::vector<double> sorted(samples_.begin(), samples_.begin() + count_);
+    size_t index = static_cast<size_t>(p * static_cast<double>(count_ - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+bool GpuProfiler::initialize(bool gles) {
+    gles_ = gles;
+    gpu_timers_ = false;
+    
+    if (gles) {
+        // Timestamps on GLES come from EXT_disjoint_timer_query, whose entry
+        // points carry the EXT suffix
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (extensions && strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+            glGenQueries = (PFNGLGENQUERIESPROC)eglGetProcAddress("glGenQueriesEXT");
+            glDeleteQueries = (PFNGLDELETEQUERIESPROC)eglGetProcAddress("glDeleteQueriesEXT");
+            glQueryCounter = (PFNGLQUERYCOUNTERPROC)eglGetProcAddress("glQueryCounterEXT");
+            glGetQueryiv = (PFNGLGETQUERYIVPROC)eglGetProcAddress("glGetQueryivEXT");
+            glGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)eglGetProcAddress("glGetQueryObjectivEXT");
+            glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+        }
+    } else {
+        glGenQueries = (PFNGLGENQUERIESPROC)eglGetProcAddress("glGenQueries");
+        glDeleteQueries = (PFNGLDELETEQUERIESPROC)eglGetProcAddress("glDeleteQueries");
+        glQueryCounter = (PFNGLQUERYCOUNTERPROC)eglGetProcAddress("glQueryCounter");
+        glGetQueryiv = (PFNGLGETQUERYIVPROC)eglGetProcAddress("glGetQueryiv");
+        glGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)eglGetProcAddress("glGetQueryObjectiv");
+        glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)eglGetProcAddress("glGetQueryObjectui64v");
+    }
+    
+    if (glGenQueries && glDeleteQueries && glQueryCounter && glGetQueryiv &&
+        glGetQueryObjectiv && glGetQueryObjectui64v) {
+        // A zero-bit timestamp counter means the driver can't time anything
+        GLint counter_bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+        glGetError();  // Clear errors from drivers without ARB_timer_query
+        gpu_timers_ = counter_bits > 0;
+    }
+    
+    if (gpu_timers_) {
+        log_debug("GPU timer queries available");
+    } else {
+        log_warn("GPU timer queries not supported - only CPU stage timings will be recorded");
+    }
+    return gpu_timers_;
+}
+
+void GpuProfiler::destroy() {
+    if (gpu_timers_) {
+        for (auto& [name, stage] : stages_) {
+            for (auto& slot : stage.slots) {
+                if (slot.begin_query != 0) {
+                    glDeleteQueries(1, &slot.begin_query);
+                    glDeleteQueries(1, &slot.end_query);
+                }
+            }
+        }
+    }
+    stages_.clear();
+    gpu_timers_ = false;
+}
+
+void GpuProfiler::begin_stage(const std::string& name) {
+    if (!enabled_) return;
+    
+    Stage& stage = stages_[name];
+    stage.open = true;
+    stage.cpu_start = std::chrono::steady_clock::now();
+    if (stage.cpu_frame != frame_) {
+        stage.cpu_frame = frame_;
+        stage.frame_cpu_ms = 0.0;
+    }
+    stage.slot_active = false;
+    
+    if (!gpu_timers_) return;
+    
+    QuerySlot& slot = stage.slots[stage.write_index];
+    if (slot.begin_query == 0) {
+        glGenQueries(1, &slot.begin_query);
+        glGenQueries(1, &slot.end_query);
+    }
+    
+    if (slot.pending) {
+        // The GPU is more than a ring behind; never block waiting for it
+        if (!slot_available(slot)) {
+            stage.dropped++;
+            return;
+        }
+        read_slot(stage, slot);
+    }
+    
+    glQueryCounter(slot.begin_query, GL_TIMESTAMP);
+    slot.frame = frame_;
+    stage.slot_active = true;
+}
+
+void GpuProfiler::end_stage(const std::string& name) {
+    if (!enabled_) return;
+    
+    auto it = stages_.find(name);
+    if (it == stages_.end() || !it->second.open) return;
+    
+    Stage& stage = it->second;
+    stage.open = false;
+    
+    auto cpu_elapsed = std::chrono::steady_clock::now() - stage.cpu_start;
+    double cpu_ms = std::chrono::duration<double, std::milli>(cpu_elapsed).count();
+    stage.cpu_ms.push(cpu_ms);
+    stage.frame_cpu_ms += cpu_ms;
+    
+    if (!stage.slot_active) return;
+    
+    QuerySlot& slot = stage.slots[stage.write_index];
+    glQueryCounter(slot.end_query, GL_TIMESTAMP);
+    slot.pending = true;
+    stage.slot_active = false;
+    stage.write_index = (stage.write_index + 1) % kQueryRingSize;
+}
+
+void GpuProfiler::collect() {
+    if (!enabled_ || !gpu_timers_) return;
+    
+    // A disjoint event (GPU reset, frequency change) invalidates every
+    // timestamp in flight on GLES; drop them rather than report garbage
+    bool disjoint = false;
+    if (gles_) {
+        GLint value = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &value);
+        disjoint = value != 0;
+    }
+
+    for (auto& [name, stage] : stages_) {
+        // Walk the ring oldest first and stop at the first unfinished query
+        for (int i = 0; i < kQueryRingSize; i++) {
+            QuerySlot& slot = stage.slots[(stage.write_index + i) % kQueryRingSize];
+            if (!slot.pending) continue;
+            if (!slot_available(slot)) break;
+            if (disjoint) {
+                slot.pending = false;
+                stage.dropped++;
+                continue;
+            }
+            read_slot(stage, slot);
+        }
+    }
+}
+
+bool GpuProfiler::slot_available(const QuerySlot& slot) {
+    GLint available = 0;
+    glGetQueryObjectiv(slot.end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != 0;
+}
+
+void GpuProfiler::read_slot(Stage& stage, QuerySlot& slot) {
+    GLuint64 begin_ns = 0, end_ns = 0;
+    glGetQueryObjectui64v(slot.begin_query, GL_QUERY_RESULT, &begin_ns);
+    glGetQueryObjectui64v(slot.end_query, GL_QUERY_RESULT, &end_ns);
+    slot.pending = false;
+    
+    // Slots are read oldest first, so a newer frame means the previous one
+    // is complete
+    if (slot.frame != stage.gpu_frame) {
+        if (stage.gpu_frame != 0) {
+            stage.gpu_last_frame_ms = stage.gpu_frame_ms;
+        }
+        stage.gpu_frame = slot.frame;
+        stage.gpu_frame_ms = 0.0;
+    }
+    if (end_ns >= begin_ns) {
+        double gpu_ms = static_cast<double>(end_ns - begin_ns) / 1e6;
+        stage.gpu_ms.push(gpu_ms);
+        stage.gpu_frame_ms += gpu_ms;
+    }
+}
+
+bool GpuProfiler::get_stage_stats(const std::string& name, StageStats& out) const {
+    auto it = stages_.find(name);
+    if (it == stages_.end()) return false;
+    
+    const Stage& stage = it->second;
+    out.name = name;
+    out.gpu_samples = stage.gpu_ms.size();
+    out.cpu_samples = stage.cpu_ms.size();
+    out.gpu_p50 = stage.gpu_ms.percentile(0.50);
+    out.gpu_p95 = stage.gpu_ms.percentile(0.95);
+    out.gpu_p99 = stage.gpu_ms.percentile(0.99);
+    out.cpu_p50 = stage.cpu_ms.percentile(0.50);
+    out.cpu_p95 = stage.cpu_ms.percentile(0.95);
+    out.cpu_p99 = stage.cpu_ms.percentile(0.99);
+    out.gpu_last = stage.gpu_ms.last();
+    out.cpu_last = stage.cpu_ms.last();
+    return true;
+}
+
+double GpuProfiler::last_frame_cost_ms() const {
+    // Stages that didn't run (a finished crossfade, a removed effect or
+    // output) drop out instead of repeating their last sample
+    double total = 0.0;
+    for (const auto& [name, stage] : stages_) {
+        if (name.rfind("present:", 0) == 0) continue;
+        if (stage.cpu_frame != frame_ - 1) continue;
+        total += std::max(stage.gpu_last_frame_ms, stage.frame_cpu_ms);
+    }
+    return total;
+}
+
+std::vector<GpuProfiler::StageStats> GpuProfiler::get_stats() const {
+    std::vector<StageStats> result;
+    for (const auto& entry : stages_) {
+        StageStats stats;
+        get_stage_stats(entry.first, stats);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void GpuProfiler::dump_stats() const {
+    if (!enabled_ || stages_.empty()) return;
+    
+    log_info("Stage timings in ms (p50/p95/p99):");
+    for (const auto& stats : get_stats()) {
+        char line[256];
+        if (gpu_timers_) {
+            snprintf(line, sizeof(line), "  %-24s gpu %6.2f/%6.2f/%6.2f  cpu %6.2f/%6.2f/%6.2f  (%zu samples)",
+                     stats.name.c_str(), stats.gpu_p50, stats.gpu_p95, stats.gpu_p99,
+                     stats.cpu_p50, stats.cpu_p95, stats.cpu_p99, stats.cpu_samples);
+        } else {
+            snprintf(line, sizeof(line), "  %-24s cpu %6.2f/%6.2f/%6.2f  (%zu samples)",
+                     stats.name.c_str(), stats.cpu_p50, stats.cpu_p95, stats.cpu_p99, stats.cpu_samples);
+        }
+        log_info(line);
+        
+        auto it = stages_.find(stats.name);
+        if (it != stages_.end() && it->second.dropped > 0) {
+            log_info("    " + std::to_string(it->second.dropped) + " GPU samples dropped (query ring full)");
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#include "universal-wallpaper/gpu_resource_pool.h"
+#include "universal-wallpaper/utils.h"
+#include <GL/glext.h>
+#include <algorithm>
+#include <iterator>
+
+size_t GpuResourceKeyHash::operator()(const GpuResourceKey& key) const {
+    size_t hash = static_cast<size_t>(key.kind);
+    hash = hash * 31 + static_cast<size_t>(key.width);
+    hash = hash * 31 + static_cast<size_t>(key.height);
+    hash = hash * 31 + static_cast<size_t>(key.internal_format);
+    hash = hash * 31 + static_cast<size_t>(key.slot);
+    return hash;
+}
+
+GpuResourcePool::GpuResourcePool(size_t budget_bytes)
+    : budget_bytes_(budget_bytes) {
+}
+
+void GpuResourcePool::set_destroyer(Destroyer destroyer) {
+    destroyer_ = std::move(destroyer);
+}
+
+void GpuResourcePool::set_budget(size_t budget_bytes) {
+    budget_bytes_ = budget_bytes;
+    over_budget_warned_ = false;
+    evict_to_fit(0);
+}
+
+void GpuResourcePool::begin_frame() {
+    current_frame_++;
+}
+
+const GpuResource* GpuResourcePool::acquire(const GpuResourceKey& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    
+    hits_++;
+    auto entry = it->second;
+    entry->last_used_frame = current_frame_;
+    if (entry != lru_.begin()) {
+        lru_.splice(lru_.begin(), lru_, entry);
+    }
+    return &entry->resource;
+}
+
+const GpuResource* GpuResourcePool::insert(const GpuResource& resource) {
+    // Replace any stale entry with the same key
+    auto existing = index_.find(resource.key);
+    if (existing != index_.end()) {
+        destroy_entry(existing->second);
+    }
+    
+    evict_to_fit(resource.bytes);
+    
+    lru_.push_front(Entry{resource, current_frame_});
+    index_[resource.key] = lru_.begin();
+    bytes_in_use_ += resource.bytes;
+    peak_bytes_ = std::max(peak_bytes_, bytes_in_use_);
+    
+    return &lru_.front().resource;
+}
+
+void GpuResourcePool::release(const GpuResourceKey& key) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        destroy_entry(it->second);
+    }
+}
+
+void GpuResourcePool::clear() {
+    if (!lru_.empty()) {
+        log_debug("Releasing GPU resource pool (" + std::to_string(lru_.size()) + " entries, " +
+                  format_bytes(bytes_in_use_) + ")");
+    }
+    
+    while (!lru_.empty()) {
+        destroy_entry(std::prev(lru_.end()));
+    }
+}
+
+GpuResourcePool::Stats GpuResourcePool::get_stats() const {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.entries = lru_.size();
+    stats.bytes_in_use = bytes_in_use_;
+    stats.peak_bytes = peak_bytes_;
+    stats.budget_bytes = budget_bytes_;
+    return stats;
+}
+
+void GpuResourcePool::dump_stats() const {
+    log_info("GPU pool: " + std::to_string(lru_.size()) + " entries, " +
+             format_bytes(bytes_in_use_) + " / " + format_bytes(budget_bytes_) +
+             " (peak " + format_bytes(peak_bytes_) + "), hits " + std::to_string(hits_) +
+             ", misses " + std::to_string(misses_) + ", evictions " + std::to_string(evictions_));
+}
+
+size_t GpuResourcePool::bytes_per_pixel(GLenum internal_format) {
+    switch (internal_format) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        // Drivers pad 24-bit formats to 32 bits per texel
+        case GL_RGB:
+        case GL_RGB8:
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_RGB10_A2:
+        case GL_SRGB8_ALPHA8:
+            return 4;
+        case GL_RGBA16:
+        case GL_RGBA16F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+size_t GpuResourcePool::bytes_for(const GpuResourceKey& key) {
+    if (key.kind == GpuResourceKind::PixelBuffer) {
+        return static_cast<size_t>(key.width);
+    }
+    
+    // A framebuffer object owns no storage besides its color attachment
+    return static_cast<size_t>(key.width) * static_cast<size_t>(key.height) *
+           bytes_per_pixel(key.internal_format);
+}
+
+void GpuResourcePool::evict_to_fit(size_t incoming_bytes) {
+    auto it = lru_.end();
+    while (bytes_in_use_ + incoming_bytes > budget_bytes_ && it != lru_.begin()) {
+        --it;
+        if (it->last_used_frame == current_frame_) {
+            continue;  // Still referenced by the frame being built
+        }
+        
+        log_debug("Evicting GPU resource " + std::to_string(it->resource.key.width) + "x" +
+                  std::to_string(it->resource.key.height) + " (" + format_bytes(it->resource.bytes) + ")");
+        auto victim = it++;
+        destroy_entry(victim);
+        evictions_++;
+    }
+    
+    if (bytes_in_use_ + incoming_bytes > budget_bytes_ && !over_budget_warned_) {
+        log_warn("GPU resource pool exceeds its VRAM budget (" +
+                 format_bytes(bytes_in_use_ + incoming_bytes) + " > " + format_bytes(budget_bytes_) +
+                 "), all resources are in use by the current frame");
+        over_budget_warned_ = true;
+    }
+}
+
+void GpuResourcePool::destroy_entry(std::list<Entry>::iterator it) {
+    if (destroyer_) {
+        destroyer_(it->resource);
+    }
+    bytes_in_use_ -= it->resource.bytes;
+    index_.erase(it->resource.key);
+    lru_.erase(it);
+}
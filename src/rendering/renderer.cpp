@@ -6,12 +6,22 @@
 #include <vector>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 
 // Fallback definitions for Wayland platform
 #ifndef EGL_PLATFORM_WAYLAND_KHR
 #define EGL_PLATFORM_WAYLAND_KHR 0x31D8
 #endif
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+#ifndef EGL_OPENGL_ES3_BIT_KHR
+#define EGL_OPENGL_ES3_BIT_KHR 0x0040
+#endif
+
 // EGL debugging functions
 static const char* egl_error_string(EGLint error) {
     switch (error) {
@@ -78,23 +88,58 @@ static void print_egl_config_info(EGLDisplay display, EGLConfig config) {
     }
 }
 
-// Simple vertex shader for fullscreen quad (for future use)
-[[maybe_unused]] static const char* vertex_shader_source = R"(
-#version 330 core
+// Ranks configs for a wallpaper that only ever draws a textured quad:
+// depth, stencil and multisampling are pure waste, 8-bit (or 10-bit) color
+// is all that is needed, and Wayland outputs need window surfaces
+static int score_egl_config(EGLDisplay display, EGLConfig config) {
+    EGLint red = 0, green = 0, blue = 0, alpha = 0;
+    EGLint depth = 0, stencil = 0, samples = 0, surface_type = 0, caveat = EGL_NONE;
+    eglGetConfigAttrib(display, config, EGL_RED_SIZE, &red);
+    eglGetConfigAttrib(display, config, EGL_GREEN_SIZE, &green);
+    eglGetConfigAttrib(display, config, EGL_BLUE_SIZE, &blue);
+    eglGetConfigAttrib(display, config, EGL_ALPHA_SIZE, &alpha);
+    eglGetConfigAttrib(display, config, EGL_DEPTH_SIZE, &depth);
+    eglGetConfigAttrib(display, config, EGL_STENCIL_SIZE, &stencil);
+    eglGetConfigAttrib(display, config, EGL_SAMPLES, &samples);
+    eglGetConfigAttrib(display, config, EGL_SURFACE_TYPE, &surface_type);
+    eglGetConfigAttrib(display, config, EGL_CONFIG_CAVEAT, &caveat);
+    
+    int score = 0;
+    if (surface_type & EGL_WINDOW_BIT) score += 1000;
+    if (surface_type & EGL_PBUFFER_BIT) score += 100;
+    
+    if (red == 8 && green == 8 && blue == 8 && (alpha == 8 || alpha == 0)) {
+        score += 400;
+    } else if (red == 10 && green == 10 && blue == 10 && alpha <= 2) {
+        score += 300;
+    } else {
+        score -= red + green + blue + alpha;
+    }
+    
+    score -= (depth + stencil) * 10;
+    score -= samples * 100;
+    
+    if (caveat == EGL_SLOW_CONFIG) score -= 2000;
+    return score;
+}
+
+// Fullscreen quad shaders, one pair per GLSL dialect. GLSL ES 1.00 has no
+// layout qualifiers; create_program binds the same attribute locations.
+// texRegion (offset, size) selects the part of the texture drawn.
+static const char* quad_vertex_shader_330 = R"(#version 330 core
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
+uniform vec4 texRegion;
 
 void main() {
     gl_Position = vec4(aPos, 0.0, 1.0);
-    TexCoord = aTexCoord;
+    TexCoord = texRegion.xy + aTexCoord * texRegion.zw;
 }
 )";
 
-// Simple fragment shader for texture rendering (for future use)
-[[maybe_unused]] static const char* fragment_shader_source = R"(
-#version 330 core
+static const char* quad_fragment_shader_330 = R"(#version 330 core
 out vec4 FragColor;
 
 in vec2 TexCoord;
@@ -105,7 +150,175 @@ void main() {
 }
 )";
 
-Renderer::Renderer() = default;
+static const char* quad_vertex_shader_300es = R"(#version 300 es
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoord;
+uniform vec4 texRegion;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    TexCoord = texRegion.xy + aTexCoord * texRegion.zw;
+}
+)";
+
+static const char* quad_fragment_shader_300es = R"(#version 300 es
+precision mediump float;
+out vec4 FragColor;
+
+in vec2 TexCoord;
+uniform sampler2D ourTexture;
+
+void main() {
+    FragColor = texture(ourTexture, TexCoord);
+}
+)";
+
+static const char* quad_vertex_shader_100 = R"(#version 100
+attribute vec2 aPos;
+attribute vec2 aTexCoord;
+
+varying vec2 TexCoord;
+uniform vec4 texRegion;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    TexCoord = texRegion.xy + aTexCoord * texRegion.zw;
+}
+)";
+
+static const char* quad_fragment_shader_100 = R"(#version 100
+precision mediump float;
+varying vec2 TexCoord;
+uniform sampler2D ourTexture;
+
+void main() {
+    gl_FragColor = texture2D(ourTexture, TexCoord);
+}
+)";
+
+static const char* crossfade_fragment_shader_330 = R"(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+uniform sampler2D fromTexture;
+uniform sampler2D toTexture;
+uniform float mixFactor;
+
+void main() {
+    FragColor = mix(texture(fromTexture, TexCoord), texture(toTexture, TexCoord), mixFactor);
+}
+)";
+
+static const char* crossfade_fragment_shader_300es = R"(#version 300 es
+precision mediump float;
+out vec4 FragColor;
+
+in vec2 TexCoord;
+uniform sampler2D fromTexture;
+uniform sampler2D toTexture;
+uniform float mixFactor;
+
+void main() {
+    FragColor = mix(texture(fromTexture, TexCoord), texture(toTexture, TexCoord), mixFactor);
+}
+)";
+
+static const char* crossfade_fragment_shader_100 = R"(#version 100
+precision mediump float;
+varying vec2 TexCoord;
+uniform sampler2D fromTexture;
+uniform sampler2D toTexture;
+uniform float mixFactor;
+
+void main() {
+    gl_FragColor = mix(texture2D(fromTexture, TexCoord), texture2D(toTexture, TexCoord), mixFactor);
+}
+)";
+
+// Vertex/fragment pairs per shading language: GLSL 330, ESSL 300, ESSL 100
+static const char* const quad_shaders[3][2] = {
+    {quad_vertex_shader_330, quad_fragment_shader_330},
+    {quad_vertex_shader_300es, quad_fragment_shader_300es},
+    {quad_vertex_shader_100, quad_fragment_shader_100}
+};
+
+static const char* const crossfade_shaders[3][2] = {
+    {quad_vertex_shader_330, crossfade_fragment_shader_330},
+    {quad_vertex_shader_300es, crossfade_fragment_shader_300es},
+    {quad_vertex_shader_100, crossfade_fragment_shader_100}
+};
+
+// Declarations put in front of --effect fragment shaders, which draw the
+// wallpaper texture through their own main() with the same names in every
+// dialect: TexCoord, ourTexture, FragColor and texture(). audioBands and
+// audioLevel carry the spectrum of what is playing, 0..1 each.
+static const char* effect_prelude_330 = R"(#version 330 core
+out vec4 FragColor;
+in vec2 TexCoord;
+)";
+
+static const char* effect_prelude_300es = R"(#version 300 es
+precision mediump float;
+out vec4 FragColor;
+in vec2 TexCoord;
+)";
+
+static const char* effect_prelude_100 = R"(#version 100
+precision mediump float;
+varying vec2 TexCoord;
+#define FragColor gl_FragColor
+#define texture texture2D
+)";
+
+static const char* effect_uniforms = R"(uniform sampler2D ourTexture;
+uniform float audioBands[16];
+uniform float audioLevel;
+#line 1
+)";
+
+// Client-side format/type used to allocate storage for a sized internal format
+static void texture_transfer_format(GLenum internal_format, GLenum* format, GLenum* type) {
+    switch (internal_format) {
+        case GL_RGB10_A2:
+            *format = GL_RGBA;
+            *type = GL_UNSIGNED_INT_2_10_10_10_REV;
+            break;
+        case GL_RGBA16F:
+            *format = GL_RGBA;
+            *type = GL_HALF_FLOAT;
+            break;
+        case GL_RGBA16:
+            *format = GL_RGBA;
+            *type = GL_UNSIGNED_SHORT;
+            break;
+        case GL_RGB:
+        case GL_RGB8:
+            *format = GL_RGB;
+            *type = GL_UNSIGNED_BYTE;
+            break;
+        default:
+            *format = GL_RGBA;
+            *type = GL_UNSIGNED_BYTE;
+            break;
+    }
+}
+
+// GLES2 only accepts unsized internal formats equal to the transfer format
+GLenum Renderer::storage_format(GLenum internal_format) const {
+    if (gles_version_ != 2) return internal_format;
+    
+    GLenum format, type;
+    texture_transfer_format(internal_format, &format, &type);
+    return format;
+}
+
+Renderer::Renderer() {
+    resource_pool_.set_destroyer([this](const GpuResource& resource) {
+        destroy_pooled_resource(resource);
+    });
+}
 
 Renderer::~Renderer() {
     destroy();
@@ -156,9 +369,21 @@ bool Renderer::setup_egl(void* native_display) {
             }
         }
     } else {
-        egl_display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-        check_egl_error("eglGetDisplay(default)");
-        log_info("Using default EGL display");
+        // Headless: Mesa's surfaceless platform needs no display server
+        // (llvmpipe when there is no GPU either)
+        const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (client_extensions && strstr(client_extensions, "EGL_MESA_platform_surfaceless")) {
+            egl_display_ = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            check_egl_error("eglGetPlatformDisplay(surfaceless)");
+            if (egl_display_ != EGL_NO_DISPLAY) {
+                log_info("Using surfaceless platform EGL display");
+            }
+        }
+        if (egl_display_ == EGL_NO_DISPLAY) {
+            egl_display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            check_egl_error("eglGetDisplay(default)");
+            log_info("Using default EGL display");
+        }
     }
     
     if (egl_display_ == EGL_NO_DISPLAY) {
@@ -186,97 +411,24 @@ bool Renderer::setup_egl(void* native_display) {
     log_info("EGL Version: " + std::string(egl_version ? egl_version : "Unknown"));
     std::cout << "[EGL DEBUG] Available extensions: " << (extensions ? extensions : "None") << std::endl;
     
-    // Choose EGL config - check for surfaceless context support first
-    EGLConfig configs[256];
-    EGLint num_configs;
-    
     // Check if EGL_KHR_surfaceless_context is available
     if (extensions && strstr(extensions, "EGL_KHR_surfaceless_context")) {
         supports_surfaceless = true;
         log_info("EGL_KHR_surfaceless_context is supported - using surfaceless rendering");
     }
     
-    // First try: prefer pbuffer support if available, but don't require it
-    EGLint preferred_attribs[] = {
-        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-        EGL_NONE
-    };
-    
-    if (!eglChooseConfig(egl_display_, preferred_attribs, configs, 256, &num_configs)) {
-        log_error("eglChooseConfig failed");
-        check_egl_error("eglChooseConfig");
-        return false;
-    }
-    
-    if (num_configs == 0) {
-        log_info("No EGL configurations with pbuffer support found, trying basic OpenGL support");
-        
-        // Fallback: basic OpenGL configuration (will use surfaceless context)
-        EGLint basic_attribs[] = {
-            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-            EGL_NONE
-        };
-        
-        if (!eglChooseConfig(egl_display_, basic_attribs, configs, 256, &num_configs) || num_configs == 0) {
-            log_error("Failed to find any EGL configuration with OpenGL support");
-            check_egl_error("eglChooseConfig basic");
-            return false;
+    bool have_context = false;
+    if (prefer_gles_) {
+        have_context = create_gles_context();
+        if (!have_context) {
+            log_warn("Failed to create an OpenGL ES context, falling back to desktop OpenGL");
         }
     }
     
-    log_info("Found " + std::to_string(num_configs) + " EGL configurations, using the first one");
-    egl_config_ = configs[0];
-    
-    // Print detailed configuration info
-    print_egl_config_info(egl_display_, egl_config_);
-    
-    // Bind OpenGL API
-    if (!eglBindAPI(EGL_OPENGL_API)) {
-        log_error("Failed to bind OpenGL API");
-        check_egl_error("eglBindAPI");
+    if (!have_context && !create_gl_context()) {
         return false;
     }
-    
-    // Try to create OpenGL context with fallback versions
-    EGLint context_attribs_33[] = {
-        EGL_CONTEXT_MAJOR_VERSION, 3,
-        EGL_CONTEXT_MINOR_VERSION, 3,
-        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
-        EGL_NONE
-    };
-    
-    egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_33);
-    check_egl_error("eglCreateContext(3.3 core)");
-    
-    if (egl_context_ == EGL_NO_CONTEXT) {
-        // Try OpenGL 3.0
-        EGLint context_attribs_30[] = {
-            EGL_CONTEXT_MAJOR_VERSION, 3,
-            EGL_CONTEXT_MINOR_VERSION, 0,
-            EGL_NONE
-        };
-        egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_30);
-        check_egl_error("eglCreateContext(3.0)");
-        
-        if (egl_context_ == EGL_NO_CONTEXT) {
-            // Try any OpenGL context
-            EGLint context_attribs_any[] = { EGL_NONE };
-            egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_any);
-            check_egl_error("eglCreateContext(any)");
-            
-            if (egl_context_ == EGL_NO_CONTEXT) {
-                log_error("Failed to create EGL context");
-                check_egl_error("eglCreateContext final");
-                return false;
-            }
-            log_info("Created basic OpenGL context");
-        } else {
-            log_info("Created OpenGL 3.0 context");
-        }
-    } else {
-        log_info("Created OpenGL 3.3 core context");
-    }
+    log_egl_config();
     
     // Create surface for rendering - try pbuffer first, then use surfaceless context
     EGLint pbuffer_attribs[] = {
@@ -328,6 +480,9 @@ bool Renderer::setup_egl(void* native_display) {
         return false;
     }
     
+    profiler_.initialize(is_gles());
+    uploader_.initialize(&resource_pool_, gles_version_);
+    
     log_info("OpenGL context created successfully");
     
     // Print OpenGL info
@@ -339,11 +494,196 @@ bool Renderer::setup_egl(void* native_display) {
     log_info("OpenGL Renderer: " + std::string(renderer ? renderer : "Unknown"));
     log_info("OpenGL Version: " + std::string(version ? version : "Unknown"));
     
+    driver_description_ = std::string(vendor ? vendor : "Unknown") + " " + (renderer ? renderer : "Unknown") + " " +
+                          (version ? version : "Unknown");
+    
     return true;
 }
 
+bool Renderer::choose_egl_config(EGLint renderable_type) {
+    // A zero surface type mask matches every config, including those without
+    // window support; the scorer decides instead of eglChooseConfig's order
+    EGLint attribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, renderable_type,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(egl_display_, attribs, nullptr, 0, &num_configs) || num_configs == 0) {
+        check_egl_error("eglChooseConfig");
+        return false;
+    }
+    
+    std::vector<EGLConfig> configs(num_configs);
+    if (!eglChooseConfig(egl_display_, attribs, configs.data(), num_configs, &num_configs) || num_configs == 0) {
+        check_egl_error("eglChooseConfig");
+        return false;
+    }
+    
+    int best_score = 0;
+    int best_index = -1;
+    for (int i = 0; i < num_configs; i++) {
+        int score = score_egl_config(egl_display_, configs[i]);
+        if (best_index < 0 || score > best_score) {
+            best_score = score;
+            best_index = i;
+        }
+    }
+    
+    egl_config_ = configs[best_index];
+    egl_config_candidates_ = num_configs;
+    
+    EGLint red = 0, green = 0, blue = 0, alpha = 0, depth = 0, stencil = 0, samples = 0;
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_RED_SIZE, &red);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_GREEN_SIZE, &green);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_BLUE_SIZE, &blue);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_ALPHA_SIZE, &alpha);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_DEPTH_SIZE, &depth);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_STENCIL_SIZE, &stencil);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_SAMPLES, &samples);
+    
+    // Color and depth/stencil storage per pixel of every window surface;
+    // drivers pad 24-bit color (and 24-bit depth) to 32 bits
+    surface_bytes_per_pixel_ = static_cast<size_t>(((red + green + blue + alpha + 31) / 32) * 4 +
+                                                   ((depth + stencil + 31) / 32) * 4) *
+                               static_cast<size_t>(std::max(1, samples));
+    return true;
+}
+
+void Renderer::log_egl_config() const {
+    // Only the config a context was created with; the ES 3, ES 2 and
+    // desktop attempts each choose one
+    EGLint config_id = 0, red = 0, green = 0, blue = 0, alpha = 0, depth = 0, stencil = 0, samples = 0;
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_CONFIG_ID, &config_id);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_RED_SIZE, &red);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_GREEN_SIZE, &green);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_BLUE_SIZE, &blue);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_ALPHA_SIZE, &alpha);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_DEPTH_SIZE, &depth);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_STENCIL_SIZE, &stencil);
+    eglGetConfigAttrib(egl_display_, egl_config_, EGL_SAMPLES, &samples);
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Selected EGL config %d of %d candidates: R%dG%dB%dA%d, depth %d, stencil %d, %d samples "
+             "(%zu bytes/pixel, %s per 1920x1080 surface)",
+             config_id, egl_config_candidates_, red, green, blue, alpha, depth, stencil, samples,
+             surface_bytes_per_pixel_,
+             format_bytes(surface_bytes_per_pixel_ * 1920 * 1080).c_str());
+    log_info(message);
+    
+    print_egl_config_info(egl_display_, egl_config_);
+}
+
+bool Renderer::create_gl_context() {
+    if (!choose_egl_config(EGL_OPENGL_BIT)) {
+        log_error("Failed to find any EGL configuration with OpenGL support");
+        return false;
+    }
+    
+    // Bind OpenGL API
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        log_error("Failed to bind OpenGL API");
+        check_egl_error("eglBindAPI");
+        return false;
+    }
+    
+    // Try to create OpenGL context with fallback versions
+    EGLint context_attribs_33[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    
+    egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_33);
+    check_egl_error("eglCreateContext(3.3 core)");
+    
+    if (egl_context_ == EGL_NO_CONTEXT) {
+        // Try OpenGL 3.0
+        EGLint context_attribs_30[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 0,
+            EGL_NONE
+        };
+        egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_30);
+        check_egl_error("eglCreateContext(3.0)");
+        
+        if (egl_context_ == EGL_NO_CONTEXT) {
+            // Try any OpenGL context
+            EGLint context_attribs_any[] = { EGL_NONE };
+            egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_any);
+            check_egl_error("eglCreateContext(any)");
+            
+            if (egl_context_ == EGL_NO_CONTEXT) {
+                log_error("Failed to create EGL context");
+                check_egl_error("eglCreateContext final");
+                return false;
+            }
+            log_info("Created basic OpenGL context");
+        } else {
+            log_info("Created OpenGL 3.0 context");
+        }
+    } else {
+        log_info("Created OpenGL 3.3 core context");
+    }
+    
+    gles_version_ = 0;
+    return true;
+}
+
+bool Renderer::create_gles_context() {
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+        check_egl_error("eglBindAPI(OpenGL ES)");
+        return false;
+    }
+    
+    if (choose_egl_config(EGL_OPENGL_ES3_BIT_KHR)) {
+        EGLint context_attribs_es3[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_NONE
+        };
+        egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_es3);
+        check_egl_error("eglCreateContext(ES 3)");
+        
+        if (egl_context_ != EGL_NO_CONTEXT) {
+            gles_version_ = 3;
+            log_info("Created OpenGL ES 3 context");
+            return true;
+        }
+    }
+    
+    if (choose_egl_config(EGL_OPENGL_ES2_BIT)) {
+        EGLint context_attribs_es2[] = {
+            EGL_CONTEXT_CLIENT_VERSION, 2,
+            EGL_NONE
+        };
+        egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT, context_attribs_es2);
+        check_egl_error("eglCreateContext(ES 2)");
+        
+        if (egl_context_ != EGL_NO_CONTEXT) {
+            gles_version_ = 2;
+            log_info("Created OpenGL ES 2 context");
+            return true;
+        }
+    }
+    
+    // Leave the API as the desktop fallback expects it
+    eglBindAPI(EGL_OPENGL_API);
+    return false;
+}
+
 void Renderer::destroy_context() {
     if (egl_display_ != EGL_NO_DISPLAY) {
+        if (make_current()) {
+            clear_effect();
+            profiler_.destroy();
+            uploader_.destroy();
+        }
         eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         
         if (egl_surface_ != EGL_NO_SURFACE) {
@@ -376,7 +716,13 @@ void Renderer::swap_buffers() {
     }
 }
 
-Renderer::FramebufferInfo Renderer::create_framebuffer(int width, int height) {
+void Renderer::begin_frame() {
+    resource_pool_.begin_frame();
+    profiler_.collect();
+    profiler_.begin_frame();
+}
+
+Renderer::FramebufferInfo Renderer::create_framebuffer(int width, int height, GLenum internal_format) {
     FramebufferInfo info{};
     info.width = width;
     info.height = height;
@@ -387,7 +733,9 @@ Renderer::FramebufferInfo Renderer::create_framebuffer(int width, int height) {
     
     // Use RGBA format for better alignment and performance
     // This reduces memory bandwidth compared to RGB
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLenum format, type;
+    texture_transfer_format(internal_format, &format, &type);
+    glTexImage2D(GL_TEXTURE_2D, 0, storage_format(internal_format), width, height, 0, format, type, nullptr);
     
     // Optimize texture parameters to reduce memory bandwidth
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -442,10 +790,12 @@ void Renderer::set_viewport(int x, int y, int width, int height) {
 }
 
 GLuint Renderer::create_texture(int width, int height, const void* data) {
+    // RGBA8 keeps rows 4-byte aligned and matches what the uploader streams
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, storage_format(GL_RGBA8), width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -455,13 +805,75 @@ GLuint Renderer::create_texture(int width, int height, const void* data) {
 }
 
 void Renderer::update_texture(GLuint texture, int width, int height, const void* data) {
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    update_texture(texture, width, height, data, width * 4, PixelFormat::RGBA8);
+}
+
+void Renderer::update_texture(GLuint texture, int width, int height, const void* data, int stride, PixelFormat format) {
+    if (!uploader_.upload(texture, width, height, data, stride, format)) {
+        // Synchronous fallback when pixel buffer objects are unavailable
+        const void* pixels = data;
+        GLenum transfer_format = format == PixelFormat::BGRA8 ? GL_BGRA : GL_RGBA;
+        
+        if (is_gles()) {
+            // GLES has neither BGRA uploads nor GL_UNPACK_ROW_LENGTH (in
+            // version 2), so repack into tight RGBA rows first
+            const size_t row_bytes = static_cast<size_t>(width) * 4;
+            upload_scratch_.resize(row_bytes * static_cast<size_t>(height));
+            const unsigned char* source = static_cast<const unsigned char*>(data);
+            for (int y = 0; y < height; y++) {
+                unsigned char* row = upload_scratch_.data() + static_cast<size_t>(y) * row_bytes;
+                memcpy(row, source + static_cast<size_t>(y) * stride, row_bytes);
+                if (format == PixelFormat::BGRA8) {
+                    for (size_t x = 0; x < row_bytes; x += 4) {
+                        std::swap(row[x], row[x + 2]);
+                    }
+                }
+            }
+            pixels = upload_scratch_.data();
+            transfer_format = GL_RGBA;
+        } else {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / 4);
+        }
+        
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, transfer_format, GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (!is_gles()) {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+    }
     
     check_gl_error("update_texture");
 }
 
+bool Renderer::read_texture_rgba(GLuint texture, int width, int height, void* pixels) {
+    // glGetTexImage doesn't exist on GLES; reading through a framebuffer
+    // works on every API
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        log_error("Cannot read back texture " + std::to_string(texture) + ": framebuffer incomplete");
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        log_error("OpenGL error reading texture: " + std::to_string(error));
+        return false;
+    }
+    return complete;
+}
+
 void Renderer::destroy_texture(GLuint texture) {
     if (texture != 0) {
         glDeleteTextures(1, &texture);
@@ -499,6 +911,10 @@ GLuint Renderer::create_program(const char* vertex_source, const char* fragment_
     GLuint program = glCreateProgram();
     glAttachShader(program, vertex_shader);
     glAttachShader(program, fragment_shader);
+    
+    // Fixed attribute slots for shaders without layout qualifiers
+    glBindAttribLocation(program, 0, "aPos");
+    glBindAttribLocation(program, 1, "aTexCoord");
     glLinkProgram(program);
     
     GLint success;
@@ -559,32 +975,55 @@ bool Renderer::load_gl_extensions() {
     glGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC)eglGetProcAddress("glGetProgramInfoLog");
     glDeleteProgram = (PFNGLDELETEPROGRAMPROC)eglGetProcAddress("glDeleteProgram");
     glUseProgram = (PFNGLUSEPROGRAMPROC)eglGetProcAddress("glUseProgram");
+    glBindAttribLocation = (PFNGLBINDATTRIBLOCATIONPROC)eglGetProcAddress("glBindAttribLocation");
     
     // Load additional OpenGL functions for rendering
-    glGenVertexArrays = (PFNGLGENVERTEXARRAYSPROC)eglGetProcAddress("glGenVertexArrays");
-    glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)eglGetProcAddress("glBindVertexArray");
+    if (gles_version_ == 2) {
+        // Vertex array objects are an extension on GLES2
+        const char* gl_extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (gl_extensions && strstr(gl_extensions, "GL_OES_vertex_array_object")) {
+            glGenVertexArrays = (PFNGLGENVERTEXARRAYSPROC)eglGetProcAddress("glGenVertexArraysOES");
+            glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)eglGetProcAddress("glBindVertexArrayOES");
+        }
+    } else {
+        glGenVertexArrays = (PFNGLGENVERTEXARRAYSPROC)eglGetProcAddress("glGenVertexArrays");
+        glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)eglGetProcAddress("glBindVertexArray");
+    }
     glGenBuffers = (PFNGLGENBUFFERSPROC)eglGetProcAddress("glGenBuffers");
     glBindBuffer = (PFNGLBINDBUFFERPROC)eglGetProcAddress("glBindBuffer");
     glBufferData = (PFNGLBUFFERDATAPROC)eglGetProcAddress("glBufferData");
+    glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)eglGetProcAddress("glDeleteBuffers");
     glVertexAttribPointer = (PFNGLVERTEXATTRIBPOINTERPROC)eglGetProcAddress("glVertexAttribPointer");
     glEnableVertexAttribArray = (PFNGLENABLEVERTEXATTRIBARRAYPROC)eglGetProcAddress("glEnableVertexAttribArray");
     glGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)eglGetProcAddress("glGetUniformLocation");
     glUniform1i = (PFNGLUNIFORM1IPROC)eglGetProcAddress("glUniform1i");
-    glBlitFramebuffer = (PFNGLBLITFRAMEBUFFERPROC)eglGetProcAddress("glBlitFramebuffer");
+    glUniform1f = (PFNGLUNIFORM1FPROC)eglGetProcAddress("glUniform1f");
+    glUniform4f = (PFNGLUNIFORM4FPROC)eglGetProcAddress("glUniform4f");
+    glUniform1fv = (PFNGLUNIFORM1FVPROC)eglGetProcAddress("glUniform1fv");
+    // Not part of GLES2, whatever eglGetProcAddress hands back
+    glBlitFramebuffer = gles_version_ == 2 ? nullptr
+                                           : (PFNGLBLITFRAMEBUFFERPROC)eglGetProcAddress("glBlitFramebuffer");
     
     if (!glGenFramebuffers || !glBindFramebuffer || !glFramebufferTexture2D ||
         !glCheckFramebufferStatus || !glDeleteFramebuffers || !glCreateShader ||
         !glShaderSource || !glCompileShader || !glGetShaderiv ||
         !glGetShaderInfoLog || !glDeleteShader || !glCreateProgram ||
         !glAttachShader || !glLinkProgram || !glGetProgramiv ||
-        !glGetProgramInfoLog || !glDeleteProgram || !glUseProgram ||
-        !glGenVertexArrays || !glBindVertexArray || !glGenBuffers ||
-        !glBindBuffer || !glBufferData || !glVertexAttribPointer ||
-        !glEnableVertexAttribArray || !glGetUniformLocation || !glUniform1i) {
+        !glGetProgramInfoLog || !glDeleteProgram || !glUseProgram || !glBindAttribLocation ||
+        !glGenBuffers ||
+        !glBindBuffer || !glBufferData || !glDeleteBuffers || !glVertexAttribPointer ||
+        !glEnableVertexAttribArray || !glGetUniformLocation || !glUniform1i || !glUniform1f ||
+        !glUniform4f || !glUniform1fv) {
         std::cerr << "Failed to load OpenGL extension functions" << std::endl;
         return false;
     }
     
+    if (!glGenVertexArrays || !glBindVertexArray) {
+        glGenVertexArrays = nullptr;
+        glBindVertexArray = nullptr;
+        log_debug("Vertex array objects not available - vertex attributes are set up per draw");
+    }
+    
     // glBlitFramebuffer is optional for multi-monitor optimization
     if (!glBlitFramebuffer) {
         log_warn("glBlitFramebuffer not available - multi-monitor optimization disabled");
@@ -611,7 +1050,8 @@ EGLSurface Renderer::create_egl_surface_for_wayland(wl_egl_window* egl_window) {
     return surface;
 }
 
-bool Renderer::render_texture_to_surface(EGLSurface target_surface, GLuint texture, int surface_width, int surface_height) {
+bool Renderer::render_texture_to_surface(EGLSurface target_surface, GLuint texture, int surface_width, int surface_height,
+                                         const std::string& output_name) {
     if (target_surface == EGL_NO_SURFACE || texture == 0) {
         return false;
     }
@@ -625,6 +1065,13 @@ bool Renderer::render_texture_to_surface(EGLSurface target_surface, GLuint textu
         return false;
     }
     
+    // Stage labels are only built while profiling, not on every frame
+    const bool profiling = profiler_.is_enabled();
+    const std::string composite_stage = profiling ? "composite:" + output_name : std::string();
+    const std::string present_stage = profiling ? "present:" + output_name : std::string();
+    
+    profiler_.begin_stage(composite_stage);
+    
     // Set viewport to surface size
     glViewport(0, 0, surface_width, surface_height);
     
@@ -632,11 +1079,17 @@ bool Renderer::render_texture_to_surface(EGLSurface target_surface, GLuint textu
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-    // Draw the texture as a fullscreen quad
-    draw_fullscreen_quad(texture);
+    // Draw the texture as a fullscreen quad, or the output's part of a
+    // texture spanning several outputs
+    auto region = output_regions_.find(output_name);
+    draw_fullscreen_quad(texture, region != output_regions_.end() ? region->second : TextureRegion());
+    
+    profiler_.end_stage(composite_stage);
     
     // Swap buffers to display
+    profiler_.begin_stage(present_stage);
     eglSwapBuffers(egl_display_, target_surface);
+    profiler_.end_stage(present_stage);
     
     // Restore original surface
     eglMakeCurrent(egl_display_, current_surface, current_surface, egl_context_);
@@ -644,46 +1097,156 @@ bool Renderer::render_texture_to_surface(EGLSurface target_surface, GLuint textu
     return true;
 }
 
-void Renderer::draw_fullscreen_quad(GLuint texture) {
+bool Renderer::render_texture_to_framebuffer(const FramebufferInfo& target, GLuint texture,
+                                             const std::string& output_name) {
+    if (target.fbo == 0 || texture == 0) {
+        return false;
+    }
+    
+    const std::string composite_stage = profiler_.is_enabled() ? "composite:" + output_name : std::string();
+    profiler_.begin_stage(composite_stage);
+    
+    bind_framebuffer(target);
+    clear(0.0f, 0.0f, 0.0f, 1.0f);
+    auto region = output_regions_.find(output_name);
+    draw_fullscreen_quad(texture, region != output_regions_.end() ? region->second : TextureRegion());
+    bind_default_framebuffer();
+    
+    profiler_.end_stage(composite_stage);
+    return true;
+}
+
+GLuint Renderer::create_quad_program(const char* const sources[3][2]) {
+    int variant = 0;
+    if (gles_version_ >= 3) {
+        variant = 1;
+    } else if (gles_version_ == 2) {
+        variant = 2;
+    }
+    return create_program(sources[variant][0], sources[variant][1]);
+}
+
+void Renderer::set_output_region(const std::string& output_name, const TextureRegion& region) {
+    output_regions_[output_name] = region;
+}
+
+void Renderer::draw_fullscreen_quad(GLuint texture, const TextureRegion& region) {
     // Simple implementation - create a fullscreen quad and render the texture
     static GLuint program = 0;
-    static GLuint vao = 0;
-    static GLuint vbo = 0;
     
     // Initialize shader program on first use
     if (program == 0) {
-        const char* vertex_shader = R"(
-            #version 330 core
-            layout (location = 0) in vec2 aPos;
-            layout (location = 1) in vec2 aTexCoord;
-            
-            out vec2 TexCoord;
-            
-            void main() {
-                gl_Position = vec4(aPos, 0.0, 1.0);
-                TexCoord = aTexCoord;
-            }
-        )";
-        
-        const char* fragment_shader = R"(
-            #version 330 core
-            out vec4 FragColor;
-            
-            in vec2 TexCoord;
-            uniform sampler2D ourTexture;
-            
-            void main() {
-                FragColor = texture(ourTexture, TexCoord);
-            }
-        )";
-        
-        program = create_program(vertex_shader, fragment_shader);
+        program = create_quad_program(quad_shaders);
         if (program == 0) {
             log_error("Failed to create wallpaper shader program");
             return;
         }
-        
-        // Create fullscreen quad
+    }
+    
+    // Use the shader program
+    use_program(program);
+    
+    // Bind texture
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(glGetUniformLocation(program, "ourTexture"), 0);
+    glUniform4f(glGetUniformLocation(program, "texRegion"), region.u, region.v, region.width, region.height);
+    
+    draw_quad();
+    
+    check_gl_error("draw_fullscreen_quad");
+}
+
+void Renderer::draw_crossfade_quad(GLuint from_texture, GLuint to_texture, float mix) {
+    static GLuint program = 0;
+    
+    if (program == 0) {
+        program = create_quad_program(crossfade_shaders);
+        if (program == 0) {
+            log_error("Failed to create crossfade shader program");
+            return;
+        }
+    }
+    
+    use_program(program);
+    
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, to_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, from_texture);
+    glUniform1i(glGetUniformLocation(program, "fromTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "toTexture"), 1);
+    glUniform1f(glGetUniformLocation(program, "mixFactor"), mix);
+    glUniform4f(glGetUniformLocation(program, "texRegion"), 0.0f, 0.0f, 1.0f, 1.0f);
+    
+    draw_quad();
+    
+    check_gl_error("draw_crossfade_quad");
+}
+
+bool Renderer::set_effect(const std::string& source) {
+    const char* preludes[3] = {effect_prelude_330, effect_prelude_300es, effect_prelude_100};
+    int variant = 0;
+    if (gles_version_ >= 3) {
+        variant = 1;
+    } else if (gles_version_ == 2) {
+        variant = 2;
+    }
+    
+    std::string fragment_source = std::string(preludes[variant]) + effect_uniforms + source;
+    GLuint program = create_program(quad_shaders[variant][0], fragment_source.c_str());
+    if (program == 0) {
+        log_error("Failed to create effect shader program");
+        return false;
+    }
+    
+    clear_effect();
+    effect_program_ = program;
+    // Unused uniforms are optimized out, so this tells whether the effect
+    // reacts to audio at all
+    effect_uses_audio_ = glGetUniformLocation(program, "audioBands") != -1 ||
+                         glGetUniformLocation(program, "audioBands[0]") != -1 ||
+                         glGetUniformLocation(program, "audioLevel") != -1;
+    return true;
+}
+
+void Renderer::clear_effect() {
+    destroy_program(effect_program_);
+    effect_program_ = 0;
+    effect_uses_audio_ = false;
+}
+
+void Renderer::set_audio_levels(const float* bands, int count, float level) {
+    std::fill(audio_bands_, audio_bands_ + kAudioBands, 0.0f);
+    std::copy(bands, bands + std::min(count, kAudioBands), audio_bands_);
+    audio_level_ = level;
+}
+
+void Renderer::draw_effect_quad(GLuint texture) {
+    if (effect_program_ == 0) {
+        draw_fullscreen_quad(texture);
+        return;
+    }
+    
+    use_program(effect_program_);
+    
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(glGetUniformLocation(effect_program_, "ourTexture"), 0);
+    glUniform4f(glGetUniformLocation(effect_program_, "texRegion"), 0.0f, 0.0f, 1.0f, 1.0f);
+    if (effect_uses_audio_) {
+        glUniform1fv(glGetUniformLocation(effect_program_, "audioBands"), kAudioBands, audio_bands_);
+        glUniform1f(glGetUniformLocation(effect_program_, "audioLevel"), audio_level_);
+    }
+    
+    draw_quad();
+    
+    check_gl_error("draw_effect_quad");
+}
+
+void Renderer::draw_quad() {
+    // Create the fullscreen quad on first use
+    if (quad_vbo_ == 0) {
         float vertices[] = {
             // positions   // texture coords
             -1.0f,  1.0f,  0.0f, 1.0f,
@@ -692,22 +1255,26 @@ void Renderer::draw_fullscreen_quad(GLuint texture) {
              1.0f,  1.0f,  1.0f, 1.0f
         };
         
-        unsigned int indices[] = {
+        // 16-bit indices; 32-bit ones need an extension on GLES2
+        unsigned short indices[] = {
             0, 1, 2,
             0, 2, 3
         };
         
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-        GLuint ebo;
-        glGenBuffers(1, &ebo);
+        glGenBuffers(1, &quad_vbo_);
+        glGenBuffers(1, &quad_ebo_);
         
-        glBindVertexArray(vao);
-        
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        // Without vertex array objects (plain GLES2) the attribute setup
+        // below is repeated on every draw instead
+        if (glGenVertexArrays) {
+            glGenVertexArrays(1, &quad_vao_);
+            glBindVertexArray(quad_vao_);
+        }
+        
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ebo_);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
         
         // Position attribute
@@ -718,61 +1285,100 @@ void Renderer::draw_fullscreen_quad(GLuint texture) {
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
         glEnableVertexAttribArray(1);
         
-        glBindVertexArray(0);
+        if (quad_vao_ != 0) {
+            glBindVertexArray(0);
+        }
     }
     
-    // Use the shader program
-    use_program(program);
-    
-    // Bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glUniform1i(glGetUniformLocation(program, "ourTexture"), 0);
-    
     // Draw the quad
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-    
-    check_gl_error("draw_fullscreen_quad");
+    if (quad_vao_ != 0) {
+        glBindVertexArray(quad_vao_);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ebo_);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+    if (quad_vao_ != 0) {
+        glBindVertexArray(0);
+    }
 }
 
-Renderer::FramebufferInfo Renderer::get_or_create_framebuffer(int width, int height) {
-    // Check if we already have a framebuffer for this size
-    auto key = std::make_pair(width, height);
-    auto it = framebuffer_cache_.find(key);
+Renderer::FramebufferInfo Renderer::get_or_create_framebuffer(int width, int height, GLenum internal_format,
+                                                              uint32_t slot) {
+    GpuResourceKey key{GpuResourceKind::Framebuffer, width, height, internal_format, slot};
     
-    if (it != framebuffer_cache_.end()) {
-        log_debug("Reusing cached framebuffer: " + std::to_string(width) + "x" + std::to_string(height));
-        return it->second;
+    if (const GpuResource* cached = resource_pool_.acquire(key)) {
+        return {cached->fbo, cached->texture, width, height};
     }
     
-    // Limit cache size to prevent memory bloat
-    if (framebuffer_cache_.size() >= 8) {
-        log_debug("Framebuffer cache limit reached, cleaning up oldest entry");
-        auto oldest = framebuffer_cache_.begin();
-        destroy_framebuffer(oldest->second);
-        framebuffer_cache_.erase(oldest);
-    }
-    
-    // Create new framebuffer and cache it
-    FramebufferInfo info = create_framebuffer(width, height);
+    FramebufferInfo info = create_framebuffer(width, height, internal_format);
     if (info.fbo != 0) {
-        framebuffer_cache_[key] = info;
-        log_debug("Created and cached new framebuffer: " + std::to_string(width) + "x" + std::to_string(height));
+        GpuResource resource;
+        resource.key = key;
+        resource.fbo = info.fbo;
+        resource.texture = info.texture;
+        resource.bytes = GpuResourcePool::bytes_for(key);
+        resource_pool_.insert(resource);
+        log_debug("Created pooled framebuffer: " + std::to_string(width) + "x" + std::to_string(height) +
+                  " (" + format_bytes(resource.bytes) + ")");
     }
     
     return info;
 }
 
-void Renderer::cleanup_framebuffer_cache() {
-    log_debug("Cleaning up framebuffer cache (" + std::to_string(framebuffer_cache_.size()) + " entries)");
+GLuint Renderer::get_or_create_texture(int width, int height, GLenum internal_format, uint32_t slot) {
+    GpuResourceKey key{GpuResourceKind::Texture, width, height, internal_format, slot};
     
-    for (auto& pair : framebuffer_cache_) {
-        destroy_framebuffer(pair.second);
+    if (const GpuResource* cached = resource_pool_.acquire(key)) {
+        return cached->texture;
     }
     
-    framebuffer_cache_.clear();
+    GLenum format, type;
+    texture_transfer_format(internal_format, &format, &type);
+    
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, storage_format(internal_format), width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    check_gl_error("get_or_create_texture");
+    
+    GpuResource resource;
+    resource.key = key;
+    resource.texture = texture;
+    resource.bytes = GpuResourcePool::bytes_for(key);
+    resource_pool_.insert(resource);
+    
+    return texture;
+}
+
+void Renderer::cleanup_framebuffer_cache() {
+    resource_pool_.clear();
+}
+
+void Renderer::set_vram_budget(size_t bytes) {
+    resource_pool_.set_budget(bytes);
+    log_info("GPU resource pool budget: " + format_bytes(bytes));
+}
+
+void Renderer::destroy_pooled_resource(const GpuResource& resource) {
+    if (resource.fbo != 0 && glDeleteFramebuffers) {
+        glDeleteFramebuffers(1, &resource.fbo);
+    }
+    if (resource.texture != 0) {
+        glDeleteTextures(1, &resource.texture);
+    }
+    if (resource.buffer != 0 && glDeleteBuffers) {
+        glDeleteBuffers(1, &resource.buffer);
+    }
 }
 
 bool Renderer::copy_framebuffer_to_texture(const FramebufferInfo& source, GLuint target_texture, int target_width, int target_height) {
@@ -0,0 +1,238 @@
+#include "universal-wallpaper/texture_uploader.h"
+#include "universal-wallpaper/gpu_resource_pool.h"
+#include "universal-wallpaper/utils.h"
+#include <EGL/egl.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Pool slots reserved for upload buffers so they never alias a caller's key
+static constexpr uint32_t kUploadSlotBase = 0x55500000;
+
+// How long an upload may block on a ring slot the GPU is still reading
+static constexpr GLuint64 kFenceTimeoutNs = 100 * 1000 * 1000;
+
+static GpuResourceKey upload_key(int index, size_t size) {
+    return GpuResourceKey{GpuResourceKind::PixelBuffer, static_cast<int>(size), 1, 0,
+                          kUploadSlotBase + static_cast<uint32_t>(index)};
+}
+
+bool TextureUploader::initialize(GpuResourcePool* pool, int gles_version) {
+    pool_ = pool;
+    gles_ = gles_version > 0;
+    initialized_ = false;
+    if (!pool_) return false;
+    
+    if (gles_version == 2) {
+        log_debug("Pixel buffer objects not available on OpenGL ES 2 - texture uploads will be synchronous");
+        return false;
+    }
+    
+    glGenBuffers = (PFNGLGENBUFFERSPROC)eglGetProcAddress("glGenBuffers");
+    glBindBuffer = (PFNGLBINDBUFFERPROC)eglGetProcAddress("glBindBuffer");
+    glBufferData = (PFNGLBUFFERDATAPROC)eglGetProcAddress("glBufferData");
+    glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)eglGetProcAddress("glDeleteBuffers");
+    glBufferStorage = (PFNGLBUFFERSTORAGEPROC)eglGetProcAddress(gles_ ? "glBufferStorageEXT" : "glBufferStorage");
+    glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)eglGetProcAddress("glMapBufferRange");
+    glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)eglGetProcAddress("glUnmapBuffer");
+    glFenceSync = (PFNGLFENCESYNCPROC)eglGetProcAddress("glFenceSync");
+    glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)eglGetProcAddress("glClientWaitSync");
+    glDeleteSync = (PFNGLDELETESYNCPROC)eglGetProcAddress("glDeleteSync");
+    glGetStringi = (PFNGLGETSTRINGIPROC)eglGetProcAddress("glGetStringi");
+    
+    if (!glGenBuffers || !glBindBuffer || !glBufferData || !glDeleteBuffers || !glMapBufferRange || !glUnmapBuffer ||
+        !glFenceSync || !glClientWaitSync || !glDeleteSync) {
+        log_warn("Pixel buffer objects not available - texture uploads will be synchronous");
+        return false;
+    }
+    
+    // eglGetProcAddress may return non-null for entry points the driver
+    // doesn't implement, so also require the extension string
+    persistent_ = glBufferStorage && glGetStringi &&
+                  has_extension(gles_ ? "GL_EXT_buffer_storage" : "GL_ARB_buffer_storage");
+    initialized_ = true;
+    
+    log_debug(persistent_ ? "Texture uploads use persistently mapped buffers"
+                          : "Texture uploads use orphaned streaming buffers");
+    return true;
+}
+
+void TextureUploader::destroy() {
+    for (int i = 0; i < kRingSize; i++) {
+        Slot& slot = slots_[i];
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.buffer != 0) {
+            // Deleting the buffer also unmaps it
+            pool_->release(upload_key(i, slot.capacity));
+        }
+        slot = Slot{};
+    }
+    initialized_ = false;
+}
+
+bool TextureUploader::has_extension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextureUploader::wait_for_slot(Slot& slot) {
+    if (!slot.fence) return;
+    
+    // Poll first; with three slots in flight the GPU has normally caught up
+    GLenum result = glClientWaitSync(slot.fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        stats_.fence_waits++;
+        result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNs);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            log_warn("Timed out waiting for a texture upload buffer");
+        }
+    }
+    
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+}
+
+bool TextureUploader::prepare_slot(Slot& slot, int index, size_t size) {
+    if (slot.buffer != 0) {
+        // The pool may have evicted the buffer under VRAM pressure; acquiring
+        // it also keeps it pinned for the current frame
+        if (!pool_->acquire(upload_key(index, slot.capacity))) {
+            slot = Slot{};
+        } else if (slot.capacity >= size) {
+            return true;
+        } else {
+            pool_->release(upload_key(index, slot.capacity));
+            slot = Slot{};
+        }
+    }
+    
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    
+    if (persistent_) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        slot.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    
+    if (persistent_ && !slot.mapped) {
+        log_error("Failed to map texture upload buffer");
+        glDeleteBuffers(1, &slot.buffer);
+        slot = Slot{};
+        return false;
+    }
+    
+    slot.capacity = size;
+    stats_.reallocations++;
+    
+    GpuResource resource;
+    resource.key = upload_key(index, size);
+    resource.buffer = slot.buffer;
+    resource.bytes = size;
+    pool_->insert(resource);
+    return true;
+}
+
+bool TextureUploader::upload(GLuint texture, int width, int height, const void* pixels, int stride, PixelFormat format) {
+    if (!initialized_ || texture == 0 || !pixels || width <= 0 || height <= 0) return false;
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    const size_t row_bytes = static_cast<size_t>(width) * 4;
+    const size_t size = row_bytes * static_cast<size_t>(height);
+    
+    int index = next_slot_;
+    Slot& slot = slots_[index];
+    next_slot_ = (next_slot_ + 1) % kRingSize;
+    
+    wait_for_slot(slot);
+    if (!prepare_slot(slot, index, size)) {
+        return false;
+    }
+    
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    
+    void* destination = slot.mapped;
+    if (!persistent_) {
+        // Orphan the old storage so the driver doesn't stall on pending reads
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+        destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!destination) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            log_error("Failed to map texture upload buffer");
+            return false;
+        }
+    }
+    
+    // Repack into tightly packed rows so the unpack state stays trivial
+    const unsigned char* source = static_cast<const unsigned char*>(pixels);
+    if (static_cast<size_t>(stride) == row_bytes) {
+        memcpy(destination, source, size);
+    } else {
+        unsigned char* row = static_cast<unsigned char*>(destination);
+        for (int y = 0; y < height; y++) {
+            memcpy(row, source + static_cast<size_t>(y) * stride, row_bytes);
+            row += row_bytes;
+        }
+    }
+    
+    if (!persistent_) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    
+    // BGRA with the reversed packed type matches the native layout of most
+    // GPUs and is transferred without a swizzle pass. GLES can't upload BGRA
+    // into RGBA8, so there the bytes go in as-is and the sampler swaps red
+    // and blue.
+    GLenum transfer_format = format == PixelFormat::BGRA8 ? GL_BGRA : GL_RGBA;
+    GLenum transfer_type = format == PixelFormat::BGRA8 ? GL_UNSIGNED_INT_8_8_8_8_REV : GL_UNSIGNED_BYTE;
+    
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (gles_) {
+        bool swap = format == PixelFormat::BGRA8;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, swap ? GL_BLUE : GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, swap ? GL_RED : GL_BLUE);
+        transfer_format = GL_RGBA;
+        transfer_type = GL_UNSIGNED_BYTE;
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, transfer_format, transfer_type, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    stats_.uploads++;
+    stats_.bytes += size;
+    stats_.cpu_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void TextureUploader::dump_stats() const {
+    if (stats_.uploads == 0) return;
+    
+    double megabytes = static_cast<double>(stats_.bytes) / (1024.0 * 1024.0);
+    double throughput = stats_.cpu_ms > 0.0 ? megabytes / (stats_.cpu_ms / 1000.0) : 0.0;
+    
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Texture uploads (%s): %llu uploads, %.1f MB, %.0f MB/s, %.3f ms avg, %llu fence waits, %llu reallocations",
+             persistent_ ? "persistent" : "orphaned", static_cast<unsigned long long>(stats_.uploads), megabytes,
+             throughput, stats_.cpu_ms / static_cast<double>(stats_.uploads),
+             static_cast<unsigned long long>(stats_.fence_waits),
+             static_cast<unsigned long long>(stats_.reallocations));
+    log_info(message);
+}
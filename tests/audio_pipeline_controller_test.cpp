@@ -0,0 +1,74 @@
+// AudioPipelineController: detaching while muted and the fade-in on
+// reattach, driven with explicit times
+#include "fake_media_engine.h"
+#include "test_util.h"
+#include "universal-wallpaper/audio_pipeline_controller.h"
+#include <chrono>
+#include <cmath>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+static bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-6;
+}
+
+int main() {
+    AudioPipelineController audio;
+    FakeMediaEngine engine;
+    Clock::time_point now = Clock::now();
+    
+    // Unmuted from the start: full volume, nothing to fade
+    CHECK(!audio.is_muted());
+    audio.sync(engine, now);
+    CHECK(engine.audio_enabled);
+    CHECK(near(engine.volume_scale, 1.0));
+    CHECK(audio.time_until_update(now) == Clock::duration::max());
+    
+    // Muting drops the track instead of the volume
+    audio.set_muted(true, now);
+    CHECK(audio.is_muted());
+    engine.calls.clear();
+    audio.sync(engine, now);
+    CHECK(!engine.audio_enabled);
+    CHECK(engine.calls.size() == 1 && engine.calls[0] == "audio off");
+    CHECK(audio.time_until_update(now + 1s) == Clock::duration::max());
+    
+    // Reattaching fades in over 400 ms; the volume is set before the track
+    // comes back, so it never starts loud
+    Clock::time_point unmuted = now + 5s;
+    audio.set_muted(false, unmuted);
+    CHECK(!audio.is_muted());
+    engine.calls.clear();
+    audio.sync(engine, unmuted);
+    CHECK(engine.audio_enabled);
+    CHECK(near(engine.volume_scale, 0.0));
+    CHECK(engine.calls.size() == 2 && engine.calls[0] == "volume" && engine.calls[1] == "audio on");
+    CHECK(audio.time_until_update(unmuted) == 25ms);
+    
+    audio.sync(engine, unmuted + 100ms);
+    CHECK(near(engine.volume_scale, 0.25));
+    audio.sync(engine, unmuted + 200ms);
+    CHECK(near(engine.volume_scale, 0.5));
+    CHECK(audio.time_until_update(unmuted + 200ms) == 25ms);
+    
+    audio.sync(engine, unmuted + 400ms);
+    CHECK(near(engine.volume_scale, 1.0));
+    audio.sync(engine, unmuted + 10s);
+    CHECK(near(engine.volume_scale, 1.0));
+    CHECK(audio.time_until_update(unmuted + 400ms) == Clock::duration::max());
+    
+    // Repeated states change nothing; a mute mid-fade detaches at once
+    audio.set_muted(false, unmuted + 500ms);
+    audio.sync(engine, unmuted + 500ms);
+    CHECK(near(engine.volume_scale, 1.0));
+    audio.set_muted(false, unmuted + 20s);
+    audio.set_muted(true, unmuted + 20s);
+    audio.set_muted(false, unmuted + 30s);
+    audio.set_muted(true, unmuted + 30s + 100ms);
+    audio.sync(engine, unmuted + 30s + 100ms);
+    CHECK(!engine.audio_enabled);
+    
+    audio.dump_stats();
+    return test_result();
+}
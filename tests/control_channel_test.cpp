@@ -0,0 +1,116 @@
+// ControlChannel: how bytes written to the FIFO become commands, including
+// lines split across writes and lines too long to accept
+#include "test_util.h"
+#include "universal-wallpaper/control_channel.h"
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using Commands = std::vector<std::string>;
+
+static std::string directory;
+
+static void send(int fd, const std::string& data) {
+    CHECK(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+}
+
+static void test_lines() {
+    const std::string path = directory + "/control.fifo";
+    ControlChannel channel;
+    CHECK(channel.open(path));
+    int writer = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+    CHECK(writer >= 0);
+    
+    CHECK(channel.read_commands().empty());
+    
+    // Several lines in one write; blank lines and CRs are dropped
+    send(writer, "switch /a.mp4\n\nnext\r\nvolume 0.5\n");
+    CHECK(channel.read_commands() == Commands({"switch /a.mp4", "next", "volume 0.5"}));
+    
+    // A line completes only with its newline
+    send(writer, "switch /b");
+    CHECK(channel.read_commands().empty());
+    send(writer, ".mp4\nnex");
+    CHECK(channel.read_commands() == Commands({"switch /b.mp4"}));
+    send(writer, "t\n");
+    CHECK(channel.read_commands() == Commands({"next"}));
+    
+    // Writers closing the FIFO don't end the channel
+    close(writer);
+    CHECK(channel.read_commands().empty());
+    writer = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+    send(writer, "pause\n");
+    CHECK(channel.read_commands() == Commands({"pause"}));
+    close(writer);
+    
+    // The FIFO it created goes away with it
+    channel.close();
+    struct stat st;
+    CHECK(stat(path.c_str(), &st) != 0);
+}
+
+static void test_oversized_lines() {
+    const std::string path = directory + "/control.fifo";
+    ControlChannel channel;
+    CHECK(channel.open(path));
+    int writer = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+    CHECK(writer >= 0);
+    
+    // Too long in one piece: dropped, the next line still arrives
+    send(writer, std::string(5000, 'a') + "\nnext\n");
+    CHECK(channel.read_commands() == Commands({"next"}));
+    
+    // Too long before its newline arrives: none of it becomes a command
+    send(writer, "switch " + std::string(5000, 'b'));
+    CHECK(channel.read_commands().empty());
+    send(writer, std::string(3000, 'b'));
+    CHECK(channel.read_commands().empty());
+    send(writer, "bbb.mp4\npause\n");
+    CHECK(channel.read_commands() == Commands({"pause"}));
+    
+    // Exactly the limit is accepted
+    std::string longest = "switch " + std::string(4096 - 7, 'c');
+    send(writer, longest + "\n");
+    CHECK(channel.read_commands() == Commands({longest}));
+    
+    close(writer);
+}
+
+static void test_existing_paths() {
+    // A FIFO that was already there is reused and left in place
+    const std::string fifo = directory + "/existing.fifo";
+    CHECK(mkfifo(fifo.c_str(), 0600) == 0);
+    {
+        ControlChannel channel;
+        CHECK(channel.open(fifo));
+    }
+    struct stat st;
+    CHECK(stat(fifo.c_str(), &st) == 0 && S_ISFIFO(st.st_mode));
+    unlink(fifo.c_str());
+    
+    // Anything else is not touched
+    const std::string file = directory + "/file";
+    close(open(file.c_str(), O_WRONLY | O_CREAT, 0600));
+    ControlChannel channel;
+    CHECK(!channel.open(file));
+    CHECK(!channel.is_open());
+    CHECK(channel.read_commands().empty());
+    CHECK(stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode));
+    unlink(file.c_str());
+}
+
+int main() {
+    char temporary[] = "/tmp/control_channel_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    
+    test_lines();
+    test_oversized_lines();
+    test_existing_paths();
+    
+    rmdir(directory.c_str());
+    return test_result();
+}
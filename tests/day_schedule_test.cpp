@@ -0,0 +1,188 @@
+// DaySchedule: clock and sun-relative entries resolved for fixed dates, in
+// UTC so the results don't depend on the machine's time zone
+#include "test_util.h"
+#include "universal-wallpaper/day_schedule.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+using Clock = DaySchedule::Clock;
+
+static std::string directory;
+
+static Clock::time_point utc(int year, int month, int day, int hour, int minute, int second = 0) {
+    tm date = {};
+    date.tm_year = year - 1900;
+    date.tm_mon = month - 1;
+    date.tm_mday = day;
+    date.tm_hour = hour;
+    date.tm_min = minute;
+    date.tm_sec = second;
+    return Clock::from_time_t(timegm(&date));
+}
+
+static bool load(DaySchedule& schedule, const std::string& manifest) {
+    std::string path = directory + "/schedule.txt";
+    std::ofstream(path) << manifest;
+    return schedule.load(path);
+}
+
+// Minutes between two times, for checks against published sun times
+static double minutes_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::ratio<60>>(b - a).count();
+}
+
+static void test_clock_entries() {
+    DaySchedule schedule;
+    CHECK(load(schedule, "transition 30\n07:00 day.jpg\n19:00 night.jpg 10\n"));
+    
+    // Midday shows the morning entry and waits for the evening one
+    Clock::time_point noon = utc(2024, 3, 1, 12, 0);
+    CHECK(schedule.start(noon));
+    CHECK(schedule.current() == directory + "/day.jpg");
+    CHECK(schedule.next() == directory + "/night.jpg");
+    CHECK(schedule.update(noon) == DaySchedule::Action::None);
+    CHECK(schedule.time_until_action(noon) == Clock::duration(7h - 5s));
+    
+    // Prepared shortly before, switched at the entry's time
+    CHECK(schedule.update(utc(2024, 3, 1, 18, 59, 56)) == DaySchedule::Action::Prepare);
+    CHECK(schedule.update(utc(2024, 3, 1, 18, 59, 58)) == DaySchedule::Action::None);
+    CHECK(schedule.update(utc(2024, 3, 1, 19, 0)) == DaySchedule::Action::Switch);
+    CHECK(schedule.current() == directory + "/night.jpg");
+    
+    // The entry's own 10 minute window, joined 4 minutes in
+    std::chrono::milliseconds duration(0);
+    std::chrono::milliseconds elapsed(0);
+    schedule.get_transition(utc(2024, 3, 1, 19, 4), duration, elapsed);
+    CHECK(duration == 10min);
+    CHECK(elapsed == 4min);
+    
+    // Before the first entry of the day, yesterday's last one still applies
+    DaySchedule early;
+    CHECK(load(early, "07:00 day.jpg\n19:00 night.jpg\n"));
+    CHECK(early.start(utc(2024, 3, 2, 3, 0)));
+    CHECK(early.current() == directory + "/night.jpg");
+}
+
+static void test_same_media() {
+    // Consecutive entries with one file move the timing, not the picture
+    DaySchedule schedule;
+    CHECK(load(schedule, "06:00 day.jpg\n12:00 day.jpg\n18:00 night.jpg\n"));
+    CHECK(schedule.start(utc(2024, 3, 1, 8, 0)));
+    CHECK(schedule.update(utc(2024, 3, 1, 11, 59, 57)) == DaySchedule::Action::None);
+    CHECK(schedule.update(utc(2024, 3, 1, 12, 0)) == DaySchedule::Action::None);
+    CHECK(schedule.current() == directory + "/day.jpg");
+    CHECK(schedule.update(utc(2024, 3, 1, 18, 0)) == DaySchedule::Action::Switch);
+}
+
+static void test_frames_between_windows() {
+    DaySchedule schedule;
+    CHECK(load(schedule, "07:00 day.jpg\n19:00 night.jpg 10\n"));
+    CHECK(schedule.start(utc(2024, 3, 1, 12, 0)));
+    
+    // Once the first frame is up, a still presents nothing until 19:00
+    schedule.frame_presented(utc(2024, 3, 1, 12, 0));
+    CHECK(schedule.get_frames_between_windows() == 0);
+    
+    // Fade steps inside the window and the one completing it are expected
+    CHECK(schedule.update(utc(2024, 3, 1, 19, 0)) == DaySchedule::Action::Switch);
+    for (int second = 0; second < 600; second += 7) {
+        schedule.frame_presented(utc(2024, 3, 1, 19, 0, 0) + std::chrono::seconds(second));
+    }
+    schedule.frame_presented(utc(2024, 3, 1, 19, 10, 1));
+    CHECK(schedule.get_frames_between_windows() == 0);
+    
+    // Anything after that is a frame a still shouldn't have cost
+    schedule.frame_presented(utc(2024, 3, 1, 20, 0));
+    schedule.frame_presented(utc(2024, 3, 1, 21, 0));
+    CHECK(schedule.get_frames_between_windows() == 2);
+}
+
+static void test_sun_times() {
+    // Berlin at the June solstice: sunrise 02:43, sunset 19:33 UTC
+    DaySchedule schedule;
+    CHECK(load(schedule, "location 52.52 13.40\nsunrise day.jpg\nsunset night.jpg\nsunset-45 dusk.jpg\n"));
+    
+    Clock::time_point noon = utc(2024, 6, 21, 12, 0);
+    CHECK(schedule.start(noon));
+    CHECK(schedule.current() == directory + "/day.jpg");
+    
+    // The next action is preparing sunset-45, 5 seconds ahead of it
+    Clock::time_point dusk = noon + schedule.time_until_action(noon) + 5s;
+    CHECK(std::abs(minutes_between(utc(2024, 6, 21, 18, 48), dusk)) < 3.0);
+    CHECK(schedule.update(dusk) == DaySchedule::Action::Switch);
+    CHECK(schedule.current() == directory + "/dusk.jpg");
+    Clock::time_point sunset = dusk + schedule.time_until_action(dusk) + 5s;
+    CHECK(std::abs(minutes_between(utc(2024, 6, 21, 19, 33), sunset)) < 3.0);
+    
+    // Before dawn the previous evening's entry applies
+    DaySchedule night;
+    CHECK(load(night, "location 52.52 13.40\nsunrise day.jpg\nsunset night.jpg\n"));
+    Clock::time_point one = utc(2024, 6, 21, 1, 0);
+    CHECK(night.start(one));
+    CHECK(night.current() == directory + "/night.jpg");
+    Clock::time_point sunrise = one + night.time_until_action(one) + 5s;
+    CHECK(std::abs(minutes_between(utc(2024, 6, 21, 2, 43), sunrise)) < 3.0);
+    
+    // --location overrides the manifest: Quito, on the equator
+    DaySchedule equator;
+    CHECK(load(equator, "location 52.52 13.40\nnoon day.jpg\ndusk night.jpg\n"));
+    equator.set_location(-0.18, -78.47);
+    Clock::time_point morning = utc(2024, 3, 20, 14, 0);
+    CHECK(equator.start(morning));
+    CHECK(equator.current() == directory + "/night.jpg");
+    Clock::time_point solar_noon = morning + equator.time_until_action(morning) + 5s;
+    CHECK(std::abs(minutes_between(utc(2024, 3, 20, 17, 21), solar_noon)) < 3.0);
+}
+
+static void test_polar_day() {
+    // Tromsø in June: the sun never sets, so sun-only schedules don't apply,
+    // while clock entries still do
+    DaySchedule sun_only;
+    CHECK(load(sun_only, "location 69.65 18.96\nsunrise day.jpg\nsunset night.jpg\n"));
+    CHECK(!sun_only.start(utc(2024, 6, 21, 12, 0)));
+    
+    DaySchedule mixed;
+    CHECK(load(mixed, "location 69.65 18.96\n08:00 day.jpg\nsunset night.jpg\n"));
+    CHECK(mixed.start(utc(2024, 6, 21, 12, 0)));
+    CHECK(mixed.current() == directory + "/day.jpg");
+}
+
+static void test_invalid_manifests() {
+    DaySchedule schedule;
+    CHECK(!load(schedule, "sunrise day.jpg\n"));            // No location
+    CHECK(!load(schedule, "25:00 day.jpg\n"));              // Bad time
+    CHECK(!load(schedule, "sunset+x day.jpg\n"));           // Bad offset
+    CHECK(!load(schedule, "07:00 missing.jpg\n"));          // No such media
+    CHECK(!load(schedule, "location 95 0\n07:00 day.jpg\n"));
+    CHECK(!load(schedule, "# only a comment\n"));
+}
+
+int main() {
+    setenv("TZ", "UTC", 1);
+    tzset();
+    
+    char temporary[] = "/tmp/day_schedule_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    for (const char* name : {"day.jpg", "night.jpg", "dusk.jpg"}) {
+        std::ofstream(directory + "/" + name) << "";
+    }
+    
+    test_clock_entries();
+    test_same_media();
+    test_frames_between_windows();
+    test_sun_times();
+    test_polar_day();
+    test_invalid_manifests();
+    
+    for (const char* name : {"day.jpg", "night.jpg", "dusk.jpg", "schedule.txt"}) {
+        unlink((directory + "/" + name).c_str());
+    }
+    rmdir(directory.c_str());
+    return test_result();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "universal-wallpaper/media_engine.h"
+#include <string>
+#include <vector>
+
+// MediaEngine that plays nothing and records the controls applied to it
+class FakeMediaEngine : public MediaEngine {
+public:
+    bool audio_enabled = false;
+    double volume_scale = 1.0;
+    bool paused = false;
+    // "audio on", "audio off" and "volume" in the order they were applied
+    std::vector<std::string> calls;
+    
+    const char* get_engine_name() const override { return "fake"; }
+    
+    bool initialize(const std::string&, bool, bool, bool, double, const std::string&) override { return true; }
+    void destroy() override {}
+    
+    bool create_render_context(void* (*)(void*, const char*), void*) override { return true; }
+    bool render_frame(int, int, int) override { return true; }
+    void report_flip() override {}
+    
+    int get_wakeup_fd() const override { return -1; }
+    uint64_t update() override { return 0; }
+    void process_events() override {}
+    
+    void get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const override {
+        flags = 0;
+        target_time_us = 0;
+    }
+    int64_t get_time_us() const override { return 0; }
+    bool skip_frame() override { return true; }
+    bool has_new_frame() const override { return false; }
+    void mark_frame_rendered() override {}
+    bool has_first_frame() const override { return true; }
+    
+    bool is_playing() const override { return !paused; }
+    bool has_video() const override { return true; }
+    double get_duration() const override { return 0.0; }
+    double get_position() const override { return 0.0; }
+    double get_container_fps() const override { return 0.0; }
+    
+    void set_audio_enabled(bool enabled) override {
+        audio_enabled = enabled;
+        calls.push_back(enabled ? "audio on" : "audio off");
+    }
+    void set_volume_scale(double scale) override {
+        volume_scale = scale;
+        calls.push_back("volume");
+    }
+    void set_paused(bool value) override { paused = value; }
+    void set_prescale_target(int, int, bool) override {}
+};
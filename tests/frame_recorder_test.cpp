@@ -0,0 +1,95 @@
+// FrameRecorder's Y4M output: header, frame count and frame layout of a
+// short recording, as --record writes it for the first headless output
+#include "test_util.h"
+#include "universal-wallpaper/frame_recorder.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static std::string directory;
+
+static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Odd sizes round the 4:2:0 chroma planes up
+static void test_y4m_frames() {
+    const int width = 5;
+    const int height = 3;
+    const int frames = 7;
+    const std::string path = directory + "/out.y4m";
+    
+    FrameRecorder recorder(path, 24);
+    CHECK(recorder.open(width, height));
+    
+    // Frame i is a flat grey of level i * 40, the last one white
+    auto level = [&](int frame) { return frame == frames - 1 ? 255 : frame * 40; };
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+    for (int i = 0; i < frames; i++) {
+        for (size_t p = 0; p < pixels.size(); p += 4) {
+            pixels[p] = pixels[p + 1] = pixels[p + 2] = static_cast<unsigned char>(level(i));
+            pixels[p + 3] = 255;
+        }
+        CHECK(recorder.write_frame(pixels.data()));
+    }
+    CHECK(recorder.get_frames_written() == frames);
+    recorder.close();
+    
+    std::string data = read_file(path);
+    const std::string header = "YUV4MPEG2 W5 H3 F24:1 Ip A1:1 C420jpeg\n";
+    CHECK(data.compare(0, header.size(), header) == 0);
+    
+    const size_t luma = static_cast<size_t>(width) * height;
+    const size_t chroma = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+    const size_t frame_size = luma + 2 * chroma;
+    CHECK(data.size() == header.size() + frames * (6 + frame_size));
+    
+    int frames_found = 0;
+    size_t offset = header.size();
+    while (offset + 6 + frame_size <= data.size() && data.compare(offset, 6, "FRAME\n") == 0) {
+        const unsigned char* planes = reinterpret_cast<const unsigned char*>(data.data() + offset + 6);
+        
+        // Greys are neutral: chroma at 128, luma scaled into 16..235
+        int expected = ((220 * level(frames_found) + 128) >> 8) + 16;
+        for (size_t i = 0; i < luma; i++) {
+            CHECK(planes[i] == expected);
+        }
+        CHECK(frames_found != 0 || planes[0] == 16);
+        CHECK(frames_found != frames - 1 || planes[0] == 235);
+        for (size_t i = luma; i < frame_size; i++) {
+            CHECK(planes[i] == 128);
+        }
+        
+        frames_found++;
+        offset += 6 + frame_size;
+    }
+    CHECK(frames_found == frames);
+    CHECK(offset == data.size());
+    
+    unlink(path.c_str());
+}
+
+// A recorder that failed to open writes nothing
+static void test_unwritable_path() {
+    FrameRecorder recorder(directory + "/missing/out.y4m", 30);
+    CHECK(!recorder.open(4, 4));
+    std::vector<unsigned char> pixels(4 * 4 * 4, 0);
+    CHECK(!recorder.write_frame(pixels.data()));
+    CHECK(recorder.get_frames_written() == 0);
+}
+
+int main() {
+    char temporary[] = "/tmp/frame_recorder_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    
+    test_y4m_frames();
+    test_unwritable_path();
+    
+    rmdir(directory.c_str());
+    return test_result();
+}
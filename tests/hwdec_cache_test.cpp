@@ -0,0 +1,100 @@
+// HwdecCache: results saved by several instances sharing one cache file
+// are merged rather than overwritten, also when they save concurrently
+#include "test_util.h"
+#include "universal-wallpaper/hwdec_cache.h"
+#include <dirent.h>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::string directory;
+
+static const char* const kDriver = "Mesa / AMD Radeon / 4.6 (Core Profile) Mesa 24.0.5";
+
+static void test_merge() {
+    HwdecCache first;
+    HwdecCache second;
+    CHECK(first.load(kDriver));
+    CHECK(second.load(kDriver));
+    
+    // Each instance probes its own stream; the later save keeps both
+    first.record("h264", "High", 1920, 1080, "vaapi");
+    second.record("hevc", "Main 10", 3840, 2160, "no");
+    CHECK(first.save());
+    CHECK(second.save());
+    CHECK(!second.save());   // Nothing new
+    
+    HwdecCache merged;
+    CHECK(merged.load(kDriver));
+    std::string hwdec;
+    CHECK(merged.lookup("h264", "High", 1920, 1080, hwdec) && hwdec == "vaapi");
+    CHECK(merged.lookup("hevc", "Main 10", 3840, 2160, hwdec) && hwdec == "no");
+    
+    // A result recorded here replaces the one on disk; the others stay
+    first.record("h264", "Main", 1280, 720, "vaapi-copy");
+    second.record("h264", "Main", 1280, 720, "no");
+    CHECK(first.save());
+    CHECK(second.save());
+    CHECK(merged.load(kDriver));
+    CHECK(merged.lookup("h264", "Main", 1280, 720, hwdec) && hwdec == "no");
+    CHECK(merged.lookup("h264", "High", 1920, 1080, hwdec) && hwdec == "vaapi");
+    
+    // Another driver starts from scratch
+    HwdecCache other;
+    CHECK(other.load("NVIDIA 550.78"));
+    CHECK(!other.lookup("h264", "High", 1920, 1080, hwdec));
+}
+
+static void test_concurrent_saves() {
+    const int savers = 8;
+    for (int i = 0; i < savers; i++) {
+        if (fork() == 0) {
+            HwdecCache cache;
+            bool saved = cache.load(kDriver);
+            cache.record("av1", "profile " + std::to_string(i), 1920, 1080, "vaapi");
+            saved = saved && cache.save();
+            _exit(saved ? 0 : 1);
+        }
+    }
+    for (int i = 0; i < savers; i++) {
+        int status = 0;
+        CHECK(wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    
+    HwdecCache cache;
+    CHECK(cache.load(kDriver));
+    std::string hwdec;
+    for (int i = 0; i < savers; i++) {
+        CHECK(cache.lookup("av1", "profile " + std::to_string(i), 1920, 1080, hwdec));
+    }
+    CHECK(cache.lookup("hevc", "Main 10", 3840, 2160, hwdec));
+    
+    // No temporary files left behind
+    std::string cache_dir = directory + "/wallpaper-ne-linux";
+    int files = 0;
+    if (DIR* dir = opendir(cache_dir.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') files++;
+        }
+        closedir(dir);
+    }
+    CHECK(files == 2);   // hwdec.cache and its lock file
+}
+
+int main() {
+    char temporary[] = "/tmp/hwdec_cache_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    setenv("XDG_CACHE_HOME", temporary, 1);
+    
+    test_merge();
+    test_concurrent_saves();
+    
+    std::string cache_dir = directory + "/wallpaper-ne-linux";
+    unlink((cache_dir + "/hwdec.cache").c_str());
+    unlink((cache_dir + "/hwdec.cache.lock").c_str());
+    rmdir(cache_dir.c_str());
+    rmdir(directory.c_str());
+    return test_result();
+}
@@ -0,0 +1,205 @@
+// LavcEngine on generated clips: stills are left to mpv, playback adds
+// exactly one thread, and frames come due at the container rate across
+// loop boundaries of a stream that doesn't start at 0. Rendering needs an
+// EGL context (Mesa's surfaceless platform or llvmpipe); without one the
+// test is skipped.
+#include "test_util.h"
+#include "universal-wallpaper/lavc_engine.h"
+#include "universal-wallpaper/renderer.h"
+#include <dirent.h>
+#include <poll.h>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+static constexpr int kWidth = 64;
+static constexpr int kHeight = 48;
+static constexpr int kFps = 25;
+static constexpr int64_t kFrameUs = 1000000 / kFps;
+
+static std::string directory;
+
+// Raw YUV frames at kFps whose first pts is first_frame frames in
+static bool write_clip(const std::string& path, int frames, int first_frame) {
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
+    AVFormatContext* muxer = nullptr;
+    if (!codec || avformat_alloc_output_context2(&muxer, nullptr, nullptr, path.c_str()) < 0) return false;
+    
+    AVStream* stream = avformat_new_stream(muxer, nullptr);
+    AVCodecContext* encoder = avcodec_alloc_context3(codec);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* packet = av_packet_alloc();
+    bool written = stream && encoder && frame && packet;
+    if (written) {
+        encoder->width = kWidth;
+        encoder->height = kHeight;
+        encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+        encoder->time_base = AVRational{1, kFps};
+        encoder->framerate = AVRational{kFps, 1};
+        stream->time_base = encoder->time_base;
+        frame->format = encoder->pix_fmt;
+        frame->width = kWidth;
+        frame->height = kHeight;
+        written = avcodec_open2(encoder, codec, nullptr) >= 0 &&
+                  avcodec_parameters_from_context(stream->codecpar, encoder) >= 0 &&
+                  av_frame_get_buffer(frame, 0) >= 0 && avio_open(&muxer->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0 &&
+                  avformat_write_header(muxer, nullptr) >= 0;
+    }
+    
+    auto drain = [&]() {
+        while (avcodec_receive_packet(encoder, packet) >= 0) {
+            av_packet_rescale_ts(packet, encoder->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            if (av_interleaved_write_frame(muxer, packet) < 0) written = false;
+        }
+    };
+    for (int i = 0; written && i <= frames; i++) {
+        if (i == frames) {
+            written = avcodec_send_frame(encoder, nullptr) >= 0;  // Flush
+        } else {
+            written = av_frame_make_writable(frame) >= 0;
+            for (int y = 0; written && y < kHeight; y++) {
+                for (int x = 0; x < kWidth; x++) {
+                    frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(16 + i * 8);
+                }
+            }
+            for (int y = 0; written && y < kHeight / 2; y++) {
+                for (int x = 0; x < kWidth / 2; x++) {
+                    frame->data[1][y * frame->linesize[1] + x] = 128;
+                    frame->data[2][y * frame->linesize[2] + x] = 128;
+                }
+            }
+            frame->pts = first_frame + i;
+            written = written && avcodec_send_frame(encoder, frame) >= 0;
+        }
+        if (written) drain();
+    }
+    if (written) {
+        written = av_write_trailer(muxer) >= 0;
+    }
+    
+    if (muxer->pb) avio_closep(&muxer->pb);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&encoder);
+    avformat_free_context(muxer);
+    return written;
+}
+
+static int count_threads() {
+    DIR* tasks = opendir("/proc/self/task");
+    if (!tasks) return -1;
+    int threads = 0;
+    while (dirent* entry = readdir(tasks)) {
+        if (entry->d_name[0] != '.') threads++;
+    }
+    closedir(tasks);
+    return threads;
+}
+
+// Updates the engine until the frame due after a step is decoded
+static bool wait_stepped(LavcEngine& engine) {
+    for (int attempt = 0; attempt < 500; attempt++) {
+        engine.update();
+        if (engine.has_stepped() && engine.has_new_frame()) return true;
+        pollfd wakeup = {engine.get_wakeup_fd(), POLLIN, 0};
+        poll(&wakeup, 1, 10);
+    }
+    return false;
+}
+
+static void test_suitability() {
+    const std::string still = directory + "/still.nut";
+    const std::string clip = directory + "/clip.nut";
+    CHECK(write_clip(still, 1, 0));
+    CHECK(write_clip(clip, 10, 0));
+    
+    CHECK(!LavcEngine::is_suitable(still));
+    CHECK(LavcEngine::is_suitable(clip));
+    CHECK(!LavcEngine::is_suitable(directory + "/missing.nut"));
+    
+    unlink(still.c_str());
+    unlink(clip.c_str());
+}
+
+static void test_playback(Renderer& renderer) {
+    // Ten frames starting at 2 s, as in a clip cut from a longer stream
+    const std::string clip = directory + "/offset.nut";
+    const int frames = 10;
+    CHECK(write_clip(clip, frames, 2 * kFps));
+    
+    Renderer::FramebufferInfo framebuffer = renderer.get_or_create_framebuffer(kWidth, kHeight);
+    CHECK(framebuffer.fbo != 0);
+    renderer.bind_framebuffer(framebuffer);
+    renderer.clear(0.0f, 0.0f, 0.0f, 1.0f);
+    
+    // The driver may start threads of its own on the first draws, so the
+    // engine's are counted as it starts and as it stops
+    int threads = count_threads();
+    {
+        LavcEngine engine(renderer);
+        CHECK(engine.initialize(clip));
+        CHECK(engine.set_clock_step(kFrameUs));
+        
+        // One decode thread; libavcodec's pools stay off
+        CHECK(count_threads() == threads + 1);
+        
+        // Each step of one frame duration brings exactly the next frame due,
+        // also across the loop: the stream start leaves no gap. The first
+        // frame starts the clock.
+        int64_t previous_target = 0;
+        for (int step = 0; step < frames * 3; step++) {
+            if (step > 0) engine.step_clock();
+            if (!wait_stepped(engine)) {
+                CHECK(false);
+                break;
+            }
+            
+            uint64_t flags = 0;
+            int64_t target = 0;
+            engine.get_next_frame_info(flags, target);
+            CHECK(flags != 0);
+            if (step > 0) {
+                CHECK(target == engine.get_time_us());
+            }
+            if (step > 1) {
+                CHECK(target - previous_target == kFrameUs);
+            }
+            previous_target = target;
+            CHECK(engine.render_frame(static_cast<int>(framebuffer.fbo), kWidth, kHeight));
+        }
+        CHECK(engine.is_playing());
+        threads = count_threads();
+        engine.destroy();
+        CHECK(count_threads() == threads - 1);
+    }
+    
+    unlink(clip.c_str());
+}
+
+int main() {
+    char temporary[] = "/tmp/lavc_engine_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    
+    test_suitability();
+    
+    Renderer renderer;
+    if (renderer.initialize() && renderer.create_context(nullptr) && renderer.make_current()) {
+        test_playback(renderer);
+        renderer.destroy();
+    } else {
+        std::fprintf(stderr, "No EGL context, playback not tested\n");
+        rmdir(directory.c_str());
+        return test_failures > 0 ? test_result() : 77;
+    }
+    
+    rmdir(directory.c_str());
+    return test_result();
+}
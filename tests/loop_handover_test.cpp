@@ -0,0 +1,113 @@
+// LoopHandover: when the second engine is prepared and when it takes over,
+// driven by the positions of frames presented at their own rate
+#include "test_util.h"
+#include "universal-wallpaper/loop_handover.h"
+#include <chrono>
+
+using namespace std::chrono_literals;
+using Clock = LoopHandover::Clock;
+using Action = LoopHandover::Action;
+
+static constexpr double kFps = 25.0;
+static constexpr auto kFrame = std::chrono::microseconds(40000);
+
+struct Pass {
+    int prepare_frame = -1;
+    int switch_frame = -1;
+    Clock::time_point switch_time;
+};
+
+// Presents `frames` frames starting at position 0 and records the actions
+static Pass play_pass(LoopHandover& handover, int frames, double duration, Clock::time_point& now) {
+    Pass pass;
+    for (int i = 0; i < frames; i++) {
+        handover.frame_presented(i / kFps, duration, kFps, now);
+        // Actions due before the next frame, as the caller's wait would find them
+        Clock::time_point next = now + kFrame;
+        while (handover.time_until_action(now) <= next - now) {
+            Clock::time_point due = now + handover.time_until_action(now);
+            Action action = handover.update(due);
+            if (action == Action::Prepare) pass.prepare_frame = i;
+            if (action == Action::Switch) {
+                pass.switch_frame = i;
+                pass.switch_time = due;
+                break;
+            }
+        }
+        now = next;
+    }
+    return pass;
+}
+
+static void test_handover() {
+    LoopHandover handover;
+    Clock::time_point now = Clock::time_point() + 1h;
+    
+    // A 10 s loop: prepared 2 s ahead, switched when its last frame is over
+    Clock::time_point last_frame = now + kFrame * 249;
+    Pass pass = play_pass(handover, 250, 10.0, now);
+    CHECK(pass.prepare_frame == 200);
+    CHECK(pass.switch_frame == 249);
+    CHECK(pass.switch_time - last_frame >= kFrame - 1ms && pass.switch_time - last_frame <= kFrame + 1ms);
+    CHECK(handover.get_handovers() == 1);
+    
+    // The prepared engine becomes current once, and the next pass starts over
+    CHECK(handover.take_handover());
+    CHECK(!handover.take_handover());
+    pass = play_pass(handover, 250, 10.0, now);
+    CHECK(pass.prepare_frame == 200);
+    CHECK(pass.switch_frame == 249);
+    CHECK(handover.take_handover());
+    CHECK(handover.get_missed() == 0);
+}
+
+static void test_short_loop() {
+    // Short loops stay with the demuxer cache
+    LoopHandover handover;
+    Clock::time_point now = Clock::time_point() + 1h;
+    Pass pass = play_pass(handover, 100, 4.0, now);
+    CHECK(pass.prepare_frame == -1);
+    CHECK(pass.switch_frame == -1);
+    CHECK(handover.time_until_action(now) == Clock::duration::max());
+}
+
+static void test_engine_looped_first() {
+    LoopHandover handover;
+    Clock::time_point now = Clock::time_point() + 1h;
+    
+    // The last frame is shown, but the engine restarts before the handover
+    for (int i = 0; i < 250; i++) {
+        handover.frame_presented(i / kFps, 10.0, kFps, now);
+        if (handover.update(now) == Action::Switch) CHECK(false);
+        now += kFrame;
+    }
+    handover.frame_presented(0.0, 10.0, kFps, now - 30ms);
+    CHECK(handover.get_missed() == 1);
+    CHECK(!handover.take_handover());
+    
+    // The engine prepared for it takes the next boundary without a new one
+    Pass pass = play_pass(handover, 250, 10.0, now);
+    CHECK(pass.prepare_frame == -1);
+    CHECK(pass.switch_frame == 249);
+}
+
+static void test_reset() {
+    LoopHandover handover;
+    Clock::time_point now = Clock::time_point() + 1h;
+    handover.frame_presented(9.0, 10.0, kFps, now);
+    handover.reset();
+    CHECK(handover.update(now) == Action::None);
+    
+    // Different media: its own pass from the start
+    Pass pass = play_pass(handover, 150, 6.0, now);
+    CHECK(pass.prepare_frame == 100);
+    CHECK(pass.switch_frame == 149);
+}
+
+int main() {
+    test_handover();
+    test_short_loop();
+    test_engine_looped_first();
+    test_reset();
+    return test_result();
+}
@@ -0,0 +1,188 @@
+// MediaSessionRegistry: which outputs share a decoder, when sessions are
+// created and destroyed, and where the audio goes. Engines are stand-ins
+// and the renderer has no context; nothing here draws.
+#include "test_util.h"
+#include "universal-wallpaper/media_session_registry.h"
+#include "universal-wallpaper/renderer.h"
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static std::string directory;
+
+// Remembers what it was opened with; plays nothing
+class FakeEngine : public MediaEngine {
+public:
+    explicit FakeEngine(bool audio) : audio(audio) {}
+    
+    const char* get_engine_name() const override { return "fake"; }
+    bool initialize(const std::string&, bool, bool, bool, double, const std::string&) override { return true; }
+    void destroy() override {}
+    bool create_render_context(void* (*)(void*, const char*), void*) override { return true; }
+    bool render_frame(int, int, int) override { return true; }
+    void report_flip() override {}
+    int get_wakeup_fd() const override { return -1; }
+    uint64_t update() override { return 0; }
+    void process_events() override {}
+    void get_next_frame_info(uint64_t& flags, int64_t& target_time_us) const override {
+        flags = 0;
+        target_time_us = 0;
+    }
+    int64_t get_time_us() const override { return 0; }
+    bool skip_frame() override { return false; }
+    bool has_new_frame() const override { return false; }
+    void mark_frame_rendered() override {}
+    bool has_first_frame() const override { return true; }
+    bool is_playing() const override { return true; }
+    bool has_video() const override { return true; }
+    double get_duration() const override { return 10.0; }
+    double get_position() const override { return 0.0; }
+    double get_container_fps() const override { return 30.0; }
+    void set_audio_enabled(bool) override {}
+    void set_volume_scale(double) override {}
+    void set_paused(bool) override {}
+    void set_prescale_target(int, int, bool) override {}
+    
+    bool audio;
+};
+
+struct Opened {
+    std::string media_path;
+    bool audio;
+};
+
+static std::vector<Opened> opened;
+
+static std::unique_ptr<MediaEngine> open_engine(const std::string& media_path, bool audio) {
+    if (media_path.find("broken") != std::string::npos) return nullptr;
+    opened.push_back({media_path, audio});
+    return std::make_unique<FakeEngine>(audio);
+}
+
+static bool attach_engine(MediaEngine&, bool) {
+    return true;
+}
+
+static std::string path(const char* name) {
+    return directory + "/" + name;
+}
+
+static void test_sharing() {
+    Renderer renderer;
+    MediaSessionRegistry sessions(renderer, open_engine, attach_engine, "--loop", 60, std::chrono::milliseconds(0));
+    opened.clear();
+    
+    // One file under several spellings is one session
+    MediaSession* left = sessions.bind("DP-1", path("a.mp4"));
+    CHECK(left != nullptr);
+    CHECK(sessions.bind("DP-2", directory + "/./a.mp4") == left);
+    CHECK(sessions.bind("DP-3", path("link.mp4")) == left);
+    CHECK(sessions.get_sessions().size() == 1);
+    CHECK(left->outputs == std::vector<std::string>({"DP-1", "DP-2", "DP-3"}));
+    CHECK(opened.size() == 1);
+    
+    // The key is the resolved file plus the playback options
+    CHECK(left->key == path("a.mp4") + "\n--loop");
+    
+    // Binding again to what it already shows changes nothing
+    CHECK(sessions.bind("DP-1", path("link.mp4")) == left);
+    CHECK(left->outputs.size() == 3);
+    
+    // Package entries are part of the key; the package file is resolved
+    MediaSession* scene = sessions.bind("HDMI-1", path("scenes.pkg") + "#one.mp4");
+    MediaSession* other = sessions.bind("HDMI-2", path("scenes.pkg") + "#two.mp4");
+    CHECK(scene != nullptr && other != nullptr && scene != other);
+    CHECK(sessions.bind("HDMI-3", path("link.pkg") + "#one.mp4") == scene);
+    CHECK(sessions.get_sessions().size() == 3);
+    
+    // Each session renders into its own framebuffer slots
+    CHECK(left->framebuffer_slot == 0);
+    CHECK(scene->framebuffer_slot == 4);
+    CHECK(other->framebuffer_slot == 8);
+}
+
+static void test_refcount() {
+    Renderer renderer;
+    MediaSessionRegistry sessions(renderer, open_engine, attach_engine, "", 60, std::chrono::milliseconds(0));
+    opened.clear();
+    
+    MediaSession* a = sessions.bind("DP-1", path("a.mp4"));
+    CHECK(sessions.bind("DP-2", path("a.mp4")) == a);
+    MediaSession* b = sessions.bind("DP-3", path("b.mp4"));
+    CHECK(a != nullptr && b != nullptr);
+    
+    // A session lives while any output shows it
+    sessions.unbind("DP-1");
+    CHECK(sessions.get_sessions().size() == 2);
+    CHECK(sessions.find_output("DP-2") == a);
+    CHECK(sessions.find_output("DP-1") == nullptr);
+    sessions.unbind("DP-1");   // Not bound: no effect
+    CHECK(sessions.get_sessions().size() == 2);
+    
+    // Moving its last output away ends it and frees its slot
+    CHECK(sessions.bind("DP-2", path("b.mp4")) == b);
+    CHECK(sessions.get_sessions().size() == 1);
+    CHECK(b->outputs == std::vector<std::string>({"DP-3", "DP-2"}));
+    MediaSession* c = sessions.bind("DP-1", path("c.mp4"));
+    CHECK(c != nullptr && c->framebuffer_slot == 0);
+    
+    // Media that can't start leaves the output where it was
+    CHECK(sessions.bind("DP-1", path("broken.mp4")) == nullptr);
+    CHECK(sessions.find_output("DP-1") == c);
+    CHECK(sessions.get_sessions().size() == 2);
+    
+    sessions.unbind("DP-1");
+    sessions.unbind("DP-2");
+    sessions.unbind("DP-3");
+    CHECK(sessions.get_sessions().empty());
+}
+
+static void test_audio() {
+    Renderer renderer;
+    MediaSessionRegistry sessions(renderer, open_engine, attach_engine, "", 60, std::chrono::milliseconds(0));
+    opened.clear();
+    
+    // Only the first session plays audio, and its engine opens with it
+    MediaSession* a = sessions.bind("DP-1", path("a.mp4"));
+    MediaSession* b = sessions.bind("DP-2", path("b.mp4"));
+    MediaSession* c = sessions.bind("DP-3", path("c.mp4"));
+    CHECK(a->has_audio && !b->has_audio && !c->has_audio);
+    CHECK(opened.size() == 3 && opened[0].audio && !opened[1].audio && !opened[2].audio);
+    
+    // When it stops, the oldest remaining session takes over
+    sessions.unbind("DP-1");
+    CHECK(b->has_audio && !c->has_audio);
+    
+    // Silent sessions stopping don't move it
+    sessions.unbind("DP-3");
+    CHECK(b->has_audio);
+    
+    // Nor does a new session take it while one has it
+    MediaSession* d = sessions.bind("DP-1", path("a.mp4"));
+    CHECK(d != nullptr && !d->has_audio);
+}
+
+int main() {
+    char temporary[] = "/tmp/media_session_registry_test.XXXXXX";
+    char resolved[PATH_MAX];
+    if (!mkdtemp(temporary) || !realpath(temporary, resolved)) return 1;
+    directory = resolved;   // Keys hold resolved paths
+    for (const char* name : {"a.mp4", "b.mp4", "c.mp4", "scenes.pkg"}) {
+        std::ofstream(path(name)) << "";
+    }
+    CHECK(symlink(path("a.mp4").c_str(), path("link.mp4").c_str()) == 0);
+    CHECK(symlink(path("scenes.pkg").c_str(), path("link.pkg").c_str()) == 0);
+    
+    test_sharing();
+    test_refcount();
+    test_audio();
+    
+    for (const char* name : {"a.mp4", "b.mp4", "c.mp4", "scenes.pkg", "link.mp4", "link.pkg"}) {
+        unlink(path(name).c_str());
+    }
+    rmdir(directory.c_str());
+    return test_result();
+}
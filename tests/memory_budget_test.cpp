@@ -0,0 +1,102 @@
+// MemoryBudget: how the budget is split and how engine shares are drawn
+// from and returned to the media cache and demuxer pools
+#include "test_util.h"
+#include "universal-wallpaper/memory_budget.h"
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static constexpr size_t kMB = 1024 * 1024;
+
+using Share = std::unique_ptr<MemoryBudget::EngineShare>;
+
+static bool share_is(const Share& share, size_t media_cache, size_t demuxer, size_t demuxer_back) {
+    return share->media_cache_bytes == media_cache && share->demuxer_bytes == demuxer &&
+           share->demuxer_back_bytes == demuxer_back;
+}
+
+static void test_split() {
+    MemoryBudget off;
+    CHECK(!off.is_enabled());
+    
+    MemoryBudget budget;
+    budget.configure(1000 * kMB);
+    CHECK(budget.is_enabled());
+    const MemoryBudget::Split& split = budget.get_split();
+    CHECK(split.vram_bytes == 250 * kMB);
+    CHECK(split.media_cache_bytes == 200 * kMB);
+    CHECK(split.demuxer_bytes == 100 * kMB);
+    CHECK(split.demuxer_back_bytes == 50 * kMB);
+    CHECK(split.hwdec_extra_frames == 1);
+    
+    // Small budgets keep minimums; large ones afford a second extra surface
+    MemoryBudget small;
+    small.configure(20 * kMB);
+    CHECK(small.get_split().vram_bytes == 16 * kMB);
+    CHECK(small.get_split().demuxer_bytes == 4 * kMB);
+    CHECK(small.get_split().demuxer_back_bytes == kMB);
+    MemoryBudget large;
+    large.configure(2048 * kMB);
+    CHECK(large.get_split().hwdec_extra_frames == 2);
+}
+
+static void test_shares() {
+    MemoryBudget budget;
+    budget.configure(1000 * kMB);
+    
+    // The two engines of a switch take half of each pool
+    Share current = budget.reserve_engine_share();
+    Share incoming = budget.reserve_engine_share();
+    CHECK(share_is(current, 100 * kMB, 50 * kMB, 25 * kMB));
+    CHECK(share_is(incoming, 100 * kMB, 50 * kMB, 25 * kMB));
+    
+    // A third streams its media; the demuxer keeps its minimum
+    Share third = budget.reserve_engine_share();
+    CHECK(share_is(third, 0, kMB, kMB));
+    
+    // Returned shares go to the next engine
+    current.reset();
+    Share next = budget.reserve_engine_share();
+    CHECK(share_is(next, 100 * kMB, 49 * kMB, 24 * kMB));
+    
+    // With everything returned the pools are whole again
+    incoming.reset();
+    third.reset();
+    next.reset();
+    Share fresh = budget.reserve_engine_share();
+    CHECK(share_is(fresh, 100 * kMB, 50 * kMB, 25 * kMB));
+}
+
+static void test_concurrent_shares() {
+    // Engines open on worker threads; the pools stay consistent
+    MemoryBudget budget;
+    budget.configure(1000 * kMB);
+    Share held = budget.reserve_engine_share();
+    
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 8; i++) {
+        workers.emplace_back([&budget]() {
+            for (int j = 0; j < 1000; j++) {
+                Share share = budget.reserve_engine_share();
+                CHECK(share->media_cache_bytes <= 100 * kMB);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    Share other = budget.reserve_engine_share();
+    CHECK(share_is(other, 100 * kMB, 50 * kMB, 25 * kMB));
+    held.reset();
+    other.reset();
+    CHECK(share_is(budget.reserve_engine_share(), 100 * kMB, 50 * kMB, 25 * kMB));
+}
+
+int main() {
+    test_split();
+    test_shares();
+    test_concurrent_shares();
+    return test_result();
+}
@@ -0,0 +1,59 @@
+// MPVWrapper's render-update signalling against a stub libmpv whose render
+// thread raises update callbacks; built with ThreadSanitizer, which fails
+// the test on any race between the callback and the render loop.
+#include "stub_libmpv.h"
+#include "test_util.h"
+#include "universal-wallpaper/mpv_wrapper.h"
+#include <chrono>
+#include <poll.h>
+
+static void* get_proc_address(void*, const char*) {
+    return nullptr;
+}
+
+int main() {
+    constexpr int kFrames = 500;
+    stub_mpv_set_frames(kFrames);
+    
+    MPVWrapper mpv;
+    CHECK(mpv.initialize("stub.mp4", false, true, true, 0.0));
+    CHECK(!mpv.has_new_frame());
+    CHECK(!mpv.has_first_frame());
+    CHECK(mpv.create_render_context(get_proc_address, nullptr));
+    
+    // The render loop: sleep on the wakeup fd, then update and render
+    // exactly when mpv reports a frame
+    int frames_seen = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+        bool done = stub_mpv_done();
+        pollfd wakeup = {mpv.get_wakeup_fd(), POLLIN, 0};
+        poll(&wakeup, 1, 100);
+        
+        // The video is configured before its first frame is shown
+        mpv.process_events();
+        uint64_t flags = mpv.update();
+        if (flags & MPV_RENDER_UPDATE_FRAME) {
+            frames_seen++;
+            CHECK(mpv.has_new_frame());
+            CHECK(mpv.has_first_frame());
+        }
+        if (mpv.has_new_frame()) {
+            CHECK(mpv.render_frame(0, 64, 64));
+            CHECK(!mpv.has_new_frame());
+        }
+        
+        // Every callback happened before `done` was read, so this pass saw it
+        if (done) break;
+    }
+    
+    // Callbacks coalesce, so frames can be seen fewer times than produced,
+    // but none goes unnoticed: the last one always leads to an update
+    CHECK(stub_mpv_frames_produced() == kFrames);
+    CHECK(frames_seen > 0);
+    CHECK(frames_seen <= kFrames);
+    CHECK(mpv.update() == 0);
+    
+    mpv.destroy();
+    return test_result();
+}
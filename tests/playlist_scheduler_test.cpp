@@ -0,0 +1,188 @@
+// PlaylistScheduler: item order for directories and list files, the
+// Prepare/Switch timing, and shuffled passes
+#include "test_util.h"
+#include "universal-wallpaper/playlist_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = PlaylistScheduler::Clock;
+using Action = PlaylistScheduler::Action;
+
+static std::string directory;
+
+static void touch(const std::string& path, time_t mtime = 0) {
+    std::ofstream(path) << "";
+    if (mtime != 0) {
+        timeval times[2] = {{mtime, 0}, {mtime, 0}};
+        utimes(path.c_str(), times);
+    }
+}
+
+// The items of one pass, following next() from current()
+static std::vector<std::string> pass(PlaylistScheduler& playlist, Clock::time_point& now) {
+    std::vector<std::string> items;
+    for (size_t i = 0; i < playlist.size(); i++) {
+        items.push_back(playlist.current());
+        std::string expected = playlist.next();
+        playlist.skip(now);
+        CHECK(playlist.current() == expected);
+        now += 1s;
+    }
+    return items;
+}
+
+static void test_directory_order() {
+    const std::string media = directory + "/media";
+    mkdir(media.c_str(), 0700);
+    mkdir((media + "/sub.mp4").c_str(), 0700);   // Directories aren't items
+    touch(media + "/b.mp4", 3000);
+    touch(media + "/a.WEBM", 2000);
+    touch(media + "/c.jpg", 1000);
+    touch(media + "/notes.txt");
+    touch(media + "/.hidden.mp4");
+    
+    Clock::time_point now = Clock::time_point() + 1h;
+    PlaylistScheduler by_name;
+    CHECK(by_name.load(media, "", false));
+    CHECK(by_name.size() == 3);
+    CHECK(pass(by_name, now) == std::vector<std::string>({media + "/a.WEBM", media + "/b.mp4", media + "/c.jpg"}));
+    CHECK(by_name.current() == media + "/a.WEBM");   // And around again
+    
+    PlaylistScheduler by_mtime;
+    CHECK(by_mtime.load(media, "mtime", false));
+    CHECK(pass(by_mtime, now) == std::vector<std::string>({media + "/c.jpg", media + "/a.WEBM", media + "/b.mp4"}));
+    
+    // Nothing playable is an error
+    const std::string empty = directory + "/empty";
+    mkdir(empty.c_str(), 0700);
+    PlaylistScheduler none;
+    CHECK(!none.load(empty, "", false));
+    rmdir(empty.c_str());
+}
+
+static void test_list_order() {
+    const std::string media = directory + "/media";
+    const std::string list = directory + "/list.txt";
+    std::ofstream(list) << "# evening\n  media/c.jpg  \n\nmedia/missing.mp4\n" << media << "/a.WEBM\nmedia/b.mp4\r\n";
+    
+    Clock::time_point now = Clock::time_point() + 1h;
+    PlaylistScheduler listed;
+    CHECK(listed.load(list, "", false));
+    CHECK(pass(listed, now) == std::vector<std::string>({media + "/c.jpg", media + "/a.WEBM", media + "/b.mp4"}));
+    
+    PlaylistScheduler by_name;
+    CHECK(by_name.load(list, "name", false));
+    CHECK(by_name.current() == media + "/a.WEBM");
+    unlink(list.c_str());
+}
+
+static void test_timing() {
+    PlaylistScheduler playlist;
+    CHECK(playlist.load(directory + "/media", "", false));
+    playlist.set_interval(60s);
+    
+    Clock::time_point start = Clock::time_point() + 1h;
+    playlist.start(start);
+    CHECK(playlist.time_until_action(start) == 55s);
+    CHECK(playlist.update(start + 54s) == Action::None);
+    CHECK(playlist.update(start + 55s) == Action::Prepare);
+    CHECK(playlist.update(start + 56s) == Action::None);
+    CHECK(playlist.time_until_action(start + 56s) == 4s);
+    
+    // The prepared item is the one switched to
+    std::string prepared = playlist.next();
+    CHECK(playlist.update(start + 60s) == Action::Switch);
+    CHECK(playlist.current() == prepared);
+    CHECK(playlist.time_until_action(start + 60s) == 55s);
+    
+    // Short intervals prepare halfway through
+    playlist.set_interval(6s);
+    playlist.skip(start + 100s);
+    CHECK(playlist.update(start + 102s) == Action::None);
+    CHECK(playlist.update(start + 103s) == Action::Prepare);
+    CHECK(playlist.update(start + 106s) == Action::Switch);
+    
+    // A single item never changes
+    const std::string single = directory + "/single.txt";
+    std::ofstream(single) << "media/b.mp4\n";
+    PlaylistScheduler one;
+    CHECK(one.load(single, "", false));
+    one.start(start);
+    CHECK(one.update(start + 1000s) == Action::None);
+    CHECK(one.time_until_action(start) == Clock::duration::max());
+    unlink(single.c_str());
+}
+
+static void test_shuffle() {
+    const std::string media = directory + "/many";
+    mkdir(media.c_str(), 0700);
+    std::vector<std::string> sorted;
+    for (int i = 0; i < 6; i++) {
+        sorted.push_back(media + "/" + std::to_string(i) + ".mp4");
+        touch(sorted.back());
+    }
+    
+    PlaylistScheduler playlist;
+    CHECK(playlist.load(media, "", true));
+    Clock::time_point now = Clock::time_point() + 1h;
+    
+    // Every pass plays each item once, next() is exact across passes, and
+    // a pass never starts with the item the previous one ended on
+    std::set<std::vector<std::string>> orders;
+    std::string last;
+    for (int i = 0; i < 50; i++) {
+        std::vector<std::string> items = pass(playlist, now);
+        CHECK(items.front() != last);
+        last = items.back();
+        orders.insert(items);
+        std::sort(items.begin(), items.end());
+        CHECK(items == sorted);
+    }
+    CHECK(orders.size() > 1);
+    
+    // With two items that means strict alternation
+    for (int i = 2; i < 6; i++) {
+        unlink(sorted[i].c_str());
+    }
+    PlaylistScheduler two;
+    CHECK(two.load(media, "", true));
+    std::string previous = two.current();
+    for (int i = 0; i < 20; i++) {
+        two.skip(now);
+        CHECK(two.current() != previous);
+        previous = two.current();
+    }
+    
+    unlink(sorted[0].c_str());
+    unlink(sorted[1].c_str());
+    rmdir(media.c_str());
+}
+
+int main() {
+    char temporary[] = "/tmp/playlist_scheduler_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    
+    test_directory_order();
+    test_list_order();
+    test_timing();
+    test_shuffle();
+    
+    const std::string media = directory + "/media";
+    for (const char* name : {"b.mp4", "a.WEBM", "c.jpg", "notes.txt", ".hidden.mp4"}) {
+        unlink((media + "/" + name).c_str());
+    }
+    rmdir((media + "/sub.mp4").c_str());
+    rmdir(media.c_str());
+    rmdir(directory.c_str());
+    return test_result();
+}
@@ -0,0 +1,109 @@
+// SpanLayout: canvas size and per-monitor regions for side-by-side,
+// stacked and uneven layouts, with bezels and canvas scaling
+#include "test_util.h"
+#include "universal-wallpaper/span_layout.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+static Monitor monitor(const char* name, int x, int y, int width, int height) {
+    return Monitor{name, x, y, width, height, 60, false};
+}
+
+// Region of an output in canvas pixels, top down like the monitor layout
+struct Pixels {
+    double x, y, width, height;
+};
+
+static bool region_is(const SpanLayout& layout, size_t index, const char* name, Pixels expected,
+                      int canvas_width, int canvas_height) {
+    const auto& [output, region] = layout.get_regions()[index];
+    auto near = [](double a, double b) { return std::abs(a - b) < 1e-3; };
+    double top = (1.0 - region.v - region.height) * canvas_height;
+    return output == name && near(region.u * canvas_width, expected.x) && near(top, expected.y) &&
+           near(region.width * canvas_width, expected.width) && near(region.height * canvas_height, expected.height);
+}
+
+static void test_side_by_side() {
+    SpanLayout layout;
+    layout.set_bezel(40, 0);
+    CHECK(layout.compute({monitor("DP-2", 1920, 0, 1920, 1080), monitor("DP-1", 0, 0, 1920, 1080)}, 0));
+    
+    // The bezel widens the canvas, so the right monitor starts past it
+    CHECK(layout.get_width() == 3880 && layout.get_height() == 1080);
+    CHECK(layout.get_regions().size() == 2);
+    CHECK(region_is(layout, 0, "DP-2", {1960, 0, 1920, 1080}, 3880, 1080));
+    CHECK(region_is(layout, 1, "DP-1", {0, 0, 1920, 1080}, 3880, 1080));
+}
+
+static void test_stacked() {
+    // Rows run top down on the canvas and bottom up in texture coordinates;
+    // negative positions are moved to the origin
+    SpanLayout layout;
+    layout.set_bezel(0, 30);
+    CHECK(layout.compute({monitor("top", 0, -1440, 2560, 1440), monitor("bottom", 320, 0, 1920, 1080)}, 0));
+    CHECK(layout.get_width() == 2560 && layout.get_height() == 2550);
+    CHECK(region_is(layout, 0, "top", {0, 0, 2560, 1440}, 2560, 2550));
+    CHECK(region_is(layout, 1, "bottom", {320, 1470, 1920, 1080}, 2560, 2550));
+    CHECK(layout.get_regions()[0].second.v > layout.get_regions()[1].second.v);
+}
+
+static void test_uneven() {
+    // A grid of three: two columns, the right one split in two rows
+    SpanLayout layout;
+    layout.set_bezel(20, 10);
+    CHECK(layout.compute({monitor("big", 0, 0, 2560, 1440), monitor("upper", 2560, 0, 1280, 720),
+                          monitor("lower", 2560, 720, 1280, 720)}, 0));
+    CHECK(layout.get_width() == 3860 && layout.get_height() == 1450);
+    CHECK(region_is(layout, 0, "big", {0, 0, 2560, 1440}, 3860, 1450));
+    CHECK(region_is(layout, 1, "upper", {2580, 0, 1280, 720}, 3860, 1450));
+    CHECK(region_is(layout, 2, "lower", {2580, 730, 1280, 720}, 3860, 1450));
+}
+
+static void test_scaling() {
+    std::vector<Monitor> pair = {monitor("DP-1", 0, 0, 3840, 2160), monitor("DP-2", 3840, 0, 3840, 2160)};
+    
+    // The longer side fits max_side; regions are relative and don't move
+    SpanLayout layout;
+    CHECK(layout.compute(pair, 4096));
+    CHECK(layout.get_width() == 4096 && layout.get_height() == 1152);
+    CHECK(region_is(layout, 1, "DP-2", {3840, 0, 3840, 2160}, 7680, 2160));
+    
+    // More than 8K worth of pixels is scaled down to it
+    pair.push_back(monitor("DP-3", 0, 2160, 7680, 4320));
+    CHECK(layout.compute(pair, 16384));
+    long long pixels = static_cast<long long>(layout.get_width()) * layout.get_height();
+    CHECK(pixels <= 7680LL * 4320 && pixels > 7680LL * 4320 * 99 / 100);
+    CHECK(std::abs(static_cast<double>(layout.get_width()) / layout.get_height() - 7680.0 / 6480.0) < 1e-3);
+    
+    // max_side 0 keeps the full size
+    CHECK(layout.compute(pair, 0));
+    CHECK(layout.get_width() == 7680 && layout.get_height() == 6480);
+}
+
+static void test_changes() {
+    std::vector<Monitor> monitors = {monitor("DP-1", 0, 0, 1920, 1080), monitor("DP-2", 1920, 0, 1920, 1080)};
+    SpanLayout layout;
+    CHECK(layout.compute(monitors, 0));
+    CHECK(!layout.compute(monitors, 0));      // Same layout again
+    CHECK(layout.compute(monitors, 1920));    // Canvas scaled
+    CHECK(!layout.compute(monitors, 1920));
+    
+    monitors[1].y = 100;                      // A region moved
+    CHECK(layout.compute(monitors, 1920));
+    monitors[1].name = "HDMI-1";              // Another output
+    CHECK(layout.compute(monitors, 1920));
+    
+    CHECK(layout.compute({}, 1920));          // Monitors gone
+    CHECK(layout.empty());
+    CHECK(!layout.compute({}, 1920));
+}
+
+int main() {
+    test_side_by_side();
+    test_stacked();
+    test_uneven();
+    test_scaling();
+    test_changes();
+    return test_result();
+}
@@ -0,0 +1,92 @@
+// SpectrumFft against a direct DFT of the same windowed samples, for every
+// butterfly backend this machine can run
+#include "test_util.h"
+#include "universal-wallpaper/spectrum_fft.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using Backend = SpectrumFft::Backend;
+
+static const double kPi = 3.14159265358979323846;
+
+// |X[k]|^2 of the Hann-windowed samples, summed term by term in double
+static std::vector<double> naive_power(const std::vector<float>& samples) {
+    const size_t size = samples.size();
+    std::vector<double> power(size / 2);
+    for (size_t k = 0; k < size / 2; k++) {
+        double re = 0.0;
+        double im = 0.0;
+        for (size_t n = 0; n < size; n++) {
+            double window = 0.5 - 0.5 * std::cos(2.0 * kPi * n / (size - 1));
+            double angle = -2.0 * kPi * static_cast<double>(k * n % size) / size;
+            re += samples[n] * window * std::cos(angle);
+            im += samples[n] * window * std::sin(angle);
+        }
+        power[k] = re * re + im * im;
+    }
+    return power;
+}
+
+// Sines at the given bins, each quieter than the one before (fractional
+// bins leak into their neighbours)
+static std::vector<float> sines(size_t size, std::initializer_list<double> bins) {
+    std::vector<float> samples(size, 0.0f);
+    double amplitude = 0.5;
+    double phase = 0.3;
+    for (double bin : bins) {
+        for (size_t n = 0; n < size; n++) {
+            samples[n] += static_cast<float>(amplitude * std::sin(2.0 * kPi * bin * n / size + phase));
+        }
+        amplitude *= 0.6;
+        phase += 1.1;
+    }
+    return samples;
+}
+
+static void check_backend(Backend backend, const char* name) {
+    for (size_t size : {16, 64, 512, 1024}) {
+        SpectrumFft fft(size, backend);
+        if (std::strcmp(fft.get_backend_name(), name) != 0) {
+            std::fprintf(stderr, "%s not available, skipped\n", name);
+            return;
+        }
+        
+        for (const std::vector<float>& samples : {sines(size, {size / 8.0}), sines(size, {3.0, size / 4.0 + 0.37}),
+                                                  sines(size, {5.0, 1.5, size / 2.0 - 2.0})}) {
+            std::vector<float> power(size / 2);
+            fft.compute(samples.data(), power.data());
+            std::vector<double> expected = naive_power(samples);
+            
+            // Single precision: errors relative to the strongest bin
+            double peak = *std::max_element(expected.begin(), expected.end());
+            double worst = 0.0;
+            for (size_t k = 0; k < size / 2; k++) {
+                worst = std::max(worst, std::abs(power[k] - expected[k]) / peak);
+            }
+            if (worst > 1e-4) {
+                std::fprintf(stderr, "%s, size %zu: error %g of the peak\n", name, size, worst);
+            }
+            CHECK(worst <= 1e-4);
+            
+            // The peak lands on the same bin
+            size_t loudest = std::max_element(power.begin(), power.end()) - power.begin();
+            CHECK(loudest == static_cast<size_t>(std::max_element(expected.begin(), expected.end()) - expected.begin()));
+        }
+    }
+}
+
+int main() {
+    check_backend(Backend::Scalar, "scalar");
+    check_backend(Backend::SSE2, "SSE2");
+    check_backend(Backend::AVX2, "AVX2");
+    check_backend(Backend::NEON, "NEON");
+    
+    // Auto picks one of them
+    SpectrumFft fft(64);
+    const char* name = fft.get_backend_name();
+    CHECK(!std::strcmp(name, "scalar") || !std::strcmp(name, "SSE2") || !std::strcmp(name, "AVX2") ||
+          !std::strcmp(name, "NEON"));
+    return test_result();
+}
@@ -0,0 +1,181 @@
+// Just enough of libmpv for MPVWrapper: no decoding or rendering, but a
+// render thread that raises update callbacks the way mpv's does, so the
+// wrapper's cross-thread signalling runs under ThreadSanitizer.
+#include "stub_libmpv.h"
+#include <mpv/client.h>
+#include <mpv/render.h>
+#include <mpv/render_gl.h>
+#include <mpv/stream_cb.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+struct mpv_handle {
+    mpv_event event{};
+    bool reconfig_pending = false;
+};
+
+struct mpv_render_context {
+    mpv_render_update_fn callback = nullptr;
+    void* callback_ctx = nullptr;
+    std::atomic<uint64_t> frames_pending{0};
+    std::thread thread;
+};
+
+static std::atomic<int> stub_frames{0};
+static std::atomic<int> stub_frames_produced{0};
+static std::atomic<bool> stub_done{false};
+
+void stub_mpv_set_frames(int frames) {
+    stub_frames = frames;
+    stub_frames_produced = 0;
+    stub_done = false;
+}
+
+int stub_mpv_frames_produced() {
+    return stub_frames_produced;
+}
+
+bool stub_mpv_done() {
+    return stub_done;
+}
+
+extern "C" {
+
+const char* mpv_error_string(int error) {
+    return error < 0 ? "error" : "success";
+}
+
+void mpv_free(void* data) {
+    (void)data;
+}
+
+mpv_handle* mpv_create(void) {
+    return new mpv_handle;
+}
+
+int mpv_initialize(mpv_handle* ctx) {
+    // The video comes up right after the file loads
+    ctx->reconfig_pending = true;
+    return 0;
+}
+
+void mpv_terminate_destroy(mpv_handle* ctx) {
+    delete ctx;
+}
+
+void mpv_free_node_contents(mpv_node* node) {
+    (void)node;
+}
+
+int mpv_set_option_string(mpv_handle*, const char*, const char*) {
+    return 0;
+}
+
+int mpv_command(mpv_handle*, const char**) {
+    return 0;
+}
+
+int mpv_command_node_async(mpv_handle*, uint64_t, mpv_node*) {
+    return MPV_ERROR_NOT_IMPLEMENTED;
+}
+
+void mpv_abort_async_command(mpv_handle*, uint64_t) {
+}
+
+int mpv_set_property_string(mpv_handle*, const char*, const char*) {
+    return 0;
+}
+
+int mpv_set_property_async(mpv_handle*, uint64_t, const char*, mpv_format, void*) {
+    return MPV_ERROR_NOT_IMPLEMENTED;
+}
+
+int mpv_get_property(mpv_handle*, const char*, mpv_format, void*) {
+    return MPV_ERROR_PROPERTY_UNAVAILABLE;
+}
+
+char* mpv_get_property_string(mpv_handle*, const char*) {
+    return nullptr;
+}
+
+int mpv_observe_property(mpv_handle*, uint64_t, const char*, mpv_format) {
+    return 0;
+}
+
+mpv_event* mpv_wait_event(mpv_handle* ctx, double timeout) {
+    (void)timeout;
+    ctx->event = mpv_event{};
+    if (ctx->reconfig_pending) {
+        ctx->reconfig_pending = false;
+        ctx->event.event_id = MPV_EVENT_VIDEO_RECONFIG;
+    }
+    return &ctx->event;
+}
+
+int64_t mpv_get_time_us(mpv_handle*) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void mpv_set_wakeup_callback(mpv_handle*, void (*)(void*), void*) {
+}
+
+int mpv_hook_add(mpv_handle*, uint64_t, const char*, int) {
+    return 0;
+}
+
+int mpv_hook_continue(mpv_handle*, uint64_t) {
+    return 0;
+}
+
+int mpv_stream_cb_add_ro(mpv_handle*, const char*, void*, mpv_stream_cb_open_ro_fn) {
+    return 0;
+}
+
+int mpv_render_context_create(mpv_render_context** res, mpv_handle*, mpv_render_param*) {
+    *res = new mpv_render_context;
+    return 0;
+}
+
+void mpv_render_context_set_update_callback(mpv_render_context* ctx, mpv_render_update_fn callback,
+                                            void* callback_ctx) {
+    ctx->callback = callback;
+    ctx->callback_ctx = callback_ctx;
+    
+    // mpv's render thread: a frame now and then, each announced through the
+    // callback, which may not call back into mpv
+    ctx->thread = std::thread([ctx]() {
+        for (int i = 0; i < stub_frames; i++) {
+            ctx->frames_pending++;
+            stub_frames_produced++;
+            ctx->callback(ctx->callback_ctx);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        stub_done = true;
+    });
+}
+
+uint64_t mpv_render_context_update(mpv_render_context* ctx) {
+    return ctx->frames_pending.exchange(0) > 0 ? MPV_RENDER_UPDATE_FRAME : 0;
+}
+
+int mpv_render_context_get_info(mpv_render_context*, mpv_render_param) {
+    return MPV_ERROR_NOT_IMPLEMENTED;
+}
+
+int mpv_render_context_render(mpv_render_context*, mpv_render_param*) {
+    return 0;
+}
+
+void mpv_render_context_report_swap(mpv_render_context*) {
+}
+
+void mpv_render_context_free(mpv_render_context* ctx) {
+    if (ctx->thread.joinable()) {
+        ctx->thread.join();
+    }
+    delete ctx;
+}
+
+}
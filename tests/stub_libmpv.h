@@ -0,0 +1,8 @@
+#pragma once
+
+// Frames the stub's render thread announces after the render context is
+// created; set before creating it
+void stub_mpv_set_frames(int frames);
+int stub_mpv_frames_produced();
+// Whether the last frame's callback has returned
+bool stub_mpv_done();
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the unit tests; a failed check fails the test binary
+// at exit but lets the remaining checks run
+inline int test_failures = 0;
+
+#define CHECK(condition)                                                                 \
+    do {                                                                                 \
+        if (!(condition)) {                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                             \
+        }                                                                                \
+    } while (false)
+
+inline int test_result() {
+    if (test_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", test_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Upload throughput of CPU-produced frames: synchronous glTexSubImage2D
+// against the TextureUploader's PBO ring, in RGBA and BGRA, on whatever EGL
+// context is available (llvmpipe on machines without a GPU). Each path is
+// also read back and compared, so the run fails if a path corrupts frames.
+// Throughput is printed only; Debug builds run under ASan, so compare
+// numbers from Release builds. Without an EGL context the run is skipped.
+//
+//   texture_upload_bench [FRAMES [WIDTH HEIGHT]]
+#include "test_util.h"
+#include "universal-wallpaper/renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static int frames = 120;
+static int width = 1920;
+static int height = 1080;
+
+// Frame i in the given byte order; every frame differs from the previous
+static void fill_frame(std::vector<unsigned char>& pixels, int frame, PixelFormat format) {
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = pixels.data() + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            unsigned char r = static_cast<unsigned char>(x + frame);
+            unsigned char g = static_cast<unsigned char>(y * 3 + frame);
+            unsigned char b = static_cast<unsigned char>((x ^ y) + frame * 7);
+            row[x * 4 + 0] = format == PixelFormat::BGRA8 ? b : r;
+            row[x * 4 + 1] = g;
+            row[x * 4 + 2] = format == PixelFormat::BGRA8 ? r : b;
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+// The texture holds the last frame, rows in upload order
+static bool matches_last_frame(Renderer& renderer, GLuint texture) {
+    std::vector<unsigned char> expected(static_cast<size_t>(width) * height * 4);
+    std::vector<unsigned char> actual(expected.size());
+    fill_frame(expected, frames - 1, PixelFormat::RGBA8);
+    return renderer.read_texture_rgba(texture, width, height, actual.data()) && actual == expected;
+}
+
+static void report(const char* path, std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double megabytes = static_cast<double>(width) * height * 4 * frames / (1024.0 * 1024.0);
+    std::printf("%-16s %8.0f MB/s  %6.2f ms/frame\n", path, megabytes / seconds, seconds * 1000.0 / frames);
+}
+
+// Frames are generated up front so only the uploads are timed; glFinish
+// makes the last upload count in full
+static void bench(Renderer& renderer, const char* path, PixelFormat format, bool direct) {
+    std::vector<std::vector<unsigned char>> sources(2, std::vector<unsigned char>(static_cast<size_t>(width) * height * 4));
+    fill_frame(sources[0], frames - 2, format);
+    fill_frame(sources[1], frames - 1, format);
+    
+    GLuint texture = renderer.create_texture(width, height);
+    CHECK(texture != 0);
+    glFinish();
+    
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        const unsigned char* pixels = sources[(i + frames) % 2].data();
+        if (direct) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        } else {
+            renderer.update_texture(texture, width, height, pixels, width * 4, format);
+        }
+    }
+    glFinish();
+    report(path, std::chrono::steady_clock::now() - start);
+    
+    if (!matches_last_frame(renderer, texture)) {
+        std::fprintf(stderr, "%s: texture contents differ from the uploaded frame\n", path);
+        CHECK(false);
+    }
+    renderer.destroy_texture(texture);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) frames = std::max(2, std::atoi(argv[1]));
+    if (argc > 3) {
+        width = std::max(1, std::atoi(argv[2]));
+        height = std::max(1, std::atoi(argv[3]));
+    }
+    
+    Renderer renderer;
+    if (!renderer.initialize() || !renderer.create_context(nullptr) || !renderer.make_current()) {
+        std::fprintf(stderr, "No EGL context, uploads not measured\n");
+        return 77;
+    }
+    
+    std::printf("%s\n%d frames of %dx%d\n", renderer.get_driver_description().c_str(), frames, width, height);
+    bench(renderer, "direct RGBA", PixelFormat::RGBA8, true);
+    bench(renderer, "uploader RGBA", PixelFormat::RGBA8, false);
+    bench(renderer, "uploader BGRA", PixelFormat::BGRA8, false);
+    
+    const TextureUploader& uploader = renderer.get_uploader();
+    const TextureUploader::Stats& stats = uploader.get_stats();
+    std::printf("uploader: %s buffers, %llu uploads, %llu fence waits, %llu reallocations\n",
+                uploader.is_persistent() ? "persistent" : "orphaned",
+                static_cast<unsigned long long>(stats.uploads), static_cast<unsigned long long>(stats.fence_waits),
+                static_cast<unsigned long long>(stats.reallocations));
+    
+    renderer.destroy();
+    return test_result();
+}
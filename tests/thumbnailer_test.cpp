@@ -0,0 +1,123 @@
+// Thumbnailer's cache key: content-addressed, so renamed, copied and
+// packaged copies of a file share a thumbnail while files that differ in
+// either end, in size or in thumbnail settings don't
+#include "test_util.h"
+#include "universal-wallpaper/thumbnailer.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static std::string directory;
+
+static std::vector<char> content(size_t size) {
+    std::vector<char> bytes(size);
+    uint32_t state = 12345;
+    for (char& byte : bytes) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<char>(state >> 24);
+    }
+    return bytes;
+}
+
+static std::string write(const std::string& name, const std::vector<char>& bytes) {
+    std::string path = directory + "/" + name;
+    std::ofstream(path, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return path;
+}
+
+// A package holding `bytes` as its only entry
+static std::string write_package(const std::string& name, const std::string& entry, const std::vector<char>& bytes) {
+    std::vector<char> package;
+    auto u32 = [&package](uint32_t value) {
+        for (int i = 0; i < 4; i++) package.push_back(static_cast<char>(value >> (8 * i)));
+    };
+    auto text = [&package, &u32](const std::string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        package.insert(package.end(), value.begin(), value.end());
+    };
+    text("PKGV0001");
+    u32(1);
+    text(entry);
+    u32(0);
+    u32(static_cast<uint32_t>(bytes.size()));
+    package.insert(package.end(), bytes.begin(), bytes.end());
+    return write(name, package);
+}
+
+static std::string key(const Thumbnailer& thumbnailer, const std::string& input) {
+    std::string path;
+    return thumbnailer.cache_path(input, path) ? path : std::string();
+}
+
+static void test_same_content() {
+    Thumbnailer thumbnailer(directory + "/cache", 256, "png");
+    std::vector<char> bytes = content(300 * 1024);
+    
+    std::string original = key(thumbnailer, write("original.mp4", bytes));
+    CHECK(!original.empty());
+    CHECK(original.compare(0, directory.size() + 7, directory + "/cache/") == 0);
+    CHECK(original.size() > 4 && original.compare(original.size() - 4, 4, ".png") == 0);
+    
+    // Names and places don't matter; neither does being in a package
+    mkdir((directory + "/copies").c_str(), 0700);
+    CHECK(key(thumbnailer, write("renamed.webm", bytes)) == original);
+    CHECK(key(thumbnailer, write("copies/original.mp4", bytes)) == original);
+    CHECK(key(thumbnailer, write_package("scene.pkg", "video.mp4", bytes) + "#video.mp4") == original);
+    
+    // The settings do
+    Thumbnailer larger(directory + "/cache", 512, "png");
+    CHECK(key(larger, directory + "/original.mp4") != original);
+}
+
+static void test_different_content() {
+    Thumbnailer thumbnailer(directory + "/cache", 256, "png");
+    
+    // A byte changed at either end, or the size, changes the key
+    for (size_t size : {1000, 100 * 1024, 300 * 1024}) {
+        std::vector<char> bytes = content(size);
+        std::string original = key(thumbnailer, write("a.mp4", bytes));
+        
+        std::vector<char> first = bytes;
+        first[10] ^= 1;
+        CHECK(key(thumbnailer, write("b.mp4", first)) != original);
+        
+        std::vector<char> last = bytes;
+        last[size - 10] ^= 1;
+        CHECK(key(thumbnailer, write("b.mp4", last)) != original);
+        
+        std::vector<char> longer = bytes;
+        longer.push_back(0);
+        CHECK(key(thumbnailer, write("b.mp4", longer)) != original);
+    }
+    
+    // Only the ends are read: a change in the middle of a large file keeps it
+    std::vector<char> bytes = content(300 * 1024);
+    std::string original = key(thumbnailer, write("a.mp4", bytes));
+    bytes[150 * 1024] ^= 1;
+    CHECK(key(thumbnailer, write("b.mp4", bytes)) == original);
+    
+    // Nothing to read, nothing to key
+    CHECK(key(thumbnailer, directory + "/missing.mp4").empty());
+    CHECK(key(thumbnailer, directory + "/copies").empty());
+    CHECK(key(thumbnailer, directory + "/scene.pkg#missing.mp4").empty());
+}
+
+int main() {
+    char temporary[] = "/tmp/thumbnailer_test.XXXXXX";
+    if (!mkdtemp(temporary)) return 1;
+    directory = temporary;
+    
+    test_same_content();
+    test_different_content();
+    
+    for (const char* name : {"original.mp4", "renamed.webm", "copies/original.mp4", "scene.pkg", "a.mp4", "b.mp4"}) {
+        unlink((directory + "/" + name).c_str());
+    }
+    rmdir((directory + "/copies").c_str());
+    rmdir(directory.c_str());
+    return test_result();
+}